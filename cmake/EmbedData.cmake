@@ -0,0 +1,58 @@
+# Generate a C source file embedding data files as constant arrays
+#
+# Usage:
+#   cmake -DDATA_DIRECTORY=<dir> [-DGENERATED_DIRECTORY=<dir>] \
+#         -DFILES=<a|b|c> -DOUTPUT=<file.c> -P EmbedData.cmake
+#
+# FILES lists the embedded files, relative to DATA_DIRECTORY and separated by
+# '|'. Files missing from DATA_DIRECTORY are read from GENERATED_DIRECTORY
+# (files computed at build time). The generated file defines the
+# embeddedAssets table declared in assets.h (an empty table if FILES is
+# empty).
+
+string(REGEX REPLACE "^\\|+|\\|+$" "" files "${FILES}")
+string(REPLACE "|" ";" files "${files}")
+
+# 16 bytes per line (no {n} repetition in CMake regular expressions)
+set(line "")
+foreach(i RANGE 15)
+  set(line "${line}0x[0-9a-f][0-9a-f],")
+endforeach()
+
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(name IN LISTS files)
+  if(EXISTS "${DATA_DIRECTORY}/${name}")
+    file(READ "${DATA_DIRECTORY}/${name}" content HEX)
+  else()
+    file(READ "${GENERATED_DIRECTORY}/${name}" content HEX)
+  endif()
+  string(LENGTH "${content}" length)
+  math(EXPR size "${length} / 2")
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${content}")
+  string(REGEX REPLACE "(${line})" "\\1\n  " bytes "${bytes}")
+  # Zero added after the content (text files usable as C strings)
+  string(CONCAT arrays "${arrays}/* ${name} */\n"
+    "static const unsigned char asset${index}[${size} + 1] = {\n"
+    "  ${bytes}0x00};\n\n")
+  set(table "${table}  {\"${name}\", asset${index}, ${size}},\n")
+  math(EXPR index "${index} + 1")
+endforeach()
+
+if(index EQUAL 0)
+  set(table "  {NULL, NULL, 0},\n")
+endif()
+
+file(WRITE "${OUTPUT}.tmp"
+  "/* Generated by cmake/EmbedData.cmake from the data directory: do not edit */\n\n"
+  "#include <stddef.h>\n\n"
+  "#include \"assets.h\"\n\n"
+  "${arrays}"
+  "const Asset embeddedAssets[] = {\n${table}};\n\n"
+  "const int embeddedAssetsCount = ${index};\n")
+
+# Unchanged output is not rewritten (no rebuild of the executable)
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different
+  "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,108 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <SDL2/SDL.h>
+
+/**
+ * Fichiers du dossier de données (packs, decks, index, menus, police)
+ * intégrés à l'exécutable lors de la compilation (cmake/EmbedData.cmake,
+ * option CMake DOBBLE_EMBED_DATA) : le jeu démarre sans ouvrir de fichier,
+ * depuis n'importe quel dossier, et les données en lecture seule sont
+ * partagées entre les instances du programme.
+ *
+ * Les fichiers sont désignés par leur nom relatif au dossier de données
+ * (ex. "menus.ui", "FONTS/Roboto-Medium.ttf"). Un fichier du même nom dans le
+ * dossier de données sur disque remplace le fichier intégré : le dossier
+ * choisi par l'option --data, sinon DATA_DIRECTORY s'il existe ; seuls les
+ * fichiers absents du dossier sont lus dans l'exécutable.
+ */
+
+/**
+ * Fichier intégré à l'exécutable (données suivies d'un zéro).
+ */
+typedef struct {
+  const char *name;
+  const unsigned char *data;
+  size_t size;
+} Asset;
+
+/* Table des fichiers intégrés, générée lors de la compilation */
+extern const Asset embeddedAssets[];
+extern const int embeddedAssetsCount;
+
+/**
+ * Choisit le dossier de données sur disque, dont les fichiers remplacent les
+ * fichiers intégrés.
+ *
+ * @param directory Le dossier, NULL pour n'utiliser que les fichiers intégrés
+ */
+void assetsSetDirectory(const char *directory);
+
+/**
+ * Retourne le dossier de données sur disque : celui choisi par
+ * assetsSetDirectory, sinon DATA_DIRECTORY s'il existe ou s'il n'y a pas de
+ * fichiers intégrés.
+ *
+ * @return Le dossier, NULL si seuls les fichiers intégrés sont utilisés
+ */
+const char *assetsDirectory();
+
+/**
+ * Construit le chemin d'accès d'un fichier dans le dossier de données sur
+ * disque (pour l'écriture des fichiers générés).
+ *
+ * @param  name Le nom du fichier
+ * @param  path Le chemin d'accès construit
+ * @param  size La taille de path
+ * @return      true si le chemin a été construit, false sans dossier sur disque
+ */
+bool assetPath(const char *name, char *path, size_t size);
+
+/**
+ * Indique si un fichier existe, sur disque ou intégré.
+ *
+ * @param  name  Le nom du fichier
+ * @param  mtime La date de modification du fichier sur disque (0 pour un
+ *               fichier intégré), peut être NULL
+ * @return       true si le fichier existe
+ */
+bool assetExists(const char *name, time_t *mtime);
+
+/**
+ * Ouvre un fichier en lecture, sur disque ou à défaut intégré (lu en mémoire,
+ * sans copie).
+ *
+ * @param  name Le nom du fichier
+ * @param  mode "r" ou "rb"
+ * @return      Le fichier, NULL s'il n'existe pas
+ */
+FILE *assetOpen(const char *name, const char *mode);
+
+/**
+ * Ouvre un fichier en lecture pour la SDL (images, polices), sur disque ou à
+ * défaut intégré.
+ *
+ * @param  name Le nom du fichier
+ * @return      Le flux, NULL si le fichier n'existe pas
+ */
+SDL_RWops *assetOpenRW(const char *name);
+
+/**
+ * Retourne le nombre de fichiers intégrés.
+ */
+int assetsCount();
+
+/**
+ * Retourne le nom d'un fichier intégré.
+ *
+ * @param  index L'indice du fichier (de 0 à assetsCount() - 1)
+ * @return       Le nom du fichier
+ */
+const char *assetsName(int index);
+
+#endif /*ASSETS_H*/
@@ -0,0 +1,191 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+/* Nombre maximal de packs d'icônes résidents en même temps */
+#define ATLAS_MAX_PACKS 8
+
+/* Côté de la grille décrivant la forme d'une icône */
+#define ICON_SHAPE_GRID 4
+
+/**
+ * Descripteur visuel d'une icône, calculé au chargement de son pack : couleur
+ * moyenne et répartition de l'opacité dans la case de l'icône.
+ */
+typedef struct {
+  float color[3]; // couleur moyenne des pixels opaques (entre 0 et 1)
+  float coverage; // part de la case couverte par l'icône (entre 0 et 1)
+  float shape[ICON_SHAPE_GRID * ICON_SHAPE_GRID]; // opacité moyenne par zone
+} IconDescriptor;
+
+/**
+ * Gestionnaire des matrices d'icônes (atlas) : plusieurs packs peuvent être
+ * résidents en même temps, dans la limite d'un budget de mémoire de texture.
+ * Chaque pack est compté par référence ; les packs qui ne sont plus référencés
+ * restent en cache et sont libérés du moins récemment utilisé au plus récent
+ * lorsque le budget est dépassé.
+ *
+ * Le jeu d'icônes courant est une liste de packs : les identifiants d'icônes
+ * sont numérotés à la suite d'un pack à l'autre, ce qui permet à un deck de
+ * mélanger les icônes de plusieurs packs.
+ */
+
+/**
+ * Initialise le gestionnaire d'atlas.
+ *
+ * @param renderer Le renderer utilisé pour créer les textures
+ * @param budget   Le budget de mémoire de texture (en octets)
+ */
+void atlasInit(SDL_Renderer *renderer, size_t budget);
+
+/**
+ * Demande la conservation en mémoire des niveaux de mipmap des packs chargés
+ * par la suite (voir atlasPixels), comptée dans le budget de mémoire de
+ * texture.
+ *
+ * @param keep true pour conserver les niveaux en mémoire
+ */
+void atlasKeepPixels(bool keep);
+
+/**
+ * Modifie le budget de mémoire de texture. Les packs non référencés sont
+ * libérés si nécessaire.
+ *
+ * @param budget Le budget de mémoire de texture (en octets)
+ */
+void atlasSetBudget(size_t budget);
+
+/**
+ * Retourne un pack résident, en le chargeant depuis le disque si nécessaire,
+ * et incrémente son compteur de références.
+ *
+ * @param  fileName Nom de l'image du pack (voir assets.h)
+ * @param  nbIcons  Nombre d'icônes du pack (0 : toutes les cases de l'image)
+ * @return          L'identifiant du pack, -1 en cas d'échec
+ */
+int atlasAcquire(const char *fileName, int nbIcons);
+
+/**
+ * Recharge depuis le disque l'image d'un pack résident (image modifiée), sans
+ * changer son identifiant ni ses références.
+ *
+ * @param  fileName Nom de l'image du pack (voir assets.h)
+ * @param  nbIcons  Nombre d'icônes du pack (0 : toutes les cases de l'image)
+ * @return          1 si le pack était résident et a été rechargé, 0 sinon
+ */
+int atlasReload(const char *fileName, int nbIcons);
+
+/**
+ * Décrémente le compteur de références d'un pack. Le pack reste en cache
+ * jusqu'à ce que le budget de mémoire impose sa libération.
+ *
+ * @param atlas L'identifiant du pack
+ */
+void atlasRelease(int atlas);
+
+/**
+ * Remplace le jeu d'icônes courant par les packs donnés, dans l'ordre : les
+ * icônes du premier pack ont les premiers identifiants, etc. Les packs du jeu
+ * précédent qui ne sont pas réutilisés sont relâchés.
+ *
+ * @param  fileNames Noms des images des packs (voir assets.h)
+ * @param  nbIcons   Nombre d'icônes de chaque pack (NULL : toutes les cases)
+ * @param  count     Nombre de packs (au plus ATLAS_MAX_PACKS)
+ * @return           1 si tous les packs ont été chargés, 0 sinon (le jeu
+ *                   d'icônes courant est alors inchangé)
+ */
+int atlasUseSet(const char *const *fileNames, const int *nbIcons, int count);
+
+/**
+ * Décode en arrière-plan les images de packs qui seront chargés par la suite
+ * (atlasUseSet, atlasAcquire) : il ne reste alors au chargement qu'à calculer
+ * les niveaux de mipmap et à créer les textures. Les packs déjà résidents
+ * sont ignorés, et les images d'une demande précédente non utilisées sont
+ * libérées.
+ *
+ * @param  fileNames Noms des images des packs (voir assets.h)
+ * @param  count     Nombre de packs (au plus ATLAS_MAX_PACKS)
+ * @param  ready     Fonction appelée depuis le thread de décodage une fois
+ *                   toutes les images décodées (NULL si aucune)
+ * @param  param     Paramètre passé à ready
+ * @return           1 si le décodage est lancé, 0 sinon (les images seront
+ *                   décodées au chargement des packs, et ready n'est pas
+ *                   appelée)
+ */
+int atlasPrefetch(const char *const *fileNames, int count,
+                  void (*ready)(void *), void *param);
+
+/**
+ * Retourne le nombre d'icônes du jeu d'icônes courant.
+ */
+int atlasIconCount();
+
+/**
+ * Cherche une icône du jeu d'icônes courant.
+ *
+ * @param  iconId L'identifiant de l'icône dans le jeu d'icônes
+ * @param  posX   Abscisse de l'icône dans la matrice de son pack (en pixels)
+ * @param  posY   Ordonnée de l'icône dans la matrice de son pack (en pixels)
+ * @return        L'identifiant du pack contenant l'icône, -1 si l'icône
+ *                n'existe pas
+ */
+int atlasLocateIcon(int iconId, int *posX, int *posY);
+
+/**
+ * Retourne le descripteur visuel d'une icône du jeu d'icônes courant.
+ *
+ * @param  iconId     L'identifiant de l'icône dans le jeu d'icônes
+ * @param  descriptor Le descripteur à remplir
+ * @return            1 si l'icône existe et que son descripteur a pu être
+ *                    calculé, 0 sinon
+ */
+int atlasIconDescriptor(int iconId, IconDescriptor *descriptor);
+
+/**
+ * Retourne la texture d'un pack adaptée à une taille de dessin : le plus petit
+ * niveau de mipmap dont les icônes sont au moins aussi grandes.
+ *
+ * @param  atlas    L'identifiant du pack
+ * @param  drawSize La taille de l'icône à l'écran (en pixels)
+ * @param  iconSize La taille d'une icône dans la texture retournée
+ * @return          La texture, NULL si le pack n'est pas résident
+ */
+SDL_Texture *atlasTexture(int atlas, int drawSize, int *iconSize);
+
+/**
+ * Retourne la copie en mémoire (format RGBA32) du niveau de mipmap d'un pack
+ * adapté à une taille de dessin, choisi comme par atlasTexture.
+ *
+ * @param  atlas    L'identifiant du pack
+ * @param  drawSize La taille de l'icône à l'écran (en pixels)
+ * @param  iconSize La taille d'une icône dans le niveau retourné
+ * @return          Le niveau, NULL si le pack n'est pas résident ou si ses
+ *                  niveaux ne sont pas conservés (voir atlasKeepPixels)
+ */
+SDL_Surface *atlasPixels(int atlas, int drawSize, int *iconSize);
+
+/**
+ * Retourne le numéro de chargement d'un pack, qui change à chaque chargement
+ * ou rechargement de son image : les rendus dérivés de l'image (icônes
+ * pré-tournées) sont périmés lorsqu'il change.
+ *
+ * @param  atlas L'identifiant du pack
+ * @return       Le numéro de chargement, 0 si le pack n'est pas résident
+ */
+Uint32 atlasSerial(int atlas);
+
+/**
+ * Affiche la mémoire de texture utilisée par chaque pack résident.
+ */
+void atlasReport();
+
+/**
+ * Libère tous les packs, référencés ou non.
+ */
+void atlasFreeAll();
+
+#endif /*ATLAS_H*/
@@ -0,0 +1,73 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+/* Graine du générateur aléatoire pour les images capturées (disposition des
+ * icônes et choix des icônes identiques d'une exécution à l'autre) */
+#define CAPTURE_SEED 20181219
+
+/**
+ * Capture d'images sans fenêtre : les menus et les paires de cartes de chaque
+ * deck et de chaque choix de packs sont dessinés par le rendu logiciel de la
+ * SDL dans une image en mémoire (voir initializeOffscreenGraphics), puis
+ * enregistrés en PNG (aperçus, images de référence) ou comparés à des images
+ * de référence (tests de non-régression de l'affichage, sans carte graphique).
+ *
+ * La comparaison des pixels est vectorisée avec SSE2 lorsqu'il est disponible.
+ */
+
+/**
+ * Compte les pixels différents entre deux images de même taille (format
+ * RGBA32).
+ *
+ * @param  a         Le premier pixel de la première image
+ * @param  pitchA    La longueur d'une ligne de la première image (en octets)
+ * @param  b         Le premier pixel de la seconde image
+ * @param  pitchB    La longueur d'une ligne de la seconde image (en octets)
+ * @param  width     La largeur des images (en pixels)
+ * @param  height    La hauteur des images (en pixels)
+ * @param  tolerance L'écart maximal toléré sur chaque composante (0 à 255)
+ * @return           Le nombre de pixels dont une composante diffère de plus
+ *                   de la tolérance
+ */
+long captureDiff(const uint8_t *a, int pitchA, const uint8_t *b, int pitchB,
+                 int width, int height, int tolerance);
+
+/**
+ * Enregistre l'image de rendu sans fenêtre en PNG.
+ *
+ * @param  fileName Le chemin d'accès au fichier
+ * @return          1 si l'image a été enregistrée, 0 sinon
+ */
+int captureSave(const char *fileName);
+
+/**
+ * Compare l'image de rendu sans fenêtre à une image de référence (PNG).
+ *
+ * @param  fileName  Le chemin d'accès à l'image de référence
+ * @param  tolerance L'écart maximal toléré sur chaque composante
+ * @return           Le nombre de pixels différents, -1 si l'image de référence
+ *                   est absente ou n'a pas la même taille
+ */
+long captureCompare(const char *fileName, int tolerance);
+
+/**
+ * Dessine sans fenêtre le menu de début, puis pour chaque choix de packs et
+ * chaque deck dont les symboles tiennent dans ces packs toutes les cartes
+ * (chacune en haut puis en bas d'une paire) et le menu de fin. Les images sont
+ * enregistrées dans un dossier et/ou comparées aux images de même nom d'un
+ * dossier de référence.
+ *
+ * @param  outDir    Le dossier où enregistrer les images (NULL : aucun)
+ * @param  goldenDir Le dossier des images de référence (NULL : aucun)
+ * @param  tolerance L'écart maximal toléré sur chaque composante
+ * @param  scale     L'échelle des images (1 : BASE_WIN_WIDTH x
+ *                   BASE_WIN_HEIGHT pixels)
+ * @return           Le code de retour du programme : 0 si toutes les images
+ *                   sont identiques aux références, 1 sinon
+ */
+int captureRun(const char *outDir, const char *goldenDir, int tolerance,
+               double scale);
+
+#endif /*CAPTURE_H*/
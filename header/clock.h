@@ -0,0 +1,42 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Retourne l'instant courant en microsecondes, mesuré sur une horloge
+ * monotone (l'origine est arbitraire, seules les différences ont un sens).
+ *
+ * L'horloge n'est pas affectée par les changements de l'heure système et peut
+ * être appelée depuis n'importe quel thread.
+ *
+ * @return L'instant courant (en microsecondes)
+ */
+int64_t clockNow();
+
+/**
+ * Remplace l'horloge monotone par une horloge virtuelle arrêtée à l'instant
+ * donné, utilisée pour relire une partie sans affichage. Une valeur négative
+ * rétablit l'horloge monotone.
+ *
+ * @param now L'instant virtuel (en microsecondes)
+ */
+void clockSetVirtual(int64_t now);
+
+/**
+ * Convertit une durée en microsecondes en millisecondes (arrondi inférieur).
+ *
+ * @param  us La durée en microsecondes
+ * @return    La durée en millisecondes
+ */
+static inline int64_t usToMs(int64_t us) { return us / 1000; }
+
+/**
+ * Convertit une durée en millisecondes en microsecondes.
+ *
+ * @param  ms La durée en millisecondes
+ * @return    La durée en microsecondes
+ */
+static inline int64_t msToUs(int64_t ms) { return ms * 1000; }
+
+#endif /*CLOCK_H*/
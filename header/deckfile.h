@@ -0,0 +1,84 @@
+#ifndef DECKFILE_H
+#define DECKFILE_H
+
+/* Taille des blocs lus dans un fichier de deck (en octets) */
+#define DECK_FILE_CHUNK 65536
+
+/**
+ * Lecture des fichiers de deck (data/pgNN.txt, decks écrits par
+ * --search-deck) :
+ *
+ *   <nombre de cartes> <nombre d'icônes par carte>
+ *   <numéros des icônes de la carte 1>
+ *   ...
+ *
+ * Le fichier est lu par blocs de DECK_FILE_CHUNK octets, et les nombres sont
+ * convertis huit chiffres à la fois (chiffres repérés et assemblés dans un
+ * entier de 64 bits, sans boucle par caractère). Chaque carte occupe une ligne
+ * (les lignes vides sont ignorées, les fins de ligne \r\n acceptées). Les
+ * nombres de cartes et d'icônes, les numéros d'icônes (de 0 à
+ * DECK_MAX_SYMBOLS - 1) et l'unicité des icônes d'une carte sont vérifiés
+ * pendant la lecture : une erreur est retournée avec sa position dans le
+ * fichier, sans quitter le programme.
+ */
+
+typedef enum {
+  DECK_FILE_OK,
+  DECK_FILE_ABSENT,     // fichier absent ou illisible
+  DECK_FILE_MEMORY,     // mémoire insuffisante
+  DECK_FILE_SYNTAX,     // caractère autre qu'un chiffre ou un espace
+  DECK_FILE_HEADER,     // nombre de cartes ou d'icônes par carte invalide
+  DECK_FILE_MISMATCH,   // nombre d'icônes par carte différent de l'attendu
+  DECK_FILE_RANGE,      // numéro d'icône hors limites
+  DECK_FILE_DUPLICATE,  // icône présente deux fois sur une carte
+  DECK_FILE_SHORT_LINE, // carte avec trop peu d'icônes
+  DECK_FILE_LONG_LINE,  // carte avec trop d'icônes
+  DECK_FILE_TRUNCATED,  // fin du fichier avant la dernière carte
+  DECK_FILE_TRAILING    // données après la dernière carte
+} DeckFileStatus;
+
+/**
+ * Erreur de lecture d'un fichier de deck.
+ */
+typedef struct {
+  DeckFileStatus status;
+  int line, column; // position de l'erreur (à partir de 1, 0 si sans objet)
+} DeckFileError;
+
+/**
+ * Deck lu dans un fichier.
+ */
+typedef struct {
+  int nbCards, nbIcons;
+  int *icons; // numéros des icônes, nbIcons par carte, carte après carte
+} DeckFile;
+
+/**
+ * Lit un fichier de deck.
+ *
+ * @param  fileName Le nom du fichier (voir assets.h)
+ * @param  nbIcons  Le nombre d'icônes par carte attendu (0 : celui de
+ *                  l'en-tête du fichier)
+ * @param  deck     Le deck lu, à libérer par deckFileFree
+ * @param  error    L'erreur rencontrée
+ * @return          1 si le deck a été lu, 0 sinon
+ */
+int deckFileRead(const char *fileName, int nbIcons, DeckFile *deck,
+                 DeckFileError *error);
+
+/**
+ * Libère un deck lu par deckFileRead.
+ *
+ * @param deck Le deck
+ */
+void deckFileFree(DeckFile *deck);
+
+/**
+ * Retourne la description d'une erreur de lecture.
+ *
+ * @param  status L'erreur
+ * @return        La description
+ */
+const char *deckFileMessage(DeckFileStatus status);
+
+#endif /*DECKFILE_H*/
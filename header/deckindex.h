@@ -0,0 +1,67 @@
+#ifndef DECKINDEX_H
+#define DECKINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "decksearch.h"
+#include "dobble.h"
+
+/**
+ * Index inversé du deck courant, construit au chargement du deck : pour
+ * chaque carte l'ensemble de ses symboles, et pour chaque symbole l'ensemble
+ * des cartes qui le portent, sous forme d'ensembles de bits (au plus
+ * DECK_MAX_CARDS cartes et DECK_MAX_SYMBOLS symboles, comme les decks
+ * recherchés : un deck de k icônes par carte a au plus k² - k + 1 cartes).
+ *
+ * Chercher laquelle de N cartes en jeu porte un symbole est une intersection
+ * d'ensembles de cartes : le coût ne dépend que de la taille du deck (quatre
+ * mots de 64 bits), pas du nombre de cartes en jeu.
+ */
+
+/**
+ * Ensemble de cartes du deck (bit i : carte numéro i).
+ */
+typedef struct {
+  uint64_t bits[DECK_WORDS];
+} CardSet;
+
+/**
+ * Construit l'index d'un deck.
+ *
+ * @param  cards   Les cartes du deck
+ * @param  nbCards Le nombre de cartes
+ * @param  nbIcons Le nombre d'icônes par carte
+ * @return         1 si l'index est construit, 0 si le deck a trop de cartes
+ *                 ou un numéro de symbole hors limites
+ */
+int deckIndexBuild(const Card *cards, int nbCards, int nbIcons);
+
+/**
+ * Ajoute une carte à un ensemble de cartes.
+ *
+ * @param set  L'ensemble
+ * @param card Le numéro de la carte dans le deck
+ */
+void cardSetAdd(CardSet *set, int card);
+
+/**
+ * Retourne le symbole commun à deux cartes du deck.
+ *
+ * @param  a Le numéro de la première carte
+ * @param  b Le numéro de la seconde carte
+ * @return   Le plus petit symbole commun, -1 si aucun
+ */
+int deckIndexCommonSymbol(int a, int b);
+
+/**
+ * Cherche parmi des cartes en jeu une carte qui porte un symbole donné.
+ *
+ * @param  symbol  Le symbole
+ * @param  visible Les cartes en jeu
+ * @return         Le numéro de la carte (la plus petite s'il y en a
+ *                 plusieurs), -1 si aucune
+ */
+int deckIndexFindHolder(int symbol, const CardSet *visible);
+
+#endif /*DECKINDEX_H*/
@@ -0,0 +1,44 @@
+#ifndef DECKSEARCH_H
+#define DECKSEARCH_H
+
+/* Nombre maximal de symboles et de cartes d'un deck recherché */
+#define DECK_MAX_SYMBOLS 256
+#define DECK_MAX_CARDS 256
+
+/* Nombre de mots de 64 bits d'un ensemble de symboles ou de cartes */
+#define DECK_WORDS (DECK_MAX_SYMBOLS / 64)
+
+/* Nombre maximal de nœuds explorés pour ajouter une carte au deck */
+#define DECK_NODE_BUDGET 20000
+
+/**
+ * Recherche d'un deck aussi grand que possible avec k symboles par carte et au
+ * plus S symboles différents, où deux cartes quelconques ont exactement un
+ * symbole en commun.
+ *
+ * La recherche part d'un plan projectif tronqué (points supprimés pour tenir
+ * dans S symboles) ou, si le plan d'ordre k - 1 n'existe pas, d'un plan plus
+ * petit complété par des symboles propres à chaque carte. Plusieurs threads
+ * l'améliorent ensuite par recherche locale : ajout d'une carte par
+ * backtracking (couverture exacte des cartes existantes, sur des ensembles de
+ * bits), retrait de cartes au hasard lorsque le deck est bloqué.
+ *
+ * Chaque symbole est sur au plus k cartes, sinon un deck où toutes les cartes
+ * partagent le même symbole serait toujours le plus grand ; le deck a donc au
+ * plus k² - k + 1 cartes (taille du plan projectif d'ordre k - 1).
+ */
+
+/**
+ * Cherche un deck et l'écrit au format lu par readCardFile.
+ *
+ * @param  nbIcons   Le nombre de symboles par carte (k)
+ * @param  nbSymbols Le nombre maximal de symboles différents (S)
+ * @param  fileName  Le fichier de deck à écrire
+ * @param  nbThreads Le nombre de threads de recherche (0 : un par cœur)
+ * @param  seconds   La durée maximale de la recherche (en secondes)
+ * @return           Le code de retour du programme
+ */
+int deckSearchRun(int nbIcons, int nbSymbols, const char *fileName,
+                  int nbThreads, int seconds);
+
+#endif /*DECKSEARCH_H*/
@@ -0,0 +1,118 @@
+#ifndef DIFFICULTY_H
+#define DIFFICULTY_H
+
+#include <stdbool.h>
+
+/* Poids de la dernière réponse dans les moyennes glissantes (demi-vie
+ * d'environ 5 réponses) */
+#define DIFFICULTY_SMOOTHING 0.125
+
+/* Temps de réaction (en ms) et taux d'erreurs visés : le niveau monte quand
+ * le joueur fait mieux, et baisse sinon */
+#define DIFFICULTY_TARGET_MS 1500
+#define DIFFICULTY_TARGET_ERRORS 0.15
+
+/* Variation maximale du niveau après une réponse */
+#define DIFFICULTY_GAIN 0.05
+
+/* Nombre minimal de réponses entre deux changements de deck */
+#define DIFFICULTY_DECK_DWELL 8
+
+/**
+ * Difficulté adaptative : le niveau (entre 0 et 1, 0.5 pour le jeu standard)
+ * suit le temps de réaction et le taux d'erreurs du joueur, moyennés sur une
+ * fenêtre à décroissance exponentielle. Chaque réponse coûte une mise à jour
+ * en temps constant.
+ *
+ * Le niveau règle l'amplitude de rotation et la variation de taille des
+ * icônes des prochaines cartes, et le bonus de temps d'une bonne réponse.
+ * Aux extrémités, le jeu passe au deck d'ordre voisin et le niveau revient au
+ * milieu.
+ *
+ * Sans difficulté adaptative, tous les réglages restent ceux du jeu standard
+ * (et les tirages aléatoires sont inchangés).
+ */
+
+/**
+ * État de la difficulté adaptative.
+ */
+typedef struct {
+  bool active;
+  double level;    // entre 0 (facile) et 1 (difficile)
+  double reaction; // moyenne glissante du temps de réaction (en ms)
+  double errors;   // moyenne glissante du taux d'erreurs
+  int sinceSwitch; // réponses depuis le dernier changement de deck
+  int lastStep;    // dernier changement de deck demandé
+} DifficultyState;
+
+/**
+ * Active la difficulté adaptative et remet le niveau au milieu.
+ */
+void difficultyEnable();
+
+/**
+ * Indique si la difficulté adaptative est activée.
+ */
+bool difficultyActive();
+
+/**
+ * Prend en compte une réponse du joueur.
+ *
+ * @param  reactionMs Le temps de réaction (en ms)
+ * @param  correct    true si la réponse est bonne
+ * @return            Le changement de deck demandé : 1 pour le deck d'ordre
+ *                    supérieur (plus d'icônes par carte), -1 pour le deck
+ *                    d'ordre inférieur, 0 sinon
+ */
+int difficultyRecordAnswer(int reactionMs, bool correct);
+
+/**
+ * Signale que le changement de deck demandé est impossible (pas de deck
+ * d'ordre voisin) : le niveau reste à son extrémité.
+ */
+void difficultyDeckUnavailable();
+
+/**
+ * Retourne le niveau courant.
+ *
+ * @return Le niveau, entre 0 (facile) et 1 (difficile)
+ */
+double difficultyLevel();
+
+/**
+ * Retourne l'amplitude de rotation des icônes.
+ *
+ * @return L'amplitude (en degrés, 360 pour une rotation quelconque)
+ */
+int difficultyRotationRange();
+
+/**
+ * Retourne le facteur de variation de taille des icônes.
+ *
+ * @return Le facteur (1 pour le jeu standard)
+ */
+double difficultyScaleSpread();
+
+/**
+ * Ajuste le bonus de temps d'une bonne réponse.
+ *
+ * @param  bonusMs Le bonus du jeu standard (en ms)
+ * @return         Le bonus ajusté (en ms)
+ */
+int difficultyTimeBonus(int bonusMs);
+
+/**
+ * Retourne l'état de la difficulté adaptative (sauvegarde de la partie).
+ *
+ * @param state L'état à remplir
+ */
+void difficultyGetState(DifficultyState *state);
+
+/**
+ * Rétablit un état de la difficulté adaptative (reprise de la partie).
+ *
+ * @param state L'état
+ */
+void difficultySetState(const DifficultyState *state);
+
+#endif /*DIFFICULTY_H*/
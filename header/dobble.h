@@ -1,6 +1,46 @@
 #ifndef DOBBLE_H
 #define DOBBLE_H
 
+#include <stdint.h>
+
+/* Nombre maximal de joueurs du mode course */
+#define RACE_MAX_PLAYERS 8
+
+/* Durée d'une partie (en millisecondes) */
+#define ROUND_DURATION_MS 30000
+
+/* Pénalité de temps pour une mauvaise réponse (en millisecondes) */
+#define TIME_PENALTY_MS 3000
+
+/* Bonus de temps maximal (réponse immédiate) et minimal (réponse lente) pour
+ * une bonne réponse (en millisecondes) */
+#define TIME_BONUS_MAX_MS 3000
+#define TIME_BONUS_MIN_MS 1000
+
+/* Temps de réaction en dessous duquel une bonne réponse rapporte un point
+ * supplémentaire (en millisecondes) */
+#define FAST_ANSWER_MS 1000
+
+/* Nombre maximal de tirages d'une paire de cartes pour éviter les icônes
+ * confondables */
+#define PAIR_ATTEMPTS 8
+
+/* Nombre de paires de cartes distribuées à l'avance (tirées, placées et
+ * rendues avant leur affichage) */
+#define DEAL_LOOKAHEAD 2
+
+/* Nombre d'erreurs permises en mode sans fin */
+#define ENDLESS_LIVES 3
+
+/* Durées des animations des cartes (en millisecondes) : distribution de la
+ * première paire, arrivée de la paire suivante après une bonne réponse
+ * (glissement) ou une erreur (retournement), et mise en évidence de l'icône
+ * commune de la paire précédente */
+#define ANIM_DEAL_MS 300
+#define ANIM_SLIDE_MS 180
+#define ANIM_FLIP_MS 180
+#define ANIM_POP_MS 350
+
 typedef enum {
   FILE_ABSENT,
   INCORRECT_FORMAT,
@@ -10,11 +50,20 @@ typedef enum {
 typedef enum {
   CORRECT,
   INCORRECT,
-  INDEFINI
+  INDEFINI,
+  TARDIF // bonne réponse, mais un autre joueur a été plus rapide (en réseau)
 } Resultat;
 
+typedef enum {
+  STATE_MENU,    // menu de début : choix du pack d'icônes et du deck
+  STATE_PLAYING, // partie en cours
+  STATE_RESULTS, // menu de fin : statistiques, rejouer ou quitter
+  STATE_QUIT     // fin du programme demandée
+} GameState;
+
 typedef struct {
-  int iconId;       // Numéro de l'icône.
+  int iconId;       // Numéro du symbole (dans le fichier de deck).
+  int imageId;      // Numéro de l'icône dessinée (choisie pour la partie).
   double radius;    // Distance entre le centre de la carte et le centre de dessin de l'icône.
   double angle;     // Angle entre l'horizontale et la position de dessin de l'icône.
   double rotation;  // Angle de rotation de l'icône par rapport à son centre.
@@ -32,17 +81,45 @@ typedef struct {
   int nbCards;
   Card* cards;
   Card cardUpper, cardLower; // cartes du haut et du bas
-  int time, score, nbFalse;  // temps restant et score du joueur
+  const Icon *dealtUpper, *dealtLower; // cartes du deck de la dernière paire tirée
+  GameState state;           // étape du jeu (menus ou partie)
+  int time, score, nbFalse;  // temps restant (en ms, écoulé en mode sans fin) et score du joueur
+  int64_t deadline;          // échéance du compte à rebours (en µs, horloge monotone)
+  bool endless;              // mode sans fin : pas de compte à rebours, ENDLESS_LIVES erreurs permises
+  int lives;                 // erreurs encore permises en mode sans fin
+  int64_t roundStart;        // début de la partie (en µs, horloge monotone)
+  uint64_t rngState;         // état du générateur aléatoire (xorshift64*)
+  int packMask;              // packs d'icônes choisis (bit i : pack numéro i)
+  bool headless;             // relecture sans fenêtre (pas de dessin)
+  int64_t pairShownAt;       // instant d'affichage de la paire courante (en µs, 0 si pas encore affichée)
   bool timerRunning;   // état du compte à rebours (lancé/non lancé)
   bool iconPackChosen; // est-ce que le pack d'icônes a été choisi ?
   bool nbIconChosen;   // est-ce que le nombre d'icônes par carte a été choisi ?
+  const char *statsFile; // fichier d'export des statistiques (NULL si aucun)
   Resultat resultatClic;
     // vaut INCORRECT à si le joueur a fait une erreur,
     // CORRECT si il a une bonne réponse et INDEFINI sinon
 } Game;
 
+extern Game gameGlobal;
+
 #include "graphics.h"
 
+/**
+ * Initialise le générateur aléatoire du jeu
+ *
+ * @param seed La graine (l'état du générateur)
+ */
+void seedRandom(uint64_t seed);
+
+/**
+ * Tire un entier aléatoire avec le générateur du jeu
+ *
+ * @param  n La borne supérieure (exclue)
+ * @return   Un entier entre 0 et n - 1
+ */
+int randomInt(int n);
+
 /**
  * Affiche à l'utilisateur une erreur donnée et quitte le programme
  *
@@ -89,11 +166,64 @@ void initCardIcons(Card currentCard);
 void freeDeck();
 
 /**
- * Lit un fichier contenant les icônes des cartes du jeu
+ * Lit un fichier contenant les icônes des cartes du jeu (voir deckfile.h) et
+ * en fait le deck courant. En cas d'erreur, sa position dans le fichier est
+ * affichée et le deck courant reste inchangé.
+ *
+ * @param  fileName Le nom du fichier
+ * @param  nbIcons  Le nombre d'icônes par carte attendu (0 : celui du
+ *                  fichier)
+ * @return          1 si le fichier a été lu, 0 sinon (en particulier si
+ *                  le nombre d'icônes par carte diffère de nbIcons)
+ */
+int readCardFile(char const *fileName, int nbIcons);
+
+/**
+ * Charge un ou plusieurs packs d'icônes. Les icônes des packs choisis sont
+ * numérotées à la suite, dans l'ordre des numéros de pack.
  *
- * @param fileName Le nom du fichier
+ * @param  packMask Les packs à utiliser (bit i : pack numéro i, dans l'ordre
+ *                  du manifeste data/packs.txt)
+ * @return          1 si les packs ont été chargés, 0 sinon
  */
-void readCardFile(char const *fileName);
+int loadIconPacks(int packMask);
+
+/**
+ * Charge seulement l'index de similarité d'un ou plusieurs packs d'icônes
+ * (relecture sans fenêtre : les tirages en dépendent)
+ *
+ * @param  packMask Les packs à utiliser
+ * @return          1 si le choix de packs est valide, 0 sinon
+ */
+int loadIconIndex(int packMask);
+
+/**
+ * Indique si les packs ont une icône différente pour chaque symbole d'un deck
+ * (le deck est lu s'il ne l'a pas encore été, sans remplacer le deck courant)
+ *
+ * @param  nbIcons  Le nombre d'icônes par carte du deck
+ * @param  packMask Les packs (0 : pas encore choisis)
+ * @return          1 si le deck existe et tient dans les packs, ou si les packs
+ *                  ne sont pas choisis, 0 sinon
+ */
+int deckFitsPacks(int nbIcons, int packMask);
+
+/**
+ * Charge le deck correspondant à un nombre d'icônes par carte
+ *
+ * @param  nbIcons Le nombre d'icônes par carte
+ * @return         1 si le deck a été chargé, 0 s'il est absent, invalide ou a
+ *                 plus de symboles que les packs choisis n'ont d'icônes (le
+ *                 deck courant reste inchangé)
+ */
+int loadDeck(int nbIcons);
+
+/**
+ * Calcule la distance entre deux points
+ *
+ * @return La distance entre (ax, ay) et (bx, by)
+ */
+double dist(double ax, double ay, double bx, double by);
 
 /**
  * Fonction appelée lors d'un mouvement du curseur de la souris sur la fenêtre.
@@ -110,16 +240,123 @@ void onMouseMove(int x, int y);
 Resultat onMouseClick(int mouseX, int mouseY);
 
 /**
- * Fonction appelée chaque seconde par le compte à rebours lorsque celui-ci est
- * activé.
+ * Fonction appelée pour chaque appui (clic de souris ou contact tactile), dans
+ * l'ordre chronologique des appuis reçus depuis le dernier passage de la
+ * boucle principale.
+ *
+ * @param x  Abscisse de l'appui
+ * @param y  Ordonnée de l'appui
+ * @param at Instant de l'appui (en µs, horloge monotone)
+ */
+void onPointerDown(int x, int y, int64_t at);
+
+/**
+ * Fonction appelée régulièrement (toutes les TIMER_PERIOD_MS millisecondes)
+ * par la boucle principale lorsque le compte à rebours est activé.
  */
 void onTimerTick();
 
 /**
- * Sélectionne deux cartes aléatoires différentes des deux précédentes
+ * Fonction appelée par la boucle principale lorsque la fenêtre perd le focus
+ * et avant de quitter sur demande du système (fermeture de la fenêtre,
+ * SIGTERM) : la partie en cours est sauvegardée (voir snapshot.h).
+ */
+void onSuspend();
+
+/**
+ * Démarre une partie : tire une première paire de cartes et lance le compte à
+ * rebours
+ */
+void startRound();
+
+/**
+ * Termine la partie en cours : arrête le compte à rebours, enregistre le
+ * résultat et passe au menu de fin
+ */
+void finishRound();
+
+/**
+ * Démarre une nouvelle partie de ROUND_DURATION_MS millisecondes (sans durée
+ * en mode sans fin) : fixe l'échéance du compte à rebours et active les tics
+ * d'affichage.
+ */
+void startCountdown();
+
+/**
+ * Met à jour le temps restant (gameGlobal.time) à partir de l'échéance du
+ * compte à rebours et de l'horloge monotone, ou le temps écoulé en mode sans
+ * fin.
+ */
+void updateRemainingTime();
+
+/**
+ * Calcule le temps de réaction du joueur pour la paire courante, mesuré depuis
+ * l'image où la paire a été affichée.
+ *
+ * @param  at L'instant de la réponse (en µs, horloge monotone)
+ * @return    Le temps de réaction (en millisecondes), -1 si la paire n'a pas
+ *            encore été affichée
+ */
+int reactionTime(int64_t at);
+
+/**
+ * Affiche la paire de cartes suivante. Les DEAL_LOOKAHEAD paires suivantes
+ * sont tirées et placées à l'avance (dans le même ordre qu'une à une : la
+ * suite des tirages ne change pas), et leur rendu est préparé après
+ * l'affichage de chaque image : la nouvelle paire apparaît dans l'image qui
+ * suit le clic.
  */
 void changeCards();
 
+/**
+ * Tire les indices de deux cartes différentes entre elles et des deux cartes
+ * de la dernière paire tirée, sans les distribuer
+ *
+ * @param upper L'indice de la carte du haut
+ * @param lower L'indice de la carte du bas
+ */
+void pickPair(int *upper, int *lower);
+
+/**
+ * Distribue et affiche immédiatement une paire de cartes imposée : nouvelle
+ * disposition aléatoire de leurs icônes, puis calcul de leurs positions. Les
+ * paires distribuées à l'avance sont abandonnées.
+ *
+ * @param upper L'indice de la carte du haut dans le deck
+ * @param lower L'indice de la carte du bas dans le deck
+ */
+void dealPair(int upper, int lower);
+
+/**
+ * Retourne les indices des cartes de la paire affichée.
+ *
+ * @param upper L'indice de la carte du haut dans le deck
+ * @param lower L'indice de la carte du bas dans le deck
+ */
+void currentPair(int *upper, int *lower);
+
+/**
+ * Affiche une paire de cartes avec une disposition de leurs icônes imposée
+ * (reprise d'une partie sauvegardée), puis tire les paires suivantes. Les
+ * positions des icônes sont recalculées à l'échelle courante.
+ *
+ * @param upper      L'indice de la carte du haut dans le deck
+ * @param lower      L'indice de la carte du bas dans le deck
+ * @param upperIcons Les icônes de la carte du haut
+ * @param lowerIcons Les icônes de la carte du bas
+ */
+void restorePair(int upper, int lower, const Icon *upperIcons,
+                 const Icon *lowerIcons);
+
+/**
+ * Fonction qui remet les icônes d'une carte dans l'ordre croissant de leurs
+ * numéros (ordre du fichier de deck)
+ *
+ * @param elems   Le tableau d'icônes à trier
+ * @param nbElems Le nombre d'icônes du tableau
+ */
+void sortIcons(Icon *elems, int nbElems);
+
 /**
  * Fonction qui mélange de manière aléatoire l'ordre des icônes d'une carte
  *
@@ -148,7 +385,8 @@ void drawCard(CardPosition currentCardPosition, Card currentCard, int erreur);
 void renderScene();
 
 /**
- * Affiche le menu de fin de partie
+ * Affiche le menu de fin de partie (statistiques et boutons décrits dans
+ * data/menus.ui)
  */
 void afficheMenuFin();
 
@@ -157,49 +395,19 @@ void afficheMenuFin();
  */
 void afficheStats();
 
-/**
- * Affiche les boutons du menu de fin de partie (pour rejouer ou quitter)
- */
-void afficheBoutonsFin();
-
 /**
  * Évènements déclenchés lors d'un clic sur un bouton du menu de fin
  */
 void ExitBoutonClic(int mouseX, int mouseY);
 
 /**
- * Affiche le menu de début de partie
+ * Affiche le menu de début de partie (décrit dans data/menus.ui)
  */
 void afficheMenuDebut();
 
-/**
- * Affiche le titre du menu du début
- */
-void afficheTitreMenuDebut();
-
-/**
- * Affiche les boutons du menu de début de partie (pour sélectionner les icônes)
- */
-void afficheBoutonsDebut();
-
-/**
- * Teste si un bouton pour sélectionner le nombre d'icônes a été cliqué
- */
-bool testnbIconsButton(int mouseX, int mouseY, float offsetX, int offsetY,
-                       int nbButton, int *nbChosen);
-
 /**
  * Évènements déclenchés lors d'un clic sur un bouton du menu de début
  */
 void EnterBoutonClic(int mouseX, int mouseY);
 
-/**
- * Affiche un bouton à l'écran
- *
- * @param offsetY     L'offset vertical (coefficient appliqué à FONT_SIZE)
- * @param circleWidth La taille du cercle du bouton (coefficient appliqué à CARD_RADIUS)
- */
-void afficheBouton(int offsetX, int offsetY, double circleWidth, char text[100], int bgr,
-                   int bgg, int bgb);
-
 #endif /*DOBBLE_H*/
@@ -0,0 +1,98 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <SDL2/SDL.h>
+
+/* Version du format des fichiers d'atlas de glyphes */
+#define FONT_SDF_VERSION 2
+
+/* Caractères de l'atlas : Latin-1 imprimable (de l'espace à ÿ), puis
+ * quelques caractères courants en français hors Latin-1 (œ, Œ, ’, …, €) */
+#define FONT_FIRST_CHAR 32
+#define FONT_LAST_CHAR 255
+#define FONT_EXTRA_CHARS 5
+#define FONT_GLYPHS (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1 + FONT_EXTRA_CHARS)
+
+/* Taille de police des glyphes de l'atlas (en pixels), et distance au bord
+ * des glyphes encodée de part et d'autre du contour (en pixels de l'atlas) */
+#define FONT_SDF_SIZE 32
+#define FONT_SDF_SPREAD 4
+
+/* Suréchantillonnage du rendu des glyphes pour le calcul des distances */
+#define FONT_SDF_SUPERSAMPLE 4
+
+/* Largeur des atlas (en pixels) */
+#define FONT_ATLAS_WIDTH 512
+
+/**
+ * Texte dessiné à partir d'un atlas de distances signées (SDF) : chaque pixel
+ * de l'atlas d'une police contient la distance au contour du glyphe le plus
+ * proche, ce qui permet d'en déduire un rendu net des glyphes à n'importe
+ * quelle taille. L'atlas est calculé une seule fois par police (rendu
+ * suréchantillonné des glyphes avec SDL_ttf, puis transformée en distance
+ * exacte) et enregistré à côté du fichier de la police (extension .sdf), dans
+ * le dossier de données sur disque ; un atlas intégré à l'exécutable avec la
+ * police (voir assets.h) évite ce calcul au premier lancement.
+ *
+ * À chaque changement de taille, les glyphes sont seuillés depuis l'atlas SDF
+ * dans une seule texture ; un texte est ensuite dessiné glyphe par glyphe
+ * depuis cette texture, colorisée au moment du dessin, sans rendu de police ni
+ * création de texture.
+ */
+
+/**
+ * Charge l'atlas SDF d'une police, calculé et enregistré s'il est absent ou
+ * périmé (police modifiée, autre version du format). SDL_ttf doit être
+ * initialisée.
+ *
+ * @param  renderer Le renderer utilisé pour créer la texture des glyphes
+ * @param  fontFile Le nom du fichier de la police (voir assets.h)
+ * @return          1 si l'atlas a été chargé, 0 sinon
+ */
+int fontLoad(SDL_Renderer *renderer, const char *fontFile);
+
+/**
+ * Prépare le dessin du texte à une taille de police : les glyphes de la
+ * police chargée sont seuillés à cette taille dans la texture des glyphes.
+ *
+ * @param  pixelSize La taille de la police (en pixels)
+ * @return           1 si la texture a été créée, 0 sinon
+ */
+int fontSetSize(int pixelSize);
+
+/**
+ * Mesure un texte (UTF-8) à la taille courante.
+ *
+ * @param text Le texte
+ * @param w    La largeur du texte (en pixels)
+ * @param h    La hauteur d'une ligne (en pixels)
+ */
+void fontMeasure(const char *text, int *w, int *h);
+
+/**
+ * Dessine un texte (UTF-8) à la taille courante sur la cible de rendu
+ * courante. Les caractères absents de l'atlas sont remplacés par '?'.
+ *
+ * @param text  Le texte
+ * @param x     Abscisse du coin supérieur gauche du texte
+ * @param y     Ordonnée du coin supérieur gauche du texte
+ * @param color La couleur du texte
+ */
+void fontDraw(const char *text, int x, int y, SDL_Color color);
+
+/**
+ * Calcule et enregistre les atlas SDF de toutes les polices d'un dossier du
+ * dossier de données sur disque (fichiers .ttf et .otf), même s'ils sont à
+ * jour.
+ *
+ * @param  directory Le dossier des polices (ex. "FONTS")
+ * @return           1 si tous les atlas ont été enregistrés, 0 sinon
+ */
+int fontBuildAll(const char *directory);
+
+/**
+ * Libère l'atlas et la texture des glyphes.
+ */
+void fontFree();
+
+#endif /*FONT_H*/
@@ -10,7 +10,13 @@
 #define CARDBORDER 160
 
 typedef enum { UpperCard,
-															LowerCard } CardPosition;
+															LowerCard,
+															CenterCard,
+															PlayerCard } CardPosition; // PlayerCard + i : carte du joueur i
+
+/* Nombre de positions de cartes (cartes du mode classique, carte centrale et
+ * cartes des joueurs du mode course) */
+#define MAX_CARD_POSITIONS (PlayerCard + RACE_MAX_PLAYERS)
 
 typedef enum { Top,
 															Middle,
@@ -44,7 +50,51 @@ void getIconLocationInMatrix(int iconId, int *posX, int *posY);
 void getCardCenter(CardPosition card, int *cardCenterX, int *cardCenterY);
 
 /**
- * Planifie l'appel de la procédure donnée en paramètre.
+ * Retourne le rayon de la carte fournie en paramètre.
+ *
+ * @param  card Carte dont retourner le rayon
+ * @return      Le rayon de la carte (en pixels)
+ */
+int getCardRadius(CardPosition card);
+
+/**
+ * Place une carte dans la fenêtre. Les coordonnées sont données à l'échelle 1
+ * (fenêtre de BASE_WIN_WIDTH x BASE_WIN_HEIGHT) ; un rayon nul rétablit
+ * l'emplacement par défaut des cartes du haut et du bas. Les icônes d'une
+ * carte plus petite que CARD_RADIUS sont rapprochées et réduites d'autant.
+ *
+ * @param card   Carte à placer
+ * @param x      Abscisse du centre de la carte
+ * @param y      Ordonnée du centre de la carte
+ * @param radius Rayon de la carte
+ */
+void setCardSlot(CardPosition card, double x, double y, double radius);
+
+/**
+ * Transformation appliquée au dessin d'une carte (animations) : la carte est
+ * déplacée, étirée et tournée en bloc autour de son centre, sans nouveau rendu
+ * de ses icônes. La transformation identité ({0, 0, 1, 1, 0}) est rétablie à
+ * l'initialisation.
+ */
+typedef struct {
+  double dx, dy;         // décalage du centre (à l'échelle 1)
+  double scaleX, scaleY; // étirement horizontal et vertical
+  double angle;          // rotation (en degrés, sens horaire)
+} CardTransform;
+
+/**
+ * Retourne la transformation appliquée au dessin d'une carte, modifiable (par
+ * exemple animée par tweenStart).
+ *
+ * @param  card La position de la carte
+ * @return      La transformation de la carte
+ */
+CardTransform *getCardTransform(CardPosition card);
+
+/**
+ * Planifie l'appel de la procédure donnée en paramètre par la boucle
+ * principale (roue de minuteries, voir timerwheel.h). Cette fonction doit être
+ * appelée depuis le thread principal.
  *
  * @param method  Méthode dont la signature est void méthode(void*) (pas de valeur de retour, mais un paramètre de type void*).
  * @param param   Paramètre à passer à la méthode lors de son appel.
@@ -53,17 +103,28 @@ void getCardCenter(CardPosition card, int *cardCenterX, int *cardCenterY);
 
 void callLater(void (*method)(void *), void *param, uint32_t delay);
 
+/**
+ * Demande l'appel de la procédure donnée en paramètre par la boucle
+ * principale, dès que possible. Cette fonction peut être appelée depuis
+ * n'importe quel thread.
+ *
+ * @param method  Méthode dont la signature est void méthode(void*).
+ * @param param   Paramètre à passer à la méthode lors de son appel.
+ */
+void callOnMainThread(void (*method)(void *), void *param);
+
 /****************** METHODES DE GESTION DU TIMER ******************/
 
 /**
  * Démarre le compte à rebours : après l'appel à cette fonction, la fonction
- * onTimer sera appelée régulièrement par la SDL.
+ * onTimerTick sera appelée toutes les TIMER_PERIOD_MS millisecondes par la
+ * boucle principale, sur le thread principal.
  */
 void startTimer();
 
 /**
  * Arrête le compte à rebours : après l'appel à cette fonction, la fonction
- * onTimer ne sera plus appelée régulièrement par la SDL.
+ * onTimerTick ne sera plus appelée par la boucle principale.
  */
 void stopTimer();
 
@@ -79,6 +140,20 @@ void stopTimer();
  */
 int loadIconMatrix(const char *fileName);
 
+/**
+ * loadIconMatrices utilise plusieurs matrices d'icônes à la fois : les icônes
+ * sont numérotées à la suite d'une matrice à l'autre (les nbIcons[0] premières
+ * icônes sont celles de la première matrice, etc.). Les matrices déjà chargées
+ * ne sont pas relues depuis le disque.
+ *
+ * @param  fileNames Chemins d'accès aux fichiers d'image
+ * @param  nbIcons   Nombre d'icônes de chaque matrice (NULL : toutes les cases)
+ * @param  count     Nombre de matrices
+ * @return           1 si les images ont été chargées correctement, 0 sinon
+ */
+int loadIconMatrices(const char *const *fileNames, const int *nbIcons,
+                     int count);
+
 /****************** METHODES DE DESSIN ******************/
 
 /**
@@ -101,7 +176,8 @@ void requestRedraw();
 /**
  * Affiche le texte donné en paramètre à la position indiquée. Le texte
  * sera aligné par rapport à la position indiquée en fonction des paramètres
- * d'alignement.
+ * d'alignement. Le texte est dessiné sans fond, à partir de l'atlas de la
+ * police (voir font.h).
  *
  * @param  message Texte à utiliser pour le titre du jeu
  * @param  x       Coordonnée x du point de dessin du texte
@@ -111,7 +187,7 @@ void requestRedraw();
  * @return         1 si le dessin a réussi, 0 sinon.
  */
 int drawText(const char *message, int x, int y, HAlign hAlign, VAlign vAlign,
-													int textR, int textG, int textB, int bgShade);
+             int textR, int textG, int textB);
 
 /**
  * Remplit un disque d'une couleur donnée.
@@ -153,6 +229,30 @@ void drawCircle(int x0, int y0, int radius, uint8_t fr, uint8_t fg, uint8_t fb,
  */
 void drawCardShape(CardPosition card, int w, uint8_t bgr, uint8_t bgg, uint8_t bgb, uint8_t fgr, uint8_t fgg, uint8_t fgb);
 
+/**
+ * Calcule la position à l'écran (centerX, centerY) d'une icône d'une carte,
+ * à partir de ses coordonnées polaires par rapport au centre de la carte.
+ *
+ * @param cardPos La position de la carte (haut ou bas)
+ * @param icon    L'icône dont calculer la position
+ */
+void layoutIcon(CardPosition cardPos, Icon *icon);
+
+/**
+ * Calcule la position à l'écran de toutes les icônes d'une carte. Le calcul ne
+ * dessine rien et peut être effectué sans fenêtre.
+ *
+ * @param cardPos La position de la carte (haut ou bas)
+ * @param card    La carte
+ */
+void layoutCard(CardPosition cardPos, Card card);
+
+/**
+ * Invalide le rendu en cache de toutes les cartes (icônes rechargées) : elles
+ * seront redessinées à leur prochain affichage.
+ */
+void invalidateCardCache();
+
 /**
  * drawIcon dessine un icône dans la carte spécifiée. L'emplacement de
  * l'icône est donnée en coordonnées polaires par rapport au centre de la carte.
@@ -180,6 +280,94 @@ void drawCardShape(CardPosition card, int w, uint8_t bgr, uint8_t bgg, uint8_t b
  */
 void drawIcon(CardPosition cardPos, Icon icon, int *centerX, int *centerY);
 
+/**
+ * Retourne la taille à l'écran d'une icône d'une carte.
+ *
+ * @param  cardPos La position de la carte
+ * @param  icon    L'icône
+ * @return         La taille de l'icône (en pixels)
+ */
+int getIconDrawSize(CardPosition cardPos, Icon icon);
+
+/**
+ * Dessine une carte complète (bord, fond et icônes, placées par layoutCard).
+ * Le fond et les icônes sont rendus une seule fois dans une texture propre à
+ * la position de la carte, puis recopiés à chaque image tant que la carte
+ * n'est pas replacée : dessiner une carte coûte deux copies de texture, quel
+ * que soit son nombre d'icônes, y compris pendant une animation (voir
+ * getCardTransform).
+ *
+ * @param cardPos La position de la carte
+ * @param card    La carte
+ * @param w       L'épaisseur du bord
+ * @param bgr     Valeur R de la couleur de fond
+ * @param bgg     Valeur G de la couleur de fond
+ * @param bgb     Valeur B de la couleur de fond
+ * @param fgr     Valeur R de la couleur du bord
+ * @param fgg     Valeur G de la couleur du bord
+ * @param fgb     Valeur B de la couleur du bord
+ */
+void drawCardCached(CardPosition cardPos, Card card, int w, uint8_t bgr,
+                    uint8_t bgg, uint8_t bgb, uint8_t fgr, uint8_t fgg,
+                    uint8_t fgb);
+
+/**
+ * Dessine une icône d'une carte agrandie et transparente, par-dessus les
+ * cartes (mise en évidence animée d'une icône).
+ *
+ * @param cardPos La position de la carte
+ * @param icon    L'icône (placée par layoutCard)
+ * @param scale   L'agrandissement de l'icône
+ * @param alpha   L'opacité de l'icône (entre 0 et 1)
+ */
+void drawIconOverlay(CardPosition cardPos, Icon icon, double scale,
+                     double alpha);
+
+/**
+ * Prépare le rendu en cache d'une carte qui sera affichée plus tard (paire
+ * distribuée à l'avance) : à son premier dessin par drawCardCached à cette
+ * position, avec le même fond, sa texture est reprise sans nouveau rendu.
+ *
+ * @param cardPos La position où la carte sera affichée
+ * @param card    La carte (placée par layoutCard)
+ * @param w       L'épaisseur du bord
+ * @param bgr     Valeur R de la couleur de fond
+ * @param bgg     Valeur G de la couleur de fond
+ * @param bgb     Valeur B de la couleur de fond
+ */
+void prepareCardCached(CardPosition cardPos, Card card, int w, uint8_t bgr,
+                       uint8_t bgg, uint8_t bgb);
+
+/**
+ * Affiche un bouton rond : un disque de fond clair entouré d'un anneau de la
+ * couleur du texte, et le texte centré. Le rendu de chaque bouton est conservé
+ * en cache jusqu'au prochain changement d'échelle : un bouton déjà dessiné
+ * coûte une seule copie de texture.
+ *
+ * @param x       Abscisse du centre du bouton
+ * @param y       Ordonnée du centre du bouton
+ * @param radius  Rayon du bouton (milieu de l'anneau)
+ * @param w       Epaisseur de l'anneau
+ * @param text    Texte du bouton
+ * @param textR   Valeur R de la couleur du texte et de l'anneau
+ * @param textG   Valeur G de la couleur du texte et de l'anneau
+ * @param textB   Valeur B de la couleur du texte et de l'anneau
+ * @param bgShade Niveau de gris du fond
+ */
+void drawButton(int x, int y, int radius, int w, const char *text, int textR,
+                int textG, int textB, int bgShade);
+
+/****************** METHODES DE GESTION DE L'ECHELLE ******************/
+
+/**
+ * Retourne l'échelle de rendu courante (WIN_SCALE), calculée à partir de la
+ * taille de la fenêtre en pixels. Vaut DEFAULT_WIN_SCALE tant que la fenêtre
+ * n'a pas été créée (relecture sans affichage).
+ *
+ * @return L'échelle de rendu
+ */
+double getWindowScale();
+
 /****************** METHODES DE GESTION DU CYCLE DE VIE ******************/
 
 /**
@@ -194,6 +382,28 @@ void drawIcon(CardPosition cardPos, Icon icon, int *centerX, int *centerY);
  */
 int initializeGraphics();
 
+/**
+ * Initialise les bibliothèques comme initializeGraphics, mais sans fenêtre ni
+ * affichage : le dessin est fait par le rendu logiciel de la SDL dans une
+ * image en mémoire (format RGBA32), à l'échelle donnée par sa taille.
+ *
+ * @param  width  La largeur de l'image de rendu (en pixels)
+ * @param  height La hauteur de l'image de rendu (en pixels)
+ * @return        1 si la SDL a été initialisée correctement, 0 sinon.
+ */
+int initializeOffscreenGraphics(int width, int height);
+
+/**
+ * Retourne l'image de rendu sans fenêtre, une fois les opérations de dessin
+ * terminées.
+ *
+ * @param  width  La largeur de l'image (en pixels)
+ * @param  height La hauteur de l'image (en pixels)
+ * @param  pitch  La longueur d'une ligne de l'image (en octets)
+ * @return        Le premier pixel (format RGBA32), NULL avec une fenêtre
+ */
+const uint8_t *getFramePixels(int *width, int *height, int *pitch);
+
 /**
  * Attend qu'un évènement utilisateur soit émis, puis traite l'évènement.
  *
@@ -202,6 +412,11 @@ int initializeGraphics();
  */
 void mainLoop();
 
+/**
+ * Termine la boucle principale après le traitement de l'évènement en cours.
+ */
+void quitMainLoop();
+
 /**
  * Libère les ressources graphiques utilisées par la bibliothèque SDL.
  */
@@ -0,0 +1,112 @@
+#ifndef ICONINDEX_H
+#define ICONINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dobble-config.h"
+
+/* Version du format des fichiers d'index */
+#define ICON_INDEX_VERSION 1
+
+/* Nombre de blocs par côté d'une icône (blocs de 10x10 pixels) */
+#define ICON_INDEX_GRID 9
+#define ICON_INDEX_BLOCK (ICON_SIZE / ICON_INDEX_GRID)
+
+/* Nombre d'anneaux du profil radial (anneaux de 5 pixels autour du centre) */
+#define ICON_INDEX_RINGS 9
+
+/* Nombre de cases de l'histogramme de couleurs (4 niveaux par composante) */
+#define ICON_INDEX_HIST_BINS 64
+
+/* Nombre de plus proches voisins de chaque icône enregistrés dans l'index */
+#define ICON_INDEX_NEIGHBOURS 8
+
+/* Distance (sur 1000) en dessous de laquelle deux icônes sont confondables */
+#define ICON_INDEX_CONFUSABLE 50
+
+/* Nombre maximal d'icônes indexées du jeu d'icônes courant */
+#define ICON_INDEX_MAX_ICONS 512
+
+/**
+ * Signature compacte d'une icône de 90x90 pixels (163 octets).
+ */
+typedef struct {
+  // Opacité moyenne de chaque bloc de 10x10 pixels
+  uint8_t mask[ICON_INDEX_GRID * ICON_INDEX_GRID];
+  // Opacité moyenne par anneau autour du centre (invariante par rotation,
+  // les icônes étant dessinées tournées)
+  uint8_t rings[ICON_INDEX_RINGS];
+  // Empreinte perceptuelle (dHash) : un bit par paire de blocs voisins d'une
+  // rangée, vrai si le bloc de gauche est plus foncé (sur fond blanc)
+  uint8_t hash[ICON_INDEX_GRID];
+  // Histogramme des couleurs des pixels opaques (total 255)
+  uint8_t histogram[ICON_INDEX_HIST_BINS];
+} IconSignature;
+
+/**
+ * Index de similarité des icônes : un analyseur hors ligne calcule la
+ * signature de chaque icône d'un pack et enregistre, à côté de l'image du pack
+ * (extension .idx), les signatures et les plus proches voisins de chaque
+ * icône. Le jeu charge les index des packs utilisés et en déduit les paires
+ * d'icônes confondables, évitées lors du choix des icônes d'une partie et lors
+ * des tirages de paires de cartes.
+ *
+ * Le calcul des signatures (luminance et opacité de chaque pixel, sommes par
+ * bloc) est vectorisé avec SSE2 lorsqu'il est disponible.
+ */
+
+/**
+ * Calcule la signature d'une icône.
+ *
+ * @param pixels    Le premier pixel de l'icône (format RGBA32)
+ * @param pitch     La longueur d'une ligne de l'image (en octets)
+ * @param signature La signature à remplir
+ */
+void iconIndexDescribe(const uint8_t *pixels, int pitch,
+                       IconSignature *signature);
+
+/**
+ * Calcule la distance entre deux signatures.
+ *
+ * @return La distance, de 0 (icônes identiques) à 1000
+ */
+int iconIndexDistance(const IconSignature *a, const IconSignature *b);
+
+/**
+ * Analyse un pack d'icônes et écrit son index (même nom que l'image, avec
+ * l'extension .idx) dans le dossier de données sur disque.
+ *
+ * @param  imageFile Le nom de l'image du pack (voir assets.h)
+ * @param  nbIcons   Le nombre d'icônes du pack
+ * @return           1 si l'index a été écrit, 0 sinon
+ */
+int iconIndexBuild(const char *imageFile, int nbIcons);
+
+/**
+ * Charge les index des packs du jeu d'icônes courant. Les icônes sont
+ * numérotées à la suite d'un pack à l'autre, comme dans le gestionnaire
+ * d'atlas ; un pack sans index n'a aucune icône confondable.
+ *
+ * @param imageFiles Les noms des images des packs (voir assets.h)
+ * @param nbIcons    Le nombre d'icônes de chaque pack
+ * @param count      Le nombre de packs
+ */
+void iconIndexUse(const char *const *imageFiles, const int *nbIcons,
+                  int count);
+
+/**
+ * Retourne les icônes confondables avec une icône du jeu d'icônes courant.
+ *
+ * @param  iconId L'identifiant de l'icône
+ * @param  count  Le nombre d'icônes confondables
+ * @return        Les identifiants des icônes confondables
+ */
+const uint16_t *iconIndexConfusables(int iconId, int *count);
+
+/**
+ * Indique si deux icônes du jeu d'icônes courant sont confondables.
+ */
+bool iconIndexConfusable(int a, int b);
+
+#endif /*ICONINDEX_H*/
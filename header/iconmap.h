@@ -0,0 +1,76 @@
+#ifndef ICONMAP_H
+#define ICONMAP_H
+
+/* Nombre maximal de symboles d'un deck et d'icônes du jeu d'icônes pris en
+ * compte pour le choix des icônes */
+#define ICON_MAP_MAX_SYMBOLS 512
+
+/**
+ * Choix des icônes dessinées pour les symboles du deck.
+ */
+typedef enum {
+  ICON_MAP_IDENTITY, // le symbole n est dessiné avec l'icône n
+  ICON_MAP_RANDOM,   // icônes tirées parmi les moins utilisées de la session
+  ICON_MAP_CURATED,  // icônes d'une liste choisie à la main
+  ICON_MAP_DISTINCT  // icônes aussi différentes que possible (couleur, forme)
+} IconMapMode;
+
+/**
+ * Correspondance entre les symboles du deck (identifiants lus par
+ * readCardFile) et les icônes du jeu d'icônes courant, choisie une fois par
+ * partie : elle est écrite dans le champ imageId des icônes de toutes les
+ * cartes du deck, et le dessin n'a ainsi aucune table à consulter.
+ *
+ * Un deck utilise n² + n + 1 symboles pour l'ordre n : sans correspondance, un
+ * deck de 13 cartes n'utiliserait que les 13 premières icônes d'un pack de 80.
+ * Les symboles présents sur le plus de cartes reçoivent les premières icônes
+ * choisies (les plus différentes, ou les premières de la liste), et chaque
+ * icône compte dans la session autant d'utilisations que de cartes où elle a
+ * été dessinée : les tirages suivants favorisent les icônes les moins vues.
+ *
+ * Les symboles du deck restent inchangés (iconId) : la logique du jeu, le
+ * réseau et les enregistrements ne dépendent pas des icônes choisies.
+ */
+
+/**
+ * Choisit la façon dont les icônes sont attribuées aux symboles.
+ *
+ * @param mode Le mode de choix des icônes
+ */
+void iconMapSetMode(IconMapMode mode);
+
+/**
+ * Charge une liste d'icônes choisies à la main et passe en mode
+ * ICON_MAP_CURATED. Le fichier contient les identifiants des icônes (dans le
+ * jeu d'icônes courant), par ordre de préférence ; les icônes manquantes sont
+ * complétées par les moins utilisées.
+ *
+ * @param  fileName Le nom du fichier de liste
+ * @return          1 si la liste a été chargée, 0 sinon
+ */
+int iconMapLoadList(const char *fileName);
+
+/**
+ * Choisit les icônes de la partie pour le deck et le jeu d'icônes courants,
+ * puis les attribue aux cartes du deck.
+ */
+void iconMapBuild();
+
+/**
+ * Impose une correspondance (relecture d'un enregistrement) et l'attribue aux
+ * cartes du deck.
+ *
+ * @param table La correspondance (icône de chaque symbole)
+ * @param size  Le nombre de symboles de la correspondance
+ */
+void iconMapSet(const int *table, int size);
+
+/**
+ * Retourne la correspondance courante.
+ *
+ * @param  size Le nombre de symboles de la correspondance
+ * @return      L'icône de chaque symbole
+ */
+const int *iconMapTable(int *size);
+
+#endif /*ICONMAP_H*/
@@ -0,0 +1,83 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "dobble.h"
+
+/* Nombre d'appels de chaque noyau par mesure de cardKernelsBench, et nombre
+ * de mesures (la meilleure est gardée) */
+#define KERNELS_BENCH_ITERATIONS 200000
+#define KERNELS_BENCH_ROUNDS 5
+
+/**
+ * Noyaux des opérations faites sur les icônes d'une carte, générés à la
+ * compilation pour chaque nombre d'icônes par carte des decks fournis (3, 4,
+ * 5, 6, 8, 9 et 10) : boucles entièrement déroulées, tableaux de taille fixe
+ * et comparaisons sans branchement. Les autres decks (recherchés avec
+ * --search-deck) utilisent les noyaux génériques, qui bouclent sur
+ * gameGlobal.nbIcons.
+ *
+ * Les noyaux d'un deck sont choisis une fois, au chargement du deck, dans une
+ * table indexée par le nombre d'icônes par carte. Ils font les mêmes tirages
+ * aléatoires, dans le même ordre, que les noyaux génériques : les parties
+ * enregistrées sont relues à l'identique.
+ */
+typedef struct {
+  int nbIcons; // 0 pour les noyaux génériques
+
+  /**
+   * Cherche l'icône commune à deux cartes.
+   *
+   * @param  upper Les icônes de la première carte
+   * @param  lower Les icônes de la seconde carte
+   * @return       L'indice de l'icône commune dans upper, -1 si aucune
+   */
+  int (*commonIcon)(const Icon *upper, const Icon *lower);
+
+  /**
+   * Cherche l'icône d'une carte qui porte un symbole donné.
+   *
+   * @param  icons  Les icônes de la carte
+   * @param  symbol Le symbole
+   * @return        L'indice de l'icône, -1 si aucune
+   */
+  int (*findSymbol)(const Icon *icons, int symbol);
+
+  /**
+   * Remet les icônes d'une carte dans l'ordre croissant de leurs numéros
+   * (voir sortIcons).
+   */
+  void (*sortIcons)(Icon *icons);
+
+  /**
+   * Mélange les icônes d'une carte (voir shuffle).
+   */
+  void (*shuffle)(Icon *icons);
+
+  /**
+   * Place aléatoirement les icônes d'une carte (voir initCardIcons).
+   */
+  void (*placeIcons)(Icon *icons);
+} CardKernels;
+
+/**
+ * Choisit les noyaux d'un deck.
+ *
+ * @param nbIcons Le nombre d'icônes par carte du deck
+ */
+void cardKernelsUse(int nbIcons);
+
+/**
+ * Retourne les noyaux du deck courant.
+ */
+const CardKernels *cardKernels();
+
+/**
+ * Compare le temps d'appel des noyaux générés à celui des noyaux génériques,
+ * pour chaque nombre d'icônes par carte, sur des paires de cartes tirées au
+ * hasard, et affiche les résultats.
+ *
+ * @return 0
+ */
+int cardKernelsBench();
+
+#endif /*KERNELS_H*/
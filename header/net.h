@@ -0,0 +1,235 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dobble.h"
+
+/* Version du protocole réseau */
+#define NET_PROTOCOL_VERSION 1
+
+/* Port UDP par défaut du serveur */
+#define NET_DEFAULT_PORT 4242
+
+/* Taille maximale d'un message */
+#define NET_MAX_PACKET 128
+
+/* Nombre maximal de joueurs d'une partie en réseau */
+#define NET_MAX_PLAYERS RACE_MAX_PLAYERS
+
+/* Délai pendant lequel le serveur attend d'autres réponses après la première
+ * bonne réponse reçue, avant de désigner le plus rapide (en ms). Il couvre
+ * l'écart de latence entre joueurs (jusqu'à 150 ms d'aller-retour) */
+#define NET_FAIRNESS_WINDOW_MS 150
+
+/* Tolérance sur l'instant d'affichage d'une paire déclaré par un client, au
+ * delà de la moitié de son aller-retour mesuré (en ms) */
+#define NET_DISPLAY_TOLERANCE_MS 50
+
+/* Aller-retour maximal d'un client retenu par le serveur (en ms) : l'aller-
+ * retour déclaré par un client ne peut pas reculer davantage l'instant
+ * d'affichage de la paire (au plus NET_MAX_RTT_MS / 2 +
+ * NET_DISPLAY_TOLERANCE_MS après son envoi) */
+#define NET_MAX_RTT_MS NET_FAIRNESS_WINDOW_MS
+
+/* Période de réémission de l'état de la partie et des réponses (en ms) */
+#define NET_RESEND_MS 200
+
+/* Période de synchronisation des horloges (en ms) */
+#define NET_SYNC_PERIOD_MS 500
+
+/* Nombre de mesures de synchronisation conservées (la mesure d'aller-retour
+ * le plus court est retenue) */
+#define NET_SYNC_SAMPLES 8
+
+/* Délai au-delà duquel un joueur silencieux est déconnecté (en ms) */
+#define NET_TIMEOUT_MS 5000
+
+/* Durée pendant laquelle un joueur ne peut plus répondre après une erreur (en
+ * ms) */
+#define NET_LOCKOUT_MS 1000
+
+/**
+ * Types de messages. Chaque message est un octet de version, un octet de type
+ * puis des entiers encodés en varint (zigzag pour les entiers signés).
+ *
+ * L'état de la partie est réémis régulièrement par le serveur et les réponses
+ * des clients jusqu'à leur prise en compte : la perte d'un message UDP ne fait
+ * que retarder sa prise en compte.
+ */
+typedef enum {
+  NET_HELLO = 1,  // client → serveur : demande de connexion
+  NET_WELCOME,    // serveur → client : joueur, nombre d'icônes, packs
+  NET_SYNC,       // client → serveur : t0, dernier aller-retour mesuré
+  NET_SYNC_REPLY, // serveur → client : t0, t1 (réception), t2 (émission)
+  NET_STATE,      // serveur → client : état de la partie
+  NET_CLAIM,      // client → serveur : réponse pour une paire
+  NET_READY,      // client → serveur : prêt pour la partie suivante
+  NET_BYE         // client → serveur : déconnexion
+} NetMessageType;
+
+/**
+ * Phase d'une partie en réseau.
+ */
+typedef enum {
+  NET_WAITING = 0, // attente des joueurs
+  NET_PLAYING,     // partie en cours
+  NET_ENDED        // partie terminée
+} NetPhase;
+
+/**
+ * Message décodé. Seuls les champs du type de message sont significatifs.
+ * Les instants sont exprimés sur l'horloge du serveur (en µs), sauf t0 qui
+ * est sur l'horloge du client.
+ */
+typedef struct {
+  NetMessageType type;
+  int player;            // WELCOME : numéro du joueur
+  int nbIcons, packMask; // WELCOME : deck et packs de la partie
+  int64_t t0, t1, t2;    // SYNC, SYNC_REPLY
+  int rttMs;             // SYNC : aller-retour mesuré par le client
+  NetPhase phase;        // STATE
+  int round;             // STATE : numéro de la partie
+  uint32_t seq;          // STATE, CLAIM : numéro de la paire
+  int upper, lower;      // STATE : indices des cartes de la paire
+  int64_t deadline;      // STATE : fin de la partie
+  int lastWinner;        // STATE : gagnant de la paire précédente, ou -1
+  int nbPlayers;         // STATE : nombre de joueurs
+  int scores[NET_MAX_PLAYERS]; // STATE : scores des joueurs
+  int iconId;            // CLAIM : icône choisie sur la carte du haut
+  int64_t shownAt, at;   // CLAIM : affichage de la paire et appui
+} NetMessage;
+
+/**
+ * Encode un message.
+ *
+ * @param  msg  Le message
+ * @param  buf  Le tampon de sortie (au moins NET_MAX_PACKET octets)
+ * @return      La taille du message encodé, 0 en cas d'erreur
+ */
+int netEncode(const NetMessage *msg, uint8_t *buf);
+
+/**
+ * Décode un message.
+ *
+ * @param  buf Le message reçu
+ * @param  len Sa taille
+ * @param  msg Le message décodé
+ * @return     1 si le message est valide, 0 sinon
+ */
+int netDecode(const uint8_t *buf, int len, NetMessage *msg);
+
+/**
+ * Ouvre une socket UDP.
+ *
+ * @param  port Le port local (0 : port quelconque)
+ * @return      La socket, -1 en cas d'échec
+ */
+int netOpenSocket(int port);
+
+/**
+ * Résout une adresse de la forme "hôte:port" (port par défaut :
+ * NET_DEFAULT_PORT).
+ *
+ * @param  address L'adresse
+ * @param  out     L'adresse résolue (struct sockaddr_in)
+ * @return         1 si l'adresse a été résolue, 0 sinon
+ */
+int netResolve(const char *address, void *out);
+
+/**
+ * Retourne le symbole commun à deux cartes du deck.
+ */
+int netCommonIcon(int upper, int lower);
+
+/****************** SERVEUR ******************/
+
+/**
+ * Lance un serveur de jeu (sans fenêtre), qui distribue les paires et désigne
+ * le joueur le plus rapide. Une partie commence lorsque tous les joueurs
+ * attendus sont connectés et prêts.
+ *
+ * @param  port      Le port UDP d'écoute
+ * @param  nbPlayers Le nombre de joueurs attendus
+ * @param  nbIcons   Le nombre d'icônes par carte
+ * @param  packMask  Les packs d'icônes utilisés par les clients
+ * @return           Le code de retour du programme
+ */
+int netRunServer(int port, int nbPlayers, int nbIcons, int packMask);
+
+/****************** CLIENT ******************/
+
+/**
+ * Se connecte à un serveur de jeu. Les messages sont reçus par un thread
+ * dédié puis traités par la boucle principale.
+ *
+ * @param  address L'adresse du serveur ("hôte:port")
+ * @return         1 si la connexion a démarré, 0 sinon
+ */
+int netConnect(const char *address);
+
+/**
+ * Indique si le jeu est connecté à un serveur.
+ */
+bool netActive();
+
+/**
+ * Indique si la partie en réseau est en cours.
+ */
+bool netPlaying();
+
+/**
+ * Indique si une bonne réponse prédite attend la confirmation du serveur (elle
+ * reste alors affichée).
+ */
+bool netAwaitingConfirmation();
+
+/**
+ * Traite un appui pendant une partie en réseau : le résultat est prédit et
+ * affiché immédiatement, puis confirmé par le serveur.
+ *
+ * @param x  Abscisse de l'appui
+ * @param y  Ordonnée de l'appui
+ * @param at Instant de l'appui (en µs, horloge monotone locale)
+ */
+void netOnPointerDown(int x, int y, int64_t at);
+
+/**
+ * Affiche l'état de la connexion en dehors des parties.
+ */
+void netRenderStatus();
+
+/**
+ * Affiche le classement de fin de partie en réseau.
+ */
+void netShowResults();
+
+/**
+ * Demande la partie suivante au serveur (menu de fin).
+ */
+void netRequestNextRound();
+
+/**
+ * Se déconnecte du serveur.
+ */
+void netShutdown();
+
+/****************** PROXY ******************/
+
+/**
+ * Lance un relais UDP entre des clients et un serveur, qui retarde chaque
+ * message d'une latence fixe plus une gigue aléatoire et peut en perdre une
+ * partie, pour tester le jeu dans des conditions réseau dégradées.
+ *
+ * @param  port      Le port d'écoute des clients
+ * @param  server    L'adresse du serveur ("hôte:port")
+ * @param  latencyMs La latence ajoutée dans chaque sens (en ms)
+ * @param  jitterMs  L'amplitude de la gigue (en ms, ± autour de la latence)
+ * @param  lossPct   Le pourcentage de messages perdus
+ * @return           Le code de retour du programme
+ */
+int netRunProxy(int port, const char *server, int latencyMs, int jitterMs,
+                int lossPct);
+
+#endif /*NET_H*/
@@ -0,0 +1,104 @@
+#ifndef PACKS_H
+#define PACKS_H
+
+#include <stdint.h>
+
+/* Nombre maximal de packs d'icônes (numéros de pack de 0 à PACKS_MAX - 1) */
+#define PACKS_MAX 16
+
+/* Nombre maximal d'icônes par carte d'un deck */
+#define DECKS_MAX_ICONS 16
+
+/**
+ * Packs d'icônes et decks du dossier de données : fichiers du dossier sur
+ * disque et fichiers intégrés à l'exécutable (voir assets.h).
+ *
+ * Les packs sont les images du dossier dont les dimensions sont des multiples
+ * de ICON_SIZE. Le manifeste packs.txt fixe l'ordre des premiers packs (leurs
+ * numéros, utilisés par l'option --packs, les menus, les enregistrements et le
+ * réseau), leur nombre d'icônes et leur nom ; les autres images sont ajoutées
+ * à la suite par ordre alphabétique, avec le nombre d'icônes de leur nom de
+ * fichier (Nom_80_90x90pixels.png) ou à défaut de toutes les cases. Seul
+ * l'en-tête de chaque image est lu : aucune image n'est décodée avant le choix
+ * de son pack.
+ *
+ * Un nouveau parcours (voir packsWatch) ne renumérote pas les packs tant que
+ * le manifeste ne change pas : les images déjà numérotées gardent leur numéro,
+ * même supprimées (le pack n'a alors plus d'icônes), et les nouvelles images
+ * sont ajoutées à la suite.
+ *
+ * Les decks sont les fichiers .txt du dossier dont la première ligne donne le
+ * nombre de cartes et le nombre d'icônes par carte ; pour un même nombre
+ * d'icônes, le premier fichier par ordre alphabétique est retenu.
+ *
+ * Ces informations sont gardées en mémoire : un nouveau parcours du dossier ne
+ * relit que les en-têtes des images modifiées.
+ */
+
+/**
+ * Parcourt le dossier de données.
+ *
+ * @return 1 si le dossier a été parcouru, 0 sinon
+ */
+int packsScan();
+
+/**
+ * Surveille le dossier de données sur disque s'il y en a un (inotify, sous
+ * Linux) : à chaque fichier modifié, le dossier est parcouru à nouveau et, sur
+ * le thread principal, le pack d'icônes modifié est rechargé s'il est
+ * résident, l'index de similarité des packs utilisés est relu, ou la
+ * description des menus est relue.
+ */
+void packsWatch();
+
+/**
+ * Retourne le nombre de packs d'icônes.
+ */
+int packsCount();
+
+/**
+ * Retourne le nom de l'image d'un pack dans le dossier de données (voir
+ * assets.h).
+ *
+ * @param  pack Le numéro du pack
+ * @return      Le nom, NULL si le pack n'existe pas
+ */
+const char *packsFile(int pack);
+
+/**
+ * Retourne le nombre d'icônes d'un pack.
+ *
+ * @param  pack Le numéro du pack
+ * @return      Le nombre d'icônes, 0 si le pack n'existe pas ou si son image
+ *              est absente
+ */
+int packsIconCount(int pack);
+
+/**
+ * Retourne une empreinte d'un ensemble de packs, tirée des noms de leurs
+ * images : contrairement aux numéros de pack, elle ne dépend ni du manifeste
+ * ni des autres images du dossier.
+ *
+ * @param  packMask Les packs (bit i : pack numéro i)
+ * @return          L'empreinte (jamais nulle), 0 si un pack n'existe pas
+ */
+uint32_t packsIdentity(int packMask);
+
+/**
+ * Retourne le nom d'un pack.
+ *
+ * @param  pack Le numéro du pack
+ * @return      Le nom, NULL si le pack n'existe pas
+ */
+const char *packsName(int pack);
+
+/**
+ * Retourne le fichier du deck correspondant à un nombre d'icônes par carte.
+ *
+ * @param  nbIcons Le nombre d'icônes par carte
+ * @return         Le nom du fichier dans le dossier de données (voir
+ *                 assets.h), NULL si aucun deck ne correspond
+ */
+const char *packsDeckFile(int nbIcons);
+
+#endif /*PACKS_H*/
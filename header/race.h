@@ -0,0 +1,96 @@
+#ifndef RACE_H
+#define RACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Durée pendant laquelle un joueur ne peut plus répondre après une erreur (en
+ * millisecondes) */
+#define RACE_LOCKOUT_MS 1000
+
+/**
+ * Mode course : de 2 à RACE_MAX_PLAYERS joueurs ont chacun leur carte devant
+ * eux et jouent en même temps, selon l'une des variantes officielles :
+ *
+ * - la tour infernale : le premier qui touche sur sa carte le symbole commun
+ *   avec la carte centrale marque un point et prend la carte centrale, qui
+ *   est remplacée par une nouvelle carte du deck ;
+ * - le puits : chaque joueur a une pile de cartes. Le premier qui touche sur
+ *   sa carte le symbole commun avec la carte centrale pose sa carte au
+ *   centre ; le premier qui a vidé sa pile gagne ;
+ * - la patate chaude : un joueur qui touche sur sa carte un symbole présent
+ *   sur la carte d'un autre joueur lui donne sa carte et les cartes qu'il a
+ *   reçues, puis reçoit une nouvelle carte du deck ;
+ * - le cadeau empoisonné : un joueur qui touche sur la carte centrale un
+ *   symbole présent sur la carte d'un autre joueur la lui donne.
+ *
+ * Dans les variantes où le joueur doit donner des cartes, le gagnant est
+ * celui qui en a reçu le moins.
+ *
+ * Chaque joueur répond en touchant (ou cliquant) sa propre carte : les appuis
+ * sont attribués au joueur dont la carte est touchée, et un joueur qui se
+ * trompe est bloqué pendant RACE_LOCKOUT_MS. Au cadeau empoisonné, les appuis
+ * sur la carte centrale ne désignent aucun joueur : les erreurs ne sont pas
+ * pénalisées.
+ */
+
+typedef enum {
+  RACE_TOWER,         // la tour infernale
+  RACE_WELL,          // le puits
+  RACE_HOT_POTATO,    // la patate chaude
+  RACE_POISONED_GIFT  // le cadeau empoisonné
+} RaceVariant;
+
+/**
+ * Active le mode course pour un nombre de joueurs donné, ou le désactive.
+ *
+ * @param nbPlayers Le nombre de joueurs (entre 2 et RACE_MAX_PLAYERS), 0 pour
+ *                  revenir au mode classique
+ * @param variant   La variante jouée
+ */
+void raceSetup(int nbPlayers, RaceVariant variant);
+
+/**
+ * Lit le nom d'une variante (option --variant).
+ *
+ * @param  name    Le nom : tour, puits, patate ou cadeau
+ * @param  variant Reçoit la variante
+ * @return         1 si le nom est valide, 0 sinon
+ */
+int raceParseVariant(const char *name, RaceVariant *variant);
+
+/**
+ * Indique si le mode course est actif.
+ */
+bool raceActive();
+
+/**
+ * Début d'une partie en mode course : remet les scores à zéro et distribue une
+ * carte à chaque joueur ainsi que la carte centrale (sauf à la patate chaude).
+ */
+void raceDeal();
+
+/**
+ * Traite un appui pendant une partie en mode course.
+ *
+ * Les appuis sont traités dans l'ordre chronologique : le premier appui
+ * correct l'emporte, et les appuis antérieurs au dernier changement des
+ * cartes en jeu (visant donc les cartes précédentes) sont ignorés.
+ *
+ * @param x  Abscisse de l'appui
+ * @param y  Ordonnée de l'appui
+ * @param at Instant de l'appui (en µs, horloge monotone)
+ */
+void raceOnPointerDown(int x, int y, int64_t at);
+
+/**
+ * Dessine les cartes et les scores d'une partie en mode course.
+ */
+void raceRender();
+
+/**
+ * Affiche le classement de fin de partie en mode course.
+ */
+void raceShowResults();
+
+#endif /*RACE_H*/
@@ -0,0 +1,118 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Taille du tampon d'enregistrement d'une partie (alloué en début de partie,
+ * environ 10 octets par évènement) */
+#define REPLAY_BUFFER_SIZE (1 << 20)
+
+/* Subdivisions d'un pixel logique des positions de clic enregistrées : un clic
+ * relu tombe sur le même pixel de la fenêtre à toute échelle */
+#define REPLAY_CLICK_UNIT 256
+
+/* Version du format d'enregistrement */
+#define REPLAY_VERSION 5
+
+/**
+ * Types d'évènements d'un enregistrement. Chaque évènement est un octet de
+ * type suivi d'entiers encodés en varint (LEB128), les instants étant codés
+ * en différence (µs) par rapport à l'évènement horodaté précédent et les
+ * positions de clic (en coordonnées logiques, à l'échelle 1, en virgule fixe
+ * : 1/REPLAY_CLICK_UNIT pixel) en différence (zigzag) par rapport au clic
+ * précédent.
+ */
+typedef enum {
+  REPLAY_DEAL = 1,  // tirage d'une paire : indice haut, indice bas
+  REPLAY_SHOWN = 2, // première image de la paire : delta temps
+  REPLAY_CLICK = 3, // clic : delta temps, delta x, delta y
+  REPLAY_END = 4    // fin de partie : delta temps, score, nombre d'erreurs
+} ReplayEventType;
+
+/**
+ * Active l'enregistrement des parties dans un fichier (tronqué). Chaque partie
+ * est ajoutée au fichier sous forme d'un segment à la fin de la partie.
+ *
+ * @param  fileName Le nom du fichier d'enregistrement
+ * @return          1 si le fichier a pu être créé, 0 sinon
+ */
+int replayStartRecording(const char *fileName);
+
+/**
+ * Début d'une partie : en enregistrement, écrit l'en-tête du segment (graine
+ * du générateur aléatoire, packs, deck, score initial) dans le tampon.
+ */
+void replayBeginRound();
+
+/**
+ * Tirage d'une nouvelle paire : en enregistrement, ajoute le tirage au tampon ;
+ * en relecture, vérifie que le tirage est identique à celui enregistré.
+ *
+ * @param upper Indice de la carte du haut dans le deck
+ * @param lower Indice de la carte du bas dans le deck
+ */
+void replayDeal(int upper, int lower);
+
+/**
+ * Enregistre l'instant d'affichage de la paire courante.
+ *
+ * @param shownAt L'instant d'affichage, celui dont part le temps de réaction
+ *                (en µs, horloge monotone)
+ */
+void replayRecordShown(int64_t shownAt);
+
+/**
+ * Enregistre un clic pendant une partie.
+ *
+ * @param x  Abscisse du clic
+ * @param y  Ordonnée du clic
+ * @param at L'instant du clic, celui auquel le temps de réaction est mesuré
+ *           (en µs, horloge monotone)
+ */
+void replayRecordClick(int x, int y, int64_t at);
+
+/**
+ * Fin d'une partie : en enregistrement, ajoute le résultat au tampon et
+ * l'écrit sur le disque en arrière-plan.
+ *
+ * @param score   Le score final
+ * @param nbFalse Le nombre d'erreurs
+ */
+void replayEndRound(int score, int nbFalse);
+
+/**
+ * Relit un enregistrement en temps réel dans la fenêtre de jeu. Les clics de
+ * l'utilisateur sont ignorés pendant la relecture.
+ *
+ * @param  fileName Le nom du fichier d'enregistrement
+ * @return          1 si la relecture a démarré, 0 sinon
+ */
+int replayStartPlayback(const char *fileName);
+
+/**
+ * Relit un enregistrement sans affichage, aussi vite que possible, et vérifie
+ * que les tirages et les résultats de chaque partie sont identiques.
+ *
+ * @param  fileName Le nom du fichier d'enregistrement
+ * @return          0 si la relecture est conforme, 1 sinon
+ */
+int replayRunHeadless(const char *fileName);
+
+/**
+ * Indique si un clic de l'utilisateur doit être pris en compte (faux pendant
+ * une relecture, sauf pour les clics rejoués).
+ */
+bool replayAcceptsClick();
+
+/**
+ * Indique si un enregistrement est en cours de relecture.
+ */
+bool replayPlaying();
+
+/**
+ * Attend la fin des écritures en arrière-plan et libère les tampons.
+ */
+void replayShutdown();
+
+#endif /*REPLAY_H*/
@@ -0,0 +1,121 @@
+#ifndef SCORES_H
+#define SCORES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Version du format du fichier des scores */
+#define SCORES_VERSION 2
+
+/* Nom du fichier des scores par défaut, dans le dossier personnel ($HOME) */
+#define SCORES_DEFAULT_FILE ".dobble-scores"
+
+/* Agrandissement minimal du fichier des scores (en nombre de parties) */
+#define SCORES_GROWTH 65536
+
+/* Scores distingués par le classement (les scores supérieurs sont classés
+ * ex aequo avec SCORES_MAX_VALUE) */
+#define SCORES_MAX_VALUE 4095
+
+/* Nombre de meilleures parties gardées par classement */
+#define SCORES_TOP 5
+
+/* Nombre maximal de classements (deck, packs et mode de jeu distincts) */
+#define SCORES_MAX_BOARDS 1024
+
+/* Modes de jeu d'une partie (ScoreRecord.flags) */
+#define SCORES_ENDLESS 1  // mode sans fin
+#define SCORES_ADAPTIVE 2 // difficulté adaptative (deck variable)
+
+/**
+ * Historique des parties et classements, gardés d'une session à l'autre dans
+ * un fichier projeté en mémoire (mmap) :
+ *
+ *   en-tête (32 octets) : "DOBS", version, taille d'une partie
+ *   parties (32 octets chacune), dans l'ordre où elles ont été jouées
+ *
+ * Les parties ne sont jamais modifiées : chaque partie est écrite après la
+ * dernière, avec une somme de contrôle écrite en dernier. Une partie
+ * interrompue par un arrêt brutal a une somme fausse, et la fin de
+ * l'historique est la première partie dont la somme est fausse (le fichier
+ * est agrandi par blocs de SCORES_GROWTH parties remplies de zéros). Le
+ * fichier est verrouillé (flock) : une seconde instance du jeu joue sans
+ * historique.
+ *
+ * Les classements (un par nombre d'icônes par carte, packs et mode de jeu ;
+ * les packs sont désignés par l'empreinte des noms de leurs images, qui ne
+ * change pas quand les packs sont renumérotés)
+ * sont construits en mémoire à l'ouverture, en une lecture de l'historique :
+ * un arbre de Fenwick compte les parties par score (rang d'un score en
+ * O(log SCORES_MAX_VALUE)) et les SCORES_TOP meilleures parties sont gardées
+ * triées. L'ajout d'une partie ne coûte qu'une écriture de 32 octets dans la
+ * projection et la mise à jour de son classement.
+ */
+
+/**
+ * Partie de l'historique (32 octets).
+ */
+typedef struct {
+  int64_t date;      // fin de la partie (secondes depuis le 1er janvier 1970)
+  int32_t score;
+  int32_t nbFalse;   // nombre d'erreurs
+  int32_t time;      // durée de survie en mode sans fin (en ms), 0 sinon
+  uint32_t packs;    // packs d'icônes (voir packsIdentity)
+  uint8_t nbIcons;   // nombre d'icônes par carte (0 si difficulté adaptative)
+  uint8_t flags;     // SCORES_ENDLESS, SCORES_ADAPTIVE
+  uint16_t reserved;
+  uint32_t check;    // somme de contrôle des 28 premiers octets
+} ScoreRecord;
+
+/**
+ * Place d'une partie dans son classement.
+ */
+typedef struct {
+  int rank;        // rang (1 pour le meilleur score, ex aequo au même rang)
+  int count;       // nombre de parties du classement
+  int best;        // meilleur score du classement
+  bool personalBest; // la partie a le meilleur score (seule ou ex aequo)
+} ScoreRank;
+
+/**
+ * Ouvre (ou crée) le fichier des scores et construit les classements.
+ *
+ * @param  fileName Le nom du fichier
+ * @return          1 si le fichier est ouvert, 0 sinon (les parties ne sont
+ *                  alors pas gardées)
+ */
+int scoresOpen(const char *fileName);
+
+/**
+ * Ferme le fichier des scores.
+ */
+void scoresClose();
+
+/**
+ * Indique si le fichier des scores est ouvert.
+ */
+bool scoresActive();
+
+/**
+ * Ajoute une partie à l'historique et à son classement.
+ *
+ * @param  record La partie (date et somme de contrôle remplies par scoresAdd)
+ * @param  rank   La place de la partie dans son classement
+ * @return        1 si la partie a été ajoutée, 0 sinon
+ */
+int scoresAdd(ScoreRecord *record, ScoreRank *rank);
+
+/**
+ * Retourne les meilleures parties d'un classement.
+ *
+ * @param  nbIcons Le nombre d'icônes par carte (0 si difficulté adaptative)
+ * @param  packs   L'empreinte des packs d'icônes (voir packsIdentity)
+ * @param  flags   Le mode de jeu
+ * @param  top     Les parties, de la meilleure à la moins bonne
+ * @param  max     Le nombre maximal de parties (au plus SCORES_TOP utiles)
+ * @return         Le nombre de parties retournées
+ */
+int scoresTop(int nbIcons, uint32_t packs, int flags, ScoreRecord *top,
+              int max);
+
+#endif /*SCORES_H*/
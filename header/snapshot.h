@@ -0,0 +1,72 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+/* Version du format des sauvegardes */
+#define SNAPSHOT_VERSION 1
+
+/* Nom du fichier de sauvegarde par défaut, dans le dossier personnel ($HOME) */
+#define SNAPSHOT_DEFAULT_FILE ".dobble-snapshot"
+
+/**
+ * Sauvegarde de la partie en cours, pour la reprendre au lancement suivant
+ * (borne éteinte ou redémarrée en pleine partie). La sauvegarde est écrite à
+ * la perte du focus de la fenêtre et à la demande d'arrêt (fermeture de la
+ * fenêtre, ou SIGTERM, que la SDL transforme en demande d'arrêt) :
+ *
+ *   en-tête : "DOBR", version, taille et somme de contrôle du fichier
+ *   état : graine du générateur aléatoire, deck, packs, score, erreurs, temps
+ *          restant (écoulé en mode sans fin), vies, difficulté adaptative,
+ *          cartes de la paire affichée
+ *   icônes des deux cartes affichées (numéros et disposition)
+ *   correspondance entre symboles du deck et icônes de la partie
+ *
+ * Le fichier est écrit à côté, enregistré sur disque (fsync) puis renommé :
+ * une sauvegarde est complète ou absente. Il est supprimé à la fin de la
+ * partie et à sa reprise. Une sauvegarde dont les cartes ou les icônes ne
+ * correspondent plus au deck ou aux packs (modifiés depuis) est ignorée.
+ *
+ * À la reprise, la paire affichée, le score et le temps restant sont rétablis
+ * aussitôt, et le compte à rebours reste arrêté pendant que les images des
+ * packs sont décodées en arrière-plan (voir atlasPrefetch) ; il repart quand
+ * les textures sont créées. Seules les parties jouées seul, ni enregistrées
+ * ni relues, sont sauvegardées.
+ */
+
+/**
+ * Active la sauvegarde de la partie.
+ *
+ * @param fileName Le nom du fichier de sauvegarde
+ */
+void snapshotEnable(const char *fileName);
+
+/**
+ * Sauvegarde la partie en cours (si une partie est en cours, sinon supprime
+ * la sauvegarde précédente).
+ *
+ * @return 1 si la partie a été sauvegardée, 0 sinon
+ */
+int snapshotSave();
+
+/**
+ * Supprime la sauvegarde (fin de la partie).
+ */
+void snapshotDiscard();
+
+/**
+ * Reprend la partie sauvegardée, s'il y en a une : deck, paire affichée,
+ * score et temps restant sont rétablis, et les packs sont chargés en
+ * arrière-plan.
+ *
+ * @return 1 si une partie a été reprise, 0 sinon
+ */
+int snapshotResume();
+
+/**
+ * Indique si une partie reprise attend le chargement de ses packs (pendant
+ * lequel les clics sont ignorés et les cartes ne sont pas dessinées).
+ */
+bool snapshotResuming();
+
+#endif /*SNAPSHOT_H*/
@@ -0,0 +1,77 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+/* Nombre d'angles de rotation des icônes pré-tournées (tous les 15 degrés) */
+#define SPRITE_ANGLE_BUCKETS 24
+
+/* Pas des tailles de dessin des icônes pré-tournées (en pixels) */
+#define SPRITE_SIZE_STEP 4
+
+/* Nombre maximal d'icônes pré-tournées en cache */
+#define SPRITE_CACHE_SIZE 2048
+
+/**
+ * Cache d'icônes pré-tournées, pour le rendu logiciel de la SDL : chaque
+ * dessin d'une icône tournée y coûte une rotation pixel par pixel de l'icône.
+ * Les icônes y sont donc dessinées à partir de textures déjà tournées (angle
+ * arrondi à l'un des SPRITE_ANGLE_BUCKETS angles, taille arrondie à
+ * SPRITE_SIZE_STEP pixels près), calculées à leur première demande depuis la
+ * copie en mémoire des niveaux de mipmap des packs (voir atlasKeepPixels), puis
+ * recopiées sans transformation. Le cache est limité par un budget de mémoire ;
+ * les icônes les moins récemment utilisées sont libérées en premier.
+ *
+ * Avec un renderer accéléré, le cache est inactif et les icônes sont tournées
+ * par la carte graphique à chaque dessin.
+ */
+
+/**
+ * Initialise le cache d'icônes pré-tournées. Doit être appelée après
+ * atlasInit et avant le chargement des packs.
+ *
+ * @param renderer Le renderer utilisé pour créer les textures
+ * @param budget   Le budget de mémoire du cache (en octets)
+ * @param enabled  true pour activer le cache (rendu logiciel)
+ */
+void spritesInit(SDL_Renderer *renderer, size_t budget, bool enabled);
+
+/**
+ * Indique si le cache d'icônes pré-tournées est actif.
+ */
+bool spritesEnabled();
+
+/**
+ * Arrondit une rotation d'icône à l'angle pré-tourné le plus proche si le
+ * cache est actif.
+ *
+ * @param  rotation La rotation (en degrés)
+ * @return          La rotation arrondie, inchangée si le cache est inactif
+ */
+double spriteSnapRotation(double rotation);
+
+/**
+ * Retourne une icône pré-tournée, calculée si elle n'est pas en cache.
+ *
+ * @param  atlas    L'identifiant du pack de l'icône
+ * @param  posX     Abscisse de l'icône dans la matrice de son pack (en pixels)
+ * @param  posY     Ordonnée de l'icône dans la matrice de son pack (en pixels)
+ * @param  rotation La rotation de l'icône (en degrés)
+ * @param  drawSize La taille de l'icône à l'écran (en pixels)
+ * @param  side     Le côté de la texture retournée, où l'icône tournée est
+ *                  centrée (en pixels)
+ * @return          La texture, NULL si le cache est inactif ou en cas d'échec
+ *                  (l'icône est alors tournée au dessin)
+ */
+SDL_Texture *spriteGet(int atlas, int posX, int posY, double rotation,
+                       int drawSize, int *side);
+
+/**
+ * Libère toutes les icônes pré-tournées.
+ */
+void spritesFreeAll();
+
+#endif /*SPRITES_H*/
@@ -0,0 +1,102 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Nombre de bits de sous-intervalle de l'histogramme : chaque puissance de 2
+ * est découpée en 2^HISTO_SUB_BITS intervalles (erreur relative < 1/16) */
+#define HISTO_SUB_BITS 4
+
+/* Temps de réaction maximal mesurable (en ms), au-delà les valeurs sont
+ * ramenées à ce maximum */
+#define HISTO_MAX_VALUE 65535
+
+/* Nombre d'intervalles de l'histogramme (valeurs exactes en dessous de
+ * 2^HISTO_SUB_BITS, puis 2^HISTO_SUB_BITS intervalles par puissance de 2) */
+#define HISTO_BUCKETS ((16 - HISTO_SUB_BITS + 1) << HISTO_SUB_BITS)
+
+/* Nombre maximal de joueurs suivis */
+#define STATS_MAX_PLAYERS 8
+
+/* Nombre maximal d'icônes par carte suivi (ordre du deck + 1) */
+#define STATS_MAX_ICONS_PER_CARD 16
+
+/* Nombre maximal d'identifiants d'icônes suivis */
+#define STATS_MAX_ICON_ID 512
+
+/**
+ * Histogramme log-linéaire (type HDR) des temps de réaction : la mémoire
+ * utilisée est constante quel que soit le nombre de réponses enregistrées et
+ * les centiles sont obtenus avec une erreur relative inférieure à 1/16.
+ */
+typedef struct {
+  uint32_t count;        // nombre de bonnes réponses (temps de réaction mesurés)
+  uint32_t errors;       // nombre de mauvaises réponses
+  uint64_t sum;          // somme des temps de réaction (en ms)
+  uint32_t min, max;     // temps de réaction extrêmes (en ms)
+  int64_t lastAnswerAt;  // horodatage de la dernière réponse (en µs)
+  uint32_t buckets[HISTO_BUCKETS];
+} ReactionHistogram;
+
+/**
+ * Enregistre une valeur dans un histogramme.
+ *
+ * @param histo    L'histogramme
+ * @param value    Le temps de réaction (en ms)
+ */
+void histogramRecord(ReactionHistogram *histo, int value);
+
+/**
+ * Retourne une estimation du centile donné d'un histogramme.
+ *
+ * @param  histo      L'histogramme
+ * @param  percentile Le centile voulu (entre 0 et 100)
+ * @return            La valeur estimée (en ms), 0 si l'histogramme est vide
+ */
+int histogramPercentile(const ReactionHistogram *histo, double percentile);
+
+/**
+ * Retourne la moyenne des valeurs d'un histogramme.
+ *
+ * @param  histo L'histogramme
+ * @return       La moyenne (en ms), 0 si l'histogramme est vide
+ */
+int histogramMean(const ReactionHistogram *histo);
+
+/**
+ * Enregistre une réponse du joueur dans les statistiques de la session :
+ * globalement, par joueur, par ordre de deck et par icône à trouver.
+ *
+ * @param player     Le numéro du joueur
+ * @param nbIcons    Le nombre d'icônes par carte du deck
+ * @param iconId     L'icône commune aux deux cartes (celle à trouver)
+ * @param reactionMs Le temps de réaction (en ms) depuis l'affichage de la paire
+ * @param correct    Vrai si la réponse est correcte
+ */
+void statsRecordAnswer(int player, int nbIcons, int iconId, int reactionMs,
+                       bool correct);
+
+/**
+ * Retourne l'histogramme de l'ensemble des réponses de la session.
+ */
+const ReactionHistogram *statsSession();
+
+/**
+ * Retourne l'histogramme des réponses d'un joueur.
+ *
+ * @param  player Le numéro du joueur
+ * @return        L'histogramme, NULL si le numéro de joueur est invalide
+ */
+const ReactionHistogram *statsPlayer(int player);
+
+/**
+ * Exporte les statistiques de la session au format CSV (une ligne par
+ * agrégat non vide : session, joueur, ordre de deck, icône).
+ *
+ * @param  fileName Le nom du fichier à écrire
+ * @return          1 si l'export a réussi, 0 sinon
+ */
+int exportStats(const char *fileName);
+
+#endif /*STATS_H*/
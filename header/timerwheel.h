@@ -0,0 +1,70 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+/* Durée d'une case du premier niveau de la roue (en microsecondes) */
+#define TIMER_WHEEL_TICK_US 1000
+
+/* Nombre de niveaux de la roue et de cases par niveau : le premier niveau
+ * couvre 64 ms, le dernier environ 4 h 40 min (les échéances plus lointaines
+ * sont replacées à chaque tour) */
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOTS 64
+
+/* Nombre maximal d'appels planifiés en attente */
+#define TIMER_WHEEL_POOL_SIZE 4096
+
+/**
+ * Roue de minuteries hiérarchique du thread principal : chaque appel planifié
+ * est rangé dans la case de son échéance, au niveau dont la granularité
+ * correspond à son délai, puis redescend d'un niveau quand la roue du niveau
+ * inférieur fait un tour. Planifier, annuler et déclencher un appel coûtent
+ * un temps constant, quel que soit le nombre d'appels en attente.
+ *
+ * Les appels sont pris dans une réserve de TIMER_WHEEL_POOL_SIZE entrées
+ * (aucune allocation), et toutes les fonctions doivent être appelées depuis
+ * le thread principal.
+ */
+
+/**
+ * Identifiant d'un appel planifié (négatif : aucun).
+ */
+typedef int TimerId;
+
+/**
+ * Planifie un appel.
+ *
+ * @param  delay  Le délai avant l'appel (en microsecondes)
+ * @param  method La procédure à appeler
+ * @param  param  Le paramètre à lui passer
+ * @return        L'identifiant de l'appel, -1 si la réserve est épuisée
+ */
+TimerId timerWheelSchedule(int64_t delay, void (*method)(void *),
+                           void *param);
+
+/**
+ * Annule un appel planifié.
+ *
+ * @param  id L'identifiant de l'appel (sans effet s'il a déjà eu lieu)
+ * @return    1 si l'appel a été annulé, 0 sinon
+ */
+int timerWheelCancel(TimerId id);
+
+/**
+ * Effectue les appels dont l'échéance est atteinte, dans l'ordre de leurs
+ * échéances (à TIMER_WHEEL_TICK_US près).
+ */
+void timerWheelRun();
+
+/**
+ * Retourne l'instant auquel timerWheelRun doit être appelée au plus tard :
+ * la prochaine échéance, ou le prochain tour d'un niveau dont une case doit
+ * redescendre.
+ *
+ * @return L'instant (en µs, horloge monotone), -1 si aucun appel n'est
+ *         planifié
+ */
+int64_t timerWheelNextDeadline();
+
+#endif /*TIMERWHEEL_H*/
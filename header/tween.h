@@ -0,0 +1,52 @@
+#ifndef TWEEN_H
+#define TWEEN_H
+
+#include <stdbool.h>
+
+/* Nombre maximal d'interpolations simultanées */
+#define TWEEN_MAX 32
+
+/* Intervalle entre deux images d'une animation (en millisecondes, environ 60
+ * images par seconde) */
+#define TWEEN_FRAME_MS 16
+
+typedef enum {
+  EASE_LINEAR,    // vitesse constante
+  EASE_OUT_CUBIC, // départ rapide, arrivée en douceur
+  EASE_OUT_BACK   // dépasse légèrement la valeur finale avant d'y revenir
+} TweenEasing;
+
+/**
+ * Interpolations de valeurs (positions, échelles, angles, opacités) pour les
+ * animations : chaque valeur animée passe de sa valeur de départ à sa valeur
+ * d'arrivée selon une courbe d'accélération. Tant qu'une interpolation est en
+ * cours, la boucle principale met les valeurs à jour et redessine la scène
+ * toutes les TWEEN_FRAME_MS millisecondes (roue de minuteries) ; aucune image
+ * n'est dessinée en dehors des animations.
+ *
+ * Les valeurs animées ne doivent pas être libérées pendant leur animation.
+ */
+
+/**
+ * Anime une valeur. Une animation en cours de la même valeur est remplacée.
+ *
+ * @param value    La valeur animée
+ * @param from     La valeur de départ
+ * @param to       La valeur d'arrivée
+ * @param duration La durée de l'animation (en millisecondes)
+ * @param easing   La courbe d'accélération
+ */
+void tweenStart(double *value, double from, double to, int duration,
+                TweenEasing easing);
+
+/**
+ * Termine immédiatement toutes les animations (valeurs d'arrivée).
+ */
+void tweenFinishAll();
+
+/**
+ * Indique si une animation est en cours.
+ */
+bool tweenRunning();
+
+#endif /*TWEEN_H*/
@@ -0,0 +1,98 @@
+#ifndef UI_H
+#define UI_H
+
+/* Nombre maximal d'éléments (textes et boutons) d'un menu */
+#define UI_MAX_WIDGETS 64
+
+/* Longueur maximale du texte d'un élément */
+#define UI_TEXT_SIZE 64
+
+/* Nombre maximal de rangées de boutons générés (lignes choix) */
+#define UI_MAX_CHOICES 8
+
+typedef enum { UI_MENU_START, UI_MENU_END, UI_NB_MENUS } UiMenu;
+
+typedef enum {
+  UI_ACTION_NONE,
+  UI_ACTION_PACK,   // choix du pack d'icônes numéro value
+  UI_ACTION_DECK,   // choix du deck de value icônes par carte
+  UI_ACTION_REPLAY, // nouvelle partie
+  UI_ACTION_QUIT    // fin du programme
+} UiActionType;
+
+/**
+ * Action d'un bouton.
+ */
+typedef struct {
+  UiActionType type;
+  int value;
+} UiAction;
+
+/**
+ * Description des menus : les textes et les boutons de chaque menu sont lus
+ * une fois dans un fichier (data/menus.ui), puis leurs positions, leurs rayons
+ * et leurs zones de clic (carrés des rayons, sans racine carrée) sont
+ * calculés à chaque changement d'échelle. Le rendu de chaque bouton est
+ * conservé en cache (voir drawButton) : une image de menu se résume à une
+ * copie de texture par élément.
+ *
+ * Chaque ligne du fichier décrit un élément (les lignes vides et commençant
+ * par # sont ignorées) :
+ *
+ *   texte  <menu> <x> <ligne> <r> <v> <b> <texte>
+ *   bouton <menu> <x> <ligne> <taille> <r> <v> <b> <action> <texte>
+ *   choix  <menu> <x> <ligne> <colonnes> <pas x> <pas ligne> <taille> <r> <v>
+ *          <b> <pack|deck>
+ *
+ * - menu : debut ou fin
+ * - x : abscisse du centre, en fraction de la largeur de la zone de dessin
+ * - ligne : ordonnée du haut d'un texte, en hauteurs de police ; pour un
+ *   bouton, ordonnée du centre en hauteurs de police sous CARD_RADIUS
+ * - taille : rayon d'un bouton, en fraction de CARD_RADIUS + 5
+ * - r, v, b : couleur du texte (et de l'anneau d'un bouton)
+ * - action : pack:N (pack d'icônes numéro N), deck:K (K icônes par carte),
+ *   rejouer ou quitter
+ *
+ * Une ligne choix place en rangées de <colonnes> boutons, à partir de (x,
+ * ligne) et espacés de (pas x, pas ligne), un bouton par pack dont l'image est
+ * présente (texte : nom du pack) ou par deck du dossier de données (texte :
+ * nombre d'icônes par carte) qui n'a pas de bouton dans le fichier. Ces
+ * boutons suivent les packs et les decks ajoutés au dossier (voir
+ * uiUpdateChoices).
+ */
+
+/**
+ * Charge la description des menus.
+ *
+ * @param  fileName Le nom du fichier (voir assets.h)
+ * @return          1 si le fichier a été chargé, 0 sinon
+ */
+int uiLoad(const char *fileName);
+
+/**
+ * Génère à nouveau les boutons des lignes choix d'après les packs et les decks
+ * connus (après packsScan).
+ *
+ * @return 1 si des boutons ont changé, 0 sinon
+ */
+int uiUpdateChoices();
+
+/**
+ * Dessine les textes et les boutons d'un menu.
+ *
+ * @param menu Le menu
+ */
+void uiDraw(UiMenu menu);
+
+/**
+ * Cherche le bouton d'un menu sous un appui.
+ *
+ * @param  menu Le menu
+ * @param  x    Abscisse de l'appui
+ * @param  y    Ordonnée de l'appui
+ * @return      L'action du premier bouton touché (dans l'ordre du fichier),
+ *              UI_ACTION_NONE si aucun
+ */
+UiAction uiHitTest(UiMenu menu, int x, int y);
+
+#endif /*UI_H*/
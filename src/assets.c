@@ -0,0 +1,95 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <SDL2/SDL.h>
+
+#include "assets.h"
+#include "dobble-config.h"
+
+/**
+ * Dossier de données sur disque.
+ */
+static struct Assets {
+  const char *directory;
+  bool chosen; // dossier choisi par assetsSetDirectory ou déjà cherché
+} d;
+
+void assetsSetDirectory(const char *directory) {
+  d.directory = directory;
+  d.chosen = true;
+}
+
+const char *assetsDirectory() {
+  if (!d.chosen) {
+    // Dossier data du projet s'il existe (développement), sinon seuls les
+    // fichiers intégrés (exécutable installé ailleurs)
+    struct stat info;
+    bool found = stat(DATA_DIRECTORY, &info) == 0 && S_ISDIR(info.st_mode);
+    d.directory = found || embeddedAssetsCount == 0 ? DATA_DIRECTORY : NULL;
+    d.chosen = true;
+  }
+  return d.directory;
+}
+
+bool assetPath(const char *name, char *path, size_t size) {
+  const char *directory = assetsDirectory();
+  if (directory == NULL)
+    return false;
+  snprintf(path, size, "%s/%s", directory, name);
+  return true;
+}
+
+/**
+ * Cherche un fichier intégré par son nom.
+ */
+static const Asset *findEmbedded(const char *name) {
+  for (int i = 0; i < embeddedAssetsCount; i++) {
+    if (strcmp(embeddedAssets[i].name, name) == 0)
+      return &embeddedAssets[i];
+  }
+  return NULL;
+}
+
+bool assetExists(const char *name, time_t *mtime) {
+  char path[512];
+  struct stat info;
+  if (assetPath(name, path, sizeof(path)) && stat(path, &info) == 0) {
+    if (mtime != NULL)
+      *mtime = info.st_mtime;
+    return true;
+  }
+  if (mtime != NULL)
+    *mtime = 0;
+  return findEmbedded(name) != NULL;
+}
+
+FILE *assetOpen(const char *name, const char *mode) {
+  char path[512];
+  FILE *file = NULL;
+  if (assetPath(name, path, sizeof(path)))
+    file = fopen(path, mode);
+  const Asset *asset = file == NULL ? findEmbedded(name) : NULL;
+  // Lecture seule : les données intégrées ne sont pas modifiées
+  if (asset != NULL)
+    file = fmemopen((void *)asset->data, asset->size, mode);
+  return file;
+}
+
+SDL_RWops *assetOpenRW(const char *name) {
+  char path[512];
+  struct stat info;
+  if (assetPath(name, path, sizeof(path)) && stat(path, &info) == 0)
+    return SDL_RWFromFile(path, "rb");
+  const Asset *asset = findEmbedded(name);
+  return asset != NULL ? SDL_RWFromConstMem(asset->data, (int)asset->size)
+                       : NULL;
+}
+
+int assetsCount() { return embeddedAssetsCount; }
+
+const char *assetsName(int index) {
+  return index >= 0 && index < embeddedAssetsCount ? embeddedAssets[index].name
+                                                   : NULL;
+}
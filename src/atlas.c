@@ -0,0 +1,626 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "assets.h"
+#include "atlas.h"
+#include "dobble-config.h"
+
+/**
+ * Pack d'icônes résident : niveaux de mipmap de sa matrice d'icônes.
+ */
+typedef struct {
+  char fileName[256];
+  // Niveaux de mipmap (le niveau 0 est l'image d'origine) et taille d'une
+  // icône dans chaque niveau
+  SDL_Texture *levels[ICON_MIP_LEVELS];
+  SDL_Surface *pixels[ICON_MIP_LEVELS]; // copies en mémoire (NULL sinon)
+  int levelIconSize[ICON_MIP_LEVELS];
+  int width, height; // taille du niveau 0 (en pixels)
+  int nbIcons;
+  IconDescriptor *descriptors; // descripteur de chaque case de la matrice
+  size_t bytes; // mémoire de texture occupée par tous les niveaux
+  int refCount;
+  Uint32 lastUse;
+  Uint32 serial; // numéro de chargement (rendus dérivés de l'image périmés)
+} Atlas;
+
+/**
+ * État du gestionnaire d'atlas.
+ */
+static struct AtlasManager {
+  SDL_Renderer *renderer;
+  Atlas atlases[ATLAS_MAX_PACKS];
+  size_t budget;
+  size_t used;
+  Uint32 clock;    // compteur d'utilisation (LRU)
+  Uint32 loads;    // nombre de chargements (numéros de chargement)
+  bool keepPixels; // conservation des niveaux en mémoire
+
+  // Jeu d'icônes courant : packs et identifiant de leur première icône
+  int set[ATLAS_MAX_PACKS];
+  int setFirstIcon[ATLAS_MAX_PACKS + 1];
+  int setSize;
+} m;
+
+/**
+ * Décodage en arrière-plan d'images de packs (voir atlasPrefetch).
+ */
+static struct Prefetch {
+  SDL_Thread *thread;
+  int count;
+  char fileNames[ATLAS_MAX_PACKS][256];
+  SDL_Surface *images[ATLAS_MAX_PACKS]; // NULL : échec ou image utilisée
+  void (*ready)(void *);
+  void *param;
+} prefetch;
+
+/**
+ * Indique si un emplacement de pack est occupé.
+ */
+static bool isResident(int atlas) {
+  return atlas >= 0 && atlas < ATLAS_MAX_PACKS &&
+         m.atlases[atlas].levels[0] != NULL;
+}
+
+/**
+ * Construit un niveau de mipmap à partir du niveau précédent : chaque icône
+ * est réduite de moitié indépendamment des autres. Les 2x2 pixels sont
+ * moyennés en alpha prémultiplié (pas de franges sombres autour des parties
+ * opaques), puis le résultat revient à l'alpha non prémultiplié des textures
+ * de la SDL.
+ *
+ * @param  src      Le niveau précédent (format RGBA32)
+ * @param  srcIcon  La taille d'une icône dans le niveau précédent
+ * @param  dstIcon  La taille d'une icône dans le nouveau niveau
+ * @return          Le nouveau niveau, NULL en cas d'échec
+ */
+static SDL_Surface *downsampleIcons(SDL_Surface *src, int srcIcon,
+                                    int dstIcon) {
+  int cols = src->w / srcIcon, rows = src->h / srcIcon;
+  SDL_Surface *dst = SDL_CreateRGBSurfaceWithFormat(
+      0, cols * dstIcon, rows * dstIcon, 32, SDL_PIXELFORMAT_RGBA32);
+  if (dst == NULL)
+    return NULL;
+
+  for (int cy = 0; cy < rows; cy++) {
+    for (int cx = 0; cx < cols; cx++) {
+      for (int y = 0; y < dstIcon; y++) {
+        Uint8 *out = (Uint8 *)dst->pixels + (cy * dstIcon + y) * dst->pitch +
+                     cx * dstIcon * 4;
+        for (int x = 0; x < dstIcon; x++, out += 4) {
+          unsigned sum[3] = {0}, a = 0;
+          // Les pixels hors de l'icône (taille impaire) sont ramenés au bord
+          for (int k = 0; k < 4; k++) {
+            int sx = 2 * x + (k & 1), sy = 2 * y + (k >> 1);
+            if (sx >= srcIcon)
+              sx = srcIcon - 1;
+            if (sy >= srcIcon)
+              sy = srcIcon - 1;
+            const Uint8 *in = (const Uint8 *)src->pixels +
+                              (cy * srcIcon + sy) * src->pitch +
+                              (cx * srcIcon + sx) * 4;
+            for (int c = 0; c < 3; c++)
+              sum[c] += (in[c] * in[3] + 127) / 255;
+            a += in[3];
+          }
+          out[3] = (a + 2) / 4;
+          for (int c = 0; c < 3; c++) {
+            unsigned premultiplied = (sum[c] + 2) / 4;
+            unsigned value =
+                out[3] ? (premultiplied * 255 + out[3] / 2) / out[3] : 0;
+            out[c] = value > 255 ? 255 : value;
+          }
+        }
+      }
+    }
+  }
+  return dst;
+}
+
+/**
+ * Calcule le descripteur visuel de chaque case d'une matrice d'icônes.
+ *
+ * @param  image La matrice d'icônes (format RGBA32)
+ * @return       Les descripteurs, dans l'ordre des cases (NULL en cas d'échec)
+ */
+static IconDescriptor *describeIcons(SDL_Surface *image) {
+  int cols = image->w / ICON_SIZE, rows = image->h / ICON_SIZE;
+  IconDescriptor *descriptors = calloc(cols * rows, sizeof(IconDescriptor));
+  if (descriptors == NULL)
+    return NULL;
+
+  for (int cy = 0; cy < rows; cy++) {
+    for (int cx = 0; cx < cols; cx++) {
+      IconDescriptor *d = &descriptors[cy * cols + cx];
+      double r = 0, gr = 0, b = 0, a = 0;
+      double zones[ICON_SHAPE_GRID * ICON_SHAPE_GRID] = {0};
+      for (int y = 0; y < ICON_SIZE; y++) {
+        const Uint8 *in = (const Uint8 *)image->pixels +
+                          (cy * ICON_SIZE + y) * image->pitch +
+                          cx * ICON_SIZE * 4;
+        int zoneY = y * ICON_SHAPE_GRID / ICON_SIZE;
+        for (int x = 0; x < ICON_SIZE; x++, in += 4) {
+          double alpha = in[3] / 255.;
+          r += in[0] * alpha;
+          gr += in[1] * alpha;
+          b += in[2] * alpha;
+          a += alpha;
+          zones[zoneY * ICON_SHAPE_GRID + x * ICON_SHAPE_GRID / ICON_SIZE] +=
+              alpha;
+        }
+      }
+      if (a > 0) {
+        d->color[0] = r / a / 255.;
+        d->color[1] = gr / a / 255.;
+        d->color[2] = b / a / 255.;
+      }
+      d->coverage = a / (ICON_SIZE * ICON_SIZE);
+      double zoneArea = (double)ICON_SIZE * ICON_SIZE /
+                        (ICON_SHAPE_GRID * ICON_SHAPE_GRID);
+      for (int z = 0; z < ICON_SHAPE_GRID * ICON_SHAPE_GRID; z++)
+        d->shape[z] = zones[z] / zoneArea;
+    }
+  }
+  return descriptors;
+}
+
+/**
+ * Retourne la mémoire de texture nécessaire à un pack (tous niveaux).
+ */
+static size_t atlasBytes(int width, int height) {
+  int cols = width / ICON_SIZE, rows = height / ICON_SIZE;
+  size_t bytes = (size_t)width * height * 4;
+  int iconSize = ICON_SIZE;
+  for (int l = 1; l < ICON_MIP_LEVELS; l++) {
+    iconSize = (iconSize + 1) / 2;
+    bytes += (size_t)cols * iconSize * rows * iconSize * 4;
+  }
+  // Copies des niveaux en mémoire, comptées dans le même budget
+  return m.keepPixels ? 2 * bytes : bytes;
+}
+
+/**
+ * Libère les textures et les copies en mémoire des niveaux d'un pack.
+ */
+static void freeLevels(Atlas *a) {
+  for (int l = 0; l < ICON_MIP_LEVELS; l++) {
+    SDL_DestroyTexture(a->levels[l]);
+    SDL_FreeSurface(a->pixels[l]);
+  }
+}
+
+/**
+ * Libère les textures d'un pack.
+ */
+static void freeAtlas(int atlas) {
+  Atlas *a = &m.atlases[atlas];
+  printf("SDL: Libération du pack '%s' (%zu Kio).\n", a->fileName,
+         a->bytes / 1024);
+  freeLevels(a);
+  free(a->descriptors);
+  m.used -= a->bytes;
+  memset(a, 0, sizeof(Atlas));
+}
+
+/**
+ * Libère le pack non référencé le moins récemment utilisé.
+ *
+ * @return 1 si un pack a été libéré, 0 si tous les packs sont référencés
+ */
+static int evictOne() {
+  int victim = -1;
+  for (int i = 0; i < ATLAS_MAX_PACKS; i++) {
+    if (isResident(i) && m.atlases[i].refCount == 0 &&
+        (victim < 0 || m.atlases[i].lastUse < m.atlases[victim].lastUse))
+      victim = i;
+  }
+  if (victim < 0)
+    return 0;
+  freeAtlas(victim);
+  return 1;
+}
+
+void atlasInit(SDL_Renderer *renderer, size_t budget) {
+  memset(&m, 0, sizeof(m));
+  m.renderer = renderer;
+  m.budget = budget;
+}
+
+void atlasKeepPixels(bool keep) { m.keepPixels = keep; }
+
+void atlasSetBudget(size_t budget) {
+  m.budget = budget;
+  while (m.used > m.budget && evictOne())
+    ;
+}
+
+/**
+ * Décode l'image d'un pack avec SDL_Image (sur disque ou intégrée), dans un
+ * format connu pour le calcul des niveaux de mipmap. Peut être appelée depuis
+ * n'importe quel thread.
+ *
+ * @return L'image, NULL en cas d'échec
+ */
+static SDL_Surface *decodeImage(const char *fileName) {
+  SDL_RWops *file = assetOpenRW(fileName);
+  SDL_Surface *loaded = file != NULL ? IMG_Load_RW(file, 1) : NULL;
+  SDL_Surface *image = NULL;
+  if (loaded != NULL) {
+    image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+  }
+  return image;
+}
+
+/**
+ * Thread de décodage des images demandées par atlasPrefetch.
+ */
+static int prefetchThreadMain(void *data) {
+  (void)data;
+  for (int i = 0; i < prefetch.count; i++)
+    prefetch.images[i] = decodeImage(prefetch.fileNames[i]);
+  if (prefetch.ready != NULL)
+    prefetch.ready(prefetch.param);
+  return 0;
+}
+
+/**
+ * Attend la fin du décodage en arrière-plan.
+ */
+static void waitPrefetch() {
+  if (prefetch.thread != NULL)
+    SDL_WaitThread(prefetch.thread, NULL);
+  prefetch.thread = NULL;
+}
+
+/**
+ * Libère les images décodées en arrière-plan qui n'ont pas été utilisées.
+ */
+static void freePrefetched() {
+  waitPrefetch();
+  for (int i = 0; i < prefetch.count; i++) {
+    SDL_FreeSurface(prefetch.images[i]);
+    prefetch.images[i] = NULL;
+  }
+  prefetch.count = 0;
+}
+
+/**
+ * Retourne l'image d'un pack décodée en arrière-plan, en attendant la fin du
+ * décodage si nécessaire.
+ *
+ * @return L'image (à libérer par l'appelant), NULL si elle n'a pas été
+ *         demandée ou si son décodage a échoué
+ */
+static SDL_Surface *takePrefetched(const char *fileName) {
+  for (int i = 0; i < prefetch.count; i++) {
+    if (strcmp(prefetch.fileNames[i], fileName) == 0) {
+      waitPrefetch();
+      SDL_Surface *image = prefetch.images[i];
+      prefetch.images[i] = NULL;
+      return image;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Charge la matrice d'icônes d'un pack dans un emplacement libre.
+ *
+ * @param image L'image déjà décodée du pack, NULL pour la décoder
+ */
+static int loadAtlas(int atlas, const char *fileName, int nbIcons,
+                     SDL_Surface *image) {
+  Atlas *a = &m.atlases[atlas];
+
+  printf("SDL: Chargement de l'image '%s'.\n", fileName);
+  if (image == NULL)
+    image = decodeImage(fileName);
+  if (image == NULL) {
+    printf("SDL: Echec du chargement de l'image '%s'.\n", fileName);
+    return 0;
+  }
+
+  // Libération des packs non référencés jusqu'à respecter le budget (le
+  // budget peut être dépassé si tous les packs résidents sont utilisés)
+  size_t bytes = atlasBytes(image->w, image->h);
+  while (m.used + bytes > m.budget && evictOne())
+    ;
+  if (m.used + bytes > m.budget)
+    printf("SDL: Budget de mémoire de texture dépassé (%zu Kio / %zu Kio).\n",
+           (m.used + bytes) / 1024, m.budget / 1024);
+
+  // Transformation de chaque niveau (données d'image) en texture (pouvant être
+  // dessiné à l'écran). Les icônes réduites sont ainsi lues dans le niveau de
+  // taille immédiatement supérieure plutôt que rééchantillonnées depuis
+  // l'image d'origine à chaque dessin
+  SDL_Surface *level = image;
+  int iconSize = ICON_SIZE;
+  for (int l = 0; l < ICON_MIP_LEVELS && level != NULL; l++) {
+    a->levels[l] = SDL_CreateTextureFromSurface(m.renderer, level);
+    a->levelIconSize[l] = iconSize;
+    if (a->levels[l] == NULL) {
+      printf("SDL: Echec de la création de texture pour '%s'.\n", fileName);
+      break;
+    }
+    // Nécessaire pour le dessin d'icônes transparents
+    SDL_SetTextureBlendMode(a->levels[l], SDL_BLENDMODE_BLEND);
+
+    // Niveau conservé en mémoire si demandé (icônes pré-tournées), libéré
+    // avec le pack
+    if (m.keepPixels)
+      a->pixels[l] = level;
+
+    if (l + 1 < ICON_MIP_LEVELS) {
+      int nextSize = (iconSize + 1) / 2;
+      SDL_Surface *next = downsampleIcons(level, iconSize, nextSize);
+      if (level != image && a->pixels[l] != level)
+        SDL_FreeSurface(level);
+      level = next;
+      iconSize = nextSize;
+    }
+  }
+  if (level != image && a->pixels[ICON_MIP_LEVELS - 1] != level)
+    SDL_FreeSurface(level);
+
+  a->width = image->w;
+  a->height = image->h;
+  // Descripteurs visuels des icônes, pour le choix d'icônes différentes
+  // (optionnels : le pack reste utilisable sans eux)
+  if (a->levels[0] != NULL)
+    a->descriptors = describeIcons(image);
+  // La surface n'est plus nécessaire (l'image est maintenant stockée dans les
+  // textures), sauf si elle est conservée en mémoire
+  if (a->pixels[0] != image)
+    SDL_FreeSurface(image);
+
+  if (a->levels[0] == NULL) {
+    memset(a, 0, sizeof(Atlas));
+    return 0;
+  }
+
+  int cells = (a->width / ICON_SIZE) * (a->height / ICON_SIZE);
+  a->nbIcons = nbIcons > 0 && nbIcons < cells ? nbIcons : cells;
+  a->bytes = bytes;
+  a->serial = ++m.loads;
+  m.used += bytes;
+  snprintf(a->fileName, sizeof(a->fileName), "%s", fileName);
+  return 1;
+}
+
+/**
+ * Cherche un pack résident par son nom de fichier.
+ */
+static int findAtlas(const char *fileName) {
+  for (int i = 0; i < ATLAS_MAX_PACKS; i++) {
+    if (isResident(i) && strcmp(m.atlases[i].fileName, fileName) == 0)
+      return i;
+  }
+  return -1;
+}
+
+int atlasAcquire(const char *fileName, int nbIcons) {
+  // Pack déjà résident
+  int resident = findAtlas(fileName);
+  if (resident >= 0) {
+    m.atlases[resident].refCount++;
+    m.atlases[resident].lastUse = ++m.clock;
+    return resident;
+  }
+
+  // Emplacement libre, en libérant si besoin le pack non référencé le moins
+  // récemment utilisé
+  int slot = -1;
+  do {
+    for (int i = 0; i < ATLAS_MAX_PACKS && slot < 0; i++) {
+      if (!isResident(i))
+        slot = i;
+    }
+  } while (slot < 0 && evictOne());
+  if (slot < 0) {
+    printf("SDL: Trop de packs d'icônes utilisés simultanément.\n");
+    return -1;
+  }
+
+  if (!loadAtlas(slot, fileName, nbIcons, takePrefetched(fileName)))
+    return -1;
+  m.atlases[slot].refCount = 1;
+  m.atlases[slot].lastUse = ++m.clock;
+  return slot;
+}
+
+int atlasReload(const char *fileName, int nbIcons) {
+  int atlas = findAtlas(fileName);
+  if (atlas < 0)
+    return 0;
+
+  // Chargement de la nouvelle image dans le même emplacement ; l'ancienne
+  // reste utilisée si le chargement échoue (fichier incomplet, etc.)
+  Atlas previous = m.atlases[atlas];
+  memset(&m.atlases[atlas], 0, sizeof(Atlas));
+  if (!loadAtlas(atlas, fileName, nbIcons, NULL)) {
+    m.atlases[atlas] = previous;
+    return 0;
+  }
+  freeLevels(&previous);
+  free(previous.descriptors);
+  m.used -= previous.bytes;
+  m.atlases[atlas].refCount = previous.refCount;
+  m.atlases[atlas].lastUse = previous.lastUse;
+
+  // Le nombre d'icônes du pack a pu changer
+  for (int i = 0; i < m.setSize; i++)
+    m.setFirstIcon[i + 1] = m.setFirstIcon[i] + m.atlases[m.set[i]].nbIcons;
+  return 1;
+}
+
+void atlasRelease(int atlas) {
+  if (isResident(atlas) && m.atlases[atlas].refCount > 0)
+    m.atlases[atlas].refCount--;
+}
+
+int atlasUseSet(const char *const *fileNames, const int *nbIcons, int count) {
+  if (count < 1 || count > ATLAS_MAX_PACKS)
+    return 0;
+
+  // Les packs déjà résidents sont référencés en premier, puis les packs du
+  // jeu précédent sont relâchés : seuls les packs manquants sont chargés, en
+  // pouvant libérer les packs qui ne sont plus utilisés
+  int set[ATLAS_MAX_PACKS];
+  for (int i = 0; i < count; i++) {
+    set[i] = findAtlas(fileNames[i]);
+    if (set[i] >= 0)
+      set[i] = atlasAcquire(fileNames[i], 0);
+  }
+  int previous[ATLAS_MAX_PACKS], previousSize = m.setSize;
+  for (int i = 0; i < previousSize; i++) {
+    previous[i] = m.set[i];
+    atlasRelease(previous[i]);
+  }
+
+  bool loaded = true;
+  for (int i = 0; i < count && loaded; i++) {
+    if (set[i] < 0) {
+      set[i] = atlasAcquire(fileNames[i], nbIcons ? nbIcons[i] : 0);
+      loaded = set[i] >= 0;
+    }
+  }
+  if (!loaded) {
+    // Le jeu d'icônes précédent reste utilisé (ses packs sont toujours
+    // résidents, sauf s'ils ont dû être libérés pour ce chargement)
+    for (int i = 0; i < count; i++) {
+      if (set[i] >= 0)
+        atlasRelease(set[i]);
+    }
+    m.setSize = 0;
+    for (int i = 0; i < previousSize; i++) {
+      if (isResident(previous[i])) {
+        m.atlases[previous[i]].refCount++;
+        m.set[m.setSize] = previous[i];
+        m.setFirstIcon[m.setSize + 1] =
+            m.setFirstIcon[m.setSize] + m.atlases[previous[i]].nbIcons;
+        m.setSize++;
+      }
+    }
+    return 0;
+  }
+
+  m.setSize = count;
+  m.setFirstIcon[0] = 0;
+  for (int i = 0; i < count; i++) {
+    m.set[i] = set[i];
+    m.setFirstIcon[i + 1] = m.setFirstIcon[i] + m.atlases[set[i]].nbIcons;
+  }
+  atlasReport();
+  return 1;
+}
+
+int atlasIconCount() { return m.setFirstIcon[m.setSize]; }
+
+int atlasLocateIcon(int iconId, int *posX, int *posY) {
+  for (int i = 0; i < m.setSize; i++) {
+    if (iconId >= m.setFirstIcon[i] && iconId < m.setFirstIcon[i + 1]) {
+      int local = iconId - m.setFirstIcon[i];
+      int columns = m.atlases[m.set[i]].width / ICON_SIZE;
+      *posX = (local % columns) * ICON_SIZE;
+      *posY = (local / columns) * ICON_SIZE;
+      return m.set[i];
+    }
+  }
+  return -1;
+}
+
+int atlasIconDescriptor(int iconId, IconDescriptor *descriptor) {
+  int posX, posY;
+  int atlas = atlasLocateIcon(iconId, &posX, &posY);
+  if (atlas < 0 || m.atlases[atlas].descriptors == NULL)
+    return 0;
+  int columns = m.atlases[atlas].width / ICON_SIZE;
+  *descriptor = m.atlases[atlas]
+                    .descriptors[posY / ICON_SIZE * columns + posX / ICON_SIZE];
+  return 1;
+}
+
+/**
+ * Retourne le plus petit niveau de mipmap d'un pack encore plus grand que
+ * l'icône dessinée : la réduction restante est faible et sans crénelage.
+ */
+static int chooseLevel(Atlas *a, int drawSize) {
+  int level = 0;
+  while (level + 1 < ICON_MIP_LEVELS && a->levels[level + 1] != NULL &&
+         a->levelIconSize[level + 1] >= drawSize) {
+    level++;
+  }
+  return level;
+}
+
+SDL_Texture *atlasTexture(int atlas, int drawSize, int *iconSize) {
+  if (!isResident(atlas))
+    return NULL;
+  Atlas *a = &m.atlases[atlas];
+  a->lastUse = ++m.clock;
+
+  int level = chooseLevel(a, drawSize);
+  *iconSize = a->levelIconSize[level];
+  return a->levels[level];
+}
+
+SDL_Surface *atlasPixels(int atlas, int drawSize, int *iconSize) {
+  if (!isResident(atlas))
+    return NULL;
+  Atlas *a = &m.atlases[atlas];
+  a->lastUse = ++m.clock;
+
+  int level = chooseLevel(a, drawSize);
+  *iconSize = a->levelIconSize[level];
+  return a->pixels[level];
+}
+
+Uint32 atlasSerial(int atlas) {
+  return isResident(atlas) ? m.atlases[atlas].serial : 0;
+}
+
+void atlasReport() {
+  printf("SDL: Mémoire de texture des packs d'icônes :\n");
+  for (int i = 0; i < ATLAS_MAX_PACKS; i++) {
+    if (!isResident(i))
+      continue;
+    Atlas *a = &m.atlases[i];
+    printf("  %-50s %4d icônes %7zu Kio (%d référence(s))\n", a->fileName,
+           a->nbIcons, a->bytes / 1024, a->refCount);
+  }
+  printf("  Total : %zu Kio / %zu Kio\n", m.used / 1024, m.budget / 1024);
+}
+
+int atlasPrefetch(const char *const *fileNames, int count,
+                  void (*ready)(void *), void *param) {
+  freePrefetched();
+  for (int i = 0; i < count && i < ATLAS_MAX_PACKS; i++) {
+    if (findAtlas(fileNames[i]) < 0)
+      snprintf(prefetch.fileNames[prefetch.count++],
+               sizeof(prefetch.fileNames[0]), "%s", fileNames[i]);
+  }
+  prefetch.ready = ready;
+  prefetch.param = param;
+  prefetch.thread =
+      SDL_CreateThread(prefetchThreadMain, "atlas-prefetch", NULL);
+  if (prefetch.thread == NULL) {
+    prefetch.count = 0;
+    return 0;
+  }
+  return 1;
+}
+
+void atlasFreeAll() {
+  freePrefetched();
+  for (int i = 0; i < ATLAS_MAX_PACKS; i++) {
+    if (isResident(i))
+      freeAtlas(i);
+  }
+  m.setSize = 0;
+  m.setFirstIcon[0] = 0;
+}
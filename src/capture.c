@@ -0,0 +1,216 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "capture.h"
+#include "clock.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "iconmap.h"
+#include "packs.h"
+#include "ui.h"
+
+/**
+ * État d'une série de captures.
+ */
+static struct Capture {
+  const char *outDir, *goldenDir;
+  int tolerance;
+
+  int nbFrames, nbDifferent, nbMissing, nbErrors;
+  int64_t renderTime; // temps passé à dessiner (en µs, hors PNG)
+} cap;
+
+long captureDiff(const uint8_t *a, int pitchA, const uint8_t *b, int pitchB,
+                 int width, int height, int tolerance) {
+  if (tolerance < 0)
+    tolerance = 0;
+  if (tolerance > 255)
+    tolerance = 255;
+
+  long count = 0;
+#ifdef __SSE2__
+  __m128i limit = _mm_set1_epi8((char)tolerance);
+  __m128i zero = _mm_setzero_si128();
+#endif
+  for (int y = 0; y < height; y++) {
+    const uint8_t *rowA = a + y * pitchA, *rowB = b + y * pitchB;
+    int x = 0;
+#ifdef __SSE2__
+    // Quatre pixels à la fois : écart absolu de chaque composante au-delà de
+    // la tolérance, puis pixels dont les quatre composantes sont nulles
+    for (; x + 4 <= width; x += 4) {
+      __m128i pa = _mm_loadu_si128((const __m128i *)(rowA + 4 * x));
+      __m128i pb = _mm_loadu_si128((const __m128i *)(rowB + 4 * x));
+      __m128i d = _mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa));
+      d = _mm_subs_epu8(d, limit);
+      int same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, zero)));
+      count += 4 - __builtin_popcount(same);
+    }
+#endif
+    for (; x < width; x++) {
+      for (int c = 0; c < 4; c++) {
+        if (abs(rowA[4 * x + c] - rowB[4 * x + c]) > tolerance) {
+          count++;
+          break;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+int captureSave(const char *fileName) {
+  int width, height, pitch;
+  const uint8_t *pixels = getFramePixels(&width, &height, &pitch);
+  if (pixels == NULL)
+    return 0;
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(
+      (void *)pixels, width, height, 32, pitch, SDL_PIXELFORMAT_RGBA32);
+  int saved = surface != NULL && IMG_SavePNG(surface, fileName) == 0;
+  SDL_FreeSurface(surface);
+  if (!saved)
+    printf("SDL: Echec de l'enregistrement de '%s': %s\n", fileName,
+           IMG_GetError());
+  return saved;
+}
+
+long captureCompare(const char *fileName, int tolerance) {
+  int width, height, pitch;
+  const uint8_t *pixels = getFramePixels(&width, &height, &pitch);
+  if (pixels == NULL)
+    return -1;
+
+  SDL_Surface *golden = NULL, *loaded = IMG_Load(fileName);
+  if (loaded != NULL) {
+    golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+  }
+  if (golden == NULL)
+    return -1;
+
+  long count = -1;
+  if (golden->w == width && golden->h == height)
+    count = captureDiff(pixels, pitch, golden->pixels, golden->pitch, width,
+                        height, tolerance);
+  SDL_FreeSurface(golden);
+  return count;
+}
+
+/**
+ * Dessine une image, puis l'enregistre et/ou la compare à sa référence.
+ *
+ * @param draw La fonction de dessin (renderScene, afficheMenuDebut, etc.)
+ * @param name Le nom de l'image (sans extension)
+ */
+static void captureFrame(void (*draw)(), const char *name) {
+  int64_t start = clockNow();
+  draw();
+  int width, height, pitch;
+  getFramePixels(&width, &height, &pitch);
+  cap.renderTime += clockNow() - start;
+  cap.nbFrames++;
+
+  char fileName[512];
+  if (cap.outDir != NULL) {
+    snprintf(fileName, sizeof(fileName), "%s/%s.png", cap.outDir, name);
+    if (!captureSave(fileName))
+      cap.nbErrors++;
+  }
+  if (cap.goldenDir != NULL) {
+    snprintf(fileName, sizeof(fileName), "%s/%s.png", cap.goldenDir, name);
+    long diff = captureCompare(fileName, cap.tolerance);
+    if (diff < 0) {
+      printf("dobble: Référence absente ou de taille différente : %s\n",
+             fileName);
+      cap.nbMissing++;
+    } else if (diff > 0) {
+      printf("dobble: %s : %ld pixel(s) différent(s)\n", name, diff);
+      cap.nbDifferent++;
+    }
+  }
+}
+
+/**
+ * Dessine toutes les cartes d'un deck, chacune en haut d'une paire puis en bas
+ * de la suivante, et le menu de fin.
+ */
+static void captureDeck(int packMask, int nbIcons) {
+  // Tirages indépendants des decks précédents
+  seedRandom(CAPTURE_SEED + 16 * packMask + nbIcons);
+  if (!loadDeck(nbIcons)) {
+    cap.nbErrors++;
+    return;
+  }
+  iconMapBuild();
+
+  char name[64];
+  gameGlobal.state = STATE_PLAYING;
+  gameGlobal.time = ROUND_DURATION_MS;
+  for (int i = 0; i < gameGlobal.nbCards; i++) {
+    dealPair(i, (i + 1) % gameGlobal.nbCards);
+    // Bord de la carte du haut : alternativement normal, vert et rouge
+    gameGlobal.resultatClic = i % 3 == 0 ? INDEFINI : i % 3 == 1 ? CORRECT
+                                                                 : INCORRECT;
+    gameGlobal.score = i;
+    snprintf(name, sizeof(name), "p%d-k%d-%03d", packMask, nbIcons, i);
+    captureFrame(renderScene, name);
+  }
+
+  gameGlobal.state = STATE_RESULTS;
+  gameGlobal.time = 0;
+  gameGlobal.nbFalse = gameGlobal.nbCards / 3;
+  snprintf(name, sizeof(name), "p%d-k%d-fin", packMask, nbIcons);
+  captureFrame(afficheMenuFin, name);
+  freeDeck();
+}
+
+int captureRun(const char *outDir, const char *goldenDir, int tolerance,
+               double scale) {
+  if (!initializeOffscreenGraphics((int)(BASE_WIN_WIDTH * scale),
+                                   (int)(BASE_WIN_HEIGHT * scale))) {
+    printf("dobble: Echec de l'initialisation du rendu sans fenêtre.\n");
+    return 1;
+  }
+  if (!uiLoad("menus.ui"))
+    return 1;
+  cap = (struct Capture){.outDir = outDir, .goldenDir = goldenDir,
+                         .tolerance = tolerance};
+  gameGlobal.state = STATE_MENU;
+  gameGlobal.timerRunning = false;
+  gameGlobal.iconPackChosen = false;
+  gameGlobal.score = 0;
+  gameGlobal.nbFalse = 0;
+  gameGlobal.time = ROUND_DURATION_MS;
+  gameGlobal.resultatClic = INDEFINI;
+
+  int64_t start = clockNow();
+  captureFrame(afficheMenuDebut, "menu-debut");
+  gameGlobal.iconPackChosen = true;
+  for (int packMask = 1; packMask < 1 << packsCount(); packMask++) {
+    if (!loadIconPacks(packMask))
+      printError(ECHEC_ICONES);
+    // Tous les decks du dossier de données qui tiennent dans les packs
+    for (int k = 0; k <= DECKS_MAX_ICONS; k++) {
+      if (packsDeckFile(k) != NULL && deckFitsPacks(k, packMask))
+        captureDeck(packMask, k);
+    }
+  }
+  int64_t elapsed = clockNow() - start;
+
+  printf("dobble: %d image(s) en %.2f s, dessin : %.0f images/s\n",
+         cap.nbFrames, elapsed / 1e6,
+         cap.renderTime > 0 ? cap.nbFrames * 1e6 / cap.renderTime : 0.);
+  if (goldenDir != NULL)
+    printf("dobble: %d image(s) différente(s), %d référence(s) absente(s)\n",
+           cap.nbDifferent, cap.nbMissing);
+  freeGraphics();
+  return cap.nbDifferent > 0 || cap.nbMissing > 0 || cap.nbErrors > 0;
+}
@@ -0,0 +1,29 @@
+#include <time.h>
+
+#include <SDL2/SDL.h>
+
+#include "clock.h"
+
+// Instant de l'horloge virtuelle (négatif si l'horloge réelle est utilisée)
+static int64_t virtualNow = -1;
+
+void clockSetVirtual(int64_t now) { virtualNow = now; }
+
+int64_t clockNow() {
+  if (virtualNow >= 0)
+    return virtualNow;
+#ifdef CLOCK_MONOTONIC
+  // Horloge monotone POSIX (Linux, macOS, Cygwin)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  }
+#endif
+  // Repli sur le compteur haute résolution de la SDL
+  static Uint64 frequency = 0;
+  if (frequency == 0)
+    frequency = SDL_GetPerformanceFrequency();
+  Uint64 counter = SDL_GetPerformanceCounter();
+  return (int64_t)(counter / frequency) * 1000000 +
+         (int64_t)((counter % frequency) * 1000000 / frequency);
+}
@@ -0,0 +1,295 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assets.h"
+#include "deckfile.h"
+#include "decksearch.h"
+#include "packs.h"
+
+/* Octets lisibles d'un coup à partir de la position de lecture : un nombre
+ * est lu huit octets à la fois, suivis d'un séparateur. Le tampon est
+ * complété par autant de zéros après la fin des données. */
+#define LOOKAHEAD 16
+
+/* Fin du fichier (caractère courant) */
+#define END_OF_FILE (-1)
+
+/**
+ * Lecteur d'un fichier de deck.
+ */
+typedef struct {
+  FILE *file;
+  unsigned char *buffer; // DECK_FILE_CHUNK + LOOKAHEAD octets
+  size_t pos, end;       // position de lecture et fin des données du tampon
+  bool eof;              // dernier bloc lu
+  long offset;           // position dans le fichier du début du tampon
+  long lineStart;        // position dans le fichier du début de la ligne
+  long token;            // position dans le fichier du dernier nombre lu
+  int line;
+  DeckFileError *error;
+} Reader;
+
+/**
+ * Garde les données non lues au début du tampon et lit le bloc suivant.
+ */
+static void refill(Reader *r) {
+  size_t left = r->end - r->pos;
+  memmove(r->buffer, r->buffer + r->pos, left);
+  r->offset += r->pos;
+  r->pos = 0;
+  size_t wanted = DECK_FILE_CHUNK - left;
+  size_t read = fread(r->buffer + left, 1, wanted, r->file);
+  r->end = left + read;
+  r->eof = read < wanted;
+  memset(r->buffer + r->end, 0, LOOKAHEAD);
+}
+
+/**
+ * Passe les espaces de la ligne courante.
+ *
+ * @return Le caractère suivant (LOOKAHEAD octets lisibles), END_OF_FILE à la
+ *         fin du fichier
+ */
+static int skipSpaces(Reader *r) {
+  for (;;) {
+    while (r->pos < r->end &&
+           (r->buffer[r->pos] == ' ' || r->buffer[r->pos] == '\t' ||
+            r->buffer[r->pos] == '\r'))
+      r->pos++;
+    if (r->end - r->pos >= LOOKAHEAD || r->eof)
+      break;
+    refill(r);
+  }
+  return r->pos < r->end ? r->buffer[r->pos] : END_OF_FILE;
+}
+
+/**
+ * Passe à la ligne suivante (caractère courant '\n').
+ */
+static void nextLine(Reader *r) {
+  r->pos++;
+  r->line++;
+  r->lineStart = r->offset + r->pos;
+}
+
+/**
+ * Passe les espaces et les lignes vides.
+ *
+ * @return Le premier caractère non blanc, END_OF_FILE à la fin du fichier
+ */
+static int skipBlankLines(Reader *r) {
+  int c;
+  while ((c = skipSpaces(r)) == '\n')
+    nextLine(r);
+  return c;
+}
+
+/**
+ * Enregistre une erreur à une position du fichier.
+ *
+ * @return 0
+ */
+static int failAt(Reader *r, DeckFileStatus status, long at) {
+  r->error->status = status;
+  r->error->line = r->line;
+  r->error->column = (int)(at - r->lineStart) + 1;
+  return 0;
+}
+
+/**
+ * Enregistre une erreur à la position de lecture.
+ */
+static int fail(Reader *r, DeckFileStatus status) {
+  return failAt(r, status, r->offset + (long)r->pos);
+}
+
+/**
+ * Lit huit octets, le premier dans l'octet de poids faible (quel que soit
+ * l'ordre des octets de la machine).
+ */
+static inline uint64_t load64(const unsigned char *p) {
+  return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+         (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+         (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+/**
+ * Convertit le nombre écrit au début de huit octets : les octets qui ne sont
+ * pas des chiffres sont repérés en parallèle (quartet de poids fort non nul
+ * ou quartet de poids faible supérieur à 9 après ^ '0'), puis les chiffres
+ * sont alignés à droite et assemblés par paires, quadruplets et octuplets.
+ *
+ * @param  p      Les octets (un chiffre au moins)
+ * @param  digits Le nombre de chiffres lus (8 si le nombre peut continuer)
+ * @return        La valeur des chiffres lus
+ */
+static inline int parseDigits(const unsigned char *p, int *digits) {
+  uint64_t t = load64(p) ^ 0x3030303030303030ull;
+  uint64_t other =
+      (t & 0xF0F0F0F0F0F0F0F0ull) |
+      (((t & 0x0F0F0F0F0F0F0F0Full) + 0x0606060606060606ull) &
+       0x1010101010101010ull);
+  int n = other != 0 ? __builtin_ctzll(other) >> 3 : 8;
+  // Chiffres dans les octets de poids fort, zéros non significatifs devant
+  t = (t & (UINT64_MAX >> (64 - 8 * n))) << (64 - 8 * n);
+  t = (t * 10 + (t >> 8)) & 0x00FF00FF00FF00FFull;
+  t = (t * 100 + (t >> 16)) & 0x0000FFFF0000FFFFull;
+  t = t * 10000 + (t >> 32);
+  *digits = n;
+  return (int)(uint32_t)t;
+}
+
+/**
+ * Lit un nombre de la ligne courante, suivi d'un espace, d'une fin de ligne
+ * ou de la fin du fichier.
+ *
+ * @param  min    La valeur minimale
+ * @param  max    La valeur maximale
+ * @param  status L'erreur d'une valeur hors limites
+ * @param  value  La valeur lue
+ * @return        1 si le nombre a été lu, -1 s'il n'y a plus de nombre sur la
+ *                ligne, 0 en cas d'erreur
+ */
+static int readValue(Reader *r, int min, int max, DeckFileStatus status,
+                     int *value) {
+  int c = skipSpaces(r);
+  if (c == '\n' || c == END_OF_FILE)
+    return -1;
+  if (c < '0' || c > '9')
+    return fail(r, DECK_FILE_SYNTAX);
+
+  int digits;
+  r->token = r->offset + (long)r->pos;
+  *value = parseDigits(r->buffer + r->pos, &digits);
+  r->pos += digits;
+  c = r->buffer[r->pos]; // zéro après la fin des données
+  if ((digits == 8 && c >= '0' && c <= '9') || *value < min || *value > max)
+    return failAt(r, status, r->token);
+  if (r->pos < r->end && c != ' ' && c != '\t' && c != '\r' && c != '\n')
+    return fail(r, DECK_FILE_SYNTAX);
+  return 1;
+}
+
+/**
+ * Lit l'en-tête et les cartes.
+ *
+ * @param expected Le nombre d'icônes par carte attendu (0 : quelconque)
+ */
+static int readDeck(Reader *r, DeckFile *deck, int expected) {
+  // En-tête : nombres de cartes (autant que l'index d'un deck en accepte) et
+  // d'icônes par carte
+  skipBlankLines(r);
+  int result = readValue(r, 2, DECK_MAX_CARDS, DECK_FILE_HEADER,
+                         &deck->nbCards);
+  if (result > 0)
+    result = readValue(r, 2, DECKS_MAX_ICONS, DECK_FILE_HEADER,
+                       &deck->nbIcons);
+  if (result < 0)
+    return fail(r, DECK_FILE_HEADER);
+  if (result == 0)
+    return 0;
+  if (expected > 0 && deck->nbIcons != expected)
+    return failAt(r, DECK_FILE_MISMATCH, r->token);
+  int c = skipSpaces(r);
+  if (c != '\n' && c != END_OF_FILE)
+    return fail(r, c >= '0' && c <= '9' ? DECK_FILE_HEADER : DECK_FILE_SYNTAX);
+
+  int k = deck->nbIcons;
+  deck->icons = malloc((size_t)deck->nbCards * k * sizeof(int));
+  if (deck->icons == NULL) {
+    r->error->status = DECK_FILE_MEMORY;
+    return 0;
+  }
+
+  // Une carte par ligne
+  for (int i = 0; i < deck->nbCards; i++) {
+    if (skipBlankLines(r) == END_OF_FILE)
+      return fail(r, DECK_FILE_TRUNCATED);
+    uint64_t seen[DECK_WORDS] = {0};
+    int *icons = &deck->icons[i * k];
+    for (int j = 0; j < k; j++) {
+      result = readValue(r, 0, DECK_MAX_SYMBOLS - 1, DECK_FILE_RANGE,
+                         &icons[j]);
+      if (result < 0)
+        return fail(r, DECK_FILE_SHORT_LINE);
+      if (result == 0)
+        return 0;
+      uint64_t bit = 1ull << (icons[j] & 63);
+      if (seen[icons[j] >> 6] & bit)
+        return failAt(r, DECK_FILE_DUPLICATE, r->token);
+      seen[icons[j] >> 6] |= bit;
+    }
+    c = skipSpaces(r);
+    if (c >= '0' && c <= '9')
+      return fail(r, DECK_FILE_LONG_LINE);
+    if (c != '\n' && c != END_OF_FILE)
+      return fail(r, DECK_FILE_SYNTAX);
+  }
+
+  if (skipBlankLines(r) != END_OF_FILE)
+    return fail(r, DECK_FILE_TRAILING);
+  return 1;
+}
+
+int deckFileRead(const char *fileName, int nbIcons, DeckFile *deck,
+                 DeckFileError *error) {
+  memset(deck, 0, sizeof(*deck));
+  *error = (DeckFileError){DECK_FILE_OK, 0, 0};
+  Reader r = {.line = 1, .error = error};
+  r.file = assetOpen(fileName, "rb");
+  if (r.file == NULL) {
+    error->status = DECK_FILE_ABSENT;
+    return 0;
+  }
+  r.buffer = malloc(DECK_FILE_CHUNK + LOOKAHEAD);
+  int ok = r.buffer != NULL && readDeck(&r, deck, nbIcons);
+  if (r.buffer == NULL)
+    error->status = DECK_FILE_MEMORY;
+  else if (ok && ferror(r.file)) {
+    *error = (DeckFileError){DECK_FILE_ABSENT, 0, 0};
+    ok = 0;
+  }
+  free(r.buffer);
+  fclose(r.file);
+  if (!ok)
+    deckFileFree(deck);
+  return ok;
+}
+
+void deckFileFree(DeckFile *deck) {
+  free(deck->icons);
+  deck->icons = NULL;
+}
+
+const char *deckFileMessage(DeckFileStatus status) {
+  switch (status) {
+  case DECK_FILE_OK:
+    return "pas d'erreur";
+  case DECK_FILE_ABSENT:
+    return "fichier absent ou illisible";
+  case DECK_FILE_MEMORY:
+    return "mémoire insuffisante";
+  case DECK_FILE_SYNTAX:
+    return "caractère inattendu (entier positif attendu)";
+  case DECK_FILE_HEADER:
+    return "nombre de cartes ou d'icônes par carte invalide";
+  case DECK_FILE_MISMATCH:
+    return "nombre d'icônes par carte différent de celui demandé";
+  case DECK_FILE_RANGE:
+    return "numéro d'icône hors limites";
+  case DECK_FILE_DUPLICATE:
+    return "icône présente deux fois sur la carte";
+  case DECK_FILE_SHORT_LINE:
+    return "icônes manquantes sur la carte";
+  case DECK_FILE_LONG_LINE:
+    return "icônes en trop sur la carte";
+  case DECK_FILE_TRUNCATED:
+    return "cartes manquantes";
+  case DECK_FILE_TRAILING:
+    return "données après la dernière carte";
+  }
+  return "erreur inconnue";
+}
@@ -0,0 +1,52 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "deckindex.h"
+
+/**
+ * Index inversé du deck courant.
+ */
+static struct DeckIndex {
+  uint64_t symbolsOf[DECK_MAX_CARDS][DECK_WORDS]; // symboles de chaque carte
+  CardSet cardsWith[DECK_MAX_SYMBOLS];            // cartes de chaque symbole
+} x;
+
+int deckIndexBuild(const Card *cards, int nbCards, int nbIcons) {
+  if (nbCards > DECK_MAX_CARDS)
+    return 0;
+  memset(&x, 0, sizeof(x));
+  for (int i = 0; i < nbCards; i++) {
+    for (int j = 0; j < nbIcons; j++) {
+      int symbol = cards[i].icons[j].iconId;
+      if (symbol < 0 || symbol >= DECK_MAX_SYMBOLS)
+        return 0;
+      x.symbolsOf[i][symbol >> 6] |= 1ull << (symbol & 63);
+      cardSetAdd(&x.cardsWith[symbol], i);
+    }
+  }
+  return 1;
+}
+
+void cardSetAdd(CardSet *set, int card) {
+  set->bits[card >> 6] |= 1ull << (card & 63);
+}
+
+int deckIndexCommonSymbol(int a, int b) {
+  for (int w = 0; w < DECK_WORDS; w++) {
+    uint64_t common = x.symbolsOf[a][w] & x.symbolsOf[b][w];
+    if (common != 0)
+      return w * 64 + __builtin_ctzll(common);
+  }
+  return -1;
+}
+
+int deckIndexFindHolder(int symbol, const CardSet *visible) {
+  const CardSet *holders = &x.cardsWith[symbol];
+  for (int w = 0; w < DECK_WORDS; w++) {
+    uint64_t found = holders->bits[w] & visible->bits[w];
+    if (found != 0)
+      return w * 64 + __builtin_ctzll(found);
+  }
+  return -1;
+}
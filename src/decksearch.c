@@ -0,0 +1,562 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <SDL2/SDL.h>
+
+#include "assets.h"
+#include "clock.h"
+#include "decksearch.h"
+#include "packs.h"
+
+/**
+ * Ensemble de symboles (une carte) ou de cartes (les cartes d'un symbole).
+ */
+typedef struct {
+  uint64_t w[DECK_WORDS];
+} Bitset;
+
+/**
+ * Deck en cours de recherche : chaque carte est l'ensemble de ses symboles, et
+ * chaque symbole l'ensemble des cartes où il figure.
+ */
+typedef struct {
+  int nbCards;
+  int nbUsed; // nombre de symboles utilisés
+  Bitset cards[DECK_MAX_CARDS];
+  Bitset symbolCards[DECK_MAX_SYMBOLS];
+  int freq[DECK_MAX_SYMBOLS];
+} SearchDeck;
+
+/**
+ * Plan projectif d'ordre q : q² + q + 1 droites (cartes) de q + 1 points
+ * (symboles).
+ */
+typedef struct {
+  int order, nbPoints;
+  Bitset lines[DECK_MAX_CARDS];
+} Plane;
+
+/**
+ * Recherche locale d'un thread.
+ */
+typedef struct {
+  int id;
+  uint64_t rngState; // générateur propre au thread (xorshift64*)
+  int budget;        // nœuds restants pour l'ajout de la carte courante
+  SearchDeck deck;
+  long added, removed;
+} Worker;
+
+/**
+ * Paramètres et meilleur deck partagés par les threads.
+ */
+static struct DeckSearch {
+  int k, S, cap; // symboles par carte, symboles au plus, cartes par symbole
+  int bound;     // nombre de cartes maximal possible
+  int64_t deadline;
+  SDL_atomic_t stop;
+  SDL_mutex *lock;
+  SearchDeck best;
+} d;
+
+/****************** ENSEMBLES DE BITS ******************/
+
+static inline void bitSet(Bitset *set, int i) {
+  set->w[i >> 6] |= 1ull << (i & 63);
+}
+
+static inline void bitClear(Bitset *set, int i) {
+  set->w[i >> 6] &= ~(1ull << (i & 63));
+}
+
+static inline bool bitTest(const Bitset *set, int i) {
+  return (set->w[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline int bitCount(const Bitset *set) {
+  int count = 0;
+  for (int i = 0; i < DECK_WORDS; i++)
+    count += __builtin_popcountll(set->w[i]);
+  return count;
+}
+
+static inline bool bitEmpty(const Bitset *set) {
+  for (int i = 0; i < DECK_WORDS; i++) {
+    if (set->w[i])
+      return false;
+  }
+  return true;
+}
+
+static inline bool bitIntersects(const Bitset *a, const Bitset *b) {
+  for (int i = 0; i < DECK_WORDS; i++) {
+    if (a->w[i] & b->w[i])
+      return true;
+  }
+  return false;
+}
+
+static inline int bitCommon(const Bitset *a, const Bitset *b) {
+  int count = 0;
+  for (int i = 0; i < DECK_WORDS; i++)
+    count += __builtin_popcountll(a->w[i] & b->w[i]);
+  return count;
+}
+
+/****************** DECK ******************/
+
+static int nextRandom(Worker *worker, int n) {
+  uint64_t x = worker->rngState;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  worker->rngState = x;
+  return (int)(((x * 0x2545F4914F6CDD1Dull) >> 33) % (uint64_t)n);
+}
+
+static void addCard(SearchDeck *deck, const Bitset *symbols) {
+  int c = deck->nbCards++;
+  deck->cards[c] = *symbols;
+  for (int s = 0; s < d.S; s++) {
+    if (bitTest(symbols, s)) {
+      if (deck->freq[s]++ == 0)
+        deck->nbUsed++;
+      bitSet(&deck->symbolCards[s], c);
+    }
+  }
+}
+
+/**
+ * Retire une carte du deck ; la dernière carte prend sa place.
+ */
+static void removeCard(SearchDeck *deck, int c) {
+  int last = --deck->nbCards;
+  for (int s = 0; s < d.S; s++) {
+    if (bitTest(&deck->cards[c], s)) {
+      if (--deck->freq[s] == 0)
+        deck->nbUsed--;
+      bitClear(&deck->symbolCards[s], c);
+    }
+  }
+  if (c != last) {
+    deck->cards[c] = deck->cards[last];
+    for (int s = 0; s < d.S; s++) {
+      if (bitTest(&deck->cards[c], s)) {
+        bitClear(&deck->symbolCards[s], last);
+        bitSet(&deck->symbolCards[s], c);
+      }
+    }
+  }
+}
+
+/**
+ * Vérifie que deux cartes quelconques du deck ont exactement un symbole en
+ * commun.
+ */
+static bool checkDeck(const SearchDeck *deck) {
+  for (int i = 0; i < deck->nbCards; i++) {
+    if (bitCount(&deck->cards[i]) != d.k)
+      return false;
+    for (int j = i + 1; j < deck->nbCards; j++) {
+      if (bitCommon(&deck->cards[i], &deck->cards[j]) != 1)
+        return false;
+    }
+  }
+  return true;
+}
+
+/****************** PLANS TRONQUÉS ******************/
+
+static bool isPrime(int n) {
+  for (int i = 2; i * i <= n; i++) {
+    if (n % i == 0)
+      return false;
+  }
+  return n >= 2;
+}
+
+/**
+ * Charge le plan projectif d'ordre q : depuis le deck de q + 1 icônes par
+ * carte du dossier de données (ceux fournis couvrent les ordres 2 à 9, dont
+ * les puissances de nombres premiers 4, 8 et 9), sinon par construction pour
+ * un ordre premier.
+ */
+static bool loadPlane(int q, Plane *plane) {
+  memset(plane, 0, sizeof(Plane));
+  plane->order = q;
+  plane->nbPoints = q * q + q + 1;
+  if (plane->nbPoints > DECK_MAX_SYMBOLS)
+    return false;
+
+  const char *fileName = packsDeckFile(q + 1);
+  if (fileName != NULL) {
+    FILE *data = assetOpen(fileName, "r");
+    int nbCards, nbIcons;
+    if (data != NULL && fscanf(data, "%d %d", &nbCards, &nbIcons) == 2 &&
+        nbCards == plane->nbPoints && nbIcons == q + 1) {
+      bool valid = true;
+      for (int i = 0; i < nbCards && valid; i++) {
+        for (int j = 0; j < nbIcons && valid; j++) {
+          int point;
+          valid = fscanf(data, "%d", &point) == 1 && point >= 0 &&
+                  point < plane->nbPoints;
+          if (valid)
+            bitSet(&plane->lines[i], point);
+        }
+      }
+      fclose(data);
+      if (valid)
+        return true;
+      memset(plane->lines, 0, sizeof(plane->lines));
+    } else if (data != NULL) {
+      fclose(data);
+    }
+  }
+  if (!isPrime(q))
+    return false;
+
+  // Points (x, y) numérotés x * q + y, directions m numérotées q² + m, et
+  // direction verticale q² + q
+  int n = 0, infinity = q * q + q;
+  for (int m = 0; m < q; m++) {
+    for (int b = 0; b < q; b++, n++) {
+      for (int x = 0; x < q; x++)
+        bitSet(&plane->lines[n], x * q + (m * x + b) % q);
+      bitSet(&plane->lines[n], q * q + m);
+    }
+  }
+  for (int c = 0; c < q; c++, n++) {
+    for (int y = 0; y < q; y++)
+      bitSet(&plane->lines[n], c * q + y);
+    bitSet(&plane->lines[n], infinity);
+  }
+  for (int m = 0; m <= q; m++)
+    bitSet(&plane->lines[n], q * q + m);
+  return true;
+}
+
+/**
+ * Construit un deck de départ à partir du plan d'ordre q : les points les
+ * moins utilisés sont supprimés (avec les droites qui les contiennent)
+ * jusqu'à tenir dans S symboles, en comptant les symboles propres ajoutés à
+ * chaque droite pour atteindre k symboles par carte.
+ */
+static void truncatedPlane(const Plane *plane, SearchDeck *deck) {
+  int q = plane->order, nbLines = plane->nbPoints, pad = d.k - (q + 1);
+  bool pointKept[DECK_MAX_SYMBOLS], lineKept[DECK_MAX_CARDS];
+  int nbPoints = plane->nbPoints, nbKept = nbLines;
+  for (int i = 0; i < nbLines; i++)
+    pointKept[i] = lineKept[i] = true;
+
+  while (nbKept > 0 && nbPoints + nbKept * pad > d.S) {
+    // Point présent sur le moins de droites restantes
+    int worst = -1, worstCount = nbLines + 1;
+    for (int p = 0; p < plane->nbPoints; p++) {
+      if (!pointKept[p])
+        continue;
+      int count = 0;
+      for (int l = 0; l < nbLines; l++)
+        count += lineKept[l] && bitTest(&plane->lines[l], p);
+      if (count < worstCount)
+        worst = p, worstCount = count;
+    }
+    pointKept[worst] = false;
+    nbPoints--;
+    for (int l = 0; l < nbLines; l++) {
+      if (lineKept[l] && bitTest(&plane->lines[l], worst))
+        lineKept[l] = false, nbKept--;
+    }
+  }
+
+  // Renumérotation des points conservés, puis symboles propres à la suite
+  int ids[DECK_MAX_SYMBOLS], next = 0;
+  for (int p = 0; p < plane->nbPoints; p++)
+    ids[p] = pointKept[p] ? next++ : -1;
+  memset(deck, 0, sizeof(SearchDeck));
+  for (int l = 0; l < nbLines; l++) {
+    if (!lineKept[l])
+      continue;
+    Bitset card;
+    memset(&card, 0, sizeof(card));
+    for (int p = 0; p < plane->nbPoints; p++) {
+      if (bitTest(&plane->lines[l], p))
+        bitSet(&card, ids[p]);
+    }
+    for (int i = 0; i < pad; i++)
+      bitSet(&card, next++);
+    addCard(deck, &card);
+  }
+}
+
+/**
+ * Retient le meilleur deck de départ parmi les plans d'ordre 2 à k - 1.
+ */
+static void seedDeck(SearchDeck *seed) {
+  memset(seed, 0, sizeof(SearchDeck));
+  SearchDeck *candidate = malloc(sizeof(SearchDeck));
+  Plane *plane = malloc(sizeof(Plane));
+  for (int q = 2; q < d.k && candidate != NULL && plane != NULL; q++) {
+    if (!loadPlane(q, plane))
+      continue;
+    truncatedPlane(plane, candidate);
+    printf("dobble: Plan d'ordre %d tronqué : %d cartes, %d symboles.\n", q,
+           candidate->nbCards, candidate->nbUsed);
+    if (candidate->nbCards > seed->nbCards ||
+        (candidate->nbCards == seed->nbCards &&
+         candidate->nbUsed < seed->nbUsed))
+      *seed = *candidate;
+  }
+  free(candidate);
+  free(plane);
+}
+
+/****************** RECHERCHE LOCALE ******************/
+
+/**
+ * Cherche par backtracking une carte qui coupe chaque carte du deck en
+ * exactement un symbole : les symboles choisis doivent couvrir exactement
+ * l'ensemble des cartes (couverture exacte), puis la carte est complétée par
+ * des symboles inutilisés. La carte non couverte qui a le moins de symboles
+ * possibles est traitée en premier.
+ */
+static bool coverCards(Worker *worker, Bitset *uncovered, Bitset *covered,
+                       Bitset *card, int count) {
+  SearchDeck *deck = &worker->deck;
+  if (--worker->budget < 0)
+    return false;
+
+  if (bitEmpty(uncovered)) {
+    int fresh = d.k - count;
+    if (fresh > d.S - deck->nbUsed)
+      return false;
+    for (int s = 0; s < d.S && fresh > 0; s++) {
+      if (deck->freq[s] == 0)
+        bitSet(card, s), fresh--;
+    }
+    return true;
+  }
+  if (count == d.k)
+    return false;
+
+  // Carte non couverte la plus contrainte
+  int nbCandidates = d.k + 1;
+  int candidates[DECK_MAX_SYMBOLS], targetCandidates[DECK_MAX_SYMBOLS];
+  for (int c = 0; c < deck->nbCards; c++) {
+    if (!bitTest(uncovered, c))
+      continue;
+    int n = 0;
+    for (int s = 0; s < d.S; s++) {
+      if (bitTest(&deck->cards[c], s) && deck->freq[s] < d.cap &&
+          !bitIntersects(&deck->symbolCards[s], covered))
+        candidates[n++] = s;
+    }
+    if (n == 0)
+      return false;
+    if (n < nbCandidates) {
+      nbCandidates = n;
+      memcpy(targetCandidates, candidates, n * sizeof(int));
+    }
+  }
+
+  // Essai des symboles possibles dans un ordre aléatoire
+  int start = nextRandom(worker, nbCandidates);
+  for (int i = 0; i < nbCandidates; i++) {
+    int s = targetCandidates[(start + i) % nbCandidates];
+    const Bitset *cards = &deck->symbolCards[s];
+    Bitset nextUncovered = *uncovered, nextCovered = *covered;
+    for (int w = 0; w < DECK_WORDS; w++) {
+      nextUncovered.w[w] &= ~cards->w[w];
+      nextCovered.w[w] |= cards->w[w];
+    }
+    bitSet(card, s);
+    if (coverCards(worker, &nextUncovered, &nextCovered, card, count + 1))
+      return true;
+    bitClear(card, s);
+    if (worker->budget < 0)
+      return false;
+  }
+  return false;
+}
+
+static bool tryAddCard(Worker *worker) {
+  SearchDeck *deck = &worker->deck;
+  if (deck->nbCards >= DECK_MAX_CARDS)
+    return false;
+  Bitset uncovered, covered, card;
+  memset(&uncovered, 0, sizeof(Bitset));
+  memset(&covered, 0, sizeof(Bitset));
+  memset(&card, 0, sizeof(Bitset));
+  for (int c = 0; c < deck->nbCards; c++)
+    bitSet(&uncovered, c);
+
+  worker->budget = DECK_NODE_BUDGET;
+  if (!coverCards(worker, &uncovered, &covered, &card, 0))
+    return false;
+  addCard(deck, &card);
+  return true;
+}
+
+/**
+ * Publie le deck d'un thread s'il est meilleur que le meilleur deck connu.
+ */
+static void publish(Worker *worker) {
+  SDL_LockMutex(d.lock);
+  if (worker->deck.nbCards > d.best.nbCards) {
+    d.best = worker->deck;
+    printf("dobble: Thread %d : %d cartes (%d symboles).\n", worker->id,
+           d.best.nbCards, d.best.nbUsed);
+    if (d.best.nbCards >= d.bound)
+      SDL_AtomicSet(&d.stop, 1);
+  }
+  SDL_UnlockMutex(d.lock);
+}
+
+static int workerMain(void *param) {
+  Worker *worker = param;
+  int stalled = 0, bestCards = worker->deck.nbCards;
+  SearchDeck *restart = malloc(sizeof(SearchDeck));
+  if (restart == NULL)
+    return 0;
+  *restart = worker->deck;
+
+  while (!SDL_AtomicGet(&d.stop) && clockNow() < d.deadline) {
+    if (tryAddCard(worker)) {
+      worker->added++;
+      if (worker->deck.nbCards > bestCards) {
+        bestCards = worker->deck.nbCards;
+        *restart = worker->deck;
+        stalled = 0;
+        publish(worker);
+      }
+      continue;
+    }
+
+    // Deck bloqué : retrait de une à trois cartes au hasard ; après une longue
+    // stagnation, retour au meilleur deck du thread et retrait plus large
+    int nbRemoved = 1 + nextRandom(worker, 3);
+    if (++stalled > 5000) {
+      worker->deck = *restart;
+      nbRemoved = 1 + nextRandom(worker, 1 + worker->deck.nbCards / 3);
+      stalled = 0;
+    }
+    for (int i = 0; i < nbRemoved && worker->deck.nbCards > 0; i++) {
+      removeCard(&worker->deck, nextRandom(worker, worker->deck.nbCards));
+      worker->removed++;
+    }
+  }
+  free(restart);
+  return 0;
+}
+
+/****************** ÉCRITURE ******************/
+
+/**
+ * Écrit un deck au format de readCardFile (symboles renumérotés à partir de
+ * 0).
+ */
+static bool writeDeck(const SearchDeck *deck, const char *fileName) {
+  FILE *out = fopen(fileName, "w");
+  if (out == NULL)
+    return false;
+  int ids[DECK_MAX_SYMBOLS], next = 0;
+  for (int s = 0; s < d.S; s++)
+    ids[s] = deck->freq[s] > 0 ? next++ : -1;
+
+  fprintf(out, "%d %d\n", deck->nbCards, d.k);
+  for (int c = 0; c < deck->nbCards; c++) {
+    const char *separator = "";
+    for (int s = 0; s < d.S; s++) {
+      if (bitTest(&deck->cards[c], s)) {
+        fprintf(out, "%s%d", separator, ids[s]);
+        separator = " ";
+      }
+    }
+    fprintf(out, "\n");
+  }
+  return fclose(out) == 0;
+}
+
+int deckSearchRun(int nbIcons, int nbSymbols, const char *fileName,
+                  int nbThreads, int seconds) {
+  if (nbIcons < 2 || nbSymbols < nbIcons || nbSymbols > DECK_MAX_SYMBOLS) {
+    printf("dobble: Paramètres invalides (2 <= k <= S <= %d).\n",
+           DECK_MAX_SYMBOLS);
+    return 1;
+  }
+  memset(&d, 0, sizeof(d));
+  d.k = nbIcons;
+  d.S = nbSymbols;
+  d.cap = nbIcons;
+
+  // Borne : au plus k² - k + 1 cartes, et chaque paire de cartes partage un
+  // symbole, soit n(n - 1) <= S k (k - 1), et n k <= S k occurrences
+  d.bound = d.k * d.k - d.k + 1;
+  while (d.bound > 0 &&
+         ((long)d.bound * (d.bound - 1) > (long)d.S * d.cap * (d.cap - 1) ||
+          d.bound > d.S))
+    d.bound--;
+  if (d.bound > DECK_MAX_CARDS)
+    d.bound = DECK_MAX_CARDS;
+
+  if (nbThreads <= 0)
+    nbThreads = SDL_GetCPUCount();
+  if (nbThreads < 1)
+    nbThreads = 1;
+  d.lock = SDL_CreateMutex();
+  SDL_AtomicSet(&d.stop, 0);
+
+  seedDeck(&d.best);
+  printf("dobble: Recherche d'un deck à %d symboles par carte sur %d "
+         "symboles (au plus %d cartes), %d thread(s), %d s.\n",
+         d.k, d.S, d.bound, nbThreads, seconds);
+  if (d.best.nbCards >= d.bound)
+    SDL_AtomicSet(&d.stop, 1);
+
+  // Chaque thread part du meilleur deck de départ avec sa propre graine
+  Worker *workers = calloc(nbThreads, sizeof(Worker));
+  SDL_Thread **threads = calloc(nbThreads, sizeof(SDL_Thread *));
+  if (workers == NULL || threads == NULL) {
+    free(workers);
+    free(threads);
+    return 1;
+  }
+  uint64_t seed = (uint64_t)time(NULL) ^ (uint64_t)clockNow();
+  d.deadline = clockNow() + msToUs(1000 * (int64_t)seconds);
+  for (int t = 0; t < nbThreads; t++) {
+    workers[t].id = t;
+    workers[t].rngState = (seed + 0x9E3779B97F4A7C15ull * (t + 1)) | 1;
+    workers[t].deck = d.best;
+    threads[t] = SDL_CreateThread(workerMain, "deck-search", &workers[t]);
+  }
+  long added = 0, removed = 0;
+  for (int t = 0; t < nbThreads; t++) {
+    if (threads[t] != NULL)
+      SDL_WaitThread(threads[t], NULL);
+    else
+      workerMain(&workers[t]);
+    added += workers[t].added;
+    removed += workers[t].removed;
+  }
+  free(threads);
+  free(workers);
+  SDL_DestroyMutex(d.lock);
+
+  int ret = 0;
+  if (!checkDeck(&d.best)) {
+    printf("dobble: Deck invalide, rien n'est écrit.\n");
+    ret = 1;
+  } else if (!writeDeck(&d.best, fileName)) {
+    printf("dobble: Echec de l'écriture de %s.\n", fileName);
+    ret = 1;
+  } else {
+    printf("dobble: %d cartes (%s), %d symboles, écrit dans %s "
+           "(%ld ajouts, %ld retraits).\n",
+           d.best.nbCards,
+           d.best.nbCards >= d.bound ? "optimal" : "borne non atteinte",
+           d.best.nbUsed, fileName, added, removed);
+  }
+  return ret;
+}
@@ -0,0 +1,81 @@
+#include <stdbool.h>
+
+#include "difficulty.h"
+
+/* Amplitude de rotation minimale des icônes (niveau 0, en degrés) */
+#define MIN_ROTATION_RANGE 60
+
+/**
+ * État du contrôleur : quelques nombres, mis à jour à chaque réponse.
+ */
+static DifficultyState d;
+
+void difficultyEnable() {
+  d.active = true;
+  d.level = 0.5;
+  // Moyennes initialisées aux objectifs : le niveau ne bouge pas tant que le
+  // joueur n'a pas répondu
+  d.reaction = DIFFICULTY_TARGET_MS;
+  d.errors = DIFFICULTY_TARGET_ERRORS;
+  d.sinceSwitch = 0;
+  d.lastStep = 0;
+}
+
+bool difficultyActive() { return d.active; }
+
+/**
+ * Ramène une valeur dans un intervalle.
+ */
+static double clamp(double value, double min, double max) {
+  return value < min ? min : value > max ? max : value;
+}
+
+int difficultyRecordAnswer(int reactionMs, bool correct) {
+  if (!d.active)
+    return 0;
+
+  // Moyennes à décroissance exponentielle (les mauvaises réponses ne mesurent
+  // pas un temps de réaction utile)
+  if (correct)
+    d.reaction += DIFFICULTY_SMOOTHING * (reactionMs - d.reaction);
+  d.errors += DIFFICULTY_SMOOTHING * ((correct ? 0. : 1.) - d.errors);
+
+  // Écarts relatifs aux objectifs, positifs si le joueur fait mieux
+  double speed = (DIFFICULTY_TARGET_MS - d.reaction) / DIFFICULTY_TARGET_MS;
+  double accuracy =
+      (DIFFICULTY_TARGET_ERRORS - d.errors) / DIFFICULTY_TARGET_ERRORS;
+  d.level = clamp(d.level + DIFFICULTY_GAIN * clamp(speed + accuracy, -1, 1),
+                  0, 1);
+
+  // Changement de deck aux extrémités, au plus une fois toutes les
+  // DIFFICULTY_DECK_DWELL réponses
+  d.sinceSwitch++;
+  int step = d.level >= 1 ? 1 : d.level <= 0 ? -1 : 0;
+  if (step == 0 || d.sinceSwitch < DIFFICULTY_DECK_DWELL)
+    return 0;
+  d.level = 0.5;
+  d.sinceSwitch = 0;
+  d.lastStep = step;
+  return step;
+}
+
+void difficultyDeckUnavailable() { d.level = d.lastStep > 0 ? 1 : 0; }
+
+double difficultyLevel() { return d.active ? d.level : 0.5; }
+
+int difficultyRotationRange() {
+  // Rotation quelconque à partir du niveau standard
+  int range = MIN_ROTATION_RANGE +
+              (int)(2 * (360 - MIN_ROTATION_RANGE) * difficultyLevel());
+  return range < 360 ? range : 360;
+}
+
+double difficultyScaleSpread() { return 0.25 + 1.5 * difficultyLevel(); }
+
+int difficultyTimeBonus(int bonusMs) {
+  return (int)(bonusMs * (1.5 - difficultyLevel()));
+}
+
+void difficultyGetState(DifficultyState *state) { *state = d; }
+
+void difficultySetState(const DifficultyState *state) { d = *state; }
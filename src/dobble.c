@@ -2,16 +2,80 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <SDL2/SDL.h>
 
+#include "assets.h"
+#include "atlas.h"
+#include "capture.h"
+#include "clock.h"
+#include "deckfile.h"
+#include "deckindex.h"
+#include "decksearch.h"
+#include "difficulty.h"
 #include "dobble-config.h"
 #include "dobble.h"
+#include "font.h"
 #include "graphics.h"
+#include "iconindex.h"
+#include "iconmap.h"
+#include "kernels.h"
+#include "net.h"
+#include "packs.h"
+#include "race.h"
+#include "replay.h"
+#include "scores.h"
+#include "snapshot.h"
+#include "sprites.h"
+#include "stats.h"
+#include "tween.h"
+#include "ui.h"
 
 Game gameGlobal; // Jeu actuel avec toutes les variables nécessaires
 
+/* Nombre de cases de la file des paires distribuées */
+#define DEAL_QUEUE_SIZE (DEAL_LOOKAHEAD + 1)
+
+/**
+ * Paire de cartes distribuée : indices dans le deck et copie de leurs icônes,
+ * disposées pour cette paire (le deck n'est pas modifié).
+ */
+typedef struct {
+  int upper, lower;
+  Icon icons[2][DECKS_MAX_ICONS];
+  double scale; // échelle de la position des icônes
+} DealtPair;
+
+/**
+ * File circulaire des paires distribuées : la paire affichée, suivie des
+ * paires tirées à l'avance. Sa taille est fixe quelle que soit la durée de la
+ * partie.
+ */
+static struct DealQueue {
+  DealtPair pairs[DEAL_QUEUE_SIZE];
+  int shown; // case de la paire affichée
+  int count; // nombre de paires en attente après la paire affichée
+} deals;
+
+/**
+ * Decks lus pendant la session, indexés par nombre d'icônes par carte et
+ * gardés en mémoire jusqu'à freeDeck : un changement de deck ne relit pas de
+ * fichier.
+ */
+static struct ResidentDeck {
+  Card *cards;
+  int nbCards;
+  int nbSymbols; // numéro de symbole le plus grand + 1
+} resident[DECKS_MAX_ICONS + 1];
+
+static struct ResidentDeck *residentDeck(int nbIcons);
+
+/* Place de la dernière partie dans l'historique des scores (voir scores.h) */
+static ScoreRank roundRank;
+static bool roundRanked;
+
 void printError(Error error) {
   switch (error) {
   case FILE_ABSENT:
@@ -27,9 +91,26 @@ void printError(Error error) {
   exit(error);
 }
 
+void seedRandom(uint64_t seed) {
+  // L'état du générateur xorshift ne doit jamais être nul
+  gameGlobal.rngState = seed != 0 ? seed : 0x9E3779B97F4A7C15ull;
+}
+
+int randomInt(int n) {
+  // Générateur xorshift64* : l'état tient dans gameGlobal, ce qui rend les
+  // tirages reproductibles à partir d'une graine enregistrée
+  uint64_t x = gameGlobal.rngState;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  gameGlobal.rngState = x;
+  return (int)(((x * 0x2545F4914F6CDD1Dull) >> 33) % (uint64_t)n);
+}
+
 void initDeck(int nbCards, int nbIcons) {
   gameGlobal.nbIcons = nbIcons;
   gameGlobal.nbCards = nbCards;
+  cardKernelsUse(nbIcons);
   gameGlobal.cards = (Card *)malloc(sizeof(Card) * nbCards);
 }
 
@@ -37,21 +118,31 @@ void initCard(Card *card, int nbIcons, int icons[]) {
   card->icons = (Icon *)malloc(sizeof(Icon) * nbIcons);
   for (int i = 0; i < nbIcons; i++) {
     card->icons[i].iconId = icons[i];
+    card->icons[i].imageId = icons[i];
   }
 }
 
 void initIcon(Icon *icon, double angle) {
   icon->angle = angle;
-  icon->rotation = rand() % 360; // random between 0 and 359
-  icon->radius =
-      CARD_RADIUS * (0.5 + (rand() % 3) * 0.1); // random between 0.5 and 0.7
-  icon->scale =
-      (rand() % 6) * 0.1 + 0.005 * icon->radius; // random between 0.6 and 1.2
+  // Amplitude de rotation et variation de taille réglées par la difficulté
+  // adaptative (mêmes tirages que le jeu standard sinon)
+  int range = difficultyRotationRange();
+  icon->rotation = randomInt(range); // random between 0 and 359
+  if (range < 360)
+    icon->rotation -= range / 2;
+  // Rendu logiciel : angle d'une icône pré-tournée (même tirage)
+  icon->rotation = spriteSnapRotation(icon->rotation);
+  icon->radius = BASE_CARD_RADIUS *
+                 (0.5 + randomInt(3) * 0.1); // random between 0.5 and 0.7
+  double variation = randomInt(6) * 0.1;
+  if (difficultyActive())
+    variation = 0.25 + (variation - 0.25) * difficultyScaleSpread();
+  icon->scale = variation + 0.005 * icon->radius; // random between 0.6 and 1.2
 }
 
 void initCardIcons(Card currentCard) {
   int currentIcon = 0;
-  int angleOffset = rand() % 360; // random between 0 and 359
+  int angleOffset = randomInt(360); // random between 0 and 359
 
   // Placement des icônes en cercle (régulièrement)
   for (int angle = angleOffset; currentIcon < gameGlobal.nbIcons - 1;
@@ -66,41 +157,39 @@ void initCardIcons(Card currentCard) {
 }
 
 void freeDeck() {
-  for (int i = 0; i < gameGlobal.nbCards; i++) {
-    free(gameGlobal.cards[i].icons);
+  for (int k = 0; k <= DECKS_MAX_ICONS; k++) {
+    for (int i = 0; i < resident[k].nbCards; i++) {
+      free(resident[k].cards[i].icons);
+    }
+    free(resident[k].cards);
   }
-  free(gameGlobal.cards);
+  memset(resident, 0, sizeof(resident));
+  gameGlobal.cards = NULL;
+  gameGlobal.nbCards = 0;
+  gameGlobal.dealtUpper = gameGlobal.dealtLower = NULL;
+  deals.count = 0;
   printf("freeDeck\n");
 }
 
-void readCardFile(char const *fileName) {
-  // Open the card file in read-only mode
-  FILE *data = fopen(fileName, "r");
-
-  // Check if the opening was successful
-  if (data == NULL)
-    printError(FILE_ABSENT);
-
-  // Check if the format is correct while reading the first line
-  int nbCards, nbIcons;
-  if (fscanf(data, "%d %d", &nbCards, &nbIcons) != 2 || nbCards == 0 ||
-      nbIcons == 0) {
-    printError(INCORRECT_FORMAT);
+int readCardFile(char const *fileName, int nbIcons) {
+  // Lecture et vérification du fichier entier avant de créer le deck
+  DeckFile deck;
+  DeckFileError error;
+  if (!deckFileRead(fileName, nbIcons, &deck, &error)) {
+    if (error.line > 0)
+      printf("dobble: %s, ligne %d, colonne %d : %s.\n", fileName, error.line,
+             error.column, deckFileMessage(error.status));
+    else
+      printf("dobble: %s : %s.\n", fileName, deckFileMessage(error.status));
+    return 0;
   }
-  initDeck(nbCards, nbIcons);
 
-  // Check is the format is correct while reading each card / line
-  int icons[nbIcons], iconId;
-  for (int i = 0; i < nbCards; i++) {
-    for (int j = 0; j < nbIcons; j++) {
-      if (fscanf(data, "%d", &iconId) != 1)
-        printError(INCORRECT_FORMAT);
-      icons[j] = iconId;
-    }
-    initCard(&gameGlobal.cards[i], nbIcons, icons);
-  }
-
-  fclose(data);
+  initDeck(deck.nbCards, deck.nbIcons);
+  for (int i = 0; i < deck.nbCards; i++)
+    initCard(&gameGlobal.cards[i], deck.nbIcons,
+             &deck.icons[i * deck.nbIcons]);
+  deckFileFree(&deck);
+  return 1;
 }
 
 void onMouseMove(int x, int y) {
@@ -112,124 +201,520 @@ double dist(double ax, double ay, double bx, double by) {
   return sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
 }
 
+/**
+ * Lit tous les decks du dossier de données avant la partie (difficulté
+ * adaptative), sans remplacer le deck choisi.
+ */
+static void preloadDecks() {
+  for (int k = 0; k <= DECKS_MAX_ICONS; k++)
+    residentDeck(k);
+}
+
+/**
+ * Passe au deck d'ordre voisin (difficulté adaptative). Le deck est déjà en
+ * mémoire : seules les icônes de la partie sont choisies à nouveau, et les
+ * paires distribuées à l'avance sont abandonnées.
+ *
+ * @param step 1 pour le deck d'ordre supérieur, -1 pour le deck inférieur
+ */
+static void switchDeck(int step) {
+  int k = gameGlobal.nbIcons + step;
+  while (k > 1 && k <= DECKS_MAX_ICONS &&
+         !deckFitsPacks(k, gameGlobal.packMask))
+    k += step;
+  if (k <= 1 || k > DECKS_MAX_ICONS) {
+    difficultyDeckUnavailable();
+    return;
+  }
+  if (!loadDeck(k)) {
+    difficultyDeckUnavailable();
+    return;
+  }
+  printf("dobble: Difficulté : %d icônes par carte.\n", k);
+  iconMapBuild();
+  deals.count = 0;
+}
+
+/**
+ * Icône commune de la paire précédente, mise en évidence par-dessus les cartes
+ * (agrandie puis effacée) après une réponse.
+ */
+static struct Pop {
+  Icon icon;
+  double scale, alpha;
+} pop;
+
+/**
+ * Indique si les cartes sont animées (pas lors d'une relecture sans fenêtre).
+ */
+static bool animationsEnabled() { return !gameGlobal.headless; }
+
+/**
+ * Anime la distribution de la première paire : les cartes grandissent en
+ * tournant jusqu'à leur place.
+ */
+static void animateDeal() {
+  tweenFinishAll();
+  for (CardPosition card = UpperCard; card <= LowerCard; card++) {
+    CardTransform *t = getCardTransform(card);
+    tweenStart(&t->scaleX, 0.2, 1, ANIM_DEAL_MS, EASE_OUT_BACK);
+    tweenStart(&t->scaleY, 0.2, 1, ANIM_DEAL_MS, EASE_OUT_BACK);
+    tweenStart(&t->angle, -90, 0, ANIM_DEAL_MS, EASE_OUT_CUBIC);
+  }
+}
+
+/**
+ * Anime l'arrivée de la paire suivante après une réponse : glissement depuis
+ * la droite après une bonne réponse, retournement après une erreur, et mise
+ * en évidence de l'icône commune de la paire précédente (la bonne réponse).
+ *
+ * @param result Le résultat du clic
+ * @param found  L'icône commune de la paire précédente, sur la carte du haut
+ */
+static void animateAnswer(Resultat result, Icon found) {
+  tweenFinishAll();
+  pop.icon = found;
+  tweenStart(&pop.scale, 1, 1.8, ANIM_POP_MS, EASE_OUT_CUBIC);
+  tweenStart(&pop.alpha, 1, 0, ANIM_POP_MS, EASE_LINEAR);
+  for (CardPosition card = UpperCard; card <= LowerCard; card++) {
+    CardTransform *t = getCardTransform(card);
+    if (result == CORRECT)
+      tweenStart(&t->dx, BASE_WIN_WIDTH / 2., 0, ANIM_SLIDE_MS,
+                 EASE_OUT_CUBIC);
+    else
+      tweenStart(&t->scaleX, 0, 1, ANIM_FLIP_MS, EASE_OUT_CUBIC);
+  }
+}
+
 Resultat onMouseClick(int mouseX, int mouseY) {
+  // Pendant une relecture, seuls les clics enregistrés sont pris en compte
+  if (!replayAcceptsClick())
+    return INDEFINI;
   printf("\ndobble: Clic de la souris.\n");
 
-  // Si le timer n'est pas enclanché :
-  // Choix du pack d'icônes et du nombre d'icônes
-  if (!gameGlobal.timerRunning &&
-      !(gameGlobal.iconPackChosen && gameGlobal.nbIconChosen)) {
+  switch (gameGlobal.state) {
+  case STATE_MENU:
+    // Choix du pack d'icônes et du nombre d'icônes, puis début de la partie
     EnterBoutonClic(mouseX, mouseY);
     showWindow();
-    if (!(gameGlobal.iconPackChosen && gameGlobal.nbIconChosen)) {
-      return INDEFINI;
+    if (gameGlobal.iconPackChosen && gameGlobal.nbIconChosen) {
+      printf("dobble: Démarrage du compte à rebours.\n");
+      if (difficultyActive())
+        preloadDecks();
+      startRound();
+      renderScene();
     }
+    return INDEFINI;
+  case STATE_RESULTS:
+    ExitBoutonClic(mouseX, mouseY);
+    return INDEFINI;
+  case STATE_QUIT:
+    return INDEFINI;
+  case STATE_PLAYING:
+    // Partie reprise dont les packs sont en cours de chargement
+    if (snapshotResuming())
+      return INDEFINI;
+    break;
   }
 
-  // Si le timmer n'est pas enclanché et que le menu a été initilisé
-  if (!gameGlobal.timerRunning && gameGlobal.iconPackChosen &&
-      gameGlobal.nbIconChosen) {
-    printf("dobble: Démarrage du compte à rebours.\n");
-    // Sélection de deux première cartes aléatoires
-    changeCards();
-    // on enclanche le timmer
-    startTimer();
-    gameGlobal.timerRunning = true;
+  // Temps écoulé avant le prochain tic : le clic est traité par le menu de fin
+  updateRemainingTime();
+  if (gameGlobal.time <= 0 && !gameGlobal.endless) {
+    finishRound();
+    ExitBoutonClic(mouseX, mouseY);
     return INDEFINI;
   }
 
-  // Si le timer est inferieur ou égal à 0 on gère les clics du menu de fin
-  // Sinon cas normal du mainloop
-  if (gameGlobal.time <= 0) {
-    ExitBoutonClic(mouseX, mouseY);
-  } else {
-    // Identification de l'icône identique aux deux cartes
-    int indexOfIdenticalIconUpper;
-    for (int i = 0; i < gameGlobal.nbIcons; i++) {
-      for (int j = 0; j < gameGlobal.nbIcons; j++) {
-        if (gameGlobal.cardUpper.icons[i].iconId ==
-            gameGlobal.cardLower.icons[j].iconId) {
-          indexOfIdenticalIconUpper = i;
-        }
-      }
-    }
+  // Un seul instant pour le temps de réaction et l'enregistrement : la
+  // relecture retrouve exactement le même temps
+  int64_t clickedAt = clockNow();
+  replayRecordClick(mouseX, mouseY, clickedAt);
 
-    // Variable booléenne permettant de savoir si on a cliqué sur le bon icône
-    bool iconClickedIsCorrect = false;
+  // Identification de l'icône identique aux deux cartes
+  int indexOfIdenticalIconUpper = cardKernels()->commonIcon(
+      gameGlobal.cardUpper.icons, gameGlobal.cardLower.icons);
+  if (indexOfIdenticalIconUpper < 0)
+    return INDEFINI;
 
-    // Vérification que le joueur n'a pas cliqué hors de la carte
-    // Si le clic est hors de la carte son action n'est pas pris en compte
-    float distance =
-        dist(mouseX, mouseY, (WIN_WIDTH / 2), (4 * FONT_SIZE + CARD_RADIUS));
-    if (distance > CARD_RADIUS) {
-      return INDEFINI;
-    }
+  // Vérification que le joueur n'a pas cliqué hors de la carte
+  // Si le clic est hors de la carte son action n'est pas pris en compte
+  float distance =
+      dist(mouseX, mouseY, (WIN_WIDTH / 2), (4 * FONT_SIZE + CARD_RADIUS));
+  if (distance > CARD_RADIUS) {
+    return INDEFINI;
+  }
 
-    // Calcul de la distance entre le curseur au moment du clic et le bon icône
-    int centerY = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].centerY;
-    int centerX = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].centerX;
-    float scale = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].scale;
-    distance = dist(mouseX, mouseY, centerX, centerY);
-
-    // Si le joueur a cliqué sur le bon icône il gagne du temps, on augmente
-    // son score et le résultat de son clic est mis à CORRECT
-    if (distance <= (scale * WIN_ICON_SIZE) / 2.) {
-      iconClickedIsCorrect = true;
-      gameGlobal.time += 3;
-      gameGlobal.score++;
-      gameGlobal.resultatClic = CORRECT;
-      changeCards();
-      renderScene();
-      return CORRECT;
-    } else {
-      // Si le joueur n'a pas cliqué sur le bon icône il perd du temps et le
-      // résultat de son clic est mis à INCORRECT
-      gameGlobal.time -= 3;
-      gameGlobal.resultatClic = INCORRECT;
-      gameGlobal.nbFalse++;
+  // Calcul de la distance entre le curseur au moment du clic et le bon icône
+  int centerY = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].centerY;
+  int centerX = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].centerX;
+  float scale = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper].scale;
+  distance = dist(mouseX, mouseY, centerX, centerY);
+
+  // Si le joueur a cliqué sur le bon icône il gagne du temps, on augmente
+  // son score et le résultat de son clic est mis à CORRECT. Le bonus de
+  // temps décroît avec le temps de réaction, et une réponse rapide rapporte
+  // un point supplémentaire (le mode sans fin n'a pas de compte à rebours).
+  // Un clic sur une paire pas encore affichée n'a ni bonus de rapidité ni
+  // temps de réaction mesuré
+  Icon found = gameGlobal.cardUpper.icons[indexOfIdenticalIconUpper];
+  int iconToFind = found.imageId;
+  int reaction = reactionTime(clickedAt);
+  bool presented = reaction >= 0;
+  if (!presented)
+    reaction = DIFFICULTY_TARGET_MS;
+  if (distance <= (scale * WIN_ICON_SIZE) / 2.) {
+    if (presented)
+      statsRecordAnswer(0, gameGlobal.nbIcons, iconToFind, reaction, true);
+    int step = difficultyRecordAnswer(reaction, true);
+    int bonus = presented ? TIME_BONUS_MAX_MS - reaction / 2 : 0;
+    if (bonus < TIME_BONUS_MIN_MS)
+      bonus = TIME_BONUS_MIN_MS;
+    if (!gameGlobal.endless)
+      gameGlobal.deadline += msToUs(difficultyTimeBonus(bonus));
+    gameGlobal.score += presented && reaction < FAST_ANSWER_MS ? 2 : 1;
+    updateRemainingTime();
+    gameGlobal.resultatClic = CORRECT;
+    if (step != 0)
+      switchDeck(step);
+    changeCards();
+    if (animationsEnabled())
+      animateAnswer(CORRECT, found);
+    renderScene();
+    return CORRECT;
+  } else {
+    // Si le joueur n'a pas cliqué sur le bon icône il perd du temps (une
+    // erreur permise en mode sans fin) et le résultat de son clic est mis à
+    // INCORRECT
+    if (presented)
+      statsRecordAnswer(0, gameGlobal.nbIcons, iconToFind, reaction, false);
+    int step = difficultyRecordAnswer(reaction, false);
+    if (!gameGlobal.endless)
+      gameGlobal.deadline -= msToUs(TIME_PENALTY_MS);
+    else if (--gameGlobal.lives == 0)
+      finishRound();
+    updateRemainingTime();
+    gameGlobal.resultatClic = INCORRECT;
+    gameGlobal.nbFalse++;
+    if (gameGlobal.state == STATE_PLAYING) {
+      if (step != 0)
+        switchDeck(step);
       changeCards();
-      renderScene();
-      return INCORRECT;
+      if (animationsEnabled())
+        animateAnswer(INCORRECT, found);
     }
+    renderScene();
+    return INCORRECT;
   }
   return INDEFINI;
 }
 
+void onPointerDown(int x, int y, int64_t at) {
+  // En réseau, les parties sont lancées par le serveur : seuls les appuis
+  // pendant une partie et les clics du menu de fin sont traités
+  if (netActive()) {
+    if (!netPlaying())
+      return;
+    updateRemainingTime();
+    if (gameGlobal.state == STATE_PLAYING && gameGlobal.time > 0)
+      netOnPointerDown(x, y, at);
+    else if (gameGlobal.state == STATE_RESULTS)
+      ExitBoutonClic(x, y);
+    return;
+  }
+
+  // En mode course, les appuis pendant la partie sont attribués aux joueurs ;
+  // les menus restent gérés comme des clics de souris
+  if (raceActive() && gameGlobal.state == STATE_PLAYING) {
+    updateRemainingTime();
+    if (gameGlobal.time > 0) {
+      raceOnPointerDown(x, y, at);
+      return;
+    }
+  }
+  onMouseClick(x, y);
+}
+
 void onTimerTick() {
-  printf("\ndobble: Tic du compte à rebours\n");
-  gameGlobal.time--;
+  updateRemainingTime();
+  if (gameGlobal.state == STATE_PLAYING && gameGlobal.time <= 0 &&
+      !gameGlobal.endless)
+    finishRound();
   renderScene();
 }
 
-void changeCards() {
+void onSuspend() { snapshotSave(); }
+
+void finishRound() {
+  // Plus besoin de rafraîchir le compte à rebours (ni de sauvegarde de la
+  // partie), et export des statistiques de la session si demandé
+  gameGlobal.state = STATE_RESULTS;
+  stopTimer();
+  snapshotDiscard();
+  replayEndRound(gameGlobal.score, gameGlobal.nbFalse);
+  if (gameGlobal.statsFile != NULL)
+    exportStats(gameGlobal.statsFile);
+
+  // Historique et classement des parties jouées seul (pas des relectures)
+  if (scoresActive() && !raceActive() && !netActive() && !replayPlaying()) {
+    ScoreRecord record = {
+        .score = gameGlobal.score,
+        .nbFalse = gameGlobal.nbFalse,
+        .time = gameGlobal.endless ? gameGlobal.time : 0,
+        .packs = packsIdentity(gameGlobal.packMask),
+        .nbIcons = difficultyActive() ? 0 : (uint8_t)gameGlobal.nbIcons,
+        .flags = (gameGlobal.endless ? SCORES_ENDLESS : 0) |
+                 (difficultyActive() ? SCORES_ADAPTIVE : 0)};
+    roundRanked = scoresAdd(&record, &roundRank);
+
+    ScoreRecord top[SCORES_TOP];
+    int n = scoresTop(record.nbIcons, record.packs, record.flags, top,
+                      SCORES_TOP);
+    if (n > 0) {
+      printf("dobble: Partie classée %d sur %d, meilleurs scores :",
+             roundRank.rank, roundRank.count);
+      for (int i = 0; i < n; i++)
+        printf(" %d", top[i].score);
+      printf("\n");
+    }
+  }
+}
+
+void startRound() {
+  // Choix des icônes de la partie (imposées par l'enregistrement pendant une
+  // relecture)
+  if (!replayPlaying())
+    iconMapBuild();
+
+  // Les paires distribuées à l'avance portent les icônes de la partie
+  // précédente
+  deals.count = 0;
+  gameGlobal.lives = ENDLESS_LIVES;
+  roundRanked = false;
+  gameGlobal.state = STATE_PLAYING;
+
+  if (raceActive()) {
+    // Distribution d'une carte par joueur et de la carte centrale
+    raceDeal();
+  } else {
+    // L'enregistrement commence avant le premier tirage pour en conserver la
+    // graine
+    replayBeginRound();
+    // Sélection de deux première cartes aléatoires
+    changeCards();
+    if (animationsEnabled())
+      animateDeal();
+  }
+  // on enclanche le timmer
+  startCountdown();
+  gameGlobal.timerRunning = true;
+}
+
+void startCountdown() {
+  gameGlobal.roundStart = clockNow();
+  gameGlobal.deadline = gameGlobal.roundStart + msToUs(ROUND_DURATION_MS);
+  gameGlobal.time = gameGlobal.endless ? 0 : ROUND_DURATION_MS;
+  startTimer();
+}
+
+void updateRemainingTime() {
+  // Le temps n'évolue que pendant une partie
+  if (!gameGlobal.timerRunning || gameGlobal.state != STATE_PLAYING)
+    return;
+  if (gameGlobal.endless) {
+    gameGlobal.time = (int)usToMs(clockNow() - gameGlobal.roundStart);
+    return;
+  }
+  if (gameGlobal.time <= 0)
+    return;
+  int64_t remaining = usToMs(gameGlobal.deadline - clockNow());
+  gameGlobal.time = remaining > 0 ? (int)remaining : 0;
+}
+
+int reactionTime(int64_t at) {
+  // La paire n'a pas encore été affichée (avant la première image, ou
+  // partie reprise) : pas de temps de réaction
+  if (gameGlobal.pairShownAt == 0)
+    return -1;
+  return (int)usToMs(at - gameGlobal.pairShownAt);
+}
+
+/**
+ * Indique si deux cartes ont des icônes différentes mais confondables (d'après
+ * l'index de similarité des packs).
+ */
+static bool confusablePair(Card a, Card b) {
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    for (int j = 0; j < gameGlobal.nbIcons; j++) {
+      if (a.icons[i].iconId != b.icons[j].iconId &&
+          iconIndexConfusable(a.icons[i].imageId, b.icons[j].imageId))
+        return true;
+    }
+  }
+  return false;
+}
+
+void pickPair(int *upper, int *lower) {
   int i, j;
 
-  // Sélection d'un indice pour gameGlobal.cardUpper différent de ceux des
-  // cartes précédentes
-  do {
-    i = rand() % (gameGlobal.nbCards);
-  } while (gameGlobal.cards[i].icons == gameGlobal.cardUpper.icons ||
-           gameGlobal.cards[i].icons == gameGlobal.cardLower.icons);
+  // Nouveau tirage (au plus PAIR_ATTEMPTS fois) si les deux cartes portent des
+  // icônes confondables, ce qui n'arrive que si le choix des icônes de la
+  // partie n'a pas pu les éviter
+  for (int attempt = 0; attempt < PAIR_ATTEMPTS; attempt++) {
+    // Sélection d'un indice pour la carte du haut différent de ceux des
+    // cartes de la dernière paire tirée
+    do {
+      i = randomInt(gameGlobal.nbCards);
+    } while (gameGlobal.cards[i].icons == gameGlobal.dealtUpper ||
+             gameGlobal.cards[i].icons == gameGlobal.dealtLower);
+
+    // Sélection d'un indice pour la carte du bas différent de ceux des
+    // cartes de la dernière paire tirée et de celui de la carte du haut
+    do {
+      j = randomInt(gameGlobal.nbCards);
+    } while (gameGlobal.cards[j].icons == gameGlobal.dealtUpper ||
+             gameGlobal.cards[i].icons == gameGlobal.dealtLower || i == j);
+
+    if (!confusablePair(gameGlobal.cards[i], gameGlobal.cards[j]))
+      break;
+  }
+
+  *upper = i;
+  *lower = j;
+}
+
+/**
+ * Retourne une carte d'une paire distribuée (0 : haut, 1 : bas).
+ */
+static Card pairCard(DealtPair *pair, int k) { return (Card){pair->icons[k]}; }
+
+/**
+ * Calcule la position des icônes d'une paire à l'échelle courante.
+ */
+static void layoutPair(DealtPair *pair) {
+  layoutCard(UpperCard, pairCard(pair, 0));
+  layoutCard(LowerCard, pairCard(pair, 1));
+  pair->scale = WIN_SCALE;
+}
 
-  // Sélection d'un indice pour gameGlobal.cardLower différent de ceux des
-  // cartes précédentes et de celui de gameGlobal.cardUpper
-  do {
-    j = rand() % (gameGlobal.nbCards);
-  } while (gameGlobal.cards[j].icons == gameGlobal.cardUpper.icons ||
-           gameGlobal.cards[i].icons == gameGlobal.cardLower.icons || i == j);
+/**
+ * Distribue une paire dans une case de la file. Le mélange des icônes change
+ * celle placée au centre ; il part de l'ordre du deck pour que la disposition
+ * ne dépende que du générateur aléatoire. La position de chaque icône est
+ * calculée une fois pour toutes.
+ */
+static void fillPair(DealtPair *pair, int i, int j) {
+  int deck[2] = {i, j};
+  for (int k = 0; k < 2; k++) {
+    memcpy(pair->icons[k], gameGlobal.cards[deck[k]].icons,
+           gameGlobal.nbIcons * sizeof(Icon));
+    cardKernels()->sortIcons(pair->icons[k]);
+    cardKernels()->shuffle(pair->icons[k]);
+    cardKernels()->placeIcons(pair->icons[k]);
+  }
+  layoutPair(pair);
+  pair->upper = i;
+  pair->lower = j;
+  gameGlobal.dealtUpper = gameGlobal.cards[i].icons;
+  gameGlobal.dealtLower = gameGlobal.cards[j].icons;
+}
 
-  // Mise à jour de gameGlobal.cardUpper et gameGlobal.cardLower en fonction des
-  // nouveaux indices
-  gameGlobal.cardUpper = gameGlobal.cards[i];
-  initCardIcons(gameGlobal.cardUpper);
-  gameGlobal.cardLower = gameGlobal.cards[j];
-  initCardIcons(gameGlobal.cardLower);
+/**
+ * Tire une paire et l'ajoute à la fin de la file.
+ */
+static void queuePair() {
+  int i, j;
+  pickPair(&i, &j);
+  fillPair(&deals.pairs[(deals.shown + 1 + deals.count) % DEAL_QUEUE_SIZE], i,
+           j);
+  deals.count++;
+}
+
+/**
+ * Affiche la paire d'une case de la file.
+ */
+static void showPair(DealtPair *pair) {
+  replayDeal(pair->upper, pair->lower);
+  // Fenêtre redimensionnée depuis la distribution
+  if (pair->scale != WIN_SCALE)
+    layoutPair(pair);
+  gameGlobal.cardUpper = pairCard(pair, 0);
+  gameGlobal.cardLower = pairCard(pair, 1);
+
+  // Le temps de réaction sera mesuré à partir du prochain affichage
+  gameGlobal.pairShownAt = 0;
+}
+
+void changeCards() {
+  if (deals.count == 0)
+    queuePair();
+  deals.shown = (deals.shown + 1) % DEAL_QUEUE_SIZE;
+  deals.count--;
+  showPair(&deals.pairs[deals.shown]);
+  while (deals.count < DEAL_LOOKAHEAD)
+    queuePair();
+}
+
+void dealPair(int i, int j) {
+  deals.count = 0;
+  deals.shown = (deals.shown + 1) % DEAL_QUEUE_SIZE;
+  fillPair(&deals.pairs[deals.shown], i, j);
+  showPair(&deals.pairs[deals.shown]);
+}
+
+void currentPair(int *upper, int *lower) {
+  *upper = deals.pairs[deals.shown].upper;
+  *lower = deals.pairs[deals.shown].lower;
+}
+
+void restorePair(int upper, int lower, const Icon *upperIcons,
+                 const Icon *lowerIcons) {
+  deals.count = 0;
+  deals.shown = (deals.shown + 1) % DEAL_QUEUE_SIZE;
+  DealtPair *pair = &deals.pairs[deals.shown];
+  memcpy(pair->icons[0], upperIcons, gameGlobal.nbIcons * sizeof(Icon));
+  memcpy(pair->icons[1], lowerIcons, gameGlobal.nbIcons * sizeof(Icon));
+  pair->upper = upper;
+  pair->lower = lower;
+  pair->scale = 0; // positions recalculées à l'affichage
+  gameGlobal.dealtUpper = gameGlobal.cards[upper].icons;
+  gameGlobal.dealtLower = gameGlobal.cards[lower].icons;
+  showPair(pair);
+  while (deals.count < DEAL_LOOKAHEAD)
+    queuePair();
+}
+
+/**
+ * Prépare le rendu des cartes des paires en attente. Appelée après
+ * l'affichage d'une image, pour ne pas la retarder.
+ */
+static void prepareDeals() {
+  for (int k = 1; k <= deals.count; k++) {
+    DealtPair *pair = &deals.pairs[(deals.shown + k) % DEAL_QUEUE_SIZE];
+    if (pair->scale != WIN_SCALE)
+      layoutPair(pair);
+    prepareCardCached(UpperCard, pairCard(pair, 0), 5, CARDCOLOR, CARDCOLOR,
+                      CARDCOLOR);
+    prepareCardCached(LowerCard, pairCard(pair, 1), 5, CARDCOLOR, CARDCOLOR,
+                      CARDCOLOR);
+  }
+}
+
+void sortIcons(Icon *elems, int nbElems) {
+  // Tri par insertion (quelques icônes par carte)
+  for (int i = 1; i < nbElems; i++) {
+    Icon tmp = elems[i];
+    int j = i - 1;
+    for (; j >= 0 && elems[j].iconId > tmp.iconId; j--) {
+      elems[j + 1] = elems[j];
+    }
+    elems[j + 1] = tmp;
+  }
 }
 
 void shuffle(Icon *elems, int nbElems) {
   // On échange des éléments aléatoirement
   for (int i = nbElems - 1; i > 0; i--) {
-    int j = rand() % i;
+    int j = randomInt(i);
     Icon tmp = elems[i];
     elems[i] = elems[j];
     elems[j] = tmp;
@@ -238,273 +723,354 @@ void shuffle(Icon *elems, int nbElems) {
 
 void drawCard(CardPosition currentCardPosition, Card currentCard,
               int resultatClic) {
-  int cx, cy;
-  // Dessin du fond de carte de la carte courante (fond clair, bord foncé)
+  // Dessin de la carte courante (fond clair, bord foncé), dont le fond et les
+  // icônes sont rendus une seule fois par tirage
   // Le joueur a fait une erreur
   if (resultatClic == INCORRECT) {
-    drawCardShape(currentCardPosition, 5, CARDCOLOR, CARDCOLOR, CARDCOLOR, 220,
-                  0, 0);
+    drawCardCached(currentCardPosition, currentCard, 5, CARDCOLOR, CARDCOLOR,
+                   CARDCOLOR, 220, 0, 0);
 
     // Le joueur a trouvé une bonne réponse
   } else if (resultatClic == CORRECT) {
-    drawCardShape(currentCardPosition, 5, CARDCOLOR, CARDCOLOR, CARDCOLOR, 0,
-                  200, 0);
+    drawCardCached(currentCardPosition, currentCard, 5, CARDCOLOR, CARDCOLOR,
+                   CARDCOLOR, 0, 200, 0);
+    // Bonne réponse, mais un autre joueur l'a emporté
+  } else if (resultatClic == TARDIF) {
+    drawCardCached(currentCardPosition, currentCard, 5, CARDCOLOR, CARDCOLOR,
+                   CARDCOLOR, 235, 140, 0);
     // cas normal
   } else {
-    drawCardShape(currentCardPosition, 5, CARDCOLOR, CARDCOLOR, CARDCOLOR,
-                  CARDBORDER, CARDBORDER, CARDBORDER);
+    drawCardCached(currentCardPosition, currentCard, 5, CARDCOLOR, CARDCOLOR,
+                   CARDCOLOR, CARDBORDER, CARDBORDER, CARDBORDER);
   }
-  // Mélange des icônes
-  shuffle(currentCard.icons, gameGlobal.nbIcons);
+}
 
-  // Affichage des icônes de la carte du courante (régulièrement en cercle)
-  for (int currentIcon = 0; currentIcon < gameGlobal.nbIcons; currentIcon++) {
-    drawIcon(currentCardPosition, currentCard.icons[currentIcon], &cx, &cy);
-    currentCard.icons[currentIcon].centerX = cx;
-    currentCard.icons[currentIcon].centerY = cy;
+/**
+ * Dessine la partie en cours : titre, score, temps et paire de cartes.
+ */
+static void renderRound() {
+  char title[100];
+  // Efface le contenu de la fenêtre
+  clearWindow();
+
+  // Crée le texte qui sera affiché avec le titre, le score et le temps
+  // restant (écoulé et erreurs permises en mode sans fin)
+  sprintf(title, "Ai & Yuki - Dobble     Score : %d", gameGlobal.score);
+  drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+  if (gameGlobal.endless)
+    sprintf(title, "Temps : %d.%ds     Vies : %d", gameGlobal.time / 1000,
+            (gameGlobal.time % 1000) / 100, gameGlobal.lives);
+  else
+    sprintf(title, "Temps restant : %d.%ds", gameGlobal.time / 1000,
+            (gameGlobal.time % 1000) / 100);
+  drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  // Partie reprise : les cartes sont dessinées une fois les packs chargés
+  if (snapshotResuming()) {
+    drawText("Reprise de la partie...", WIN_WIDTH / 2,
+             4 * FONT_SIZE + CARD_RADIUS, Center, Middle, TEXTCOLOR,
+             TEXTCOLOR, TEXTCOLOR);
+    showWindow();
+    return;
   }
-  // (cx, cy) est le centre de l'icône placé à l'écran (en pixels)
+
+  // Dessin de la carte supérieure et de la carte inférieure
+  drawCard(UpperCard, gameGlobal.cardUpper, gameGlobal.resultatClic);
+  // on remet erreur à 0 pour que seulement le cercle du
+  // haut soit modifié en cas d'erreur ou de bonne réponse (en réseau, une
+  // bonne réponse reste affichée jusqu'à sa confirmation par le serveur ;
+  // sinon, jusqu'à la fin de l'animation de la paire suivante)
+  bool awaiting = netAwaitingConfirmation();
+  if (!awaiting && !tweenRunning())
+    gameGlobal.resultatClic = INDEFINI;
+  drawCard(LowerCard, gameGlobal.cardLower,
+           awaiting ? gameGlobal.resultatClic : INDEFINI);
+
+  // Icône commune de la paire précédente, par-dessus les cartes
+  drawIconOverlay(UpperCard, pop.icon, pop.scale, pop.alpha);
+
+  // Met au premier plan le résultat des opérations de dessin
+  showWindow();
+
+  // Première image de la paire courante : début du temps de réaction
+  if (gameGlobal.pairShownAt == 0) {
+    gameGlobal.pairShownAt = clockNow();
+    replayRecordShown(gameGlobal.pairShownAt);
+  }
+
+  // Rendu des paires suivantes, pendant l'attente du prochain clic
+  prepareDeals();
 }
 
 void renderScene() {
+  // Pas d'affichage lors d'une relecture sans fenêtre
+  if (gameGlobal.headless)
+    return;
+
   // Affichage des différents menus ou du jeu
-  if (gameGlobal.time <= 0) {
-    afficheMenuFin();
-  } else if (!gameGlobal.iconPackChosen) {
+  if (netActive() && !netPlaying()) {
+    netRenderStatus();
+    return;
+  }
+  switch (gameGlobal.state) {
+  case STATE_MENU:
     afficheMenuDebut();
-  } else {
-    char title[100];
-    // Efface le contenu de la fenêtre
-    clearWindow();
-
-    // Crée le texte qui sera affiché avec le titre, le score et le temps
-    // restant
-    sprintf(title, "Ai & Yuki - Dobble     Score : %d", gameGlobal.score);
-    drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-             TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-    sprintf(title, "Temps restant : %ds", gameGlobal.time);
-    drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
-             TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-    // Dessin de la carte supérieure et de la carte inférieure
-    drawCard(UpperCard, gameGlobal.cardUpper, gameGlobal.resultatClic);
-    // on remet erreur à 0 pour que seulement le cercle du
-    // haut soit modifié en cas d'erreur ou de bonne réponse
-    gameGlobal.resultatClic = INDEFINI;
-    drawCard(LowerCard, gameGlobal.cardLower, gameGlobal.resultatClic);
-
-    // Met au premier plan le résultat des opérations de dessin
-    showWindow();
+    break;
+  case STATE_PLAYING:
+    if (raceActive())
+      raceRender();
+    else
+      renderRound();
+    break;
+  case STATE_RESULTS:
+    afficheMenuFin();
+    break;
+  case STATE_QUIT:
+    break;
   }
 }
 
 void afficheMenuDebut() {
   clearWindow();
-  afficheTitreMenuDebut();
-  afficheBoutonsDebut();
+  uiDraw(UI_MENU_START);
   showWindow();
 }
 
 void afficheMenuFin() {
   clearWindow();
   afficheStats();
-  afficheBoutonsFin();
+  uiDraw(UI_MENU_END);
   showWindow();
 }
 
 void afficheStats() {
   char title[100];
 
+  // Classement des joueurs en mode course
+  if (raceActive()) {
+    raceShowResults();
+    return;
+  }
+  // Classement des joueurs en réseau
+  if (netActive()) {
+    netShowResults();
+    return;
+  }
+
   sprintf(title, "Ai & Yuki - Dobble     Score : %d", gameGlobal.score);
   drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
+           TEXTCOLOR, TEXTCOLOR);
 
-  sprintf(title, "Nombre d'erreurs : %d", gameGlobal.nbFalse);
+  if (gameGlobal.endless)
+    sprintf(title, "Survie : %d s, %d erreurs", gameGlobal.time / 1000,
+            gameGlobal.nbFalse);
+  else
+    sprintf(title, "Nombre d'erreurs : %d", gameGlobal.nbFalse);
   drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
+           TEXTCOLOR, TEXTCOLOR);
 
-  sprintf(title, "Bravo ! Et merci d'avoir joué !");
+  // Temps de réaction du joueur sur l'ensemble de la session
+  const ReactionHistogram *reactions = statsPlayer(0);
+  sprintf(title, "Réaction : médiane %d ms, p90 %d ms",
+          histogramPercentile(reactions, 50),
+          histogramPercentile(reactions, 90));
   drawText(title, WIN_WIDTH / 2, 2.8 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-  sprintf(title, "Voulez-vous rejouer ?");
+           TEXTCOLOR, TEXTCOLOR);
+
+  // Place de la partie dans l'historique des parties du même deck, des mêmes
+  // packs et du même mode de jeu
+  if (roundRanked && roundRank.count == 1)
+    sprintf(title, "Première partie enregistrée !");
+  else if (roundRanked && roundRank.personalBest)
+    sprintf(title, "Meilleur score sur %d parties !", roundRank.count);
+  else if (roundRanked)
+    sprintf(title, "%de sur %d parties, record : %d", roundRank.rank,
+            roundRank.count, roundRank.best);
+  else
+    sprintf(title, "Bravo ! Et merci d'avoir joué !");
   drawText(title, WIN_WIDTH / 2, 4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-}
+           TEXTCOLOR, TEXTCOLOR);
 
-void afficheTitreMenuDebut() {
-  char title[100];
-
-  sprintf(title, "Bienvenue sur");
-  drawText(title, WIN_WIDTH / 3, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-  sprintf(title, "Ai");
-  drawText(title, WIN_WIDTH / 1.9, 0.4 * FONT_SIZE, Center, Top, 200, 90, 180,
-           GENERALCOLOR);
-
-  sprintf(title, "&");
-  drawText(title, WIN_WIDTH / 1.75, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-  sprintf(title, "Yuki");
-  drawText(title, WIN_WIDTH / 1.58, 0.4 * FONT_SIZE, Center, Top, 90, 190, 190,
-           GENERALCOLOR);
-
-  sprintf(title, "Dobble !");
-  drawText(title, WIN_WIDTH / 1.28, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-  sprintf(title, "À quelle version voulez-vous jouer ?");
-  drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-
-  sprintf(title, "Choisissez le nombres d'icônes par carte !");
-  drawText(title, WIN_WIDTH / 2, 2.8 * FONT_SIZE, Center, Top, TEXTCOLOR,
-           TEXTCOLOR, TEXTCOLOR, GENERALCOLOR);
-}
-
-void afficheBouton(int offsetX, int offsetY, double circleWidth, char text[100],
-                   int textR, int textG, int textB) {
-
-  int w = (int)(WIN_SCALE * 5);
-  if (w <= 0)
-    w = 1;
-  fillCircle(offsetX, offsetY * FONT_SIZE + CARD_RADIUS,
-             (CARD_RADIUS + 5) * circleWidth + w / 2, textR, textG, textB, 255);
-  fillCircle(offsetX, offsetY * FONT_SIZE + CARD_RADIUS,
-             (CARD_RADIUS + 5) * circleWidth - w / 2, 1.1 * GENERALCOLOR,
-             1.1 * GENERALCOLOR, 1.1 * GENERALCOLOR, 255);
-
-  char title[100];
-  sprintf(title, "%s\n", text);
-  drawText(title, offsetX, offsetY * FONT_SIZE + CARD_RADIUS, Center, Middle,
-           textR, textG, textB, 1.1 * GENERALCOLOR);
-}
-
-void afficheBoutonsFin() {
-  afficheBouton(WIN_WIDTH / 2, 4, 1 / 4., "Oui", TEXTCOLOR, TEXTCOLOR,
-                TEXTCOLOR);
-  afficheBouton(WIN_WIDTH / 2, 10, 1 / 4., "Non", TEXTCOLOR, TEXTCOLOR,
-                TEXTCOLOR);
-}
-
-void afficheBoutonsDebut() {
-  // affichage des bouton de choix d'icones
-  afficheBouton(WIN_WIDTH / 2, 4, 1 / 3., "Cœur", 200, 90, 180);
-  afficheBouton(WIN_WIDTH / 2, 10, 1 / 3., "Flocon", 90, 190, 190);
-  afficheBouton(WIN_WIDTH / 2, 16, 1 / 3., "Food", 225, 150, 50);
-  // affichage des boutons de choix du nombre d'icones par cartes
-  afficheBouton(WIN_WIDTH / 4, 23, 1 / 5., "3", 150, 60, 10);
-  afficheBouton(WIN_WIDTH / 2, 23, 1 / 5., "4", 150, 60, 10);
-  afficheBouton((WIN_WIDTH * 3) / 4, 23, 1 / 5., "5", 150, 60, 10);
-  afficheBouton(WIN_WIDTH / 4, 27, 1 / 5., "6", 150, 60, 10);
-  afficheBouton(WIN_WIDTH / 2, 27, 1 / 5., "8", 150, 60, 10);
-  afficheBouton((WIN_WIDTH * 3) / 4, 27, 1 / 5., "9", 150, 60, 10);
+  sprintf(title, "Voulez-vous rejouer ?");
+  drawText(title, WIN_WIDTH / 2, 5.2 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
 }
 
 void ExitBoutonClic(int mouseX, int mouseY) {
-  float rayon = ((CARD_RADIUS + 5) / 4);
-  int centerX = WIN_WIDTH / 2;
-
-  // Test si le clic est au niveau du bouton Oui (pour rejouer)
-  int centerY = 4 * FONT_SIZE + CARD_RADIUS;
-  float distance = dist(mouseX, mouseY, centerX, centerY);
-  if (distance <= rayon) {
-    // on reprend 2 nouvelles cartes
-    changeCards();
-    // on réinitialise le temps et on conserve le score
-    gameGlobal.time = 30;
+  UiAction action = uiHitTest(UI_MENU_END, mouseX, mouseY);
+  if (action.type == UI_ACTION_REPLAY && netActive()) {
+    // En réseau, la partie suivante commence quand tous les joueurs sont prêts
+    netRequestNextRound();
+  } else if (action.type == UI_ACTION_REPLAY) {
+    // on reprend 2 nouvelles cartes et on réinitialise le temps et le score
+    // (chaque partie est classée séparément)
+    gameGlobal.score = 0;
+    gameGlobal.nbFalse = 0;
+    startRound();
     // on remet le résultat à INDEFINI pour l'inintialiser normalement
     gameGlobal.resultatClic = INDEFINI;
-    // on relance la boucle principale
-    mainLoop();
-    // on conserve le score d'une partie à l'autre
-  }
-
-  // Test si le clic est au niveau du bouton Non (pour quitter)
-  centerY = 10 * FONT_SIZE + CARD_RADIUS;
-  distance = dist(mouseX, mouseY, centerX, centerY);
-  if (distance <= rayon) {
-    freeDeck();
-    freeGraphics();
-    exit(0);
+    // la boucle principale continue avec la nouvelle partie
+    renderScene();
+  } else if (action.type == UI_ACTION_QUIT) {
+    // Les ressources sont libérées à la sortie de la boucle principale
+    gameGlobal.state = STATE_QUIT;
+    quitMainLoop();
   }
 }
 
-bool testnbIconsButton(int mouseX, int mouseY, float offsetX, int offsetY,
-                       int nbButton, int *nbChosen) {
-  float rayon = ((CARD_RADIUS + 5) / 3);
-  int centerY = offsetY * FONT_SIZE + CARD_RADIUS;
-  int centerX = WIN_WIDTH * offsetX;
-  float distance = dist(mouseX, mouseY, centerX, centerY);
-
-  if (distance <= rayon) {
-    *nbChosen = nbButton;
-    return true;
-  }
-  return false;
-}
-
 void EnterBoutonClic(int mouseX, int mouseY) {
-  float rayon = ((CARD_RADIUS + 5) / 3);
-  int centerX = WIN_WIDTH / 2;
-
-  // Test si le clic est au niveau du bouton Cœur
-  int centerY = 4 * FONT_SIZE + CARD_RADIUS;
-  float distance = dist(mouseX, mouseY, centerX, centerY);
-  if (distance <= rayon) {
-    printf("Pack cœur\n");
-    if (loadIconMatrix(DATA_DIRECTORY "/Hearts_80_90x90pixels.png") != 1) {
+  // Si le clic est hors des boutons on sort de la fonction sans rien faire
+  UiAction action = uiHitTest(UI_MENU_START, mouseX, mouseY);
+  if (action.type == UI_ACTION_PACK) {
+    printf("Pack %s\n", packsName(action.value));
+    if (!loadIconPacks(1 << action.value)) {
       printError(ECHEC_ICONES);
     }
     gameGlobal.iconPackChosen = true;
-    return;
+    // Deck déjà choisi avec plus de symboles que le pack n'a d'icônes
+    if (gameGlobal.nbIconChosen &&
+        !deckFitsPacks(gameGlobal.nbIcons, gameGlobal.packMask)) {
+      printf("dobble: Pack trop petit pour le deck de %d icônes par carte.\n",
+             gameGlobal.nbIcons);
+      gameGlobal.nbIconChosen = false;
+    }
+  } else if (action.type == UI_ACTION_DECK) {
+    // Lecture du fichier de cartes
+    printf("%d icones\n", action.value);
+    if (loadDeck(action.value))
+      gameGlobal.nbIconChosen = true;
   }
+}
 
-  // Test si le clic est au niveau du bouton Flocon
-  centerY = 10 * FONT_SIZE + CARD_RADIUS;
-  distance = dist(mouseX, mouseY, centerX, centerY);
-  if (distance <= rayon) {
-    printf("Pack flocon\n");
-    if (loadIconMatrix(DATA_DIRECTORY "/Snowflakes_200_90x90pixels.png") != 1) {
-      printError(ECHEC_ICONES);
+/**
+ * Retourne les fichiers et le nombre d'icônes des packs choisis, dans l'ordre
+ * des numéros de pack.
+ *
+ * @return Le nombre de packs, 0 si le choix est vide ou invalide
+ */
+static int packFiles(int packMask, const char **files, int *sizes) {
+  if (packMask >> packsCount())
+    return 0;
+  int count = 0;
+  for (int i = 0; i < packsCount(); i++) {
+    if (packMask & (1 << i)) {
+      // Pack du manifeste dont l'image est absente
+      if (packsIconCount(i) == 0)
+        return 0;
+      files[count] = packsFile(i);
+      sizes[count] = packsIconCount(i);
+      count++;
     }
-    gameGlobal.iconPackChosen = true;
-    return;
   }
+  return count;
+}
 
-  // Test si le clic est au niveau du bouton Food
-  centerY = 16 * FONT_SIZE + CARD_RADIUS;
-  distance = dist(mouseX, mouseY, centerX, centerY);
-  if (distance <= rayon) {
-    printf("Pack food\n");
-    if (loadIconMatrix(DATA_DIRECTORY "/Gastronomy_230_90x90pixels.png") != 1) {
-      printError(ECHEC_ICONES);
+int loadIconPacks(int packMask) {
+  const char *files[PACKS_MAX];
+  int sizes[PACKS_MAX];
+  int count = packFiles(packMask, files, sizes);
+  if (count == 0)
+    return 0;
+  if (loadIconMatrices(files, sizes, count) != 1)
+    return 0;
+  iconIndexUse(files, sizes, count);
+  gameGlobal.packMask = packMask;
+  return 1;
+}
+
+int loadIconIndex(int packMask) {
+  const char *files[PACKS_MAX];
+  int sizes[PACKS_MAX];
+  int count = packFiles(packMask, files, sizes);
+  if (count == 0)
+    return 0;
+  iconIndexUse(files, sizes, count);
+  gameGlobal.packMask = packMask;
+  return 1;
+}
+
+/**
+ * Retourne le deck d'un nombre d'icônes par carte, lu à la première demande
+ * sans remplacer le deck courant.
+ *
+ * @return Le deck, NULL s'il est absent ou invalide
+ */
+static struct ResidentDeck *residentDeck(int nbIcons) {
+  const char *cardFileName = packsDeckFile(nbIcons);
+  if (cardFileName == NULL)
+    return NULL;
+  struct ResidentDeck *deck = &resident[nbIcons];
+  if (deck->cards != NULL)
+    return deck;
+
+  Card *cards = gameGlobal.cards;
+  int nbCards = gameGlobal.nbCards, current = gameGlobal.nbIcons;
+  if (!readCardFile(cardFileName, nbIcons))
+    return NULL;
+  deck->cards = gameGlobal.cards;
+  deck->nbCards = gameGlobal.nbCards;
+  deck->nbSymbols = 0;
+  for (int i = 0; i < deck->nbCards; i++) {
+    for (int j = 0; j < nbIcons; j++) {
+      if (deck->cards[i].icons[j].iconId >= deck->nbSymbols)
+        deck->nbSymbols = deck->cards[i].icons[j].iconId + 1;
     }
-    gameGlobal.iconPackChosen = true;
-    return;
   }
+  gameGlobal.cards = cards;
+  gameGlobal.nbCards = nbCards;
+  gameGlobal.nbIcons = current;
+  cardKernelsUse(current);
+  return deck;
+}
 
-  char cardFileName[100] = "../data/pg20.txt";
-  int nbChosen = 0;
+/**
+ * Retourne le nombre total d'icônes des packs choisis.
+ *
+ * @return Le nombre d'icônes, 0 si le choix de packs est vide ou invalide
+ */
+static int packsIconTotal(int packMask) {
+  const char *files[PACKS_MAX];
+  int sizes[PACKS_MAX];
+  int count = packFiles(packMask, files, sizes), total = 0;
+  for (int i = 0; i < count; i++)
+    total += sizes[i];
+  return total;
+}
 
-  // Test si le clic est au niveau du bouton 3, 4, 5, 6, 8 ou 9
-  if (testnbIconsButton(mouseX, mouseY, 1 / 4., 23, 3, &nbChosen) ||
-      testnbIconsButton(mouseX, mouseY, 1 / 2., 23, 4, &nbChosen) ||
-      testnbIconsButton(mouseX, mouseY, 3 / 4., 23, 5, &nbChosen) ||
-      testnbIconsButton(mouseX, mouseY, 1 / 4., 27, 6, &nbChosen) ||
-      testnbIconsButton(mouseX, mouseY, 1 / 2., 27, 8, &nbChosen) ||
-      testnbIconsButton(mouseX, mouseY, 3 / 4., 27, 9, &nbChosen)) {
-    // Lecture du fichier de cartes
-    printf("%d icones\n", nbChosen);
-    cardFileName[11] = nbChosen - 1 + '0';
-    readCardFile(cardFileName);
-    gameGlobal.nbIconChosen = true;
-    return;
-  }
+int deckFitsPacks(int nbIcons, int packMask) {
+  struct ResidentDeck *deck = residentDeck(nbIcons);
+  int total = packsIconTotal(packMask);
+  return deck != NULL && (total == 0 || deck->nbSymbols <= total);
+}
 
-  // Si le clic est hors des boutons on sort de la fonction sans rien faire
+int loadDeck(int nbIcons) {
+  const char *cardFileName = packsDeckFile(nbIcons);
+  if (cardFileName == NULL) {
+    printf("dobble: Pas de deck de %d icônes par carte.\n", nbIcons);
+    return 0;
+  }
+  struct ResidentDeck *deck = residentDeck(nbIcons);
+  if (deck == NULL)
+    return 0;
+  // Chaque symbole du deck doit avoir sa propre icône dans les packs choisis
+  if (!deckFitsPacks(nbIcons, gameGlobal.packMask)) {
+    printf("dobble: Deck %s : %d symboles pour %d icônes dans les packs "
+           "choisis.\n",
+           cardFileName, deck->nbSymbols, packsIconTotal(gameGlobal.packMask));
+    return 0;
+  }
+  gameGlobal.cards = deck->cards;
+  gameGlobal.nbCards = deck->nbCards;
+  gameGlobal.nbIcons = nbIcons;
+  cardKernelsUse(nbIcons);
+  if (!deckIndexBuild(gameGlobal.cards, gameGlobal.nbCards, nbIcons)) {
+    printf("dobble: Deck %s hors des limites de l'index des cartes.\n",
+           cardFileName);
+    return 0;
+  }
+  return 1;
 }
 
 Card getCardFromPosition(CardPosition cardPos) {
@@ -514,24 +1080,272 @@ Card getCardFromPosition(CardPosition cardPos) {
     return gameGlobal.cardLower;
 }
 
+/**
+ * Construit le chemin d'un fichier du dossier personnel ($HOME).
+ *
+ * @return Le chemin, NULL si le dossier personnel est inconnu
+ */
+static const char *homeFile(const char *name, char *path, size_t size) {
+  const char *home = getenv("HOME");
+  if (home == NULL || snprintf(path, size, "%s/%s", home, name) >= (int)size)
+    return NULL;
+  return path;
+}
+
 int main(int argc, char **argv) {
-  srand(time(NULL));
+  seedRandom((uint64_t)time(NULL) ^ (uint64_t)clockNow());
+
+  // Lecture des options de la ligne de commande
+  const char *recordFile = NULL, *replayFile = NULL, *scoresFile = NULL;
+  const char *snapshotFile = NULL;
+  bool headless = false;
+  int packMask = 0, atlasBudget = -1, nbPlayers = 0;
+  RaceVariant variant = RACE_TOWER;
+  const char *connectAddress = NULL, *proxyTarget = NULL;
+  int serverPort = 0, proxyPort = 0, nbIcons = 8;
+  int latencyMs = 0, jitterMs = 0, lossPct = 0;
+  const char *searchFile = NULL;
+  bool analyzeIcons = false, buildFonts = false, bench = false;
+  int searchIcons = 0, searchSymbols = 0, nbThreads = 0, searchSeconds = 60;
+  const char *captureDir = NULL, *goldenDir = NULL;
+  int tolerance = 0;
+  double captureScale = DEFAULT_WIN_SCALE;
+  gameGlobal.statsFile = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      gameGlobal.statsFile = argv[++i];
+    } else if (strcmp(argv[i], "--scores") == 0 && i + 1 < argc) {
+      scoresFile = argv[++i];
+    } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+      snapshotFile = argv[++i];
+    } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+      assetsSetDirectory(argv[++i]);
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordFile = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayFile = argv[++i];
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--endless") == 0) {
+      gameGlobal.endless = true;
+    } else if (strcmp(argv[i], "--adaptive") == 0) {
+      difficultyEnable();
+    } else if (strcmp(argv[i], "--packs") == 0 && i + 1 < argc) {
+      // Liste de numéros de packs séparés par des virgules, ex. "0,1"
+      for (char *p = argv[++i], *end; *p; p = end) {
+        long pack = strtol(p, &end, 10);
+        if (end == p)
+          end = p + 1; // séparateur
+        else if (pack >= 0 && pack < PACKS_MAX)
+          packMask |= 1 << pack;
+      }
+    } else if (strcmp(argv[i], "--atlas-budget") == 0 && i + 1 < argc) {
+      atlasBudget = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+      nbPlayers = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc &&
+               raceParseVariant(argv[i + 1], &variant)) {
+      i++;
+    } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+      serverPort = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--icons") == 0 && i + 1 < argc) {
+      nbIcons = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+      connectAddress = argv[++i];
+    } else if (strcmp(argv[i], "--proxy") == 0 && i + 2 < argc) {
+      proxyPort = atoi(argv[++i]);
+      proxyTarget = argv[++i];
+    } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+      latencyMs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+      jitterMs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      lossPct = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--icon-map") == 0 && i + 1 < argc &&
+               (strcmp(argv[i + 1], "identity") == 0 ||
+                strcmp(argv[i + 1], "random") == 0 ||
+                strcmp(argv[i + 1], "distinct") == 0)) {
+      i++;
+      iconMapSetMode(argv[i][0] == 'i'   ? ICON_MAP_IDENTITY
+                     : argv[i][0] == 'r' ? ICON_MAP_RANDOM
+                                         : ICON_MAP_DISTINCT);
+    } else if (strcmp(argv[i], "--icon-list") == 0 && i + 1 < argc) {
+      if (!iconMapLoadList(argv[++i]))
+        return 1;
+    } else if (strcmp(argv[i], "--analyze-icons") == 0) {
+      analyzeIcons = true;
+    } else if (strcmp(argv[i], "--build-fonts") == 0) {
+      buildFonts = true;
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      bench = true;
+    } else if (strcmp(argv[i], "--search-deck") == 0 && i + 3 < argc) {
+      searchIcons = atoi(argv[++i]);
+      searchSymbols = atoi(argv[++i]);
+      searchFile = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      nbThreads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      searchSeconds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      captureDir = argv[++i];
+    } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      goldenDir = argv[++i];
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--capture-scale") == 0 && i + 1 < argc) {
+      captureScale = atof(argv[++i]);
+    } else {
+      printf("Usage : %s [--data dossier] [--stats fichier.csv] "
+             "[--scores fichier] [--snapshot fichier] [--record fichier] "
+             "[--replay fichier [--headless]] [--packs 0,1,2] "
+             "[--atlas-budget Mio] [--players 2-%d] [--endless] [--adaptive]\n"
+             "         [--variant tour|puits|patate|cadeau] "
+             "[--icon-map identity|random|distinct] [--icon-list fichier]\n"
+             "       %s --server port [--players N] [--icons 3-9] "
+             "[--packs 0,1,2]\n"
+             "       %s --connect hôte:port\n"
+             "       %s --proxy port hôte:port [--latency ms] [--jitter ms] "
+             "[--loss %%]\n"
+             "       %s --search-deck k S fichier [--threads N] "
+             "[--seconds T]\n"
+             "       %s --analyze-icons | --build-fonts | --bench\n"
+             "       %s [--capture dossier] [--golden dossier] "
+             "[--tolerance n] [--capture-scale s]\n",
+             argv[0], RACE_MAX_PLAYERS, argv[0], argv[0], argv[0], argv[0],
+             argv[0], argv[0]);
+      return 1;
+    }
+  }
+
+  // Packs d'icônes et decks disponibles
+  if (!packsScan())
+    return 1;
+
+  // Analyse des icônes, atlas des polices, mesure des noyaux, recherche de
+  // deck, capture d'images, serveur et relais réseau, sans fenêtre
+  if (analyzeIcons) {
+    for (int i = 0; i < packsCount(); i++) {
+      if (packsIconCount(i) > 0 &&
+          !iconIndexBuild(packsFile(i), packsIconCount(i)))
+        return 1;
+    }
+    return 0;
+  }
+  if (buildFonts)
+    return fontBuildAll("FONTS") ? 0 : 1;
+  if (bench)
+    return cardKernelsBench();
+  if (searchFile != NULL)
+    return deckSearchRun(searchIcons, searchSymbols, searchFile, nbThreads,
+                         searchSeconds);
+  if (captureDir != NULL || goldenDir != NULL)
+    return captureRun(captureDir, goldenDir, tolerance,
+                      captureScale > 0 ? captureScale : DEFAULT_WIN_SCALE);
+  if (serverPort > 0)
+    return netRunServer(serverPort, nbPlayers > 0 ? nbPlayers : 2, nbIcons,
+                        packMask != 0 ? packMask : 1 << 0);
+  if (proxyTarget != NULL)
+    return netRunProxy(proxyPort, proxyTarget, latencyMs, jitterMs, lossPct);
+
+  // Le mode réseau n'est pas enregistrable et se joue sur une carte par joueur
+  if (connectAddress != NULL &&
+      (nbPlayers > 0 || recordFile != NULL || replayFile != NULL)) {
+    printf("dobble: Le mode réseau ne peut pas être enregistré ni relu, ni "
+           "combiné au mode course.\n");
+    return 1;
+  }
+
+  // Les variantes sont celles du mode course
+  if (variant != RACE_TOWER && nbPlayers < 2) {
+    printf("dobble: L'option --variant demande le mode course (--players).\n");
+    return 1;
+  }
+
+  // Le mode course n'est pas enregistrable (les parties enregistrées n'ont
+  // qu'un joueur)
+  if (nbPlayers > 1 && (recordFile != NULL || replayFile != NULL)) {
+    printf("dobble: Le mode course ne peut pas être enregistré ni relu.\n");
+    return 1;
+  }
+
+  // Le mode sans fin et la difficulté adaptative se jouent seul et ne sont
+  // pas enregistrables (les parties enregistrées ont une durée et un deck
+  // fixes)
+  if ((gameGlobal.endless || difficultyActive()) &&
+      (nbPlayers > 1 || connectAddress != NULL || recordFile != NULL ||
+       replayFile != NULL)) {
+    printf("dobble: Le mode sans fin et la difficulté adaptative se jouent "
+           "seul et ne peuvent pas être enregistrés ni relus.\n");
+    return 1;
+  }
+  raceSetup(nbPlayers, variant);
+
+  // Relecture sans fenêtre, à vitesse maximale
+  if (replayFile != NULL && headless)
+    return replayRunHeadless(replayFile);
 
   if (!initializeGraphics()) {
     printf("dobble: Echec de l'initialisation de la librairie graphique.\n");
     return 1;
   }
+  if (!uiLoad("menus.ui"))
+    return 1;
+  packsWatch();
 
   // Initialisation des variables globales
+  gameGlobal.state = STATE_MENU;
   gameGlobal.timerRunning = false;
   gameGlobal.iconPackChosen = false;
   gameGlobal.nbIconChosen = false;
-  gameGlobal.time = 30;
+  gameGlobal.time = ROUND_DURATION_MS;
   gameGlobal.score = 0;
   gameGlobal.nbFalse = 0;
   gameGlobal.resultatClic = INDEFINI;
 
+  if (atlasBudget >= 0)
+    atlasSetBudget((size_t)atlasBudget << 20);
+
+  // Historique des parties et sauvegarde de la partie en cours, dans le
+  // dossier personnel par défaut, pour les parties jouées seul (la partie
+  // sauvegardée n'est pas enregistrée)
+  char defaultScores[512], defaultSnapshot[512];
+  if (scoresFile == NULL)
+    scoresFile = homeFile(SCORES_DEFAULT_FILE, defaultScores,
+                          sizeof(defaultScores));
+  if (snapshotFile == NULL)
+    snapshotFile = homeFile(SNAPSHOT_DEFAULT_FILE, defaultSnapshot,
+                            sizeof(defaultSnapshot));
+  bool solo = nbPlayers < 2 && connectAddress == NULL && replayFile == NULL;
+  if (scoresFile != NULL && solo)
+    scoresOpen(scoresFile);
+  if (snapshotFile != NULL && solo && recordFile == NULL)
+    snapshotEnable(snapshotFile);
+  bool resumed = snapshotResume();
+
+  // Packs choisis sur la ligne de commande (le menu des packs est alors passé),
+  // sauf reprise d'une partie sauvegardée
+  if (packMask != 0 && !resumed) {
+    if (!loadIconPacks(packMask)) {
+      printError(ECHEC_ICONES);
+      return 1;
+    }
+    gameGlobal.iconPackChosen = true;
+  }
+
+  if (connectAddress != NULL && !netConnect(connectAddress))
+    return 1;
+  if (recordFile != NULL && !replayStartRecording(recordFile))
+    return 1;
+  if (replayFile != NULL && !replayStartPlayback(replayFile))
+    return 1;
+
   mainLoop();
 
+  netShutdown();
+  replayShutdown();
+  scoresClose();
+  if (gameGlobal.nbIconChosen)
+    freeDeck();
+  freeGraphics();
   return 0;
 }
@@ -0,0 +1,696 @@
+#include <dirent.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "assets.h"
+#include "clock.h"
+#include "font.h"
+
+/* Distance « infinie » du calcul des distances (carré, pixel sans contour) */
+#define FONT_INF 1e20
+
+/* Taille de l'en-tête d'un fichier d'atlas : signature, version, paramètres
+ * et taille de l'atlas (16 bits chacun), taille et empreinte de la police (64
+ * bits chacune) */
+#define FONT_HEADER (5 + 2 * 7 + 2 * 8)
+
+/* Nombre de valeurs (16 bits chacune) d'un enregistrement de glyphe */
+#define FONT_GLYPH_FIELDS 7
+
+/**
+ * Fichier d'une police lu en mémoire, et son empreinte (hachage FNV-1a du
+ * contenu).
+ */
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  uint64_t hash;
+} FontData;
+
+/**
+ * Glyphe de l'atlas SDF.
+ */
+typedef struct {
+  int x, y, w, h;       // case du glyphe dans l'atlas (vide : w = 0)
+  int offsetX, offsetY; // position de la case par rapport au début de la
+                        // ligne (en pixels de l'atlas)
+  int advance; // avance (en pixels de l'atlas × FONT_SDF_SUPERSAMPLE)
+} Glyph;
+
+/**
+ * Police chargée : atlas SDF, et glyphes seuillés à la taille courante.
+ */
+static struct Font {
+  SDL_Renderer *renderer;
+  Glyph glyphs[FONT_GLYPHS];
+  int lineHeight; // hauteur d'une ligne (× FONT_SDF_SUPERSAMPLE)
+  uint8_t *sdf;   // distances (128 : contour, plus clair à l'intérieur)
+  int sdfWidth, sdfHeight;
+
+  SDL_Texture *texture; // glyphes seuillés (blancs, colorisés au dessin)
+  SDL_Rect cells[FONT_GLYPHS];    // case de chaque glyphe dans la texture
+  SDL_Point origins[FONT_GLYPHS]; // position des cases par rapport au début
+                                  // de la ligne (en pixels à l'écran)
+  double ratio; // taille courante / FONT_SDF_SIZE
+} f;
+
+/* Caractères de l'atlas après le Latin-1 */
+static const int extraChars[FONT_EXTRA_CHARS] = {0x152, 0x153, 0x2019,
+                                                 0x2026, 0x20AC};
+
+/**
+ * Retourne le caractère d'un glyphe de l'atlas.
+ */
+static int glyphChar(int index) {
+  if (index <= FONT_LAST_CHAR - FONT_FIRST_CHAR)
+    return FONT_FIRST_CHAR + index;
+  return extraChars[index - (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1)];
+}
+
+/**
+ * Retourne le glyphe d'un caractère ('?' pour un caractère hors de l'atlas ou
+ * absent de la police).
+ */
+static int glyphIndex(int c) {
+  int index = -1;
+  if (c >= FONT_FIRST_CHAR && c <= FONT_LAST_CHAR)
+    index = c - FONT_FIRST_CHAR;
+  for (int i = 0; i < FONT_EXTRA_CHARS && index < 0; i++) {
+    if (extraChars[i] == c)
+      index = FONT_LAST_CHAR - FONT_FIRST_CHAR + 1 + i;
+  }
+  return index >= 0 && f.glyphs[index].advance > 0 ? index
+                                                   : '?' - FONT_FIRST_CHAR;
+}
+
+/**
+ * Lit le prochain caractère d'un texte UTF-8 et avance dans le texte.
+ *
+ * @return Le caractère, '?' pour une séquence invalide
+ */
+static int nextChar(const char **text) {
+  const unsigned char *p = (const unsigned char *)*text;
+  int c = *p++;
+  if (c >= 0x80) {
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+    if (extra < 0) {
+      c = '?';
+    } else {
+      c &= 0x3F >> extra;
+      for (; extra > 0 && (*p & 0xC0) == 0x80; extra--)
+        c = c << 6 | (*p++ & 0x3F);
+      if (extra > 0)
+        c = '?';
+    }
+  }
+  *text = (const char *)p;
+  return c;
+}
+
+/**
+ * Écrit un caractère en UTF-8 (au plus trois octets et le zéro final).
+ */
+static void encodeChar(int c, char *out) {
+  if (c < 0x80) {
+    *out++ = c;
+  } else if (c < 0x800) {
+    *out++ = 0xC0 | c >> 6;
+    *out++ = 0x80 | (c & 0x3F);
+  } else {
+    *out++ = 0xE0 | c >> 12;
+    *out++ = 0x80 | (c >> 6 & 0x3F);
+    *out++ = 0x80 | (c & 0x3F);
+  }
+  *out = '\0';
+}
+
+/****************** CALCUL DE L'ATLAS ******************/
+
+/**
+ * Transformée en distance exacte d'une ligne (Felzenszwalb et Huttenlocher) :
+ * remplace chaque valeur par le minimum sur la ligne de (q - p)² + f(p).
+ *
+ * @param grid   Les valeurs (carrés des distances)
+ * @param stride L'écart entre deux valeurs de la ligne
+ * @param n      Le nombre de valeurs
+ * @param f      Tampon de n valeurs
+ * @param v      Tampon de n indices (paraboles de l'enveloppe inférieure)
+ * @param z      Tampon de n + 1 valeurs (limites entre les paraboles)
+ */
+static void distance1d(double *grid, int stride, int n, double *f, int *v,
+                       double *z) {
+  v[0] = 0;
+  z[0] = -FONT_INF;
+  z[1] = FONT_INF;
+  f[0] = grid[0];
+  for (int q = 1, k = 0; q < n; q++) {
+    f[q] = grid[q * stride];
+    double s;
+    do {
+      int r = v[k];
+      s = (f[q] - f[r] + (double)q * q - (double)r * r) / (q - r) / 2;
+    } while (s <= z[k] && --k > -1);
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = FONT_INF;
+  }
+  for (int q = 0, k = 0; q < n; q++) {
+    while (z[k + 1] < q)
+      k++;
+    int r = v[k];
+    grid[q * stride] = f[r] + (double)(q - r) * (q - r);
+  }
+}
+
+/**
+ * Transformée en distance exacte d'une image : carré de la distance de chaque
+ * pixel au pixel nul le plus proche (lignes, puis colonnes).
+ */
+static void distance2d(double *grid, int w, int h) {
+  int n = w > h ? w : h;
+  double *f = malloc(n * sizeof(double)), *z = malloc((n + 1) * sizeof(double));
+  int *v = malloc(n * sizeof(int));
+  if (f != NULL && z != NULL && v != NULL) {
+    for (int y = 0; y < h; y++)
+      distance1d(grid + y * w, 1, w, f, v, z);
+    for (int x = 0; x < w; x++)
+      distance1d(grid + x, w, h, f, v, z);
+  }
+  free(f);
+  free(z);
+  free(v);
+}
+
+/**
+ * Calcule la case SDF d'un glyphe : rendu suréchantillonné du glyphe, distance
+ * de chaque pixel au contour (positive à l'intérieur), puis moyenne par bloc
+ * de FONT_SDF_SUPERSAMPLE × FONT_SDF_SUPERSAMPLE pixels.
+ *
+ * @param  font  La police, ouverte à FONT_SDF_SIZE × FONT_SDF_SUPERSAMPLE
+ * @param  c     Le caractère
+ * @param  glyph Le glyphe à remplir (sauf sa place dans l'atlas)
+ * @return       Les distances de la case (w × h octets), NULL pour un glyphe
+ *               vide ou en cas d'échec
+ */
+static uint8_t *glyphDistances(TTF_Font *font, int c, Glyph *glyph) {
+  const int S = FONT_SDF_SUPERSAMPLE;
+  memset(glyph, 0, sizeof(Glyph));
+  int minx, maxx, miny, maxy;
+  if (!TTF_GlyphIsProvided(font, c) ||
+      TTF_GlyphMetrics(font, c, &minx, &maxx, &miny, &maxy,
+                       &glyph->advance) != 0)
+    return NULL;
+
+  char text[4];
+  encodeChar(c, text);
+  SDL_Surface *image = NULL,
+              *rendered = TTF_RenderUTF8_Blended(font, text,
+                                                 (SDL_Color){255, 255, 255, 255});
+  if (rendered != NULL) {
+    image = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(rendered);
+  }
+  if (image == NULL)
+    return NULL;
+
+  // Contour du glyphe : pixels couverts au moins à moitié
+  int left = image->w, right = -1, top = image->h, bottom = -1;
+  for (int y = 0; y < image->h; y++) {
+    const uint8_t *in = (const uint8_t *)image->pixels + y * image->pitch;
+    for (int x = 0; x < image->w; x++) {
+      if (in[4 * x + 3] >= 128) {
+        left = x < left ? x : left;
+        right = x > right ? x : right;
+        top = y < top ? y : top;
+        bottom = y > bottom ? y : bottom;
+      }
+    }
+  }
+  if (right < 0) {
+    SDL_FreeSurface(image);
+    return NULL;
+  }
+
+  // Case du glyphe, élargie de la distance encodée, en pixels de l'atlas
+  glyph->offsetX = left / S - FONT_SDF_SPREAD;
+  glyph->offsetY = top / S - FONT_SDF_SPREAD;
+  glyph->w = right / S + 1 + FONT_SDF_SPREAD - glyph->offsetX;
+  glyph->h = bottom / S + 1 + FONT_SDF_SPREAD - glyph->offsetY;
+
+  // Carrés des distances de chaque pixel de la case au pixel intérieur et au
+  // pixel extérieur les plus proches
+  int w = glyph->w * S, h = glyph->h * S;
+  double *toInside = malloc((size_t)w * h * sizeof(double));
+  double *toOutside = malloc((size_t)w * h * sizeof(double));
+  uint8_t *cell = malloc((size_t)glyph->w * glyph->h);
+  if (toInside == NULL || toOutside == NULL || cell == NULL) {
+    free(toInside);
+    free(toOutside);
+    free(cell);
+    SDL_FreeSurface(image);
+    glyph->w = glyph->h = 0;
+    return NULL;
+  }
+  for (int y = 0; y < h; y++) {
+    int sy = glyph->offsetY * S + y;
+    for (int x = 0; x < w; x++) {
+      int sx = glyph->offsetX * S + x;
+      bool inside = sx >= 0 && sy >= 0 && sx < image->w && sy < image->h &&
+                    ((const uint8_t *)image->pixels)[sy * image->pitch +
+                                                     4 * sx + 3] >= 128;
+      toInside[y * w + x] = inside ? 0 : FONT_INF;
+      toOutside[y * w + x] = inside ? FONT_INF : 0;
+    }
+  }
+  SDL_FreeSurface(image);
+  distance2d(toInside, w, h);
+  distance2d(toOutside, w, h);
+
+  // Distance signée au contour (entre les centres des pixels de part et
+  // d'autre), moyennée par bloc et ramenée aux pixels de l'atlas
+  for (int cy = 0; cy < glyph->h; cy++) {
+    for (int cx = 0; cx < glyph->w; cx++) {
+      double sum = 0;
+      for (int y = cy * S; y < (cy + 1) * S; y++) {
+        for (int x = cx * S; x < (cx + 1) * S; x++) {
+          double in = toInside[y * w + x], out = toOutside[y * w + x];
+          sum += in == 0 ? sqrt(out) - 0.5 : 0.5 - sqrt(in);
+        }
+      }
+      double distance = sum / (S * S) / S;
+      double value = 128 + distance * 127 / FONT_SDF_SPREAD;
+      cell[cy * glyph->w + cx] =
+          value < 0 ? 0 : value > 255 ? 255 : (uint8_t)lround(value);
+    }
+  }
+  free(toInside);
+  free(toOutside);
+  return cell;
+}
+
+/**
+ * Calcule l'atlas SDF d'une police : case de chaque glyphe, puis rangement
+ * des cases par rangées dans l'atlas.
+ *
+ * @return 1 si l'atlas a été calculé, 0 sinon
+ */
+static int buildAtlas(const char *fontFile, const FontData *data) {
+  TTF_Font *font = TTF_OpenFontRW(SDL_RWFromConstMem(data->data, (int)data->size),
+                                  1, FONT_SDF_SIZE * FONT_SDF_SUPERSAMPLE);
+  if (font == NULL) {
+    printf("SDL: Echec du chargement de la police '%s': %s\n", fontFile,
+           TTF_GetError());
+    return 0;
+  }
+  f.lineHeight = TTF_FontHeight(font);
+
+  uint8_t *cells[FONT_GLYPHS];
+  int x = 0, y = 0, rowHeight = 0;
+  for (int i = 0; i < FONT_GLYPHS; i++) {
+    Glyph *glyph = &f.glyphs[i];
+    cells[i] = glyphDistances(font, glyphChar(i), glyph);
+    if (cells[i] == NULL)
+      continue;
+    if (x + glyph->w > FONT_ATLAS_WIDTH) {
+      x = 0;
+      y += rowHeight;
+      rowHeight = 0;
+    }
+    glyph->x = x;
+    glyph->y = y;
+    x += glyph->w;
+    rowHeight = glyph->h > rowHeight ? glyph->h : rowHeight;
+  }
+  TTF_CloseFont(font);
+
+  f.sdfWidth = FONT_ATLAS_WIDTH;
+  f.sdfHeight = y + rowHeight;
+  f.sdf = calloc((size_t)f.sdfWidth * (f.sdfHeight > 0 ? f.sdfHeight : 1), 1);
+  for (int i = 0; i < FONT_GLYPHS; i++) {
+    Glyph *glyph = &f.glyphs[i];
+    for (int row = 0; cells[i] != NULL && f.sdf != NULL && row < glyph->h;
+         row++)
+      memcpy(f.sdf + (glyph->y + row) * f.sdfWidth + glyph->x,
+             cells[i] + row * glyph->w, glyph->w);
+    free(cells[i]);
+  }
+  return f.sdf != NULL;
+}
+
+/****************** FICHIERS D'ATLAS ******************/
+
+/**
+ * Construit le nom du fichier d'atlas d'une police : celui de la police, avec
+ * l'extension .sdf.
+ */
+static void atlasFileName(const char *fontFile, char *fileName, size_t size) {
+  snprintf(fileName, size, "%s", fontFile);
+  char *extension = strrchr(fileName, '.');
+  if (extension != NULL && strchr(extension, '/') == NULL)
+    *extension = '\0';
+  size_t length = strlen(fileName);
+  snprintf(fileName + length, size - length, ".sdf");
+}
+
+static void putShort(uint8_t *out, int value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+}
+
+static int getShort(const uint8_t *in) { return (int16_t)(in[0] | in[1] << 8); }
+
+static void putLong(uint8_t *out, int64_t value) {
+  for (int i = 0; i < 8; i++)
+    out[i] = (uint64_t)value >> (8 * i) & 0xFF;
+}
+
+/**
+ * Remplit l'en-tête d'un fichier d'atlas pour la police courante : les
+ * paramètres de l'atlas, puis la taille et l'empreinte de la police, qui
+ * rendent l'atlas périmé lorsque la police change (l'atlas intégré à
+ * l'exécutable reste valable pour la police intégrée).
+ */
+static void fillHeader(uint8_t *header, const FontData *font) {
+  memcpy(header, "DOBF", 4);
+  header[4] = FONT_SDF_VERSION;
+  int values[7] = {FONT_SDF_SIZE, FONT_SDF_SPREAD, FONT_SDF_SUPERSAMPLE,
+                   FONT_GLYPHS,   f.lineHeight,    f.sdfWidth,
+                   f.sdfHeight};
+  for (int i = 0; i < 7; i++)
+    putShort(header + 5 + 2 * i, values[i]);
+  putLong(header + 19, (int64_t)font->size);
+  putLong(header + 27, (int64_t)font->hash);
+}
+
+/**
+ * Enregistre l'atlas de la police courante dans le dossier de données sur
+ * disque.
+ */
+static int saveAtlas(const char *fileName, const FontData *font) {
+  char path[512];
+  FILE *file =
+      assetPath(fileName, path, sizeof(path)) ? fopen(path, "wb") : NULL;
+  if (file == NULL)
+    return 0;
+  uint8_t header[FONT_HEADER];
+  fillHeader(header, font);
+  fwrite(header, 1, sizeof(header), file);
+  for (int i = 0; i < FONT_GLYPHS; i++) {
+    const Glyph *glyph = &f.glyphs[i];
+    int values[FONT_GLYPH_FIELDS] = {glyph->x,       glyph->y,
+                                     glyph->w,       glyph->h,
+                                     glyph->offsetX, glyph->offsetY,
+                                     glyph->advance};
+    uint8_t record[2 * FONT_GLYPH_FIELDS];
+    for (int k = 0; k < FONT_GLYPH_FIELDS; k++)
+      putShort(record + 2 * k, values[k]);
+    fwrite(record, 1, sizeof(record), file);
+  }
+  fwrite(f.sdf, 1, (size_t)f.sdfWidth * f.sdfHeight, file);
+  bool written = ferror(file) == 0;
+  return fclose(file) == 0 && written;
+}
+
+/**
+ * Charge l'atlas enregistré d'une police, s'il correspond à la police et à
+ * cette version du format.
+ */
+static int loadAtlas(const char *fileName, const FontData *font) {
+  FILE *file = assetOpen(fileName, "rb");
+  if (file == NULL)
+    return 0;
+  uint8_t header[FONT_HEADER], expected[FONT_HEADER];
+  bool valid = fread(header, 1, sizeof(header), file) == sizeof(header);
+  if (valid) {
+    // Hauteur de ligne et taille de l'atlas lues, le reste comparé
+    f.lineHeight = getShort(header + 5 + 2 * 4);
+    f.sdfWidth = getShort(header + 5 + 2 * 5);
+    f.sdfHeight = getShort(header + 5 + 2 * 6);
+    fillHeader(expected, font);
+    valid = memcmp(header, expected, sizeof(header)) == 0 &&
+            f.sdfWidth > 0 && f.sdfHeight > 0;
+  }
+  for (int i = 0; valid && i < FONT_GLYPHS; i++) {
+    uint8_t record[2 * FONT_GLYPH_FIELDS];
+    valid = fread(record, 1, sizeof(record), file) == sizeof(record);
+    Glyph *glyph = &f.glyphs[i];
+    glyph->x = getShort(record);
+    glyph->y = getShort(record + 2);
+    glyph->w = getShort(record + 4);
+    glyph->h = getShort(record + 6);
+    glyph->offsetX = getShort(record + 8);
+    glyph->offsetY = getShort(record + 10);
+    glyph->advance = getShort(record + 12);
+    valid = valid && glyph->x >= 0 && glyph->y >= 0 && glyph->w >= 0 &&
+            glyph->h >= 0 && glyph->x + glyph->w <= f.sdfWidth &&
+            glyph->y + glyph->h <= f.sdfHeight;
+  }
+  size_t size = valid ? (size_t)f.sdfWidth * f.sdfHeight : 0;
+  f.sdf = valid ? malloc(size) : NULL;
+  valid = f.sdf != NULL && fread(f.sdf, 1, size, file) == size;
+  fclose(file);
+  if (!valid) {
+    free(f.sdf);
+    f.sdf = NULL;
+  }
+  return valid;
+}
+
+/**
+ * Lit le fichier d'une police (sur disque ou intégré) et calcule son
+ * empreinte.
+ *
+ * @return 1 si la police a été lue, 0 sinon
+ */
+static int readFont(const char *fontFile, FontData *font) {
+  memset(font, 0, sizeof(FontData));
+  SDL_RWops *file = assetOpenRW(fontFile);
+  Sint64 size = file != NULL ? SDL_RWsize(file) : -1;
+  font->data = size > 0 ? malloc((size_t)size) : NULL;
+  bool read = font->data != NULL &&
+              SDL_RWread(file, font->data, 1, (size_t)size) == (size_t)size;
+  if (file != NULL)
+    SDL_RWclose(file);
+  if (!read) {
+    free(font->data);
+    font->data = NULL;
+    return 0;
+  }
+  font->size = (size_t)size;
+  font->hash = 14695981039346656037u;
+  for (size_t i = 0; i < font->size; i++)
+    font->hash = (font->hash ^ font->data[i]) * 1099511628211u;
+  return 1;
+}
+
+/**
+ * Charge l'atlas d'une police depuis son fichier, ou le calcule et
+ * l'enregistre.
+ *
+ * @param  rebuild true pour recalculer l'atlas même s'il est à jour
+ * @return         1 si l'atlas est chargé (même s'il n'a pas pu être
+ *                 enregistré, sauf avec rebuild), 0 sinon
+ */
+static int openAtlas(const char *fontFile, bool rebuild) {
+  FontData font;
+  if (!readFont(fontFile, &font)) {
+    printf("SDL: Police '%s' introuvable.\n", fontFile);
+    return 0;
+  }
+  char fileName[256];
+  atlasFileName(fontFile, fileName, sizeof(fileName));
+
+  free(f.sdf);
+  f.sdf = NULL;
+  if (!rebuild && loadAtlas(fileName, &font)) {
+    free(font.data);
+    return 1;
+  }
+
+  int64_t start = clockNow();
+  memset(f.glyphs, 0, sizeof(f.glyphs));
+  bool built = buildAtlas(fontFile, &font);
+  bool saved = built && saveAtlas(fileName, &font);
+  free(font.data);
+  if (!built)
+    return 0;
+  printf("dobble: Atlas de glyphes de '%s' (%dx%d) calculé en %.1f ms%s "
+         "'%s'.\n",
+         fontFile, f.sdfWidth, f.sdfHeight, (clockNow() - start) / 1000.,
+         saved ? ", enregistré dans" : ", impossible d'enregistrer", fileName);
+  return saved || !rebuild;
+}
+
+/****************** DESSIN ******************/
+
+int fontLoad(SDL_Renderer *renderer, const char *fontFile) {
+  f.renderer = renderer;
+  SDL_DestroyTexture(f.texture);
+  f.texture = NULL;
+  return openAtlas(fontFile, false);
+}
+
+/**
+ * Interpole la distance encodée d'un glyphe en un point de sa case (les
+ * points hors de la case sont loin du contour, à l'extérieur).
+ *
+ * @param u Abscisse dans la case (centres des pixels aux demi-entiers)
+ * @param v Ordonnée dans la case
+ */
+static double sampleGlyph(const Glyph *glyph, double u, double v) {
+  u -= 0.5;
+  v -= 0.5;
+  int iu = (int)floor(u), iv = (int)floor(v);
+  double fu = u - iu, fv = v - iv, value = 0;
+  for (int k = 0; k < 4; k++) {
+    int x = iu + (k & 1), y = iv + (k >> 1);
+    double weight = (k & 1 ? fu : 1 - fu) * (k >> 1 ? fv : 1 - fv);
+    if (x >= 0 && y >= 0 && x < glyph->w && y < glyph->h)
+      value += weight * f.sdf[(glyph->y + y) * f.sdfWidth + glyph->x + x];
+  }
+  return value;
+}
+
+int fontSetSize(int pixelSize) {
+  if (f.sdf == NULL || pixelSize <= 0)
+    return 0;
+  double ratio = (double)pixelSize / FONT_SDF_SIZE;
+
+  // Cases des glyphes à cette taille, alignées sur les pixels à l'écran (le
+  // glyphe garde sa position exacte dans sa case), rangées par rangées
+  int x = 0, y = 0, rowHeight = 0, width = FONT_ATLAS_WIDTH;
+  for (int i = 0; i < FONT_GLYPHS; i++) {
+    const Glyph *glyph = &f.glyphs[i];
+    SDL_Rect *cell = &f.cells[i];
+    SDL_Point *origin = &f.origins[i];
+    origin->x = (int)floor(glyph->offsetX * ratio);
+    origin->y = (int)floor(glyph->offsetY * ratio);
+    cell->w = glyph->w > 0
+                  ? (int)ceil((glyph->offsetX + glyph->w) * ratio) - origin->x
+                  : 0;
+    cell->h = glyph->h > 0
+                  ? (int)ceil((glyph->offsetY + glyph->h) * ratio) - origin->y
+                  : 0;
+    if (cell->w > width)
+      width = cell->w;
+    if (x + cell->w > width) {
+      x = 0;
+      y += rowHeight;
+      rowHeight = 0;
+    }
+    cell->x = x;
+    cell->y = y;
+    x += cell->w;
+    rowHeight = cell->h > rowHeight ? cell->h : rowHeight;
+  }
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, width, y + rowHeight > 0 ? y + rowHeight : 1, 32,
+      SDL_PIXELFORMAT_RGBA32);
+  if (surface == NULL)
+    return 0;
+
+  // Seuillage : opacité selon la distance du centre de chaque pixel au
+  // contour, à cette taille (bord lissé sur un pixel)
+  double scale = FONT_SDF_SPREAD * ratio / 127;
+  for (int i = 0; i < FONT_GLYPHS; i++) {
+    const Glyph *glyph = &f.glyphs[i];
+    const SDL_Rect *cell = &f.cells[i];
+    const SDL_Point *origin = &f.origins[i];
+    for (int cy = 0; cy < cell->h; cy++) {
+      uint8_t *out = (uint8_t *)surface->pixels +
+                     (cell->y + cy) * surface->pitch + cell->x * 4;
+      double v = (origin->y + cy + 0.5) / ratio - glyph->offsetY;
+      for (int cx = 0; cx < cell->w; cx++, out += 4) {
+        double u = (origin->x + cx + 0.5) / ratio - glyph->offsetX;
+        double value = sampleGlyph(glyph, u, v);
+        double coverage = (value - 128) * scale + 0.5;
+        coverage = coverage < 0 ? 0 : coverage > 1 ? 1 : coverage;
+        out[0] = out[1] = out[2] = 255;
+        out[3] = (uint8_t)lround(coverage * 255);
+      }
+    }
+  }
+
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(f.renderer, surface);
+  SDL_FreeSurface(surface);
+  if (texture == NULL)
+    return 0;
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  SDL_DestroyTexture(f.texture);
+  f.texture = texture;
+  f.ratio = ratio;
+  return 1;
+}
+
+void fontMeasure(const char *text, int *w, int *h) {
+  int advance = 0;
+  while (*text != '\0')
+    advance += f.glyphs[glyphIndex(nextChar(&text))].advance;
+  *w = (int)lround(advance * f.ratio / FONT_SDF_SUPERSAMPLE);
+  *h = (int)lround(f.lineHeight * f.ratio / FONT_SDF_SUPERSAMPLE);
+}
+
+void fontDraw(const char *text, int x, int y, SDL_Color color) {
+  if (f.texture == NULL)
+    return;
+  SDL_SetTextureColorMod(f.texture, color.r, color.g, color.b);
+  double pen = x;
+  while (*text != '\0') {
+    int index = glyphIndex(nextChar(&text));
+    const Glyph *glyph = &f.glyphs[index];
+    if (glyph->w > 0) {
+      SDL_Rect dstRect = {(int)lround(pen) + f.origins[index].x,
+                          y + f.origins[index].y, f.cells[index].w,
+                          f.cells[index].h};
+      SDL_RenderCopy(f.renderer, f.texture, &f.cells[index], &dstRect);
+    }
+    pen += glyph->advance * f.ratio / FONT_SDF_SUPERSAMPLE;
+  }
+}
+
+int fontBuildAll(const char *directory) {
+  char path[512];
+  DIR *dir = assetPath(directory, path, sizeof(path)) ? opendir(path) : NULL;
+  if (dir == NULL) {
+    printf("dobble: Dossier de polices '%s' introuvable (voir --data).\n",
+           directory);
+    return 0;
+  }
+  bool init = !TTF_WasInit();
+  if (init && TTF_Init() == -1) {
+    printf("SDL: Erreur d'initialisation de TTF_Init: %s\n", TTF_GetError());
+    closedir(dir);
+    return 0;
+  }
+  bool built = true;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    const char *extension = strrchr(entry->d_name, '.');
+    if (extension == NULL ||
+        (strcmp(extension, ".ttf") != 0 && strcmp(extension, ".otf") != 0))
+      continue;
+    char fontFile[512];
+    snprintf(fontFile, sizeof(fontFile), "%s/%s", directory, entry->d_name);
+    built = openAtlas(fontFile, true) && built;
+  }
+  closedir(dir);
+  if (init)
+    TTF_Quit();
+  free(f.sdf);
+  f.sdf = NULL;
+  return built;
+}
+
+void fontFree() {
+  SDL_DestroyTexture(f.texture);
+  free(f.sdf);
+  memset(&f, 0, sizeof(f));
+}
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <string.h>
 
 /**
  * pour mac os x, et suivant l'installation de la librairie SDL2, vous devrez
@@ -9,9 +10,75 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "atlas.h"
+#include "clock.h"
 #include "dobble-config.h"
 #include "dobble.h"
+#include "font.h"
 #include "graphics.h"
+#include "sprites.h"
+#include "timerwheel.h"
+
+/* Nombre maximal d'appuis (souris ou tactiles) traités ensemble */
+#define INPUT_BATCH_SIZE 64
+
+/* Nombre de disques et de boutons conservés en cache */
+#define DISC_CACHE_SIZE 16
+#define BUTTON_CACHE_SIZE 16
+
+/* Nombre de rendus de cartes préparés à l'avance (deux par paire distribuée à
+ * l'avance) */
+#define CARD_PREPARED_SIZE (2 * DEAL_LOOKAHEAD)
+
+/**
+ * Texture d'un disque blanc de rayon donné (colorisé au moment du dessin).
+ */
+typedef struct {
+  int radius;
+  SDL_Texture *texture;
+  Uint32 lastUse;
+} DiscCacheEntry;
+
+/**
+ * Rendu d'un bouton (anneau, fond et texte), identifié par son texte, sa
+ * taille et ses couleurs.
+ */
+typedef struct {
+  char text[64];
+  SDL_Color color;
+  int bgShade;
+  int radius, w;
+  SDL_Texture *texture;
+  Uint32 lastUse;
+} ButtonCacheEntry;
+
+/**
+ * Appui (clic de souris ou contact tactile) en attente de traitement.
+ */
+typedef struct {
+  int64_t at; // instant de l'appui (en µs, horloge monotone)
+  int x, y;   // position dans la zone de dessin
+} PointerPress;
+
+/**
+ * Emplacement d'une carte dans la fenêtre, à l'échelle 1.
+ */
+typedef struct {
+  double x, y;
+  double radius;
+} CardSlot;
+
+/**
+ * Rendu d'une carte (fond et icônes), valide tant que la carte n'a pas été
+ * replacée.
+ */
+typedef struct {
+  SDL_Texture *texture;
+  int size;
+  const Icon *icons; // carte rendue (NULL si le rendu n'est plus valide)
+  SDL_Color background;
+  CardPosition position; // position de la carte (rendus préparés)
+} CardCacheEntry;
 
 /**
  * Représente l'état des méthodes graphiques.
@@ -22,45 +89,62 @@
 static struct GraphicState {
   SDL_Window *window;
   SDL_Renderer *renderer;
+  SDL_Surface *frame; // image de rendu sans fenêtre (NULL avec une fenêtre)
+
+  bool fontReady; // glyphes préparés à l'échelle courante
 
-  SDL_Texture *matrixTexture;
-  SDL_Texture *iconTexture;
+  // Échelle courante, zone de dessin (centrée dans la fenêtre) et rapport
+  // entre pixels de rendu et coordonnées de la fenêtre (écrans haute densité)
+  double scale;
+  SDL_Rect viewport;
+  double pixelRatio;
 
-  Sint32 matrixWidth;
-  Sint32 matrixHeight;
+  // Textures mises en cache, régénérées uniquement au changement d'échelle
+  DiscCacheEntry discCache[DISC_CACHE_SIZE];
+  ButtonCacheEntry buttonCache[BUTTON_CACHE_SIZE];
+  Uint32 cacheClock; // compteur d'utilisation des caches (LRU)
 
-  TTF_Font *font;
+  // Emplacement (à l'échelle 1, rayon nul : emplacement par défaut) et rendu
+  // en cache (fond et icônes) de chaque position de carte
+  CardSlot slots[MAX_CARD_POSITIONS];
+  CardCacheEntry cardCache[MAX_CARD_POSITIONS];
+  CardTransform transforms[MAX_CARD_POSITIONS]; // animations des cartes
+
+  // Rendus préparés des prochaines cartes (paires distribuées à l'avance),
+  // échangés avec le rendu de leur position à leur premier affichage
+  CardCacheEntry preparedCache[CARD_PREPARED_SIZE];
 
-  bool stopTimerRequested;
   bool timerRunning;
+  int64_t nextTimerTick; // instant du prochain tic du compte à rebours (µs)
+  TimerId countdownTimer; // appel planifié du prochain tic
 
   bool redrawRequested;
+  bool quitRequested;
+
+  // Appuis reçus depuis le dernier passage de la boucle principale, traités
+  // ensemble dans l'ordre de leurs horodatages
+  PointerPress presses[INPUT_BATCH_SIZE];
+  int nbPresses;
 
-  Uint32 userTimerEvent;
   Uint32 userCallLaterEvent;
 } g;
 
-typedef struct {
-  void (*method)(void *);
-  void *param;
-} CallLaterData;
-
 /****************** METHODES A IMPLEMENTER ******************/
 
 void getIconLocationInMatrix(int iconId, int *posX, int *posY) {
-  // TODO: Calculer la position de l'icône iconId dans la matrice d'icônes
-  // g.matrixWidth (resp. g.matrixHeight) sont la largeur (resp. hauteur) de la
-  // matrice d'icônes, en pixels Les icônes sont de taille ICON_SIZE (défini
-  // dans build/dobble-config.h)
-  int nbImageLigne = g.matrixWidth / ICON_SIZE;
-  *posX = (iconId % nbImageLigne) * ICON_SIZE;
-  *posY = (iconId / nbImageLigne) * ICON_SIZE;
+  // Les matrices d'icônes des packs sont gérées par le gestionnaire d'atlas,
+  // qui retrouve le pack contenant l'icône dans le jeu d'icônes courant
+  if (atlasLocateIcon(iconId, posX, posY) < 0)
+    *posX = *posY = 0;
 }
 
 /****************** METHODES UTILITAIRES ******************/
 
 void getCardCenter(CardPosition card, int *cardCenterX, int *cardCenterY) {
-  if (card == UpperCard) {
+  if (g.slots[card].radius > 0) {
+    (*cardCenterX) = (int)(g.slots[card].x * WIN_SCALE);
+    (*cardCenterY) = (int)(g.slots[card].y * WIN_SCALE);
+  } else if (card == UpperCard) {
     (*cardCenterX) = WIN_WIDTH / 2;
     (*cardCenterY) = 4 * FONT_SIZE + CARD_RADIUS;
   } else {
@@ -69,129 +153,122 @@ void getCardCenter(CardPosition card, int *cardCenterX, int *cardCenterY) {
   }
 }
 
-Uint32 callLaterCallback(Uint32 interval, void *param) {
+int getCardRadius(CardPosition card) {
+  if (g.slots[card].radius > 0)
+    return (int)(g.slots[card].radius * WIN_SCALE);
+  return CARD_RADIUS;
+}
+
+void setCardSlot(CardPosition card, double x, double y, double radius) {
+  g.slots[card].x = x;
+  g.slots[card].y = y;
+  g.slots[card].radius = radius;
+  g.cardCache[card].icons = NULL;
+}
+
+CardTransform *getCardTransform(CardPosition card) {
+  return &g.transforms[card];
+}
+
+/**
+ * Indique si une transformation laisse la carte inchangée.
+ */
+static bool isIdentity(const CardTransform *t) {
+  return t->dx == 0 && t->dy == 0 && t->scaleX == 1 && t->scaleY == 1 &&
+         t->angle == 0;
+}
+
+/**
+ * Rapport entre la taille d'une carte et la taille par défaut (les icônes
+ * d'une carte plus petite sont rapprochées et réduites d'autant).
+ */
+static double cardRatio(CardPosition card) {
+  return g.slots[card].radius > 0 ? g.slots[card].radius / BASE_CARD_RADIUS
+                                  : 1.;
+}
+
+void callOnMainThread(void (*method)(void *), void *param) {
   // Envoi d'un évènement à la boucle principale pour appeler la méthode
-  // indiquée en paramètre
+  // indiquée en paramètre (SDL_PushEvent peut être appelée depuis n'importe
+  // quel thread)
   SDL_Event evt;
   SDL_zero(evt);
   evt.type = SDL_USEREVENT;
   evt.user.type = g.userCallLaterEvent;
-  evt.user.data1 = ((CallLaterData *)param)->method;
-  evt.user.data2 = ((CallLaterData *)param)->param;
-
-  // Libération de la mémoire
-  free(param);
-
+  evt.user.data1 = method;
+  evt.user.data2 = param;
   SDL_PushEvent(&evt);
-
-  return 0;
 }
 
 void callLater(void (*method)(void *), void *param, Uint32 delay) {
-  CallLaterData *data = malloc(sizeof(CallLaterData));
-  if (!data) {
-    printf(
-        "SDL: Echec de l'allocation pour l'invocation de méthode planifiée.\n");
-    return;
-  }
-
-  data->method = method;
-  data->param = param;
-
-  SDL_AddTimer(delay, callLaterCallback, data);
+  // Appel effectué par la boucle principale, sans thread de timer ni
+  // allocation
+  timerWheelSchedule(msToUs(delay), method, param);
 }
 
 /****************** METHODES DE GESTION DU TIMER ******************/
 
 /**
- * Procédure appelée par la SDL lorsqu'un timer est activé.
- *
- * @param  interval  Nombre de millisecondes depuis le dernier appel
- * @param  param     Paramètre personnalisé (NULL)
- * @return           0 si le compte à rebours doit être arrêté, != 0 sinon
+ * Tic du compte à rebours : planifie le tic suivant, puis appelle la
+ * procédure onTimerTick déclarée dans dobble.h et implémentée dans dobble.c
+ * (qui peut arrêter le compte à rebours).
  */
-Uint32 myTimer(Uint32 interval, void *param) {
-  if (g.stopTimerRequested) {
-    // L'arrêt du compte à rebours a été demandé, retour de la
-    // valeur 0 pour arrêter le timer de la SDL
-    g.timerRunning = false;
-    g.stopTimerRequested = false;
-    return 0;
-  } else {
-    // Envoi d'un évènement à la boucle principale pour indiquer que le timer a
-    // été déclenché La méthode myTimer est appelée sur un thread différent du
-    // thread principal, on utilise les évènements de la SDL pour éviter les
-    // problèmes de synchronisation
-    SDL_Event evt;
-    SDL_zero(evt);
-    evt.type = SDL_USEREVENT;
-    evt.user.type = g.userTimerEvent;
-    SDL_PushEvent(&evt);
-
-    // Sinon continuer l'exécution du timer avec le même intervalle
-    // de temps
-    return interval;
-  }
+static void onCountdownTimer(void *param) {
+  (void)param;
+  g.nextTimerTick += msToUs(TIMER_PERIOD_MS);
+  // Rattrapage sans rafale si la boucle a pris du retard
+  if (g.nextTimerTick <= clockNow())
+    g.nextTimerTick = clockNow() + msToUs(TIMER_PERIOD_MS);
+  g.countdownTimer = timerWheelSchedule(g.nextTimerTick - clockNow(),
+                                        onCountdownTimer, NULL);
+  onTimerTick();
 }
 
 void startTimer() {
   if (g.timerRunning) {
-    if (g.stopTimerRequested)
-      g.stopTimerRequested = false;
-    else
-      printf("SDL: Impossible de lancer un compte à rebours alors qu'un compte "
-             "à rebours est déjà en cours d'exécution.\n");
+    printf("SDL: Impossible de lancer un compte à rebours alors qu'un compte "
+           "à rebours est déjà en cours d'exécution.\n");
     return;
   }
 
+  // Le compte à rebours est géré par la boucle principale (pas de thread de
+  // timer) : le prochain tic est une échéance de la roue de minuteries
   g.timerRunning = true;
-
-  // 1000ms = 1s, intervalle par défaut du timer
-  SDL_AddTimer(1000, myTimer, NULL);
+  g.nextTimerTick = clockNow() + msToUs(TIMER_PERIOD_MS);
+  g.countdownTimer =
+      timerWheelSchedule(msToUs(TIMER_PERIOD_MS), onCountdownTimer, NULL);
 }
 
 void stopTimer() {
-  // Demander l'arrêt du timer au prochain déclenchement
-  g.stopTimerRequested = true;
+  if (g.timerRunning)
+    timerWheelCancel(g.countdownTimer);
+  g.timerRunning = false;
+}
+
+/**
+ * Retourne le délai d'attente maximal de la boucle principale avant la
+ * prochaine échéance de la roue de minuteries.
+ *
+ * @return Le délai (en millisecondes), -1 si aucun appel n'est planifié
+ */
+static int timeUntilNextDeadline() {
+  int64_t deadline = timerWheelNextDeadline();
+  if (deadline < 0)
+    return -1;
+  int64_t delay = deadline - clockNow();
+  // Arrondi supérieur pour ne pas se réveiller avant l'échéance
+  return delay > 0 ? (int)((delay + 999) / 1000) : 0;
 }
 
 /****************** METHODES DE CHARGEMENT ******************/
 
 int loadIconMatrix(const char *fileName) {
-  SDL_Surface *image = NULL;
-
-  printf("SDL: Chargement de l'image '%s'.\n", fileName);
-
-  // Chargement de l'image avec SDL_Image
-  image = IMG_Load(fileName);
-  if (image == NULL) {
-    printf("SDL: Echec du chargement de l'image '%s'.\n", fileName);
-    g.matrixWidth = g.matrixHeight = 0;
-    return 0;
-  }
-
-  // Transformation de la surface (données d'image) en texture (pouvant être
-  // dessiné à l'écran)
-  g.matrixTexture = SDL_CreateTextureFromSurface(g.renderer, image);
-  if (g.matrixTexture == NULL) {
-    printf("SDL: Echec de la création de texture pour '%s'.\n", fileName);
-    g.matrixWidth = g.matrixHeight = 0;
-    SDL_FreeSurface(image);
-    return 0;
-  }
-
-  // Nécessaire pour le dessin d'icônes transparents
-  SDL_SetTextureBlendMode(g.matrixTexture, SDL_BLENDMODE_NONE);
-
-  // La surface n'est plus nécessaire (l'image est maintenant stockée dans la
-  // texture)
-  SDL_FreeSurface(image);
-
-  // Obtention de la taille de la matrice d'icônes (en pixels)
-  SDL_QueryTexture(g.matrixTexture, NULL, NULL, &g.matrixWidth,
-                   &g.matrixHeight);
+  return loadIconMatrices(&fileName, NULL, 1);
+}
 
-  return 1;
+int loadIconMatrices(const char *const *fileNames, const int *nbIcons,
+                     int count) {
+  return atlasUseSet(fileNames, nbIcons, count);
 }
 
 /****************** METHODES DE DESSIN ******************/
@@ -206,35 +283,26 @@ void showWindow() { SDL_RenderPresent(g.renderer); }
 
 void requestRedraw() { g.redrawRequested = true; }
 
-int drawText(const char *message, int x, int y, HAlign hAlign, VAlign vAlign,
-             int textR, int textG, int textB, int bgShade) {
-  SDL_Surface *text = NULL;
-  SDL_Texture *textTexture = NULL;
-  int tw, th;
-
-  SDL_Color textColor = {textR, textG, textB},
-            textBackground = {bgShade, bgShade, bgShade};
-
-  // Rendu du texte dans une surface (texte foncé, fond clair)
-  text = TTF_RenderUTF8_Shaded(g.font, message, textColor, textBackground);
-  tw = text->w;
-  th = text->h;
-
-  if (text == NULL) {
-    printf("SDL: Echec de la création de la surface texte.\n");
-    return 0;
-  }
+/**
+ * Cherche l'entrée à réutiliser (la moins récemment utilisée, d'après son
+ * champ lastUse) dans un tableau d'entrées de cache.
+ */
+#define LEAST_RECENT(cache, size, index)                                       \
+  do {                                                                         \
+    index = 0;                                                                 \
+    for (int i_ = 1; i_ < (size); i_++) {                                      \
+      if ((cache)[i_].lastUse < (cache)[index].lastUse)                        \
+        index = i_;                                                            \
+    }                                                                          \
+  } while (0)
 
-  // Tranformation de la surface en texture
-  textTexture = SDL_CreateTextureFromSurface(g.renderer, text);
-  if (textTexture == NULL) {
-    printf("SDL: Echec de la création de la texture texte.\n");
-    SDL_FreeSurface(text);
+int drawText(const char *message, int x, int y, HAlign hAlign, VAlign vAlign,
+             int textR, int textG, int textB) {
+  // Texte dessiné sans fond, depuis les glyphes de la police
+  if (!g.fontReady)
     return 0;
-  }
-
-  // La surface de texte n'est plus nécessaire (convertie en texture)
-  SDL_FreeSurface(text);
+  int tw, th;
+  fontMeasure(message, &tw, &th);
 
   // Position par défaut pour alignement (Left, Top)
   SDL_Rect textPosition = {x, y, tw, th};
@@ -251,45 +319,97 @@ int drawText(const char *message, int x, int y, HAlign hAlign, VAlign vAlign,
     textPosition.y -= th;
   }
 
-  SDL_RenderCopy(g.renderer, textTexture, NULL, &textPosition);
-
-  // La texture de texte n'est plus nécessaire maintenant
-  SDL_DestroyTexture(textTexture);
+  fontDraw(message, textPosition.x, textPosition.y,
+           (SDL_Color){textR, textG, textB, 255});
 
   return 1;
 }
 
-// Remplissage de cercle basé sur des scanlines et le midpoint algorithm.
-// Chaque itération remplit 4 lignes de pixels du cercle.
-//
-// https://en.wikipedia.org/wiki/Midpoint_circle_algorithm
-void fillCircle(int x0, int y0, int radius, Uint8 fr, Uint8 fg, Uint8 fb,
-                Uint8 fa) {
-  int x = radius - 1;
-  int y = 0;
-  int dx = 1;
-  int dy = 1;
-  int err = dx - (radius << 1);
+/**
+ * Retourne la texture d'un disque blanc de rayon donné, au bord lissé,
+ * calculée lors de la première demande puis conservée en cache jusqu'au
+ * prochain changement d'échelle.
+ */
+static SDL_Texture *getDiscTexture(int radius) {
+  g.cacheClock++;
+  for (int i = 0; i < DISC_CACHE_SIZE; i++) {
+    if (g.discCache[i].texture != NULL && g.discCache[i].radius == radius) {
+      g.discCache[i].lastUse = g.cacheClock;
+      return g.discCache[i].texture;
+    }
+  }
 
-  SDL_SetRenderDrawColor(g.renderer, fr, fg, fb, fa);
+  int size = 2 * radius;
+  SDL_Surface *disc =
+      SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_RGBA32);
+  if (disc == NULL)
+    return NULL;
+
+  // Opacité de chaque pixel selon la distance de son centre au bord du disque
+  for (int y = 0; y < size; y++) {
+    Uint8 *pixel = (Uint8 *)disc->pixels + y * disc->pitch;
+    double dy = y + 0.5 - radius;
+    for (int x = 0; x < size; x++, pixel += 4) {
+      double dx = x + 0.5 - radius;
+      double coverage = radius - sqrt(dx * dx + dy * dy) + 0.5;
+      if (coverage < 0)
+        coverage = 0;
+      if (coverage > 1)
+        coverage = 1;
+      pixel[0] = pixel[1] = pixel[2] = 255;
+      pixel[3] = (Uint8)(coverage * 255);
+    }
+  }
 
-  while (x >= y) {
-    SDL_RenderDrawLine(g.renderer, x0 - x, y0 - y, x0 + x, y0 - y);
-    SDL_RenderDrawLine(g.renderer, x0 - x, y0 + y, x0 + x, y0 + y);
-    SDL_RenderDrawLine(g.renderer, x0 - y, y0 + x, x0 + y, y0 + x);
-    SDL_RenderDrawLine(g.renderer, x0 - y, y0 - x, x0 + y, y0 - x);
+  int index;
+  LEAST_RECENT(g.discCache, DISC_CACHE_SIZE, index);
+  DiscCacheEntry *entry = &g.discCache[index];
+  SDL_DestroyTexture(entry->texture);
+  entry->texture = SDL_CreateTextureFromSurface(g.renderer, disc);
+  entry->radius = radius;
+  entry->lastUse = g.cacheClock;
+  SDL_FreeSurface(disc);
+  if (entry->texture != NULL)
+    SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+  return entry->texture;
+}
 
-    if (err <= 0) {
-      y++;
-      err += dy;
-      dy += 2;
-    }
-    if (err > 0) {
-      x--;
-      dx += 2;
-      err += (-radius << 1) + dx;
-    }
+/**
+ * Vide les caches de disques, de boutons et de cartes (changement d'échelle).
+ */
+static void flushTextureCaches() {
+  for (int i = 0; i < DISC_CACHE_SIZE; i++) {
+    SDL_DestroyTexture(g.discCache[i].texture);
+  }
+  for (int i = 0; i < BUTTON_CACHE_SIZE; i++) {
+    SDL_DestroyTexture(g.buttonCache[i].texture);
+  }
+  for (int i = 0; i < MAX_CARD_POSITIONS; i++) {
+    SDL_DestroyTexture(g.cardCache[i].texture);
+  }
+  for (int i = 0; i < CARD_PREPARED_SIZE; i++) {
+    SDL_DestroyTexture(g.preparedCache[i].texture);
   }
+  SDL_zero(g.discCache);
+  SDL_zero(g.buttonCache);
+  SDL_zero(g.cardCache);
+  SDL_zero(g.preparedCache);
+}
+
+// Remplissage de cercle par copie d'un disque blanc mis en cache, colorisé
+// au moment du dessin : un disque coûte une seule copie de texture.
+void fillCircle(int x0, int y0, int radius, Uint8 fr, Uint8 fg, Uint8 fb,
+                Uint8 fa) {
+  if (radius <= 0)
+    return;
+  SDL_Texture *disc = getDiscTexture(radius);
+  if (disc == NULL)
+    return;
+
+  SDL_SetTextureColorMod(disc, fr, fg, fb);
+  SDL_SetTextureAlphaMod(disc, fa);
+  SDL_Rect dstRect = {x0 - radius, y0 - radius, 2 * radius, 2 * radius};
+  SDL_RenderCopy(g.renderer, disc, NULL, &dstRect);
 }
 
 // Dessin de cercle basé sur le midpoint algorithm.
@@ -337,73 +457,483 @@ void drawCardShape(CardPosition card, int w, Uint8 bgr, Uint8 bgg, Uint8 bgb,
     w = 1;
 
   getCardCenter(card, &cardCenterX, &cardCenterY);
+  int radius = getCardRadius(card);
 
-  fillCircle(cardCenterX, cardCenterY, CARD_RADIUS + w / 2, fgr, fgg, fgb, 255);
-  fillCircle(cardCenterX, cardCenterY, CARD_RADIUS - w / 2, bgr, bgg, bgb, 255);
+  fillCircle(cardCenterX, cardCenterY, radius + w / 2, fgr, fgg, fgb, 255);
+  fillCircle(cardCenterX, cardCenterY, radius - w / 2, bgr, bgg, bgb, 255);
 }
 
-void drawIcon(CardPosition cardPos, Icon icon, int *centerX, int *centerY) {
+void layoutIcon(CardPosition cardPos, Icon *icon) {
   int cardCenterX, cardCenterY;
 
-  double radius = icon.radius * WIN_SCALE;
-  double scale = icon.scale * WIN_SCALE;
+  double radius = icon->radius * WIN_SCALE * cardRatio(cardPos);
 
   getCardCenter(cardPos, &cardCenterX, &cardCenterY);
 
   /* Mise à l'échelle des mesures */
-  double cx = radius * cos(icon.angle / 360. * (2. * M_PI)) + cardCenterX;
-  double cy = radius * sin(icon.angle / 360. * (2. * M_PI)) + cardCenterY;
+  icon->centerX =
+      (int)(radius * cos(icon->angle / 360. * (2. * M_PI)) + cardCenterX);
+  icon->centerY =
+      (int)(radius * sin(icon->angle / 360. * (2. * M_PI)) + cardCenterY);
+}
 
-  if (centerX)
-    *centerX = (int)cx;
-  if (centerY)
-    *centerY = (int)cy;
+void layoutCard(CardPosition cardPos, Card card) {
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    layoutIcon(cardPos, &card.icons[i]);
+  }
+  // Les rendus en cache de la carte ne sont plus valides (les rendus des
+  // autres cartes sont conservés)
+  for (int i = 0; i < MAX_CARD_POSITIONS; i++) {
+    if (g.cardCache[i].icons == card.icons)
+      g.cardCache[i].icons = NULL;
+  }
+  for (int i = 0; i < CARD_PREPARED_SIZE; i++) {
+    if (g.preparedCache[i].icons == card.icons)
+      g.preparedCache[i].icons = NULL;
+  }
+}
+
+void invalidateCardCache() {
+  for (int i = 0; i < MAX_CARD_POSITIONS; i++)
+    g.cardCache[i].icons = NULL;
+  for (int i = 0; i < CARD_PREPARED_SIZE; i++)
+    g.preparedCache[i].icons = NULL;
+}
+
+int getIconDrawSize(CardPosition cardPos, Icon icon) {
+  return (int)(DRAW_ICON_SIZE * icon.scale * WIN_SCALE * cardRatio(cardPos));
+}
 
+/**
+ * Copie une icône de sa matrice d'icônes vers la cible de rendu courante.
+ *
+ * @param icon     L'icône (numéro et rotation)
+ * @param cx       Abscisse du centre de l'icône dans la cible de rendu
+ * @param cy       Ordonnée du centre de l'icône dans la cible de rendu
+ * @param drawSize La taille de l'icône dans la cible de rendu
+ * @param alpha    L'opacité de l'icône
+ */
+static void copyIcon(Icon icon, double cx, double cy, int drawSize,
+                     Uint8 alpha) {
   // Attention aux conversions entre nombres flottants et entiers
-  int destX = cx - scale * (double)(DRAW_ICON_SIZE) / 2.;
-  int destY = cy - scale * (double)(DRAW_ICON_SIZE) / 2.;
+  int destX = cx - drawSize / 2.;
+  int destY = cy - drawSize / 2.;
   int origX, origY;
 
-  // Récupération de la position de l'icône dans la matrice d'icônes
-  getIconLocationInMatrix(icon.iconId, &origX, &origY);
+  // Récupération du pack contenant l'icône choisie pour le symbole et de sa
+  // position dans la matrice
+  // d'icônes, puis dans le niveau de mipmap adapté à la taille de dessin
+  int atlas = atlasLocateIcon(icon.imageId, &origX, &origY);
+
+  // Rendu logiciel : icône déjà tournée, recopiée sans transformation
+  int side;
+  SDL_Texture *sprite =
+      spriteGet(atlas, origX, origY, icon.rotation, drawSize, &side);
+  if (sprite != NULL) {
+    SDL_Rect dstRect = {(int)(cx - side / 2.), (int)(cy - side / 2.), side,
+                        side};
+    SDL_SetTextureAlphaMod(sprite, alpha);
+    SDL_RenderCopy(g.renderer, sprite, NULL, &dstRect);
+    return;
+  }
+
+  int levelSize;
+  SDL_Texture *texture = atlasTexture(atlas, drawSize, &levelSize);
+  if (texture == NULL)
+    return;
+  origX = origX / ICON_SIZE * levelSize;
+  origY = origY / ICON_SIZE * levelSize;
 
   // Zone occupée par l'icône dans la matrice d'icônes
-  SDL_Rect srcRect = {origX, origY, ICON_SIZE, ICON_SIZE};
+  SDL_Rect srcRect = {origX, origY, levelSize, levelSize};
   // Zone occupée par l'icône dans le rendu de la fenêtre du jeu
-  SDL_Rect dstRect = {destX, destY, DRAW_ICON_SIZE * scale,
-                      DRAW_ICON_SIZE * scale};
-  // Zone occupée par l'icône dans la texture temporaire
-  SDL_Rect tmpRect = {0, 0, ICON_SIZE, ICON_SIZE};
+  SDL_Rect dstRect = {destX, destY, drawSize, drawSize};
+
+  // Dessin de l'icône vers l'écran
+  if (alpha != 255)
+    SDL_SetTextureAlphaMod(texture, alpha);
+  SDL_RenderCopyEx(g.renderer, texture, &srcRect, &dstRect,
+                   icon.rotation, NULL, SDL_FLIP_NONE);
+  if (alpha != 255)
+    SDL_SetTextureAlphaMod(texture, 255);
+}
+
+void drawIcon(CardPosition cardPos, Icon icon, int *centerX, int *centerY) {
+  layoutIcon(cardPos, &icon);
 
-  // Copie de l'icône dans une texture temporaire
-  SDL_SetRenderTarget(g.renderer, g.iconTexture);
+  if (centerX)
+    *centerX = icon.centerX;
+  if (centerY)
+    *centerY = icon.centerY;
+
+  copyIcon(icon, icon.centerX, icon.centerY, getIconDrawSize(cardPos, icon),
+           255);
+}
+
+void drawIconOverlay(CardPosition cardPos, Icon icon, double scale,
+                     double alpha) {
+  if (alpha <= 0)
+    return;
+  copyIcon(icon, icon.centerX, icon.centerY,
+           (int)(getIconDrawSize(cardPos, icon) * scale),
+           (Uint8)(alpha >= 1 ? 255 : alpha * 255));
+}
+
+/**
+ * Rend le fond et les icônes d'une carte dans la texture d'une entrée du
+ * cache.
+ *
+ * @return La texture, NULL en cas d'échec
+ */
+static SDL_Texture *renderCardTexture(CardCacheEntry *entry,
+                                      CardPosition cardPos, Card card,
+                                      int radius, Uint8 bgr, Uint8 bgg,
+                                      Uint8 bgb) {
+  int size = 2 * radius + 2;
+  if (entry->texture == NULL || entry->size != size) {
+    SDL_DestroyTexture(entry->texture);
+    entry->texture =
+        SDL_CreateTexture(g.renderer, SDL_PIXELFORMAT_RGBA8888,
+                          SDL_TEXTUREACCESS_TARGET, size, size);
+    entry->size = size;
+    if (entry->texture == NULL)
+      return NULL;
+    SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+  }
+
+  SDL_SetRenderTarget(g.renderer, entry->texture);
+  SDL_SetRenderDrawColor(g.renderer, bgr, bgg, bgb, 0);
   SDL_RenderClear(g.renderer);
-  SDL_RenderCopyEx(g.renderer, g.matrixTexture, &srcRect, &tmpRect, 0.0, NULL,
-                   SDL_FLIP_NONE);
+
+  // Fond de la carte recopié sans mélange, pour conserver l'opacité de ses
+  // bords dans la texture (sinon assombris lors du dessin à l'écran)
+  SDL_Texture *disc = getDiscTexture(radius);
+  if (disc != NULL) {
+    SDL_SetTextureColorMod(disc, bgr, bgg, bgb);
+    SDL_SetTextureAlphaMod(disc, 255);
+    SDL_SetTextureBlendMode(disc, SDL_BLENDMODE_NONE);
+    SDL_Rect dstRect = {1, 1, 2 * radius, 2 * radius};
+    SDL_RenderCopy(g.renderer, disc, NULL, &dstRect);
+    SDL_SetTextureBlendMode(disc, SDL_BLENDMODE_BLEND);
+  }
+
+  // Icônes, placées par rapport au coin de la texture
+  int cardCenterX, cardCenterY;
+  getCardCenter(cardPos, &cardCenterX, &cardCenterY);
+  int offsetX = cardCenterX - radius - 1, offsetY = cardCenterY - radius - 1;
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    Icon icon = card.icons[i];
+    copyIcon(icon, icon.centerX - offsetX, icon.centerY - offsetY,
+             getIconDrawSize(cardPos, icon), 255);
+  }
+
   SDL_SetRenderTarget(g.renderer, NULL);
+  entry->icons = card.icons;
+  entry->background = (SDL_Color){bgr, bgg, bgb, 255};
+  entry->position = cardPos;
+  return entry->texture;
+}
+
+/**
+ * Indique si une entrée du cache contient le rendu d'une carte.
+ */
+static bool cardCacheMatches(const CardCacheEntry *entry, Card card,
+                             int inner, Uint8 bgr, Uint8 bgg, Uint8 bgb) {
+  return entry->icons == card.icons && entry->size == 2 * inner + 2 &&
+         entry->background.r == bgr && entry->background.g == bgg &&
+         entry->background.b == bgb;
+}
 
-  // Dessin de l'icône en texture temporaire vers l'écran
-  SDL_RenderCopyEx(g.renderer, g.iconTexture, &tmpRect, &dstRect, icon.rotation,
-                   NULL, SDL_FLIP_NONE);
+/**
+ * Retourne la zone occupée par un carré centré, étiré par une transformation
+ * (au moins un pixel de côté).
+ *
+ * @param cx   Abscisse du centre (déjà déplacé)
+ * @param cy   Ordonnée du centre (déjà déplacé)
+ * @param half La demi-largeur du carré
+ * @param t    La transformation
+ */
+static SDL_Rect transformedRect(int cx, int cy, int half,
+                                const CardTransform *t) {
+  int halfX = (int)(half * fabs(t->scaleX) + 0.5);
+  int halfY = (int)(half * fabs(t->scaleY) + 0.5);
+  if (halfX <= 0)
+    halfX = 1;
+  if (halfY <= 0)
+    halfY = 1;
+  return (SDL_Rect){cx - halfX, cy - halfY, 2 * halfX, 2 * halfY};
 }
 
-/****************** METHODES DE GESTION DU CYCLE DE VIE ******************/
+void drawCardCached(CardPosition cardPos, Card card, int w, Uint8 bgr,
+                    Uint8 bgg, Uint8 bgb, Uint8 fgr, Uint8 fgg, Uint8 fgb) {
+  int cardCenterX, cardCenterY;
+  getCardCenter(cardPos, &cardCenterX, &cardCenterY);
+  int radius = getCardRadius(cardPos);
+
+  /* Mise à l'échelle de l'épaisseur */
+  w = (int)(WIN_SCALE * w);
+  if (w <= 0)
+    w = 1;
+
+  // Carte animée : bord et rendu en cache déplacés, étirés et tournés
+  const CardTransform *t = &g.transforms[cardPos];
+  bool transformed = !isIdentity(t);
+  if (transformed) {
+    cardCenterX += (int)(t->dx * WIN_SCALE);
+    cardCenterY += (int)(t->dy * WIN_SCALE);
+  }
+
+  // Bord de la carte (sa couleur change sans invalider le rendu en cache)
+  if (!transformed) {
+    fillCircle(cardCenterX, cardCenterY, radius + w / 2, fgr, fgg, fgb, 255);
+  } else {
+    SDL_Texture *disc = getDiscTexture(radius + w / 2);
+    if (disc != NULL) {
+      SDL_SetTextureColorMod(disc, fgr, fgg, fgb);
+      SDL_SetTextureAlphaMod(disc, 255);
+      SDL_Rect dstRect =
+          transformedRect(cardCenterX, cardCenterY, radius + w / 2, t);
+      SDL_RenderCopy(g.renderer, disc, NULL, &dstRect);
+    }
+  }
+
+  // Fond et icônes : rendus une fois par carte, puis recopiés à chaque image
+  int inner = radius - w / 2;
+  CardCacheEntry *entry = &g.cardCache[cardPos];
+  if (!cardCacheMatches(entry, card, inner, bgr, bgg, bgb)) {
+    // Carte préparée à l'avance : échange des textures, sans rendu
+    for (int i = 0; i < CARD_PREPARED_SIZE; i++) {
+      CardCacheEntry *prepared = &g.preparedCache[i];
+      if (prepared->position == cardPos &&
+          cardCacheMatches(prepared, card, inner, bgr, bgg, bgb)) {
+        CardCacheEntry tmp = *entry;
+        *entry = *prepared;
+        *prepared = tmp;
+        prepared->icons = NULL;
+        break;
+      }
+    }
+  }
+  SDL_Texture *texture = entry->texture;
+  if (!cardCacheMatches(entry, card, inner, bgr, bgg, bgb))
+    texture = renderCardTexture(entry, cardPos, card, inner, bgr, bgg, bgb);
+
+  if (texture != NULL && transformed) {
+    // Pas de rotation d'une carte entière avec le rendu logiciel (rotation
+    // pixel par pixel à chaque image)
+    SDL_Rect dstRect = transformedRect(cardCenterX, cardCenterY, inner + 1, t);
+    SDL_RenderCopyEx(g.renderer, texture, NULL, &dstRect,
+                     spritesEnabled() ? 0 : t->angle, NULL, SDL_FLIP_NONE);
+  } else if (texture != NULL) {
+    SDL_Rect dstRect = {cardCenterX - inner - 1, cardCenterY - inner - 1,
+                        2 * inner + 2, 2 * inner + 2};
+    SDL_RenderCopy(g.renderer, texture, NULL, &dstRect);
+  } else {
+    // Rendu en cache impossible : dessin direct
+    fillCircle(cardCenterX, cardCenterY, inner, bgr, bgg, bgb, 255);
+    for (int i = 0; i < gameGlobal.nbIcons; i++)
+      drawIcon(cardPos, card.icons[i], NULL, NULL);
+  }
+}
+
+void prepareCardCached(CardPosition cardPos, Card card, int w, Uint8 bgr,
+                       Uint8 bgg, Uint8 bgb) {
+  if (g.renderer == NULL || gameGlobal.headless)
+    return;
+  w = (int)(WIN_SCALE * w);
+  if (w <= 0)
+    w = 1;
+  int inner = getCardRadius(cardPos) - w / 2;
+
+  // Déjà préparée, ou déjà rendue à sa position
+  if (cardCacheMatches(&g.cardCache[cardPos], card, inner, bgr, bgg, bgb))
+    return;
+  CardCacheEntry *unused = NULL;
+  for (int i = 0; i < CARD_PREPARED_SIZE; i++) {
+    CardCacheEntry *prepared = &g.preparedCache[i];
+    if (prepared->position == cardPos &&
+        cardCacheMatches(prepared, card, inner, bgr, bgg, bgb))
+      return;
+    // Entrée libre, ou rendu à une autre échelle (jamais affiché)
+    if (unused == NULL &&
+        (prepared->icons == NULL || prepared->size != 2 * inner + 2))
+      unused = prepared;
+  }
+  // Toutes les entrées sont prises : la carte sera rendue à son affichage
+  if (unused != NULL)
+    renderCardTexture(unused, cardPos, card, inner, bgr, bgg, bgb);
+}
+
+/**
+ * Dessine un bouton sur la cible de rendu courante. Dans une texture vide,
+ * l'anneau est recopié sans mélange, pour conserver l'opacité de son bord
+ * (sinon assombri lors du dessin à l'écran).
+ */
+static void renderButton(int x, int y, int radius, int w, const char *text,
+                         SDL_Color color, int bgShade, bool blendRing) {
+  SDL_Texture *disc = getDiscTexture(radius + w / 2);
+  if (disc != NULL) {
+    SDL_SetTextureColorMod(disc, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(disc, 255);
+    SDL_SetTextureBlendMode(disc, blendRing ? SDL_BLENDMODE_BLEND
+                                            : SDL_BLENDMODE_NONE);
+    SDL_Rect dstRect = {x - radius - w / 2, y - radius - w / 2,
+                        2 * (radius + w / 2), 2 * (radius + w / 2)};
+    SDL_RenderCopy(g.renderer, disc, NULL, &dstRect);
+    SDL_SetTextureBlendMode(disc, SDL_BLENDMODE_BLEND);
+  }
+  fillCircle(x, y, radius - w / 2, bgShade, bgShade, bgShade, 255);
+  drawText(text, x, y, Center, Middle, color.r, color.g, color.b);
+}
+
+void drawButton(int x, int y, int radius, int w, const char *text, int textR,
+                int textG, int textB, int bgShade) {
+  SDL_Color color = {textR, textG, textB, 255};
+  int size = 2 * (radius + w / 2) + 2;
+
+  g.cacheClock++;
+  ButtonCacheEntry *entry = NULL;
+  bool cacheable = strlen(text) < sizeof(g.buttonCache[0].text);
+  for (int i = 0; cacheable && entry == NULL && i < BUTTON_CACHE_SIZE; i++) {
+    ButtonCacheEntry *e = &g.buttonCache[i];
+    if (e->texture != NULL && e->radius == radius && e->w == w &&
+        e->bgShade == bgShade && e->color.r == color.r &&
+        e->color.g == color.g && e->color.b == color.b &&
+        strcmp(e->text, text) == 0)
+      entry = e;
+  }
+
+  // Premier dessin du bouton : rendu dans une texture qui remplace l'entrée
+  // la moins récemment utilisée
+  if (entry == NULL && cacheable) {
+    int index;
+    LEAST_RECENT(g.buttonCache, BUTTON_CACHE_SIZE, index);
+    entry = &g.buttonCache[index];
+    SDL_DestroyTexture(entry->texture);
+    entry->texture =
+        SDL_CreateTexture(g.renderer, SDL_PIXELFORMAT_RGBA8888,
+                          SDL_TEXTUREACCESS_TARGET, size, size);
+    if (entry->texture != NULL) {
+      SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+      SDL_SetRenderTarget(g.renderer, entry->texture);
+      SDL_SetRenderDrawColor(g.renderer, color.r, color.g, color.b, 0);
+      SDL_RenderClear(g.renderer);
+      renderButton(size / 2, size / 2, radius, w, text, color, bgShade, false);
+      SDL_SetRenderTarget(g.renderer, NULL);
+      strcpy(entry->text, text);
+      entry->color = color;
+      entry->bgShade = bgShade;
+      entry->radius = radius;
+      entry->w = w;
+    } else {
+      entry = NULL;
+    }
+  }
+
+  if (entry != NULL) {
+    entry->lastUse = g.cacheClock;
+    SDL_Rect dstRect = {x - size / 2, y - size / 2, size, size};
+    SDL_RenderCopy(g.renderer, entry->texture, NULL, &dstRect);
+  } else {
+    // Rendu en cache impossible : dessin direct
+    renderButton(x, y, radius, w, text, color, bgShade, true);
+  }
+}
+
+/****************** METHODES DE GESTION DE L'ECHELLE ******************/
+
+double getWindowScale() { return g.scale > 0 ? g.scale : DEFAULT_WIN_SCALE; }
+
+/**
+ * Recalcule l'échelle de rendu à partir de la taille de la fenêtre en pixels
+ * (qui peut être supérieure à sa taille en coordonnées sur un écran haute
+ * densité). La zone de dessin est centrée dans la fenêtre. Si l'échelle
+ * change, la police est rechargée à la nouvelle taille, les textures en cache
+ * sont régénérées à la demande et les icônes des cartes sont replacées.
+ */
+static void updateWindowScale() {
+  int windowWidth, windowHeight, outputWidth, outputHeight;
+  if (g.window != NULL) {
+    SDL_GetWindowSize(g.window, &windowWidth, &windowHeight);
+  } else {
+    windowWidth = g.frame->w;
+    windowHeight = g.frame->h;
+  }
+  if (SDL_GetRendererOutputSize(g.renderer, &outputWidth, &outputHeight) != 0) {
+    outputWidth = windowWidth;
+    outputHeight = windowHeight;
+  }
+  g.pixelRatio = windowWidth > 0 ? (double)outputWidth / windowWidth : 1.;
+
+  double scale = fmin((double)outputWidth / BASE_WIN_WIDTH,
+                      (double)outputHeight / BASE_WIN_HEIGHT);
+  if (scale <= 0)
+    scale = DEFAULT_WIN_SCALE;
+
+  if (scale != g.scale || !g.fontReady) {
+    // Glyphes de la police seuillés à la nouvelle taille depuis son atlas
+    if (fontSetSize((int)(BASE_FONT_SIZE * scale))) {
+      g.fontReady = true;
+      g.scale = scale;
+      flushTextureCaches();
+    } else if (g.fontReady) {
+      printf("SDL: Echec du chargement de la police à l'échelle %.2f.\n",
+             scale);
+    }
+  }
+
+  // Zone de dessin centrée
+  g.viewport.w = WIN_WIDTH;
+  g.viewport.h = WIN_HEIGHT;
+  g.viewport.x = (outputWidth - g.viewport.w) / 2;
+  g.viewport.y = (outputHeight - g.viewport.h) / 2;
+  SDL_RenderSetViewport(g.renderer, &g.viewport);
+
+  // Les positions des icônes dépendent de l'échelle
+  if (gameGlobal.cardUpper.icons != NULL)
+    layoutCard(UpperCard, gameGlobal.cardUpper);
+  if (gameGlobal.cardLower.icons != NULL)
+    layoutCard(LowerCard, gameGlobal.cardLower);
 
-int initializeGraphics() {
-  // Initialisation de la structure de données
-  SDL_zero(g);
   g.redrawRequested = true;
+}
 
-  // Initialisation de la SDL
-  SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER);
+/**
+ * Convertit une position de la souris (coordonnées de la fenêtre) en position
+ * dans la zone de dessin (pixels de rendu).
+ */
+static void windowToScene(int *x, int *y) {
+  *x = (int)(*x * g.pixelRatio) - g.viewport.x;
+  *y = (int)(*y * g.pixelRatio) - g.viewport.y;
+}
 
-  // Création de la fenêtre
-  g.window = SDL_CreateWindow("Polytech - RICM3 - API - 愛&雪 Dobble",
-                              SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                              WIN_WIDTH, WIN_HEIGHT, 0);
+/****************** METHODES DE GESTION DU CYCLE DE VIE ******************/
 
-  // Création du renderer (objet de dessin sur la fenêtre)
-  g.renderer = SDL_CreateRenderer(g.window, -1, SDL_RENDERER_TARGETTEXTURE);
+/**
+ * Termine l'initialisation une fois le renderer créé : gestionnaire d'atlas,
+ * SDL_image, SDL_ttf, police de caractères et évènements.
+ *
+ * @return 1 si l'initialisation a réussi, 0 sinon
+ */
+static int initializeRenderer() {
+  if (g.renderer == NULL) {
+    printf("SDL: Echec de la création du renderer: %s\n", SDL_GetError());
+    return 0;
+  }
+
+  // Gestionnaire des matrices d'icônes, et icônes pré-tournées avec le rendu
+  // logiciel d'une fenêtre (pas pour les captures, dont les images servent de
+  // référence)
+  atlasInit(g.renderer, (size_t)ATLAS_BUDGET_MB << 20);
+  SDL_RendererInfo info;
+  bool software = SDL_GetRendererInfo(g.renderer, &info) == 0 &&
+                  (info.flags & SDL_RENDERER_SOFTWARE);
+  spritesInit(g.renderer, (size_t)SPRITE_BUDGET_MB << 20,
+              software && g.frame == NULL);
+
+  // Cartes dessinées sans transformation
+  for (int i = 0; i < MAX_CARD_POSITIONS; i++)
+    g.transforms[i] = (CardTransform){0, 0, 1, 1, 0};
 
   // Initialisation de SDL_image
   int imgFlags = IMG_INIT_PNG;
@@ -412,77 +942,225 @@ int initializeGraphics() {
     return 0;
   }
 
-  // Initialisation de SDL_ttf
+  // Initialisation de SDL_ttf (calcul de l'atlas de la police)
   if (TTF_Init() == -1) {
     printf("SDL: Erreur d'initialisation de TTF_Init: %s\n", TTF_GetError());
     return 0;
   }
 
-  // Chargement de la police de caractères
-  g.font = TTF_OpenFont(DATA_DIRECTORY "/FONTS/Roboto-Medium.ttf", FONT_SIZE);
-  if (g.font == NULL) {
+  // Atlas de la police de caractères (calculé au premier lancement), puis
+  // calcul de l'échelle et préparation des glyphes à cette taille
+  if (!fontLoad(g.renderer, "FONTS/Roboto-Medium.ttf")) {
+    printf("SDL: Echec du chargement de la police de caractères.\n");
+    return 0;
+  }
+  updateWindowScale();
+  if (!g.fontReady) {
     printf("SDL: Echec du chargement de la police de caractères.\n");
     return 0;
   }
 
-  // Création de la texture temporaire d'icône
-  g.iconTexture =
-      SDL_CreateTexture(g.renderer, SDL_PIXELFORMAT_RGBA8888,
-                        SDL_TEXTUREACCESS_TARGET, ICON_SIZE, ICON_SIZE);
+  // Enregistrement de l'évènement d'invocation planifiée (premier évènement
+  // utilisateur enregistré, donc égal à SDL_USEREVENT)
+  g.userCallLaterEvent = SDL_RegisterEvents(1);
 
-  if (g.iconTexture == NULL) {
-    printf("SDL: Echec de la création de la texture d'icône temporaire.\n");
+  return 1;
+}
+
+int initializeGraphics() {
+  // Initialisation de la structure de données
+  SDL_zero(g);
+  g.redrawRequested = true;
+
+  // Initialisation de la SDL
+  SDL_Init(SDL_INIT_VIDEO);
+
+  // Création de la fenêtre, redimensionnable et en pleine résolution sur les
+  // écrans haute densité
+  g.window = SDL_CreateWindow("Polytech - RICM3 - API - 愛&雪 Dobble",
+                              SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                              WIN_WIDTH, WIN_HEIGHT,
+                              SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+  SDL_SetWindowMinimumSize(g.window, BASE_WIN_WIDTH / 4, BASE_WIN_HEIGHT / 4);
+
+  // Filtrage linéaire des textures réduites (icônes)
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+
+  // Création du renderer (objet de dessin sur la fenêtre)
+  g.renderer = SDL_CreateRenderer(g.window, -1, SDL_RENDERER_TARGETTEXTURE);
+
+  return initializeRenderer();
+}
+
+int initializeOffscreenGraphics(int width, int height) {
+  SDL_zero(g);
+  g.redrawRequested = true;
+
+  // Ni vidéo ni affichage : seulement les évènements (appels demandés par
+  // d'autres threads)
+  SDL_Init(SDL_INIT_EVENTS);
+
+  // Image de rendu en mémoire, dessinée par le rendu logiciel de la SDL (sans
+  // carte graphique)
+  g.frame = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                           SDL_PIXELFORMAT_RGBA32);
+  if (g.frame == NULL) {
+    printf("SDL: Echec de la création de l'image de rendu: %s\n",
+           SDL_GetError());
     return 0;
   }
 
-  // Choix du mode de mélange pour la texture d'icône
-  SDL_SetTextureBlendMode(g.iconTexture, SDL_BLENDMODE_BLEND);
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+  g.renderer = SDL_CreateSoftwareRenderer(g.frame);
 
-  // Initialisation du générateur de nombres aléatoires
-  srand(SDL_GetTicks());
+  return initializeRenderer();
+}
 
-  // Enregistrement de l'évènement de timer
-  g.userTimerEvent = SDL_RegisterEvents(1);
+const uint8_t *getFramePixels(int *width, int *height, int *pitch) {
+  if (g.frame == NULL)
+    return NULL;
+  // Exécution des opérations de dessin en attente dans le renderer
+  SDL_RenderFlush(g.renderer);
+  *width = g.frame->w;
+  *height = g.frame->h;
+  *pitch = g.frame->pitch;
+  return g.frame->pixels;
+}
 
-  return 1;
+static void dispatchPresses();
+
+/**
+ * Ajoute un appui aux appuis en attente.
+ *
+ * @param timestamp Horodatage SDL de l'évènement (en ms depuis SDL_Init)
+ * @param x         Abscisse de l'appui (coordonnées de la fenêtre)
+ * @param y         Ordonnée de l'appui (coordonnées de la fenêtre)
+ */
+static void queuePress(Uint32 timestamp, int x, int y) {
+  if (g.nbPresses == INPUT_BATCH_SIZE)
+    dispatchPresses();
+
+  // Conversion de l'horodatage SDL vers l'horloge monotone du jeu : les
+  // appuis sont datés à leur réception par la SDL, pas à leur traitement
+  int64_t now = clockNow();
+  int64_t at = now - msToUs(SDL_GetTicks() - timestamp);
+  if (at > now)
+    at = now;
+
+  windowToScene(&x, &y);
+  PointerPress *press = &g.presses[g.nbPresses++];
+  press->at = at;
+  press->x = x;
+  press->y = y;
 }
 
+/**
+ * Traite les appuis en attente dans l'ordre chronologique. Le tri est stable :
+ * deux appuis de même horodatage restent dans leur ordre d'arrivée (celui de
+ * la file d'évènements du système).
+ */
+static void dispatchPresses() {
+  for (int i = 1; i < g.nbPresses; i++) {
+    PointerPress tmp = g.presses[i];
+    int j = i - 1;
+    for (; j >= 0 && g.presses[j].at > tmp.at; j--) {
+      g.presses[j + 1] = g.presses[j];
+    }
+    g.presses[j + 1] = tmp;
+  }
+
+  // Les appuis sont retirés de la file avant leur traitement, qui peut
+  // relancer la boucle principale
+  int nbPresses = g.nbPresses;
+  PointerPress presses[INPUT_BATCH_SIZE];
+  memcpy(presses, g.presses, nbPresses * sizeof(PointerPress));
+  g.nbPresses = 0;
+  for (int i = 0; i < nbPresses; i++) {
+    onPointerDown(presses[i].x, presses[i].y, presses[i].at);
+  }
+}
+
+/**
+ * Traite un évènement de la SDL. Les appuis sont mis en attente pour être
+ * traités ensemble, une fois la file d'évènements vidée.
+ *
+ * @return 1 si l'utilisateur a demandé à quitter, 0 sinon
+ */
+static int handleEvent(SDL_Event *event) {
+  int w, h;
+
+  switch (event->type) {
+  case SDL_MOUSEMOTION:
+    // Rajouter ici le test "souris sur un pixel non transparent"
+    windowToScene(&event->motion.x, &event->motion.y);
+    onMouseMove(event->motion.x, event->motion.y);
+    break;
+  case SDL_MOUSEBUTTONDOWN:
+    // Les contacts tactiles sont traités directement (et non par les clics
+    // simulés par la SDL, qui ne distinguent pas les doigts)
+    if (event->button.which != SDL_TOUCH_MOUSEID)
+      queuePress(event->button.timestamp, event->button.x, event->button.y);
+    break;
+  case SDL_FINGERDOWN:
+    // Position normalisée (entre 0 et 1) dans la fenêtre
+    SDL_GetWindowSize(g.window, &w, &h);
+    queuePress(event->tfinger.timestamp, (int)(event->tfinger.x * w),
+               (int)(event->tfinger.y * h));
+    break;
+  case SDL_WINDOWEVENT:
+    if (event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+      updateWindowScale();
+    // Sauvegarde de la partie, si la borne est éteinte sans retour au jeu
+    if (event->window.event == SDL_WINDOWEVENT_FOCUS_LOST)
+      onSuspend();
+    g.redrawRequested = true;
+    break;
+  case SDL_APP_WILLENTERBACKGROUND:
+    onSuspend();
+    break;
+  case SDL_USEREVENT:
+    if (event->user.type == g.userCallLaterEvent) {
+      // Appel de la procédure fournie en paramètre de l'évènement
+      void (*method)(void *) = event->user.data1;
+      void *param = event->user.data2;
+
+      method(param);
+    }
+    break;
+  case SDL_QUIT:
+    // Fermeture de la fenêtre ou SIGTERM (transformé en SDL_QUIT par la SDL)
+    onSuspend();
+    printf("Merci d'avoir joué!\n");
+    return 1;
+  }
+  return 0;
+}
+
+void quitMainLoop() { g.quitRequested = true; }
+
 void mainLoop() {
   int quit = 0;
   SDL_Event event;
 
-  while (!quit) {
-    SDL_WaitEvent(&event);
-
-    switch (event.type) {
-    case SDL_MOUSEMOTION:
-      // Rajouter ici le test "souris sur un pixel non transparent"
-      onMouseMove(event.motion.x, event.motion.y);
-      break;
-    case SDL_MOUSEBUTTONDOWN:
-      onMouseClick(event.motion.x, event.motion.y);
-      break;
-    case SDL_WINDOWEVENT:
-      g.redrawRequested = true;
-      break;
-    case SDL_USEREVENT:
-      if (event.user.type == g.userTimerEvent) {
-        // Appel de la procédure onTimerTick déclarée dans dobble.h
-        // et implémentée dans dobble.c
-        onTimerTick();
-      } else if (event.user.type == g.userCallLaterEvent) {
-        // Appel de la procédure fournie en paramètre de l'évènement
-        void (*method)(void *) = event.user.data1;
-        void *param = event.user.data2;
-
-        method(param);
-      }
-      break;
-    case SDL_QUIT:
-      printf("Merci d'avoir joué!\n");
-      quit = 1;
-      break;
+  g.quitRequested = false;
+  while (!quit && !g.quitRequested) {
+    // Attente d'un évènement, au plus jusqu'à la prochaine échéance de la roue
+    // de minuteries
+    int timeout = timeUntilNextDeadline();
+    int received = timeout < 0 ? SDL_WaitEvent(&event)
+                               : SDL_WaitEventTimeout(&event, timeout);
+
+    // Traitement de tous les évènements en attente : les appuis simultanés
+    // (plusieurs joueurs) sont ainsi départagés par leurs horodatages
+    while (received && !quit) {
+      quit = handleEvent(&event);
+      received = SDL_PollEvent(&event);
     }
+    dispatchPresses();
+
+    // Appels planifiés échus (invocations planifiées, tics du compte à
+    // rebours)
+    timerWheelRun();
 
     if (g.redrawRequested) {
       renderScene();
@@ -492,14 +1170,16 @@ void mainLoop() {
 }
 
 void freeGraphics() {
-  TTF_CloseFont(g.font);
+  fontFree();
   TTF_Quit();
   IMG_Quit();
 
-  SDL_DestroyTexture(g.matrixTexture);
-  SDL_DestroyTexture(g.iconTexture);
+  atlasFreeAll();
+  spritesFreeAll();
+  flushTextureCaches();
   SDL_DestroyRenderer(g.renderer);
   SDL_DestroyWindow(g.window);
+  SDL_FreeSurface(g.frame);
   printf("freeGraphics\n");
   SDL_Quit();
 }
@@ -0,0 +1,389 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "assets.h"
+#include "clock.h"
+#include "iconindex.h"
+
+/* Nombre maximal d'icônes confondables avec une même icône */
+#define ICON_INDEX_MAX_CONFUSABLES (2 * ICON_INDEX_NEIGHBOURS)
+
+/* Taille d'un enregistrement d'icône dans un fichier d'index : signature puis
+ * voisins (identifiant et distance sur 16 bits chacun) */
+#define ICON_INDEX_RECORD (sizeof(IconSignature) + 4 * ICON_INDEX_NEIGHBOURS)
+
+/**
+ * Paires d'icônes confondables du jeu d'icônes courant.
+ */
+static struct IconIndex {
+  uint16_t confusables[ICON_INDEX_MAX_ICONS][ICON_INDEX_MAX_CONFUSABLES];
+  uint8_t count[ICON_INDEX_MAX_ICONS];
+} ix;
+
+/****************** SIGNATURES ******************/
+
+/**
+ * Calcule l'opacité et l'assombrissement (opacité × (255 - luminance) / 256,
+ * soit l'écart au blanc du pixel dessiné sur fond blanc) de chaque pixel d'une
+ * ligne d'icône.
+ */
+static void shadeRow(const uint8_t *row, uint16_t *alpha, uint16_t *dark) {
+  int x = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+  const __m128i white = _mm_set1_epi32(255 * 256);
+  for (; x + 4 <= ICON_SIZE; x += 4) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *)(row + 4 * x));
+    // Luminance × 256 de quatre pixels : _mm_madd_epi16 somme les produits
+    // deux à deux (rouge et vert, puis bleu), les deux sommes de chaque pixel
+    // sont ensuite additionnées
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128i luminance =
+        _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0)),
+                           _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0)));
+
+    // Opacité (octet de poids fort) et assombrissement, calculés sur 16 bits
+    // (produits d'au plus 255 × 255)
+    __m128i opacity = _mm_packs_epi32(_mm_srli_epi32(pixels, 24), zero);
+    __m128i darkness = _mm_packs_epi32(
+        _mm_srli_epi32(_mm_sub_epi32(white, luminance), 8), zero);
+    __m128i shade = _mm_srli_epi16(_mm_mullo_epi16(opacity, darkness), 8);
+    _mm_storel_epi64((__m128i *)(alpha + x), opacity);
+    _mm_storel_epi64((__m128i *)(dark + x), shade);
+  }
+#endif
+  for (; x < ICON_SIZE; x++) {
+    const uint8_t *p = row + 4 * x;
+    int luminance = 77 * p[0] + 150 * p[1] + 29 * p[2];
+    alpha[x] = p[3];
+    dark[x] = p[3] * ((255 * 256 - luminance) >> 8) >> 8;
+  }
+}
+
+/**
+ * Ajoute une ligne de valeurs à une somme de lignes.
+ */
+static void addRow(uint16_t *sum, const uint16_t *row) {
+  int x = 0;
+#ifdef __SSE2__
+  for (; x + 8 <= ICON_SIZE; x += 8) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(sum + x));
+    __m128i r = _mm_loadu_si128((const __m128i *)(row + x));
+    _mm_storeu_si128((__m128i *)(sum + x), _mm_add_epi16(s, r));
+  }
+#endif
+  for (; x < ICON_SIZE; x++)
+    sum[x] += row[x];
+}
+
+/**
+ * Retourne l'anneau de chaque pixel d'une icône (ICON_INDEX_RINGS pour les
+ * coins, hors du disque inscrit) et la surface de chaque anneau.
+ */
+static const uint8_t *ringTable(const int **areas) {
+  static uint8_t rings[ICON_SIZE * ICON_SIZE];
+  static int ringAreas[ICON_INDEX_RINGS];
+  static bool ready = false;
+  if (!ready) {
+    double center = (ICON_SIZE - 1) / 2.;
+    double width = ICON_SIZE / 2. / ICON_INDEX_RINGS;
+    for (int y = 0; y < ICON_SIZE; y++) {
+      for (int x = 0; x < ICON_SIZE; x++) {
+        double r = sqrt((x - center) * (x - center) +
+                        (y - center) * (y - center));
+        int ring = (int)(r / width);
+        if (ring > ICON_INDEX_RINGS)
+          ring = ICON_INDEX_RINGS;
+        rings[y * ICON_SIZE + x] = ring;
+        if (ring < ICON_INDEX_RINGS)
+          ringAreas[ring]++;
+      }
+    }
+    ready = true;
+  }
+  *areas = ringAreas;
+  return rings;
+}
+
+void iconIndexDescribe(const uint8_t *pixels, int pitch,
+                       IconSignature *signature) {
+  const int *ringAreas;
+  const uint8_t *rings = ringTable(&ringAreas);
+  unsigned ringSums[ICON_INDEX_RINGS + 1] = {0};
+  unsigned histogram[ICON_INDEX_HIST_BINS] = {0}, opaque = 0;
+  int darkBlocks[ICON_INDEX_GRID][ICON_INDEX_GRID];
+
+  for (int by = 0; by < ICON_INDEX_GRID; by++) {
+    // Sommes verticales des lignes d'une rangée de blocs
+    uint16_t alphaSum[ICON_SIZE] = {0}, darkSum[ICON_SIZE] = {0};
+    for (int y = by * ICON_INDEX_BLOCK; y < (by + 1) * ICON_INDEX_BLOCK; y++) {
+      const uint8_t *row = pixels + y * pitch;
+      uint16_t alpha[ICON_SIZE], dark[ICON_SIZE];
+      shadeRow(row, alpha, dark);
+      addRow(alphaSum, alpha);
+      addRow(darkSum, dark);
+
+      // Profil radial et couleurs des pixels opaques
+      for (int x = 0; x < ICON_SIZE; x++) {
+        ringSums[rings[y * ICON_SIZE + x]] += alpha[x];
+        if (alpha[x] >= 128) {
+          const uint8_t *p = row + 4 * x;
+          histogram[(p[0] >> 6) * 16 + (p[1] >> 6) * 4 + (p[2] >> 6)]++;
+          opaque++;
+        }
+      }
+    }
+
+    // Sommes horizontales de chaque bloc
+    for (int bx = 0; bx < ICON_INDEX_GRID; bx++) {
+      unsigned a = 0, d = 0;
+      for (int x = bx * ICON_INDEX_BLOCK; x < (bx + 1) * ICON_INDEX_BLOCK; x++) {
+        a += alphaSum[x];
+        d += darkSum[x];
+      }
+      signature->mask[by * ICON_INDEX_GRID + bx] =
+          a / (ICON_INDEX_BLOCK * ICON_INDEX_BLOCK);
+      darkBlocks[by][bx] = d;
+    }
+  }
+
+  for (int r = 0; r < ICON_INDEX_RINGS; r++)
+    signature->rings[r] = ringSums[r] / ringAreas[r];
+  for (int by = 0; by < ICON_INDEX_GRID; by++) {
+    signature->hash[by] = 0;
+    for (int bx = 0; bx + 1 < ICON_INDEX_GRID; bx++) {
+      if (darkBlocks[by][bx] > darkBlocks[by][bx + 1])
+        signature->hash[by] |= 1 << bx;
+    }
+  }
+  for (int i = 0; i < ICON_INDEX_HIST_BINS; i++)
+    signature->histogram[i] = opaque > 0 ? histogram[i] * 255 / opaque : 0;
+}
+
+int iconIndexDistance(const IconSignature *a, const IconSignature *b) {
+  int mask = 0, rings = 0, hash = 0, histogram = 0;
+  for (int i = 0; i < ICON_INDEX_GRID * ICON_INDEX_GRID; i++)
+    mask += abs(a->mask[i] - b->mask[i]);
+  for (int i = 0; i < ICON_INDEX_RINGS; i++)
+    rings += abs(a->rings[i] - b->rings[i]);
+  for (int i = 0; i < ICON_INDEX_GRID; i++)
+    hash += __builtin_popcount(a->hash[i] ^ b->hash[i]);
+  for (int i = 0; i < ICON_INDEX_HIST_BINS; i++)
+    histogram += abs(a->histogram[i] - b->histogram[i]);
+
+  // Le profil radial, insensible à la rotation des icônes, compte le plus
+  return (250 * mask / (ICON_INDEX_GRID * ICON_INDEX_GRID * 255) +
+          300 * rings / (ICON_INDEX_RINGS * 255) +
+          200 * hash / (ICON_INDEX_GRID * (ICON_INDEX_GRID - 1)) +
+          250 * histogram / (2 * 255));
+}
+
+/****************** ANALYSE HORS LIGNE ******************/
+
+/**
+ * Construit le nom du fichier d'index d'un pack : celui de son image, avec
+ * l'extension .idx.
+ */
+static void indexFileName(const char *imageFile, char *fileName, size_t size) {
+  snprintf(fileName, size, "%s", imageFile);
+  char *extension = strrchr(fileName, '.');
+  if (extension != NULL && strchr(extension, '/') == NULL)
+    *extension = '\0';
+  size_t length = strlen(fileName);
+  snprintf(fileName + length, size - length, ".idx");
+}
+
+static void putShort(uint8_t *out, int value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+}
+
+static int getShort(const uint8_t *in) { return in[0] | in[1] << 8; }
+
+int iconIndexBuild(const char *imageFile, int nbIcons) {
+  SDL_RWops *source = assetOpenRW(imageFile);
+  SDL_Surface *image = NULL,
+              *loaded = source != NULL ? IMG_Load_RW(source, 1) : NULL;
+  if (loaded != NULL) {
+    image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+  }
+  if (image == NULL) {
+    printf("SDL: Echec du chargement de l'image '%s'.\n", imageFile);
+    return 0;
+  }
+  int columns = image->w / ICON_SIZE;
+  int cells = columns * (image->h / ICON_SIZE);
+  if (nbIcons <= 0 || nbIcons > cells)
+    nbIcons = cells;
+
+  // Signatures de toutes les icônes
+  IconSignature *signatures = malloc(nbIcons * sizeof(IconSignature));
+  if (signatures == NULL) {
+    SDL_FreeSurface(image);
+    return 0;
+  }
+  int64_t start = clockNow();
+  for (int i = 0; i < nbIcons; i++) {
+    const uint8_t *pixels = (const uint8_t *)image->pixels +
+                            i / columns * ICON_SIZE * image->pitch +
+                            i % columns * ICON_SIZE * 4;
+    iconIndexDescribe(pixels, image->pitch, &signatures[i]);
+  }
+  int64_t described = clockNow();
+  SDL_FreeSurface(image);
+
+  // Plus proches voisins de chaque icône, puis écriture de l'index dans le
+  // dossier de données sur disque
+  char fileName[256], path[512];
+  indexFileName(imageFile, fileName, sizeof(fileName));
+  FILE *file = assetPath(fileName, path, sizeof(path)) ? fopen(path, "wb")
+                                                       : NULL;
+  if (file == NULL) {
+    printf("dobble: Impossible de créer l'index '%s' (voir --data).\n",
+           fileName);
+    free(signatures);
+    return 0;
+  }
+  uint8_t header[7] = {'D', 'O', 'B', 'I', ICON_INDEX_VERSION};
+  putShort(header + 5, nbIcons);
+  fwrite(header, 1, sizeof(header), file);
+
+  int nbConfusable = 0;
+  for (int i = 0; i < nbIcons; i++) {
+    int neighbours[ICON_INDEX_NEIGHBOURS], distances[ICON_INDEX_NEIGHBOURS];
+    int nbNeighbours = 0;
+    for (int j = 0; j < nbIcons; j++) {
+      if (j == i)
+        continue;
+      int d = iconIndexDistance(&signatures[i], &signatures[j]);
+      if (nbNeighbours == ICON_INDEX_NEIGHBOURS &&
+          d >= distances[nbNeighbours - 1])
+        continue;
+      // Insertion dans la liste triée des voisins
+      int k = nbNeighbours < ICON_INDEX_NEIGHBOURS ? nbNeighbours++
+                                                   : nbNeighbours - 1;
+      for (; k > 0 && distances[k - 1] > d; k--) {
+        neighbours[k] = neighbours[k - 1];
+        distances[k] = distances[k - 1];
+      }
+      neighbours[k] = j;
+      distances[k] = d;
+    }
+
+    uint8_t record[ICON_INDEX_RECORD] = {0};
+    memcpy(record, &signatures[i], sizeof(IconSignature));
+    for (int k = 0; k < ICON_INDEX_NEIGHBOURS; k++) {
+      uint8_t *out = record + sizeof(IconSignature) + 4 * k;
+      putShort(out, k < nbNeighbours ? neighbours[k] : 0xFFFF);
+      putShort(out + 2, k < nbNeighbours ? distances[k] : 0xFFFF);
+      if (k < nbNeighbours && distances[k] <= ICON_INDEX_CONFUSABLE &&
+          neighbours[k] > i)
+        nbConfusable++;
+    }
+    fwrite(record, 1, sizeof(record), file);
+  }
+  bool written = ferror(file) == 0;
+  written = fclose(file) == 0 && written;
+  free(signatures);
+
+  printf("dobble: %d icônes de '%s' analysées en %.1f ms, %d paires "
+         "confondables, index écrit dans '%s'.\n",
+         nbIcons, imageFile, (described - start) / 1000., nbConfusable,
+         fileName);
+  return written;
+}
+
+/****************** UTILISATION ******************/
+
+/**
+ * Ajoute une icône confondable à la liste d'une icône.
+ */
+static void addConfusable(int a, int b) {
+  for (int k = 0; k < ix.count[a]; k++) {
+    if (ix.confusables[a][k] == b)
+      return;
+  }
+  if (ix.count[a] < ICON_INDEX_MAX_CONFUSABLES)
+    ix.confusables[a][ix.count[a]++] = b;
+}
+
+/**
+ * Charge l'index d'un pack dont la première icône a l'identifiant first.
+ */
+static void loadIndex(const char *imageFile, int nbIcons, int first) {
+  char fileName[256];
+  indexFileName(imageFile, fileName, sizeof(fileName));
+  FILE *file = assetOpen(fileName, "rb");
+  if (file == NULL) {
+    printf("dobble: Pas d'index de similarité pour '%s' (voir "
+           "--analyze-icons).\n",
+           imageFile);
+    return;
+  }
+
+  uint8_t header[7];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+      memcmp(header, "DOBI", 4) != 0 || header[4] != ICON_INDEX_VERSION ||
+      getShort(header + 5) != nbIcons) {
+    printf("dobble: Index de similarité '%s' invalide ou périmé.\n", fileName);
+    fclose(file);
+    return;
+  }
+
+  uint8_t record[ICON_INDEX_RECORD];
+  for (int i = 0; i < nbIcons; i++) {
+    if (fread(record, 1, sizeof(record), file) != sizeof(record))
+      break;
+    for (int k = 0; k < ICON_INDEX_NEIGHBOURS; k++) {
+      const uint8_t *in = record + sizeof(IconSignature) + 4 * k;
+      int neighbour = getShort(in), distance = getShort(in + 2);
+      if (neighbour >= nbIcons || distance > ICON_INDEX_CONFUSABLE)
+        break;
+      addConfusable(first + i, first + neighbour);
+      addConfusable(first + neighbour, first + i);
+    }
+  }
+  fclose(file);
+}
+
+void iconIndexUse(const char *const *imageFiles, const int *nbIcons,
+                  int count) {
+  memset(&ix, 0, sizeof(ix));
+  int first = 0;
+  for (int i = 0; i < count; i++) {
+    if (first + nbIcons[i] > ICON_INDEX_MAX_ICONS)
+      break;
+    loadIndex(imageFiles[i], nbIcons[i], first);
+    first += nbIcons[i];
+  }
+}
+
+const uint16_t *iconIndexConfusables(int iconId, int *count) {
+  bool valid = iconId >= 0 && iconId < ICON_INDEX_MAX_ICONS;
+  *count = valid ? ix.count[iconId] : 0;
+  return valid ? ix.confusables[iconId] : NULL;
+}
+
+bool iconIndexConfusable(int a, int b) {
+  int count;
+  const uint16_t *confusables = iconIndexConfusables(a, &count);
+  for (int k = 0; k < count; k++) {
+    if (confusables[k] == b)
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,275 @@
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "dobble.h"
+#include "iconindex.h"
+#include "iconmap.h"
+
+/**
+ * État du choix des icônes.
+ */
+static struct IconMap {
+  IconMapMode mode;
+
+  // Liste d'icônes choisies à la main (mode ICON_MAP_CURATED)
+  int list[ICON_MAP_MAX_SYMBOLS];
+  int listSize;
+
+  // Correspondance de la partie : icône de chaque symbole
+  int table[ICON_MAP_MAX_SYMBOLS];
+  int size;
+
+  // Nombre de cartes dessinées avec chaque icône pendant la session, remis à
+  // zéro lorsque le jeu d'icônes change
+  int uses[ICON_MAP_MAX_SYMBOLS];
+  int usesPackMask;
+} im = {.mode = ICON_MAP_RANDOM};
+
+void iconMapSetMode(IconMapMode mode) { im.mode = mode; }
+
+int iconMapLoadList(const char *fileName) {
+  FILE *file = fopen(fileName, "r");
+  if (file == NULL) {
+    printf("dobble: Impossible d'ouvrir la liste d'icônes '%s'.\n", fileName);
+    return 0;
+  }
+  im.listSize = 0;
+  int iconId;
+  while (im.listSize < ICON_MAP_MAX_SYMBOLS &&
+         fscanf(file, "%d", &iconId) == 1) {
+    if (iconId >= 0 && iconId < ICON_MAP_MAX_SYMBOLS)
+      im.list[im.listSize++] = iconId;
+  }
+  fclose(file);
+  im.mode = ICON_MAP_CURATED;
+  return 1;
+}
+
+/**
+ * Écrit l'icône de chaque symbole dans les cartes du deck. Les symboles hors
+ * de la correspondance sont dessinés avec l'icône de même numéro.
+ */
+static void applyTable() {
+  for (int i = 0; i < gameGlobal.nbCards; i++) {
+    for (int j = 0; j < gameGlobal.nbIcons; j++) {
+      Icon *icon = &gameGlobal.cards[i].icons[j];
+      icon->imageId = icon->iconId >= 0 && icon->iconId < im.size
+                          ? im.table[icon->iconId]
+                          : icon->iconId;
+    }
+  }
+}
+
+/**
+ * Marque les icônes confondables avec une icône choisie.
+ */
+static void blockConfusables(bool *blocked, int icon) {
+  int count;
+  const uint16_t *confusables = iconIndexConfusables(icon, &count);
+  for (int k = 0; k < count; k++) {
+    if (confusables[k] < ICON_MAP_MAX_SYMBOLS)
+      blocked[confusables[k]] = true;
+  }
+}
+
+/**
+ * Complète une sélection d'icônes avec les icônes les moins utilisées (à
+ * égalité, dans un ordre aléatoire). Les icônes confondables avec une icône
+ * de la sélection ne sont prises qu'en dernier recours.
+ *
+ * @param chosen   La sélection
+ * @param nbChosen Le nombre d'icônes déjà sélectionnées
+ * @param count    Le nombre d'icônes à sélectionner
+ * @param nbIcons  Le nombre d'icônes du jeu d'icônes
+ */
+static void pickLeastUsed(int *chosen, int nbChosen, int count, int nbIcons) {
+  bool taken[ICON_MAP_MAX_SYMBOLS] = {false};
+  bool blocked[ICON_MAP_MAX_SYMBOLS] = {false};
+  for (int i = 0; i < nbChosen; i++) {
+    taken[chosen[i]] = true;
+    blockConfusables(blocked, chosen[i]);
+  }
+
+  // Mélange des icônes libres puis tri stable par nombre d'utilisations
+  int candidates[ICON_MAP_MAX_SYMBOLS], nbCandidates = 0;
+  for (int i = 0; i < nbIcons; i++) {
+    if (!taken[i]) {
+      int j = randomInt(nbCandidates + 1);
+      candidates[nbCandidates++] = candidates[j];
+      candidates[j] = i;
+    }
+  }
+  for (int i = 1; i < nbCandidates; i++) {
+    int icon = candidates[i], j = i - 1;
+    for (; j >= 0 && im.uses[candidates[j]] > im.uses[icon]; j--)
+      candidates[j + 1] = candidates[j];
+    candidates[j + 1] = icon;
+  }
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; nbChosen < count && i < nbCandidates; i++) {
+      int icon = candidates[i];
+      if (taken[icon] || (pass == 0 && blocked[icon]))
+        continue;
+      chosen[nbChosen++] = icon;
+      taken[icon] = true;
+      blockConfusables(blocked, icon);
+    }
+  }
+}
+
+/**
+ * Distance entre les descripteurs de deux icônes : écart de couleur moyenne,
+ * de surface couverte et de répartition de l'opacité.
+ */
+static float descriptorDistance(const IconDescriptor *a,
+                                 const IconDescriptor *b) {
+  float color = 0, shape = 0;
+  for (int c = 0; c < 3; c++)
+    color += (a->color[c] - b->color[c]) * (a->color[c] - b->color[c]);
+  for (int z = 0; z < ICON_SHAPE_GRID * ICON_SHAPE_GRID; z++)
+    shape += (a->shape[z] - b->shape[z]) * (a->shape[z] - b->shape[z]);
+  float coverage = a->coverage - b->coverage;
+  return color + shape / (ICON_SHAPE_GRID * ICON_SHAPE_GRID) +
+         coverage * coverage;
+}
+
+/**
+ * Sélectionne des icônes aussi différentes que possible parmi les moins
+ * utilisées (au moins la moitié du jeu d'icônes, pour varier d'une partie à
+ * l'autre) : la première est la moins utilisée, chaque suivante est la plus
+ * éloignée des icônes déjà choisies, hors icônes confondables si possible.
+ *
+ * @return 1 si la sélection a été faite, 0 si les descripteurs des icônes ne
+ *         sont pas disponibles
+ */
+static int pickDistinct(int *chosen, int count, int nbIcons) {
+  int pool[ICON_MAP_MAX_SYMBOLS];
+  int poolSize = 2 * count > nbIcons / 2 ? 2 * count : nbIcons / 2;
+  if (poolSize > nbIcons)
+    poolSize = nbIcons;
+  pickLeastUsed(pool, 0, poolSize, nbIcons);
+
+  IconDescriptor descriptors[ICON_MAP_MAX_SYMBOLS];
+  float nearest[ICON_MAP_MAX_SYMBOLS];
+  for (int i = 0; i < poolSize; i++) {
+    if (!atlasIconDescriptor(pool[i], &descriptors[i]))
+      return 0;
+    nearest[i] = FLT_MAX;
+  }
+
+  // pool[0], l'une des moins utilisées, est choisie en premier ; chaque icône
+  // choisie est retirée du pool en l'échangeant avec la dernière
+  bool blocked[ICON_MAP_MAX_SYMBOLS] = {false};
+  for (int n = 0; n < count; n++) {
+    int best = n > 0 ? -1 : 0;
+    for (int pass = 0; pass < 2 && best < 0; pass++) {
+      for (int i = 0; i < poolSize; i++) {
+        if ((pass == 0 && blocked[pool[i]]) ||
+            (best >= 0 && nearest[i] <= nearest[best]))
+          continue;
+        best = i;
+      }
+    }
+    chosen[n] = pool[best];
+    blockConfusables(blocked, pool[best]);
+    IconDescriptor last = descriptors[best];
+    poolSize--;
+    pool[best] = pool[poolSize];
+    descriptors[best] = descriptors[poolSize];
+    nearest[best] = nearest[poolSize];
+    for (int i = 0; i < poolSize; i++) {
+      float d = descriptorDistance(&descriptors[i], &last);
+      if (d < nearest[i])
+        nearest[i] = d;
+    }
+  }
+  return 1;
+}
+
+void iconMapBuild() {
+  // Symboles du deck et nombre de cartes portant chacun d'eux
+  int frequency[ICON_MAP_MAX_SYMBOLS] = {0}, nbSymbols = 0;
+  for (int i = 0; i < gameGlobal.nbCards; i++) {
+    for (int j = 0; j < gameGlobal.nbIcons; j++) {
+      int symbol = gameGlobal.cards[i].icons[j].iconId;
+      if (symbol >= 0 && symbol < ICON_MAP_MAX_SYMBOLS) {
+        frequency[symbol]++;
+        if (symbol >= nbSymbols)
+          nbSymbols = symbol + 1;
+      }
+    }
+  }
+  int nbIcons = atlasIconCount();
+  if (nbIcons > ICON_MAP_MAX_SYMBOLS)
+    nbIcons = ICON_MAP_MAX_SYMBOLS;
+  if (im.usesPackMask != gameGlobal.packMask) {
+    memset(im.uses, 0, sizeof(im.uses));
+    im.usesPackMask = gameGlobal.packMask;
+  }
+
+  // Symboles par nombre de cartes décroissant (tri stable)
+  int order[ICON_MAP_MAX_SYMBOLS];
+  for (int s = 0; s < nbSymbols; s++) {
+    int j = s - 1;
+    for (; j >= 0 && frequency[order[j]] < frequency[s]; j--)
+      order[j + 1] = order[j];
+    order[j + 1] = s;
+  }
+
+  // Sélection des icônes, une par symbole tant que le jeu d'icônes suffit
+  int chosen[ICON_MAP_MAX_SYMBOLS], count = 0;
+  int needed = nbSymbols < nbIcons ? nbSymbols : nbIcons;
+  switch (im.mode) {
+  case ICON_MAP_IDENTITY:
+    for (; count < needed; count++)
+      chosen[count] = order[count];
+    break;
+  case ICON_MAP_CURATED: {
+    bool taken[ICON_MAP_MAX_SYMBOLS] = {false};
+    for (int i = 0; i < im.listSize && count < needed; i++) {
+      if (im.list[i] < nbIcons && !taken[im.list[i]]) {
+        taken[im.list[i]] = true;
+        chosen[count++] = im.list[i];
+      }
+    }
+    pickLeastUsed(chosen, count, needed, nbIcons);
+    count = needed;
+    break;
+  }
+  case ICON_MAP_DISTINCT:
+    if (pickDistinct(chosen, needed, nbIcons)) {
+      count = needed;
+      break;
+    }
+    // Pas de descripteurs (pack non chargé) : tirage parmi les moins utilisées
+    // fall through
+  case ICON_MAP_RANDOM:
+    pickLeastUsed(chosen, 0, needed, nbIcons);
+    count = needed;
+    break;
+  }
+
+  im.size = nbSymbols;
+  for (int s = 0; s < nbSymbols; s++)
+    im.table[s] = s;
+  for (int i = 0; i < count; i++) {
+    im.table[order[i]] = chosen[i];
+    im.uses[chosen[i]] += frequency[order[i]];
+  }
+  applyTable();
+}
+
+void iconMapSet(const int *table, int size) {
+  im.size = size < ICON_MAP_MAX_SYMBOLS ? size : ICON_MAP_MAX_SYMBOLS;
+  memcpy(im.table, table, im.size * sizeof(int));
+  applyTable();
+}
+
+const int *iconMapTable(int *size) {
+  *size = im.size;
+  return im.table;
+}
@@ -0,0 +1,300 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+#include "decksearch.h"
+#include "dobble.h"
+#include "kernels.h"
+#include "packs.h"
+
+/* Nombre de paires de cartes tirées pour les mesures */
+#define BENCH_PAIRS 1024
+
+/*
+ * Répétition d'une macro m(i, a) pour i de 0 à n - 1. Les macros répétées
+ * dans une macro répétée utilisent INNER_n : le préprocesseur ne développe pas
+ * une macro dans son propre développement.
+ */
+#define REPEAT_1(m, a) m(0, a)
+#define REPEAT_2(m, a) REPEAT_1(m, a) m(1, a)
+#define REPEAT_3(m, a) REPEAT_2(m, a) m(2, a)
+#define REPEAT_4(m, a) REPEAT_3(m, a) m(3, a)
+#define REPEAT_5(m, a) REPEAT_4(m, a) m(4, a)
+#define REPEAT_6(m, a) REPEAT_5(m, a) m(5, a)
+#define REPEAT_7(m, a) REPEAT_6(m, a) m(6, a)
+#define REPEAT_8(m, a) REPEAT_7(m, a) m(7, a)
+#define REPEAT_9(m, a) REPEAT_8(m, a) m(8, a)
+#define REPEAT_10(m, a) REPEAT_9(m, a) m(9, a)
+
+#define INNER_3(m, a) m(0, a) m(1, a) m(2, a)
+#define INNER_4(m, a) INNER_3(m, a) m(3, a)
+#define INNER_5(m, a) INNER_4(m, a) m(4, a)
+#define INNER_6(m, a) INNER_5(m, a) m(5, a)
+#define INNER_8(m, a) INNER_6(m, a) m(6, a) m(7, a)
+#define INNER_9(m, a) INNER_8(m, a) m(8, a)
+#define INNER_10(m, a) INNER_9(m, a) m(9, a)
+
+/* Garde l'indice i si match vaut 1 (index inchangé si match vaut 0) */
+#define KEEP_IF(index, i, match) (index) ^= ((index) ^ (i)) & -(match);
+
+/* Icône commune par comparaison de l'icône i de upper aux K icônes de lower
+ * (ou bit à bit des comparaisons), pour quelques icônes par carte */
+#define MATCH_TERM(j, symbol) | ((symbol) == lower[j].iconId)
+#define COMPARE_ROW(i, K)                                                      \
+  KEEP_IF(index, i, 0 INNER_##K(MATCH_TERM, upper[i].iconId))
+#define COMMON_BY_COMPARE(K) REPEAT_##K(COMPARE_ROW, K)
+
+/* Icône commune par ensemble des symboles de lower, puis test du symbole de
+ * chaque icône de upper : 2K opérations au lieu de K² comparaisons (les
+ * symboles d'un deck chargé sont inférieurs à DECK_MAX_SYMBOLS) */
+#define SYMBOL_BIT(symbol) (1ull << ((symbol) & 63))
+#define ADD_SYMBOL(j, K)                                                       \
+  symbols[lower[j].iconId >> 6] |= SYMBOL_BIT(lower[j].iconId);
+#define SET_ROW(i, K)                                                          \
+  KEEP_IF(index, i,                                                            \
+          (symbols[upper[i].iconId >> 6] & SYMBOL_BIT(upper[i].iconId)) != 0)
+#define COMMON_BY_SET(K)                                                       \
+  uint64_t symbols[DECK_WORDS] = {0};                                          \
+  REPEAT_##K(ADD_SYMBOL, K)                                                    \
+  REPEAT_##K(SET_ROW, K)
+
+#define FIND_ROW(i, K) KEEP_IF(index, i, icons[i].iconId == symbol)
+
+/* Rang de l'icône i : nombre d'icônes de numéro inférieur */
+#define RANK_TERM(j, symbol) +((symbol) > icons[j].iconId)
+#define RANK_ROW(i, K)                                                         \
+  sorted[0 INNER_##K(RANK_TERM, icons[i].iconId)] = icons[i];
+
+/* Échanges du mélange, de la dernière icône à la deuxième */
+#define SHUFFLE_STEP(n, K) swapIcons(icons, K - 1 - n, randomInt(K - 1 - n));
+
+/* Icônes placées en cercle, à intervalle régulier depuis l'angle offset */
+#define PLACE_STEP(n, K)                                                       \
+  initIcon(&icons[n], (offset + n * (360 / (K - 1))) % 360);
+
+/**
+ * Noyaux d'un nombre d'icônes par carte K (KM1 = K - 1), l'icône commune
+ * étant cherchée par COMMON_BY_COMPARE ou COMMON_BY_SET (COMMON).
+ */
+#define DEFINE_KERNELS(K, KM1, COMMON)                                         \
+  static int commonIcon##K(const Icon *upper, const Icon *lower) {             \
+    int index = -1;                                                            \
+    COMMON(K)                                                                  \
+    return index;                                                              \
+  }                                                                            \
+                                                                               \
+  static int findSymbol##K(const Icon *icons, int symbol) {                    \
+    int index = -1;                                                            \
+    REPEAT_##K(FIND_ROW, K)                                                    \
+    return index;                                                              \
+  }                                                                            \
+                                                                               \
+  static void sortIcons##K(Icon *icons) {                                      \
+    Icon sorted[K];                                                            \
+    REPEAT_##K(RANK_ROW, K)                                                    \
+    memcpy(icons, sorted, sizeof(sorted));                                     \
+  }                                                                            \
+                                                                               \
+  static void shuffle##K(Icon *icons) {                                        \
+    REPEAT_##KM1(SHUFFLE_STEP, K)                                              \
+  }                                                                            \
+                                                                               \
+  static void placeIcons##K(Icon *icons) {                                     \
+    int offset = randomInt(360);                                               \
+    REPEAT_##KM1(PLACE_STEP, K)                                                \
+    initIcon(&icons[KM1], 0.);                                                 \
+    icons[KM1].radius = 0;                                                     \
+    icons[KM1].scale = 1;                                                      \
+  }
+
+#define KERNELS(K)                                                             \
+  [K] = {K, commonIcon##K, findSymbol##K, sortIcons##K, shuffle##K,            \
+         placeIcons##K}
+
+/**
+ * Échange deux icônes d'une carte.
+ */
+static inline void swapIcons(Icon *icons, int i, int j) {
+  Icon tmp = icons[i];
+  icons[i] = icons[j];
+  icons[j] = tmp;
+}
+
+// Pas de deck de 7 icônes par carte : il n'existe pas de plan projectif
+// d'ordre 6. L'ensemble des symboles ne coûte moins que les comparaisons
+// qu'à partir de 5 icônes par carte (voir --bench)
+DEFINE_KERNELS(3, 2, COMMON_BY_COMPARE)
+DEFINE_KERNELS(4, 3, COMMON_BY_COMPARE)
+DEFINE_KERNELS(5, 4, COMMON_BY_SET)
+DEFINE_KERNELS(6, 5, COMMON_BY_SET)
+DEFINE_KERNELS(8, 7, COMMON_BY_SET)
+DEFINE_KERNELS(9, 8, COMMON_BY_SET)
+DEFINE_KERNELS(10, 9, COMMON_BY_SET)
+
+static int commonIconGeneric(const Icon *upper, const Icon *lower) {
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    for (int j = 0; j < gameGlobal.nbIcons; j++) {
+      if (upper[i].iconId == lower[j].iconId)
+        return i;
+    }
+  }
+  return -1;
+}
+
+static int findSymbolGeneric(const Icon *icons, int symbol) {
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    if (icons[i].iconId == symbol)
+      return i;
+  }
+  return -1;
+}
+
+static void sortIconsGeneric(Icon *icons) {
+  sortIcons(icons, gameGlobal.nbIcons);
+}
+
+static void shuffleGeneric(Icon *icons) { shuffle(icons, gameGlobal.nbIcons); }
+
+static void placeIconsGeneric(Icon *icons) { initCardIcons((Card){icons}); }
+
+static const CardKernels generic = {0, commonIconGeneric, findSymbolGeneric,
+                                    sortIconsGeneric, shuffleGeneric,
+                                    placeIconsGeneric};
+
+/**
+ * Table des noyaux générés, indexée par le nombre d'icônes par carte (les
+ * entrées vides renvoient aux noyaux génériques).
+ */
+static const CardKernels table[DECKS_MAX_ICONS + 1] = {
+    KERNELS(3), KERNELS(4), KERNELS(5),  KERNELS(6),
+    KERNELS(8), KERNELS(9), KERNELS(10),
+};
+
+/**
+ * Noyaux du deck courant.
+ */
+static const CardKernels *current = &generic;
+
+/**
+ * Retourne les noyaux d'un nombre d'icônes par carte.
+ */
+static const CardKernels *kernelsFor(int nbIcons) {
+  if (nbIcons < 0 || nbIcons > DECKS_MAX_ICONS || table[nbIcons].nbIcons == 0)
+    return &generic;
+  return &table[nbIcons];
+}
+
+void cardKernelsUse(int nbIcons) { current = kernelsFor(nbIcons); }
+
+const CardKernels *cardKernels() { return current; }
+
+/* Résultats des noyaux mesurés, gardés pour que les appels aient lieu */
+static volatile int sink;
+
+/**
+ * Mesure d'un noyau sur des paires de cartes.
+ *
+ * @param  kernels Les noyaux
+ * @param  nbIcons Le nombre d'icônes par carte
+ * @param  pairs   Les paires de cartes
+ * @return         La durée d'un appel (en nanosecondes)
+ */
+typedef double (*BenchPass)(const CardKernels *kernels, int nbIcons,
+                            Icon (*pairs)[2][DECKS_MAX_ICONS]);
+
+/**
+ * Mesure la recherche de l'icône commune aux paires.
+ */
+static double benchCommon(const CardKernels *kernels, int nbIcons,
+                          Icon (*pairs)[2][DECKS_MAX_ICONS]) {
+  (void)nbIcons;
+  int64_t start = clockNow();
+  for (int n = 0; n < KERNELS_BENCH_ITERATIONS; n++) {
+    Icon(*pair)[DECKS_MAX_ICONS] = pairs[n % BENCH_PAIRS];
+    sink += kernels->commonIcon(pair[0], pair[1]);
+  }
+  return (clockNow() - start) * 1000. / KERNELS_BENCH_ITERATIONS;
+}
+
+/**
+ * Mesure la recherche d'un symbole de la carte du bas sur la carte du haut.
+ */
+static double benchFind(const CardKernels *kernels, int nbIcons,
+                        Icon (*pairs)[2][DECKS_MAX_ICONS]) {
+  int64_t start = clockNow();
+  for (int n = 0; n < KERNELS_BENCH_ITERATIONS; n++) {
+    Icon(*pair)[DECKS_MAX_ICONS] = pairs[n % BENCH_PAIRS];
+    sink += kernels->findSymbol(pair[0], pair[1][n % nbIcons].iconId);
+  }
+  return (clockNow() - start) * 1000. / KERNELS_BENCH_ITERATIONS;
+}
+
+/**
+ * Mesure la distribution d'une carte : tri, mélange et placement des icônes
+ * (comme pour chaque carte d'une paire distribuée).
+ */
+static double benchDeal(const CardKernels *kernels, int nbIcons,
+                        Icon (*pairs)[2][DECKS_MAX_ICONS]) {
+  Icon icons[DECKS_MAX_ICONS];
+  int64_t start = clockNow();
+  for (int n = 0; n < KERNELS_BENCH_ITERATIONS; n++) {
+    memcpy(icons, pairs[n % BENCH_PAIRS][0], nbIcons * sizeof(Icon));
+    kernels->sortIcons(icons);
+    kernels->shuffle(icons);
+    kernels->placeIcons(icons);
+    sink += icons[0].iconId;
+  }
+  return (clockNow() - start) * 1000. / KERNELS_BENCH_ITERATIONS;
+}
+
+/**
+ * Mesure un noyau générique et le noyau généré correspondant en alternance,
+ * KERNELS_BENCH_ROUNDS fois, et affiche les meilleures durées (les moins
+ * perturbées par le reste du système).
+ */
+static void bench(const char *name, BenchPass pass, int nbIcons,
+                  Icon (*pairs)[2][DECKS_MAX_ICONS]) {
+  double genericNs = 0, generatedNs = 0;
+  for (int round = 0; round < KERNELS_BENCH_ROUNDS; round++) {
+    double ns = pass(&generic, nbIcons, pairs);
+    if (round == 0 || ns < genericNs)
+      genericNs = ns;
+    ns = pass(&table[nbIcons], nbIcons, pairs);
+    if (round == 0 || ns < generatedNs)
+      generatedNs = ns;
+  }
+  printf("%7d  %-12s %9.1f ns %9.1f ns  x%.2f\n", nbIcons, name, genericNs,
+         generatedNs, generatedNs > 0 ? genericNs / generatedNs : 0.);
+}
+
+int cardKernelsBench() {
+  static Icon pairs[BENCH_PAIRS][2][DECKS_MAX_ICONS];
+  seedRandom(1);
+  printf("%7s  %-12s %12s %12s  %s\n", "icônes", "noyau", "générique",
+         "généré", "gain");
+  for (int k = 0; k <= DECKS_MAX_ICONS; k++) {
+    if (table[k].nbIcons == 0)
+      continue;
+    gameGlobal.nbIcons = k;
+
+    // Paires de cartes de symboles 0 à 2k - 2, avec un seul symbole commun,
+    // dans le désordre
+    for (int p = 0; p < BENCH_PAIRS; p++) {
+      memset(pairs[p], 0, sizeof(pairs[p]));
+      int common = randomInt(k);
+      for (int i = 0; i < k; i++) {
+        pairs[p][0][i].iconId = i;
+        pairs[p][1][i].iconId = i == 0 ? common : k + i - 1;
+      }
+      shuffle(pairs[p][0], k);
+      shuffle(pairs[p][1], k);
+    }
+
+    bench("appariement", benchCommon, k, pairs);
+    bench("recherche", benchFind, k, pairs);
+    bench("distribution", benchDeal, k, pairs);
+  }
+  return 0;
+}
@@ -0,0 +1,240 @@
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "dobble.h"
+#include "kernels.h"
+#include "net.h"
+#include "packs.h"
+
+/**
+ * Tampon d'un message en cours d'encodage ou de décodage.
+ */
+typedef struct {
+  uint8_t *data;
+  int size; // capacité (encodage) ou taille du message (décodage)
+  int pos;
+  bool error;
+} NetBuffer;
+
+/****************** ENCODAGE ******************/
+
+static void putByte(NetBuffer *buffer, uint8_t byte) {
+  if (buffer->pos >= buffer->size) {
+    buffer->error = true;
+    return;
+  }
+  buffer->data[buffer->pos++] = byte;
+}
+
+/**
+ * Ajoute un entier non signé encodé en varint (7 bits par octet).
+ */
+static void putVarint(NetBuffer *buffer, uint64_t value) {
+  while (value >= 0x80) {
+    putByte(buffer, (uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  putByte(buffer, (uint8_t)value);
+}
+
+/**
+ * Ajoute un entier signé encodé en zigzag puis en varint.
+ */
+static void putSigned(NetBuffer *buffer, int64_t value) {
+  putVarint(buffer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/**
+ * Lit un entier encodé en varint (0 et erreur si le message est tronqué).
+ */
+static uint64_t getVarint(NetBuffer *buffer) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (buffer->pos >= buffer->size)
+      break;
+    uint8_t byte = buffer->data[buffer->pos++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  buffer->error = true;
+  return 0;
+}
+
+static int64_t getSigned(NetBuffer *buffer) {
+  uint64_t zigzag = getVarint(buffer);
+  return (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+}
+
+int netEncode(const NetMessage *msg, uint8_t *buf) {
+  NetBuffer buffer = {buf, NET_MAX_PACKET, 0, false};
+  putByte(&buffer, NET_PROTOCOL_VERSION);
+  putByte(&buffer, (uint8_t)msg->type);
+
+  switch (msg->type) {
+  case NET_HELLO:
+  case NET_READY:
+  case NET_BYE:
+    break;
+  case NET_WELCOME:
+    putVarint(&buffer, msg->player);
+    putVarint(&buffer, msg->nbIcons);
+    putVarint(&buffer, msg->packMask);
+    break;
+  case NET_SYNC:
+    putSigned(&buffer, msg->t0);
+    putVarint(&buffer, msg->rttMs);
+    break;
+  case NET_SYNC_REPLY:
+    putSigned(&buffer, msg->t0);
+    putSigned(&buffer, msg->t1);
+    putSigned(&buffer, msg->t2);
+    break;
+  case NET_STATE:
+    putVarint(&buffer, msg->phase);
+    putVarint(&buffer, msg->round);
+    putVarint(&buffer, msg->seq);
+    putVarint(&buffer, msg->upper);
+    putVarint(&buffer, msg->lower);
+    putSigned(&buffer, msg->deadline);
+    putSigned(&buffer, msg->lastWinner);
+    putVarint(&buffer, msg->nbPlayers);
+    for (int p = 0; p < msg->nbPlayers && p < NET_MAX_PLAYERS; p++)
+      putVarint(&buffer, msg->scores[p]);
+    break;
+  case NET_CLAIM:
+    putVarint(&buffer, msg->seq);
+    putSigned(&buffer, msg->iconId);
+    putSigned(&buffer, msg->shownAt);
+    putSigned(&buffer, msg->at);
+    break;
+  default:
+    return 0;
+  }
+  return buffer.error ? 0 : buffer.pos;
+}
+
+int netDecode(const uint8_t *buf, int len, NetMessage *msg) {
+  NetBuffer buffer = {(uint8_t *)buf, len, 2, false};
+  if (len < 2 || buf[0] != NET_PROTOCOL_VERSION)
+    return 0;
+  memset(msg, 0, sizeof(NetMessage));
+  msg->type = buf[1];
+
+  switch (msg->type) {
+  case NET_HELLO:
+  case NET_READY:
+  case NET_BYE:
+    break;
+  case NET_WELCOME:
+    msg->player = (int)getVarint(&buffer);
+    msg->nbIcons = (int)getVarint(&buffer);
+    msg->packMask = (int)getVarint(&buffer);
+    if (msg->player < 0 || msg->player >= NET_MAX_PLAYERS ||
+        msg->nbIcons < 2 || msg->nbIcons > DECKS_MAX_ICONS ||
+        msg->packMask <= 0)
+      return 0;
+    break;
+  case NET_SYNC:
+    msg->t0 = getSigned(&buffer);
+    msg->rttMs = (int)getVarint(&buffer);
+    if (msg->rttMs < 0)
+      return 0;
+    break;
+  case NET_SYNC_REPLY:
+    msg->t0 = getSigned(&buffer);
+    msg->t1 = getSigned(&buffer);
+    msg->t2 = getSigned(&buffer);
+    break;
+  case NET_STATE:
+    msg->phase = (NetPhase)getVarint(&buffer);
+    msg->round = (int)getVarint(&buffer);
+    msg->seq = (uint32_t)getVarint(&buffer);
+    msg->upper = (int)getVarint(&buffer);
+    msg->lower = (int)getVarint(&buffer);
+    msg->deadline = getSigned(&buffer);
+    msg->lastWinner = (int)getSigned(&buffer);
+    msg->nbPlayers = (int)getVarint(&buffer);
+    if (msg->nbPlayers > NET_MAX_PLAYERS || msg->phase > NET_ENDED)
+      return 0;
+    // Cartes de la paire : le nombre de cartes du deck est vérifié par le
+    // client, qui seul l'utilise
+    if (msg->upper < 0 || msg->lower < 0 ||
+        (msg->phase == NET_PLAYING && msg->upper == msg->lower))
+      return 0;
+    for (int p = 0; p < msg->nbPlayers; p++)
+      msg->scores[p] = (int)getVarint(&buffer);
+    break;
+  case NET_CLAIM:
+    msg->seq = (uint32_t)getVarint(&buffer);
+    msg->iconId = (int)getSigned(&buffer);
+    msg->shownAt = getSigned(&buffer);
+    msg->at = getSigned(&buffer);
+    break;
+  default:
+    return 0;
+  }
+  return !buffer.error;
+}
+
+/****************** SOCKETS ******************/
+
+int netOpenSocket(int port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    perror("dobble: socket");
+    return -1;
+  }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons((uint16_t)port);
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    perror("dobble: bind");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int netResolve(const char *address, void *out) {
+  char host[256];
+  int port = NET_DEFAULT_PORT;
+
+  // Séparation de l'hôte et du port
+  snprintf(host, sizeof(host), "%s", address);
+  char *colon = strrchr(host, ':');
+  if (colon != NULL) {
+    *colon = '\0';
+    port = atoi(colon + 1);
+  }
+  if (port <= 0 || port > 65535)
+    return 0;
+
+  struct addrinfo hints, *result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host[0] ? host : "127.0.0.1", NULL, &hints, &result) != 0)
+    return 0;
+  struct sockaddr_in *resolved = out;
+  memcpy(resolved, result->ai_addr, sizeof(struct sockaddr_in));
+  resolved->sin_port = htons((uint16_t)port);
+  freeaddrinfo(result);
+  return 1;
+}
+
+int netCommonIcon(int upper, int lower) {
+  Card a = gameGlobal.cards[upper], b = gameGlobal.cards[lower];
+  int i = cardKernels()->commonIcon(a.icons, b.icons);
+  return i >= 0 ? a.icons[i].iconId : -1;
+}
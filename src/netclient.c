@@ -0,0 +1,488 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "clock.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "iconmap.h"
+#include "net.h"
+#include "packs.h"
+#include "stats.h"
+
+/**
+ * Message reçu par le thread de réception, transmis à la boucle principale.
+ */
+typedef struct {
+  NetMessage msg;
+  int64_t receivedAt; // instant de réception (en µs, horloge locale)
+} NetDelivery;
+
+/**
+ * Mesure de synchronisation des horloges.
+ */
+typedef struct {
+  int64_t offset; // horloge du serveur - horloge locale (en µs)
+  int64_t rtt;    // aller-retour, hors temps de traitement du serveur (en µs)
+} SyncSample;
+
+/**
+ * État du client.
+ */
+static struct NetClient {
+  bool active;
+  const char *address;
+  int fd;
+  SDL_Thread *receiver;
+  SDL_atomic_t stop;
+  int64_t lastHeard; // dernier message reçu du serveur (en µs)
+
+  int player; // numéro du joueur (-1 avant la réponse du serveur)
+
+  // Synchronisation des horloges
+  SyncSample samples[NET_SYNC_SAMPLES];
+  int nbSamples, nextSample;
+  int64_t offset; // décalage retenu (mesure d'aller-retour le plus court)
+  int rttMs;
+  int64_t lastSyncAt;
+
+  // État de la partie reçu du serveur
+  NetPhase phase;
+  int round;
+  uint32_t seq;
+  int upper, lower;
+  int64_t deadline; // fin de la partie (horloge du serveur)
+  int nbPlayers;
+  int scores[NET_MAX_PLAYERS];
+  bool waitingNext; // partie suivante demandée
+
+  // Réponse prédite correcte, en attente de confirmation
+  bool claimPending;
+  NetMessage claim;
+  int64_t lockedUntil; // fin du blocage après une erreur (en µs)
+} n;
+
+static void sendMessage(const NetMessage *msg) {
+  uint8_t buf[NET_MAX_PACKET];
+  int len = netEncode(msg, buf);
+  if (len > 0)
+    send(n.fd, buf, len, 0);
+}
+
+static void sendSimple(NetMessageType type) {
+  NetMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = type;
+  sendMessage(&msg);
+}
+
+static void sendSync() {
+  NetMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = NET_SYNC;
+  msg.t0 = clockNow();
+  msg.rttMs = n.rttMs;
+  sendMessage(&msg);
+  n.lastSyncAt = msg.t0;
+}
+
+/****************** RÉCEPTION ******************/
+
+/**
+ * Thread de réception : les messages sont décodés puis traités par la boucle
+ * principale, qui seule modifie l'état du jeu.
+ */
+static void handleDelivery(void *param);
+
+static int receiveThreadMain(void *param) {
+  (void)param;
+  while (!SDL_AtomicGet(&n.stop)) {
+    uint8_t buf[NET_MAX_PACKET];
+    int len = recv(n.fd, buf, sizeof(buf), 0);
+    if (len <= 0)
+      continue; // délai d'attente écoulé
+    int64_t receivedAt = clockNow();
+    NetDelivery *delivery = malloc(sizeof(NetDelivery));
+    if (delivery == NULL)
+      continue;
+    if (!netDecode(buf, len, &delivery->msg)) {
+      free(delivery);
+      continue;
+    }
+    delivery->receivedAt = receivedAt;
+    callOnMainThread(handleDelivery, delivery);
+  }
+  return 0;
+}
+
+/**
+ * Ajoute une mesure de synchronisation (méthode NTP) : le décalage retenu est
+ * celui de la mesure d'aller-retour le plus court parmi les dernières, la
+ * moins perturbée par la gigue.
+ */
+static void addSyncSample(const NetMessage *msg, int64_t t3) {
+  SyncSample sample;
+  sample.rtt = (t3 - msg->t0) - (msg->t2 - msg->t1);
+  sample.offset = ((msg->t1 - msg->t0) + (msg->t2 - t3)) / 2;
+  if (sample.rtt < 0)
+    return;
+  n.samples[n.nextSample] = sample;
+  n.nextSample = (n.nextSample + 1) % NET_SYNC_SAMPLES;
+  if (n.nbSamples < NET_SYNC_SAMPLES)
+    n.nbSamples++;
+
+  const SyncSample *best = &n.samples[0];
+  for (int i = 1; i < n.nbSamples; i++) {
+    if (n.samples[i].rtt < best->rtt)
+      best = &n.samples[i];
+  }
+  n.offset = best->offset;
+  n.rttMs = (int)usToMs(best->rtt);
+
+  // Échéance de la partie sur l'horloge locale
+  if (n.round > 0 && n.phase == NET_PLAYING)
+    gameGlobal.deadline = n.deadline - n.offset;
+}
+
+/**
+ * Vérifie que les packs et le deck imposés par le serveur sont disponibles.
+ */
+static bool welcomeSupported(const NetMessage *msg) {
+  if (msg->packMask <= 0 || msg->packMask >> packsCount() ||
+      packsDeckFile(msg->nbIcons) == NULL)
+    return false;
+  for (int i = 0; i < packsCount(); i++) {
+    if ((msg->packMask & (1 << i)) && packsIconCount(i) == 0)
+      return false;
+  }
+  return true;
+}
+
+static void handleWelcome(const NetMessage *msg) {
+  if (n.player >= 0)
+    return;
+  if (!welcomeSupported(msg)) {
+    printf("dobble: Packs (0x%x) ou deck de %d icônes du serveur absents.\n",
+           msg->packMask, msg->nbIcons);
+    printError(ECHEC_ICONES);
+  }
+  n.player = msg->player;
+  printf("dobble: Connecté au serveur, joueur %d.\n", n.player + 1);
+
+  // Packs et deck imposés par le serveur
+  if (!loadIconPacks(msg->packMask))
+    printError(ECHEC_ICONES);
+  if (!loadDeck(msg->nbIcons))
+    printError(INCORRECT_FORMAT);
+  gameGlobal.iconPackChosen = true;
+  gameGlobal.nbIconChosen = true;
+}
+
+/**
+ * Nouvelle paire : la prédiction d'une bonne réponse est confirmée si le
+ * score du joueur a augmenté, sinon un autre joueur a été plus rapide.
+ */
+static void reconcile(const NetMessage *msg) {
+  if (msg->lastWinner >= 0)
+    printf("dobble: Paire prise par le joueur %d.\n", msg->lastWinner + 1);
+  if (n.claimPending) {
+    bool won = msg->round == n.round &&
+               msg->scores[n.player] > n.scores[n.player];
+    gameGlobal.resultatClic = won ? CORRECT : TARDIF;
+    n.claimPending = false;
+  }
+}
+
+static void handleState(const NetMessage *msg) {
+  // L'état n'est exploitable qu'une fois le deck chargé et les horloges
+  // synchronisées ; les états plus anciens que le dernier reçu sont ignorés
+  // (la gigue peut inverser l'ordre des messages)
+  if (n.player < 0 || n.nbSamples == 0 || n.player >= msg->nbPlayers)
+    return;
+  if (msg->phase == NET_PLAYING &&
+      (msg->upper >= gameGlobal.nbCards || msg->lower >= gameGlobal.nbCards))
+    return;
+  if (msg->seq < n.seq || (msg->seq == n.seq && msg->phase < n.phase))
+    return;
+
+  if (msg->phase == NET_PLAYING) {
+    if (msg->round != n.round) {
+      // Nouvelle partie
+      printf("dobble: Partie %d.\n", msg->round);
+      gameGlobal.nbFalse = 0;
+      gameGlobal.resultatClic = INDEFINI;
+      gameGlobal.state = STATE_PLAYING;
+      gameGlobal.timerRunning = true;
+      gameGlobal.time = ROUND_DURATION_MS;
+      n.claimPending = false;
+      n.lockedUntil = 0;
+      n.waitingNext = false;
+      // Chaque client choisit ses icônes : le serveur ne connaît que les
+      // symboles du deck
+      iconMapBuild();
+      startTimer();
+    }
+    if (msg->seq != n.seq) {
+      reconcile(msg);
+      n.upper = msg->upper;
+      n.lower = msg->lower;
+      dealPair(msg->upper, msg->lower);
+    }
+    n.deadline = msg->deadline;
+    gameGlobal.deadline = n.deadline - n.offset;
+  }
+
+  bool ended = msg->phase == NET_ENDED && n.phase == NET_PLAYING;
+  n.phase = msg->phase;
+  n.round = msg->round;
+  n.seq = msg->seq;
+  n.nbPlayers = msg->nbPlayers;
+  memcpy(n.scores, msg->scores, sizeof(n.scores));
+  gameGlobal.score = n.scores[n.player];
+
+  if (ended && gameGlobal.time > 0) {
+    // Fin de partie décidée par le serveur : le compte à rebours local est
+    // arrêté même si l'estimation du décalage des horloges est imparfaite
+    n.claimPending = false;
+    gameGlobal.deadline = clockNow();
+    onTimerTick();
+  } else {
+    updateRemainingTime();
+    renderScene();
+  }
+}
+
+static void handleDelivery(void *param) {
+  NetDelivery *delivery = param;
+  if (n.active) {
+    n.lastHeard = delivery->receivedAt;
+    switch (delivery->msg.type) {
+    case NET_WELCOME:
+      handleWelcome(&delivery->msg);
+      renderScene();
+      break;
+    case NET_SYNC_REPLY:
+      addSyncSample(&delivery->msg, delivery->receivedAt);
+      break;
+    case NET_STATE:
+      handleState(&delivery->msg);
+      break;
+    default:
+      break;
+    }
+  }
+  free(delivery);
+}
+
+/****************** ÉMISSION PÉRIODIQUE ******************/
+
+/**
+ * Réémission des messages non confirmés et synchronisation des horloges,
+ * toutes les NET_RESEND_MS millisecondes.
+ */
+static void onNetTick(void *param) {
+  (void)param;
+  if (!n.active)
+    return;
+
+  int64_t now = clockNow();
+  if (n.player < 0)
+    sendSimple(NET_HELLO);
+  if (now - n.lastSyncAt >= msToUs(NET_SYNC_PERIOD_MS))
+    sendSync();
+  if (n.claimPending)
+    sendMessage(&n.claim);
+  if (n.waitingNext)
+    sendSimple(NET_READY);
+  // Mise à jour de l'écran d'attente (état de la connexion)
+  if (!netPlaying())
+    renderScene();
+
+  callLater(onNetTick, NULL, NET_RESEND_MS);
+}
+
+/****************** API ******************/
+
+int netConnect(const char *address) {
+  struct sockaddr_in server;
+  if (!netResolve(address, &server)) {
+    printf("dobble: Adresse de serveur invalide : %s\n", address);
+    return 0;
+  }
+  n.fd = netOpenSocket(0);
+  if (n.fd < 0)
+    return 0;
+
+  // Socket connectée : seuls les messages du serveur sont reçus. Le délai
+  // d'attente permet au thread de réception de s'arrêter
+  struct timeval timeout = {0, 100000};
+  setsockopt(n.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (connect(n.fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+    perror("dobble: connect");
+    close(n.fd);
+    return 0;
+  }
+
+  n.active = true;
+  n.address = address;
+  n.player = -1;
+  n.lastHeard = clockNow();
+  SDL_AtomicSet(&n.stop, 0);
+  n.receiver = SDL_CreateThread(receiveThreadMain, "net-receive", NULL);
+  if (n.receiver == NULL) {
+    printf("dobble: Echec de la création du thread de réception.\n");
+    close(n.fd);
+    n.active = false;
+    return 0;
+  }
+
+  sendSimple(NET_HELLO);
+  sendSync();
+  callLater(onNetTick, NULL, NET_RESEND_MS);
+  return 1;
+}
+
+bool netActive() { return n.active; }
+
+bool netPlaying() { return n.active && n.round > 0 && !n.waitingNext; }
+
+bool netAwaitingConfirmation() { return n.active && n.claimPending; }
+
+void netOnPointerDown(int x, int y, int64_t at) {
+  // Paire pas encore affichée, appui antérieur à son affichage (il visait la
+  // paire précédente), réponse déjà envoyée ou joueur bloqué après une erreur
+  if (n.phase != NET_PLAYING || gameGlobal.pairShownAt == 0 ||
+      at < gameGlobal.pairShownAt || n.claimPending || at < n.lockedUntil)
+    return;
+
+  // Seuls les appuis sur la carte du haut sont des réponses
+  int cx, cy;
+  getCardCenter(UpperCard, &cx, &cy);
+  if (dist(x, y, cx, cy) > getCardRadius(UpperCard))
+    return;
+
+  // Icône touchée (-1 si l'appui est entre les icônes) et icône à trouver
+  int common = netCommonIcon(n.upper, n.lower);
+  int iconId = -1, imageToFind = common;
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    Icon icon = gameGlobal.cardUpper.icons[i];
+    if (icon.iconId == common)
+      imageToFind = icon.imageId;
+    if (iconId < 0 && dist(x, y, icon.centerX, icon.centerY) <=
+                          getIconDrawSize(UpperCard, icon) / 2.)
+      iconId = icon.iconId;
+  }
+
+  // Prédiction : le résultat est affiché sans attendre le serveur, qui
+  // départage les joueurs
+  bool correct = iconId == common;
+  int reaction = (int)usToMs(at - gameGlobal.pairShownAt);
+  statsRecordAnswer(0, gameGlobal.nbIcons, imageToFind, reaction, correct);
+
+  NetMessage *claim = &n.claim;
+  memset(claim, 0, sizeof(NetMessage));
+  claim->type = NET_CLAIM;
+  claim->seq = n.seq;
+  claim->iconId = iconId;
+  claim->shownAt = gameGlobal.pairShownAt + n.offset;
+  claim->at = at + n.offset;
+  sendMessage(claim);
+
+  if (correct) {
+    // Réponse réémise jusqu'à la paire suivante
+    n.claimPending = true;
+    gameGlobal.resultatClic = CORRECT;
+  } else {
+    gameGlobal.resultatClic = INCORRECT;
+    gameGlobal.nbFalse++;
+    n.lockedUntil = at + msToUs(NET_LOCKOUT_MS);
+  }
+  renderScene();
+}
+
+void netRenderStatus() {
+  char title[100];
+
+  clearWindow();
+  sprintf(title, "Ai & Yuki - Dobble     En ligne");
+  drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  if (clockNow() - n.lastHeard > msToUs(NET_TIMEOUT_MS))
+    sprintf(title, "Serveur injoignable : %s", n.address);
+  else if (n.player < 0)
+    sprintf(title, "Connexion à %s...", n.address);
+  else
+    sprintf(title, "Joueur %d : en attente des joueurs", n.player + 1);
+  drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  if (n.nbSamples > 0) {
+    sprintf(title, "Aller-retour : %d ms", n.rttMs);
+    drawText(title, WIN_WIDTH / 2, 2.8 * FONT_SIZE, Center, Top, TEXTCOLOR,
+             TEXTCOLOR, TEXTCOLOR);
+  }
+  showWindow();
+}
+
+void netShowResults() {
+  char title[100];
+
+  // Classement de la partie
+  int rank = 1;
+  for (int p = 0; p < n.nbPlayers; p++) {
+    if (n.scores[p] > n.scores[n.player])
+      rank++;
+  }
+  sprintf(title, "Joueur %d : %d points, %de sur %d", n.player + 1,
+          n.scores[n.player], rank, n.nbPlayers);
+  drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  // Scores de tous les joueurs, quatre par ligne
+  for (int line = 0; line * 4 < n.nbPlayers; line++) {
+    int length = 0;
+    title[0] = '\0';
+    for (int p = line * 4; p < n.nbPlayers && p < line * 4 + 4; p++) {
+      length += snprintf(title + length, sizeof(title) - length, "%sJ%d : %d",
+                         length ? "   " : "", p + 1, n.scores[p]);
+    }
+    drawText(title, WIN_WIDTH / 2, (1.6 + 1.2 * line) * FONT_SIZE, Center, Top,
+             TEXTCOLOR, TEXTCOLOR, TEXTCOLOR);
+  }
+
+  sprintf(title, "Bravo ! Et merci d'avoir joué !");
+  drawText(title, WIN_WIDTH / 2, 4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  sprintf(title, "Voulez-vous rejouer ?");
+  drawText(title, WIN_WIDTH / 2, 5.2 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+}
+
+void netRequestNextRound() {
+  n.waitingNext = true;
+  gameGlobal.time = ROUND_DURATION_MS;
+  gameGlobal.resultatClic = INDEFINI;
+  sendSimple(NET_READY);
+  renderScene();
+}
+
+void netShutdown() {
+  if (!n.active)
+    return;
+  n.active = false;
+  sendSimple(NET_BYE);
+  SDL_AtomicSet(&n.stop, 1);
+  SDL_WaitThread(n.receiver, NULL);
+  close(n.fd);
+}
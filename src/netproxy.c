@@ -0,0 +1,240 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "dobble.h"
+#include "net.h"
+
+/* Nombre maximal de clients relayés */
+#define PROXY_MAX_CLIENTS 16
+
+/* Nombre maximal de messages en attente de relais */
+#define PROXY_QUEUE_SIZE 1024
+
+/**
+ * Message retardé, relayé à son échéance.
+ */
+typedef struct {
+  int64_t releaseAt; // échéance du relais (en µs)
+  int fd;            // socket d'émission
+  struct sockaddr_in to;
+  uint8_t data[NET_MAX_PACKET];
+  int len;
+} DelayedPacket;
+
+/**
+ * Client relayé : chaque client a sa propre socket vers le serveur, pour que
+ * le serveur le distingue des autres.
+ */
+typedef struct {
+  bool used;
+  struct sockaddr_in address;
+  int upstream;
+  int64_t lastHeard;
+} ProxyClient;
+
+static struct Proxy {
+  int fd; // socket d'écoute des clients
+  struct sockaddr_in server;
+  int latencyMs, jitterMs, lossPct;
+  ProxyClient clients[PROXY_MAX_CLIENTS];
+
+  // File de priorité des messages en attente (tas binaire sur l'échéance)
+  DelayedPacket queue[PROXY_QUEUE_SIZE];
+  int queueSize;
+  int relayed, dropped;
+} x;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal) {
+  (void)signal;
+  stopRequested = 1;
+}
+
+static void swapPackets(int a, int b) {
+  DelayedPacket tmp = x.queue[a];
+  x.queue[a] = x.queue[b];
+  x.queue[b] = tmp;
+}
+
+/**
+ * Met un message en attente avec une latence aléatoire (ou le perd).
+ */
+static void enqueue(int fd, const struct sockaddr_in *to, const uint8_t *data,
+                    int len, int64_t now) {
+  if (randomInt(100) < x.lossPct || x.queueSize == PROXY_QUEUE_SIZE) {
+    x.dropped++;
+    return;
+  }
+  int delayMs = x.latencyMs;
+  if (x.jitterMs > 0)
+    delayMs += randomInt(2 * x.jitterMs + 1) - x.jitterMs;
+  if (delayMs < 0)
+    delayMs = 0;
+
+  int i = x.queueSize++;
+  DelayedPacket *packet = &x.queue[i];
+  packet->releaseAt = now + msToUs(delayMs);
+  packet->fd = fd;
+  packet->to = *to;
+  memcpy(packet->data, data, len);
+  packet->len = len;
+
+  // Remontée dans le tas
+  while (i > 0 && x.queue[(i - 1) / 2].releaseAt > x.queue[i].releaseAt) {
+    swapPackets(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+/**
+ * Relaie les messages dont l'échéance est atteinte.
+ */
+static void releaseDue(int64_t now) {
+  while (x.queueSize > 0 && x.queue[0].releaseAt <= now) {
+    DelayedPacket *packet = &x.queue[0];
+    sendto(packet->fd, packet->data, packet->len, 0,
+           (struct sockaddr *)&packet->to, sizeof(packet->to));
+    x.relayed++;
+
+    // Retrait de la racine du tas
+    x.queue[0] = x.queue[--x.queueSize];
+    int i = 0;
+    for (;;) {
+      int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+      if (left < x.queueSize &&
+          x.queue[left].releaseAt < x.queue[smallest].releaseAt)
+        smallest = left;
+      if (right < x.queueSize &&
+          x.queue[right].releaseAt < x.queue[smallest].releaseAt)
+        smallest = right;
+      if (smallest == i)
+        break;
+      swapPackets(i, smallest);
+      i = smallest;
+    }
+  }
+}
+
+/**
+ * Retourne le client correspondant à une adresse, entendu à l'instant now, en
+ * lui attribuant une socket vers le serveur s'il est nouveau (la place du
+ * client le plus anciennement entendu est reprise si toutes sont occupées).
+ */
+static ProxyClient *findClient(const struct sockaddr_in *from, int64_t now) {
+  ProxyClient *oldest = &x.clients[0];
+  for (int c = 0; c < PROXY_MAX_CLIENTS; c++) {
+    ProxyClient *client = &x.clients[c];
+    if (client->used &&
+        client->address.sin_addr.s_addr == from->sin_addr.s_addr &&
+        client->address.sin_port == from->sin_port) {
+      client->lastHeard = now;
+      return client;
+    }
+    if (!client->used ||
+        (oldest->used && client->lastHeard < oldest->lastHeard))
+      oldest = client;
+  }
+
+  if (oldest->used)
+    close(oldest->upstream);
+  oldest->upstream = netOpenSocket(0);
+  if (oldest->upstream < 0) {
+    oldest->used = false;
+    return NULL;
+  }
+  oldest->used = true;
+  oldest->address = *from;
+  oldest->lastHeard = now;
+  printf("dobble: Relais du client %s:%d.\n", inet_ntoa(from->sin_addr),
+         ntohs(from->sin_port));
+  return oldest;
+}
+
+int netRunProxy(int port, const char *server, int latencyMs, int jitterMs,
+                int lossPct) {
+  memset(&x, 0, sizeof(x));
+  x.latencyMs = latencyMs;
+  x.jitterMs = jitterMs;
+  x.lossPct = lossPct;
+  if (!netResolve(server, &x.server)) {
+    printf("dobble: Adresse de serveur invalide : %s\n", server);
+    return 1;
+  }
+  x.fd = netOpenSocket(port);
+  if (x.fd < 0)
+    return 1;
+  seedRandom((uint64_t)time(NULL) ^ (uint64_t)clockNow());
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  printf("dobble: Relais du port %d vers %s (latence %d ms, gigue %d ms, "
+         "pertes %d %%).\n",
+         port, server, latencyMs, jitterMs, lossPct);
+
+  while (!stopRequested) {
+    // Attente d'un message, au plus jusqu'à la prochaine échéance
+    int64_t now = clockNow();
+    int64_t wait = 1000000;
+    if (x.queueSize > 0)
+      wait = x.queue[0].releaseAt > now ? x.queue[0].releaseAt - now : 0;
+    struct timeval timeout = {(time_t)(wait / 1000000),
+                              (suseconds_t)(wait % 1000000)};
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(x.fd, &readable);
+    int maxFd = x.fd;
+    for (int c = 0; c < PROXY_MAX_CLIENTS; c++) {
+      if (x.clients[c].used) {
+        FD_SET(x.clients[c].upstream, &readable);
+        if (x.clients[c].upstream > maxFd)
+          maxFd = x.clients[c].upstream;
+      }
+    }
+    int ready = select(maxFd + 1, &readable, NULL, NULL, &timeout);
+    now = clockNow();
+
+    if (ready > 0) {
+      uint8_t buf[NET_MAX_PACKET];
+      struct sockaddr_in from;
+      socklen_t fromLength = sizeof(from);
+
+      // Client vers serveur
+      if (FD_ISSET(x.fd, &readable)) {
+        int len = recvfrom(x.fd, buf, sizeof(buf), 0, (struct sockaddr *)&from,
+                           &fromLength);
+        ProxyClient *client = len > 0 ? findClient(&from, now) : NULL;
+        if (client != NULL)
+          enqueue(client->upstream, &x.server, buf, len, now);
+      }
+
+      // Serveur vers clients
+      for (int c = 0; c < PROXY_MAX_CLIENTS; c++) {
+        ProxyClient *client = &x.clients[c];
+        if (!client->used || !FD_ISSET(client->upstream, &readable))
+          continue;
+        int len = recv(client->upstream, buf, sizeof(buf), 0);
+        if (len > 0)
+          enqueue(x.fd, &client->address, buf, len, now);
+      }
+    }
+    releaseDue(now);
+  }
+
+  printf("dobble: Arrêt du relais (%d messages relayés, %d perdus).\n",
+         x.relayed, x.dropped);
+  for (int c = 0; c < PROXY_MAX_CLIENTS; c++) {
+    if (x.clients[c].used)
+      close(x.clients[c].upstream);
+  }
+  close(x.fd);
+  return 0;
+}
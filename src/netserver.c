@@ -0,0 +1,397 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "dobble.h"
+#include "net.h"
+
+/**
+ * Joueur connecté au serveur.
+ */
+typedef struct {
+  bool connected;
+  struct sockaddr_in address;
+  int64_t lastHeard;   // dernier message reçu (en µs)
+  int rttMs;           // aller-retour mesuré par le client (borné)
+  bool ready;          // prêt pour la partie suivante
+  int score, nbFalse;  // bonnes et mauvaises réponses de la partie
+  int64_t lockedUntil; // fin du blocage après une erreur (en µs)
+
+  // Bonne réponse pour la paire courante
+  bool claimed;
+  int64_t reaction; // temps de réaction retenu (en µs)
+  int64_t arrival;  // réception de la réponse (en µs)
+} NetPlayer;
+
+/**
+ * État du serveur.
+ */
+static struct NetServer {
+  int fd;
+  int nbPlayers, nbIcons, packMask;
+  NetPlayer players[NET_MAX_PLAYERS];
+
+  NetPhase phase;
+  int round;
+  uint32_t seq;           // numéro de la paire courante
+  int upper, lower;       // indices des cartes de la paire courante
+  int common;             // symbole commun aux deux cartes
+  int64_t dealAt;         // envoi de la paire courante (en µs)
+  int64_t deadline;       // fin de la partie (en µs)
+  int lastWinner;         // gagnant de la paire précédente
+  int64_t resolveAt;      // fin de la fenêtre d'équité (0 : pas de réponse)
+  int64_t nextBroadcast;  // prochaine réémission de l'état (en µs)
+} s;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal) {
+  (void)signal;
+  stopRequested = 1;
+}
+
+static void sendMessage(const NetMessage *msg, struct sockaddr_in *to) {
+  uint8_t buf[NET_MAX_PACKET];
+  int len = netEncode(msg, buf);
+  if (len > 0)
+    sendto(s.fd, buf, len, 0, (struct sockaddr *)to, sizeof(*to));
+}
+
+/**
+ * Envoie l'état de la partie à tous les joueurs connectés.
+ */
+static void broadcastState(int64_t now) {
+  NetMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = NET_STATE;
+  msg.phase = s.phase;
+  msg.round = s.round;
+  msg.seq = s.seq;
+  msg.upper = s.upper;
+  msg.lower = s.lower;
+  msg.deadline = s.deadline;
+  msg.lastWinner = s.lastWinner;
+  msg.nbPlayers = s.nbPlayers;
+  for (int p = 0; p < s.nbPlayers; p++)
+    msg.scores[p] = s.players[p].score;
+
+  for (int p = 0; p < s.nbPlayers; p++) {
+    if (s.players[p].connected)
+      sendMessage(&msg, &s.players[p].address);
+  }
+  s.nextBroadcast = now + msToUs(NET_RESEND_MS);
+}
+
+/**
+ * Distribue une nouvelle paire et l'envoie aux joueurs.
+ */
+static void dealNext(int64_t now) {
+  int i, j;
+  pickPair(&i, &j);
+  // Le serveur ne dessine pas les cartes : seule la paire précédente est
+  // retenue pour le tirage suivant
+  gameGlobal.dealtUpper = gameGlobal.cards[i].icons;
+  gameGlobal.dealtLower = gameGlobal.cards[j].icons;
+
+  s.upper = i;
+  s.lower = j;
+  s.common = netCommonIcon(i, j);
+  s.seq++;
+  s.dealAt = now;
+  s.resolveAt = 0;
+  for (int p = 0; p < s.nbPlayers; p++)
+    s.players[p].claimed = false;
+  broadcastState(now);
+}
+
+static void beginRound(int64_t now) {
+  s.round++;
+  s.phase = NET_PLAYING;
+  s.deadline = now + msToUs(ROUND_DURATION_MS);
+  s.lastWinner = -1;
+  for (int p = 0; p < s.nbPlayers; p++) {
+    NetPlayer *player = &s.players[p];
+    player->score = player->nbFalse = 0;
+    player->lockedUntil = 0;
+    player->ready = false;
+  }
+  printf("dobble: Partie %d : début.\n", s.round);
+  dealNext(now);
+}
+
+static void endRound(int64_t now) {
+  s.phase = NET_ENDED;
+  s.resolveAt = 0;
+  printf("dobble: Partie %d : fin.", s.round);
+  for (int p = 0; p < s.nbPlayers; p++)
+    printf(" J%d %d (%d erreurs)", p + 1, s.players[p].score,
+           s.players[p].nbFalse);
+  printf("\n");
+  broadcastState(now);
+}
+
+/**
+ * Fin de la fenêtre d'équité : la bonne réponse dont le temps de réaction est
+ * le plus court l'emporte, quel que soit son ordre d'arrivée.
+ */
+static void resolvePair(int64_t now) {
+  int winner = -1;
+  for (int p = 0; p < s.nbPlayers; p++) {
+    NetPlayer *player = &s.players[p];
+    if (!player->claimed)
+      continue;
+    if (winner < 0 || player->reaction < s.players[winner].reaction ||
+        (player->reaction == s.players[winner].reaction &&
+         player->arrival < s.players[winner].arrival))
+      winner = p;
+  }
+  if (winner >= 0) {
+    s.players[winner].score++;
+    printf("dobble: Paire %u : joueur %d en %d ms.\n", s.seq, winner + 1,
+           (int)usToMs(s.players[winner].reaction));
+  }
+  s.lastWinner = winner;
+  dealNext(now);
+}
+
+/**
+ * Traite la réponse d'un joueur pour la paire courante.
+ */
+static void handleClaim(int p, const NetMessage *msg, int64_t now) {
+  NetPlayer *player = &s.players[p];
+  if (s.phase != NET_PLAYING || msg->seq != s.seq || player->claimed ||
+      now < player->lockedUntil)
+    return;
+
+  if (msg->iconId != s.common) {
+    player->nbFalse++;
+    player->lockedUntil = now + msToUs(NET_LOCKOUT_MS);
+    return;
+  }
+
+  // Les instants déclarés par le client sont bornés : la paire ne peut pas
+  // avoir été affichée avant son envoi, ni beaucoup plus tard que la moitié de
+  // l'aller-retour du joueur, et l'appui ne peut pas être postérieur à la
+  // réception de la réponse
+  int64_t shownAt = msg->shownAt, at = msg->at;
+  int64_t latest =
+      s.dealAt + msToUs(player->rttMs / 2 + NET_DISPLAY_TOLERANCE_MS);
+  if (shownAt < s.dealAt)
+    shownAt = s.dealAt;
+  if (shownAt > latest)
+    shownAt = latest;
+  if (at > now)
+    at = now;
+  player->claimed = true;
+  player->reaction = at > shownAt ? at - shownAt : 0;
+  player->arrival = now;
+
+  // La première bonne réponse ouvre la fenêtre d'équité
+  if (s.resolveAt == 0)
+    s.resolveAt = now + msToUs(NET_FAIRNESS_WINDOW_MS);
+}
+
+/**
+ * Retourne le joueur correspondant à une adresse, -1 si inconnu.
+ */
+static int findPlayer(const struct sockaddr_in *from) {
+  for (int p = 0; p < s.nbPlayers; p++) {
+    const NetPlayer *player = &s.players[p];
+    if (player->connected &&
+        player->address.sin_addr.s_addr == from->sin_addr.s_addr &&
+        player->address.sin_port == from->sin_port)
+      return p;
+  }
+  return -1;
+}
+
+static void handleHello(struct sockaddr_in *from, int64_t now) {
+  int p = findPlayer(from);
+  if (p < 0) {
+    // Nouveau joueur : première place libre
+    for (p = 0; p < s.nbPlayers && s.players[p].connected; p++)
+      ;
+    if (p == s.nbPlayers) {
+      printf("dobble: Partie complète, connexion refusée.\n");
+      return;
+    }
+    NetPlayer *player = &s.players[p];
+    memset(player, 0, sizeof(NetPlayer));
+    player->connected = true;
+    player->address = *from;
+    player->ready = true;
+    player->lastHeard = now;
+    printf("dobble: Joueur %d connecté (%s:%d).\n", p + 1,
+           inet_ntoa(from->sin_addr), ntohs(from->sin_port));
+  }
+
+  // Le message de bienvenue est renvoyé à chaque HELLO (il a pu être perdu)
+  NetMessage msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = NET_WELCOME;
+  msg.player = p;
+  msg.nbIcons = s.nbIcons;
+  msg.packMask = s.packMask;
+  sendMessage(&msg, from);
+  broadcastState(now);
+}
+
+static void handleMessage(const NetMessage *msg, struct sockaddr_in *from,
+                          int64_t now) {
+  if (msg->type == NET_HELLO) {
+    handleHello(from, now);
+    return;
+  }
+
+  int p = findPlayer(from);
+  if (p < 0)
+    return;
+  NetPlayer *player = &s.players[p];
+  player->lastHeard = now;
+
+  switch (msg->type) {
+  case NET_SYNC: {
+    // Aller-retour déclaré par le client, borné : il ne sert qu'à tolérer
+    // un affichage tardif de la paire
+    player->rttMs = msg->rttMs < NET_MAX_RTT_MS ? msg->rttMs : NET_MAX_RTT_MS;
+    NetMessage reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type = NET_SYNC_REPLY;
+    reply.t0 = msg->t0;
+    reply.t1 = now;
+    reply.t2 = clockNow();
+    sendMessage(&reply, from);
+    break;
+  }
+  case NET_CLAIM:
+    handleClaim(p, msg, now);
+    break;
+  case NET_READY:
+    player->ready = true;
+    break;
+  case NET_BYE:
+    printf("dobble: Joueur %d déconnecté.\n", p + 1);
+    player->connected = false;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Déconnecte les joueurs dont aucun message n'a été reçu depuis
+ * NET_TIMEOUT_MS.
+ */
+static void dropSilentPlayers(int64_t now) {
+  for (int p = 0; p < s.nbPlayers; p++) {
+    NetPlayer *player = &s.players[p];
+    if (player->connected && now - player->lastHeard > msToUs(NET_TIMEOUT_MS)) {
+      printf("dobble: Joueur %d perdu (aucun message).\n", p + 1);
+      player->connected = false;
+      player->claimed = false;
+    }
+  }
+}
+
+/**
+ * Indique si tous les joueurs attendus sont connectés et prêts.
+ */
+static bool allReady() {
+  for (int p = 0; p < s.nbPlayers; p++) {
+    if (!s.players[p].connected || !s.players[p].ready)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Retourne le délai jusqu'à la prochaine échéance du serveur (en µs).
+ */
+static int64_t nextTimeout(int64_t now) {
+  int64_t next = s.nextBroadcast;
+  if (s.resolveAt != 0 && s.resolveAt < next)
+    next = s.resolveAt;
+  if (s.phase == NET_PLAYING && s.deadline < next)
+    next = s.deadline;
+  return next > now ? next - now : 0;
+}
+
+int netRunServer(int port, int nbPlayers, int nbIcons, int packMask) {
+  memset(&s, 0, sizeof(s));
+  s.nbPlayers = nbPlayers < 1 ? 1 : nbPlayers;
+  if (s.nbPlayers > NET_MAX_PLAYERS)
+    s.nbPlayers = NET_MAX_PLAYERS;
+  s.nbIcons = nbIcons;
+  s.packMask = packMask;
+  s.lastWinner = -1;
+
+  seedRandom((uint64_t)time(NULL) ^ (uint64_t)clockNow());
+  if (!loadDeck(nbIcons))
+    return 1;
+  if (!deckFitsPacks(nbIcons, packMask)) {
+    printf("dobble: Packs trop petits pour le deck de %d icônes par carte.\n",
+           nbIcons);
+    return 1;
+  }
+  if (gameGlobal.nbCards < 3) {
+    printf("dobble: Deck trop petit pour une partie en réseau.\n");
+    return 1;
+  }
+
+  s.fd = netOpenSocket(port);
+  if (s.fd < 0)
+    return 1;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  printf("dobble: Serveur en attente de %d joueur(s) sur le port %d.\n",
+         s.nbPlayers, port);
+
+  s.nextBroadcast = clockNow() + msToUs(NET_RESEND_MS);
+  while (!stopRequested) {
+    int64_t wait = nextTimeout(clockNow());
+    struct timeval timeout = {(time_t)(wait / 1000000),
+                              (suseconds_t)(wait % 1000000)};
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(s.fd, &readable);
+    int ready = select(s.fd + 1, &readable, NULL, NULL, &timeout);
+
+    // L'instant de réception est relevé avant le décodage : c'est lui qui
+    // borne l'instant d'appui déclaré par le client
+    int64_t now = clockNow();
+    if (ready > 0 && FD_ISSET(s.fd, &readable)) {
+      uint8_t buf[NET_MAX_PACKET];
+      struct sockaddr_in from;
+      socklen_t fromLength = sizeof(from);
+      int len = recvfrom(s.fd, buf, sizeof(buf), 0, (struct sockaddr *)&from,
+                         &fromLength);
+      NetMessage msg;
+      if (len > 0 && netDecode(buf, len, &msg))
+        handleMessage(&msg, &from, now);
+    }
+
+    now = clockNow();
+    dropSilentPlayers(now);
+    if (s.phase == NET_PLAYING && now >= s.deadline)
+      endRound(now);
+    else if (s.resolveAt != 0 && now >= s.resolveAt)
+      resolvePair(now);
+    if (s.phase != NET_PLAYING && allReady())
+      beginRound(now);
+    if (now >= s.nextBroadcast)
+      broadcastState(now);
+  }
+
+  printf("dobble: Arrêt du serveur.\n");
+  close(s.fd);
+  freeDeck();
+  return 0;
+}
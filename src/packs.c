@@ -0,0 +1,394 @@
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "assets.h"
+#include "atlas.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "packs.h"
+#include "ui.h"
+
+/* Nom du manifeste des packs d'icônes dans le dossier de données */
+#define PACKS_MANIFEST "packs.txt"
+
+/* Nombre maximal de fichiers du dossier de données pris en compte */
+#define PACKS_MAX_FILES 256
+
+/* Longueur maximale d'un nom de fichier du dossier de données */
+#define PACKS_PATH_SIZE 256
+
+/**
+ * Pack d'icônes : description (manifeste ou nom du fichier) et dimensions de
+ * son image, lues dans l'en-tête du fichier.
+ */
+typedef struct {
+  char file[PACKS_PATH_SIZE]; // nom de l'image (voir assets.h)
+  char name[32];
+  int nbIcons;    // nombre d'icônes demandé (0 : toutes les cases)
+  int width;      // dimensions de l'image (0 : image absente ou illisible)
+  int height;
+  time_t mtime;   // date de modification de l'image lors de sa lecture (0 :
+                  // image intégrée)
+} Pack;
+
+/**
+ * Contenu du dossier de données.
+ */
+static struct Packs {
+  Pack packs[PACKS_MAX];
+  int nbPacks;
+  int nbManifest; // packs du manifeste (les premiers)
+  char decks[DECKS_MAX_ICONS + 1][PACKS_PATH_SIZE]; // "" : pas de deck
+} p;
+
+/**
+ * Lit les dimensions d'une image PNG dans son en-tête (bloc IHDR), sans la
+ * décoder.
+ *
+ * @return 1 si le fichier est une image PNG, 0 sinon
+ */
+static int readPngSize(const char *fileName, int *width, int *height) {
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                       '\n'};
+  uint8_t header[24];
+  FILE *file = assetOpen(fileName, "rb");
+  if (file == NULL)
+    return 0;
+  size_t length = fread(header, 1, sizeof(header), file);
+  fclose(file);
+  if (length != sizeof(header) || memcmp(header, signature, 8) != 0 ||
+      memcmp(header + 12, "IHDR", 4) != 0)
+    return 0;
+  *width = header[16] << 24 | header[17] << 16 | header[18] << 8 | header[19];
+  *height = header[20] << 24 | header[21] << 16 | header[22] << 8 | header[23];
+  return 1;
+}
+
+/**
+ * Met à jour les dimensions de l'image d'un pack, relues seulement si le
+ * fichier a changé depuis la dernière lecture.
+ */
+static void refreshPack(Pack *pack, const struct Packs *previous) {
+  time_t mtime;
+  if (!assetExists(pack->file, &mtime)) {
+    pack->width = pack->height = 0;
+    return;
+  }
+  for (int i = 0; i < previous->nbPacks; i++) {
+    const Pack *known = &previous->packs[i];
+    if (strcmp(known->file, pack->file) == 0 && known->width > 0 &&
+        known->mtime == mtime) {
+      pack->width = known->width;
+      pack->height = known->height;
+      pack->mtime = known->mtime;
+      return;
+    }
+  }
+  pack->mtime = mtime;
+  if (!readPngSize(pack->file, &pack->width, &pack->height) ||
+      pack->width < ICON_SIZE || pack->height < ICON_SIZE)
+    pack->width = pack->height = 0;
+}
+
+/**
+ * Cherche un pack par le nom de son image.
+ */
+static int findPack(const char *fileName) {
+  for (int i = 0; i < p.nbPacks; i++) {
+    if (strcmp(p.packs[i].file, fileName) == 0)
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Lit le manifeste : une ligne par pack, "<image> <nombre d'icônes> <nom>".
+ *
+ * @return Le nombre de packs du manifeste
+ */
+static int readManifest() {
+  FILE *file = assetOpen(PACKS_MANIFEST, "r");
+  if (file == NULL)
+    return 0;
+  char line[256], image[128];
+  int nbIcons, offset;
+  while (p.nbPacks < PACKS_MAX && fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] == '#' ||
+        sscanf(line, "%127s %d %n", image, &nbIcons, &offset) != 2)
+      continue;
+    Pack *pack = &p.packs[p.nbPacks++];
+    snprintf(pack->file, sizeof(pack->file), "%s", image);
+    snprintf(pack->name, sizeof(pack->name), "%.*s",
+             (int)strcspn(line + offset, "\r\n"), line + offset);
+    pack->nbIcons = nbIcons > 0 ? nbIcons : 0;
+  }
+  fclose(file);
+  return p.nbPacks;
+}
+
+/**
+ * Ajoute un pack trouvé dans le dossier (absent du manifeste). Son nom et son
+ * nombre d'icônes sont tirés du nom du fichier (Nom_80_90x90pixels.png).
+ */
+static void addDiscoveredPack(const char *entry) {
+  if (p.nbPacks == PACKS_MAX || strlen(entry) >= PACKS_PATH_SIZE ||
+      findPack(entry) >= 0)
+    return;
+  Pack *pack = &p.packs[p.nbPacks];
+  memset(pack, 0, sizeof(Pack));
+  strcpy(pack->file, entry);
+  snprintf(pack->name, sizeof(pack->name), "%.*s",
+           (int)strcspn(entry, "_."), entry);
+  const char *count = strchr(entry, '_');
+  pack->nbIcons = count != NULL ? atoi(count + 1) : 0;
+  p.nbPacks++;
+}
+
+/**
+ * Retient un fichier de deck s'il est le premier (par ordre alphabétique) pour
+ * son nombre d'icônes par carte.
+ */
+static void addDeck(const char *entry) {
+  FILE *file = strlen(entry) < PACKS_PATH_SIZE ? assetOpen(entry, "r") : NULL;
+  if (file == NULL)
+    return;
+  int nbCards, nbIcons;
+  if (fscanf(file, "%d %d", &nbCards, &nbIcons) == 2 && nbCards > 1 &&
+      nbIcons > 1 && nbIcons <= DECKS_MAX_ICONS && p.decks[nbIcons][0] == '\0')
+    strcpy(p.decks[nbIcons], entry);
+  fclose(file);
+}
+
+/**
+ * Compare deux noms de fichiers (tri alphabétique).
+ */
+static int compareNames(const void *a, const void *b) {
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/**
+ * Indique si un nom de fichier a une extension donnée.
+ */
+static bool hasExtension(const char *name, const char *extension) {
+  const char *dot = strrchr(name, '.');
+  return dot != NULL && strcmp(dot, extension) == 0;
+}
+
+/**
+ * Indique si un fichier du dossier de données est une image ou un texte
+ * (pack, manifeste ou deck).
+ */
+static bool isDataFile(const char *name) {
+  return name[0] != '.' && strchr(name, '/') == NULL &&
+         (hasExtension(name, ".png") || hasExtension(name, ".txt"));
+}
+
+/**
+ * Indique si un nom fait partie d'une liste de noms.
+ */
+static bool containsName(char *const *names, int nbNames, const char *name) {
+  for (int i = 0; i < nbNames; i++) {
+    if (strcmp(names[i], name) == 0)
+      return true;
+  }
+  return false;
+}
+
+int packsScan() {
+  // Fichiers du dossier de données sur disque, puis fichiers intégrés qu'ils
+  // ne remplacent pas
+  char *names[PACKS_MAX_FILES];
+  int nbNames = 0;
+  const char *dataDirectory = assetsDirectory();
+  if (dataDirectory != NULL) {
+    DIR *directory = opendir(dataDirectory);
+    if (directory == NULL) {
+      printf("dobble: Impossible de parcourir le dossier de données '%s'.\n",
+             dataDirectory);
+      if (assetsCount() == 0)
+        return 0;
+    }
+    struct dirent *entry;
+    while (directory != NULL && nbNames < PACKS_MAX_FILES &&
+           (entry = readdir(directory)) != NULL) {
+      if (isDataFile(entry->d_name))
+        names[nbNames++] = strdup(entry->d_name);
+    }
+    if (directory != NULL)
+      closedir(directory);
+  }
+  for (int i = 0; i < assetsCount() && nbNames < PACKS_MAX_FILES; i++) {
+    const char *name = assetsName(i);
+    if (isDataFile(name) && !containsName(names, nbNames, name))
+      names[nbNames++] = strdup(name);
+  }
+  qsort(names, nbNames, sizeof(char *), compareNames);
+
+  // Les dimensions des images inchangées sont reprises du parcours précédent
+  static struct Packs previous;
+  previous = p;
+  memset(&p, 0, sizeof(p));
+  p.nbManifest = readManifest();
+  // Les images trouvées lors d'un parcours précédent gardent leur numéro,
+  // même supprimées ; les nouvelles images sont numérotées à la suite
+  for (int i = previous.nbManifest; i < previous.nbPacks; i++)
+    addDiscoveredPack(previous.packs[i].file);
+  int nbNumbered = p.nbPacks;
+  for (int i = 0; i < nbNames; i++) {
+    if (hasExtension(names[i], ".png"))
+      addDiscoveredPack(names[i]);
+    else if (strcmp(names[i], PACKS_MANIFEST) != 0)
+      addDeck(names[i]);
+    free(names[i]);
+  }
+
+  // Les nouvelles images illisibles sont ignorées ; les autres gardent leur
+  // numéro de pack
+  int kept = 0;
+  for (int i = 0; i < p.nbPacks; i++) {
+    refreshPack(&p.packs[i], &previous);
+    if (p.packs[i].width > 0 || i < nbNumbered)
+      p.packs[kept++] = p.packs[i];
+  }
+  p.nbPacks = kept;
+  return 1;
+}
+
+int packsCount() { return p.nbPacks; }
+
+const char *packsFile(int pack) {
+  return pack >= 0 && pack < p.nbPacks ? p.packs[pack].file : NULL;
+}
+
+int packsIconCount(int pack) {
+  if (pack < 0 || pack >= p.nbPacks)
+    return 0;
+  const Pack *a = &p.packs[pack];
+  int cells = (a->width / ICON_SIZE) * (a->height / ICON_SIZE);
+  return a->nbIcons > 0 && a->nbIcons < cells ? a->nbIcons : cells;
+}
+
+uint32_t packsIdentity(int packMask) {
+  if (packMask <= 0 || packMask >> p.nbPacks)
+    return 0;
+  // Empreintes (FNV-1a) des noms des images combinées sans tenir compte de
+  // l'ordre des packs
+  uint32_t identity = 0;
+  for (int i = 0; i < p.nbPacks; i++) {
+    if (!(packMask & (1 << i)))
+      continue;
+    uint32_t hash = 2166136261u;
+    for (const char *c = p.packs[i].file; *c != '\0'; c++)
+      hash = (hash ^ (unsigned char)*c) * 16777619u;
+    identity += hash;
+  }
+  return identity != 0 ? identity : 1;
+}
+
+const char *packsName(int pack) {
+  return pack >= 0 && pack < p.nbPacks ? p.packs[pack].name : NULL;
+}
+
+const char *packsDeckFile(int nbIcons) {
+  if (nbIcons < 0 || nbIcons > DECKS_MAX_ICONS || p.decks[nbIcons][0] == '\0')
+    return NULL;
+  return p.decks[nbIcons];
+}
+
+/**
+ * Prend en compte un fichier modifié du dossier de données (appelée sur le
+ * thread principal).
+ *
+ * @param param Le nom du fichier (alloué par le thread de surveillance)
+ */
+static void onFileChanged(void *param) {
+  char *name = param;
+  packsScan();
+  // Boutons des packs et des decks apparus ou disparus
+  if (uiUpdateChoices())
+    requestRedraw();
+
+  // Un fichier supprimé du dossier est remplacé par le fichier intégré
+  int pack = findPack(name);
+  if (pack >= 0 && atlasReload(name, packsIconCount(pack))) {
+    // Les cartes affichées sont redessinées avec les nouvelles icônes
+    printf("dobble: Pack '%s' rechargé.\n", p.packs[pack].name);
+    invalidateCardCache();
+    requestRedraw();
+  } else if (hasExtension(name, ".idx") && gameGlobal.packMask != 0) {
+    loadIconIndex(gameGlobal.packMask);
+  } else if (strcmp(name, "menus.ui") == 0 && uiLoad(name)) {
+    printf("dobble: Menus rechargés.\n");
+    requestRedraw();
+  }
+  free(name);
+}
+
+#ifdef __linux__
+/**
+ * Thread de surveillance du dossier de données : transmet le nom de chaque
+ * fichier modifié à la boucle principale.
+ */
+static int watchThreadMain(void *param) {
+  int fd = (int)(intptr_t)param;
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0)
+      break;
+    for (char *event = buffer; event < buffer + length;) {
+      struct inotify_event *e = (struct inotify_event *)event;
+      char *name = e->len > 0 ? strdup(e->name) : NULL;
+      // Événement ignoré si la copie du nom n'a pas pu être allouée
+      if (name != NULL)
+        callOnMainThread(onFileChanged, name);
+      event += sizeof(struct inotify_event) + e->len;
+    }
+  }
+  close(fd);
+  return 0;
+}
+#endif
+
+void packsWatch() {
+#ifdef __linux__
+  // Pas de surveillance sans dossier de données sur disque
+  const char *dataDirectory = assetsDirectory();
+  if (dataDirectory == NULL)
+    return;
+
+  // Fichiers écrits puis fermés, déplacés dans le dossier (enregistrement par
+  // renommage) ou supprimés
+  int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0 || inotify_add_watch(fd, dataDirectory,
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) <
+                    0) {
+    printf("dobble: Impossible de surveiller le dossier de données.\n");
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+  SDL_Thread *thread =
+      SDL_CreateThread(watchThreadMain, "packs-watch", (void *)(intptr_t)fd);
+  if (thread == NULL) {
+    printf("dobble: Echec de la création du thread de surveillance.\n");
+    close(fd);
+    return;
+  }
+  // Le thread reste bloqué en lecture jusqu'à la fin du programme
+  SDL_DetachThread(thread);
+#endif
+}
@@ -0,0 +1,475 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "clock.h"
+#include "deckindex.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "kernels.h"
+#include "race.h"
+#include "stats.h"
+
+// Noms des variantes (option --variant et titre de la partie)
+static const char *variantOptions[] = {"tour", "puits", "patate", "cadeau"};
+static const char *variantNames[] = {"La tour infernale", "Le puits",
+                                     "La patate chaude",
+                                     "Le cadeau empoisonné"};
+
+// Couleurs des joueurs (bord de leur carte et score)
+static const Uint8 playerColors[RACE_MAX_PLAYERS][3] = {
+    {200, 90, 180}, {90, 190, 190}, {225, 150, 50}, {90, 160, 60},
+    {80, 110, 210}, {210, 80, 80},  {150, 60, 10},  {120, 120, 120}};
+
+/**
+ * Joueur du mode course.
+ */
+typedef struct {
+  int card;            // indice de la carte du joueur dans le deck
+  int score, nbFalse;  // nombre de bonnes et de mauvaises réponses
+  int pile;            // cartes à poser (puits) ou reçues (patate chaude,
+                       // cadeau empoisonné)
+  int64_t lockedUntil; // fin du blocage après une erreur (en µs)
+  bool won;            // vrai si le dernier appui a remporté la carte centrale
+} RacePlayer;
+
+/**
+ * État du mode course.
+ */
+static struct Race {
+  int requestedPlayers; // nombre de joueurs demandé (0 : mode classique)
+  RaceVariant variant;
+  int nbPlayers;        // nombre de joueurs de la partie (limité par le deck)
+  RacePlayer players[RACE_MAX_PLAYERS];
+  int center;      // indice de la carte centrale dans le deck (-1 : aucune)
+  int64_t shownAt; // affichage des cartes en jeu après leur dernier
+                   // changement (en µs, 0 si pas encore affichées)
+  double labelY[RACE_MAX_PLAYERS]; // ordonnée du score de chaque joueur
+} r;
+
+void raceSetup(int nbPlayers, RaceVariant variant) {
+  if (nbPlayers > RACE_MAX_PLAYERS)
+    nbPlayers = RACE_MAX_PLAYERS;
+  if (nbPlayers < 2)
+    nbPlayers = 0;
+  r.requestedPlayers = nbPlayers;
+  r.variant = variant;
+}
+
+int raceParseVariant(const char *name, RaceVariant *variant) {
+  for (int v = RACE_TOWER; v <= RACE_POISONED_GIFT; v++) {
+    if (strcmp(name, variantOptions[v]) == 0) {
+      *variant = v;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+bool raceActive() { return r.requestedPlayers > 0; }
+
+/**
+ * Place les cartes des joueurs sur deux rangées (en haut et en bas de la
+ * fenêtre) et la carte centrale entre les deux, à l'échelle 1.
+ */
+static void layoutSlots() {
+  int top = (r.nbPlayers + 1) / 2, bottom = r.nbPlayers - top;
+  double radius = BASE_WIN_WIDTH / (2. * top) - 8;
+  if (radius > 95)
+    radius = 95;
+
+  double topY = 2.8 * BASE_FONT_SIZE + BASE_FONT_SIZE + radius + 4;
+  double bottomY = BASE_WIN_HEIGHT - BASE_FONT_SIZE - radius - 8;
+  for (int p = 0; p < r.nbPlayers; p++) {
+    bool upper = p < top;
+    int column = upper ? p : p - top, columns = upper ? top : bottom;
+    double y = upper ? topY : bottomY;
+    setCardSlot(PlayerCard + p, BASE_WIN_WIDTH * (column + 0.5) / columns, y,
+                radius);
+    // Score au-dessus des cartes du haut, en dessous des cartes du bas
+    r.labelY[p] = upper ? y - radius - 2 : y + radius + 6;
+  }
+
+  // Carte centrale dans l'espace restant
+  double spaceTop = topY + radius, spaceBottom = bottomY - radius;
+  double centerRadius = (spaceBottom - spaceTop) / 2 - 10;
+  if (centerRadius > 0.8 * BASE_CARD_RADIUS)
+    centerRadius = 0.8 * BASE_CARD_RADIUS;
+  setCardSlot(CenterCard, BASE_WIN_WIDTH / 2., (spaceTop + spaceBottom) / 2,
+              centerRadius);
+}
+
+/**
+ * Prépare une carte du deck pour une position : nouvelle disposition
+ * aléatoire de ses icônes, puis calcul de leurs positions.
+ */
+static void dealCard(CardPosition pos, int index) {
+  Card card = gameGlobal.cards[index];
+  cardKernels()->sortIcons(card.icons);
+  cardKernels()->shuffle(card.icons);
+  cardKernels()->placeIcons(card.icons);
+  layoutCard(pos, card);
+}
+
+/**
+ * Indique si une carte du deck est en jeu (carte centrale ou carte d'un
+ * joueur).
+ */
+static bool inPlay(int index) {
+  if (index == r.center)
+    return true;
+  for (int p = 0; p < r.nbPlayers; p++) {
+    if (r.players[p].card == index)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Tire une carte du deck qui n'est pas en jeu et différente d'une carte donnée.
+ */
+static int drawFreeCard(int excluded) {
+  int index;
+  do {
+    index = randomInt(gameGlobal.nbCards);
+  } while (inPlay(index) || index == excluded);
+  return index;
+}
+
+void raceDeal() {
+  // Il faut au moins une carte libre en plus des cartes en jeu pour remplacer
+  // la carte centrale
+  r.nbPlayers = r.requestedPlayers;
+  if (r.nbPlayers > gameGlobal.nbCards - 2) {
+    r.nbPlayers = gameGlobal.nbCards - 2;
+    printf("dobble: Deck trop petit, partie limitée à %d joueurs.\n",
+           r.nbPlayers);
+  }
+  layoutSlots();
+
+  // Au puits, le deck (sauf la carte centrale) est partagé entre les joueurs
+  int pile = r.variant == RACE_WELL ? (gameGlobal.nbCards - 1) / r.nbPlayers
+                                    : 0;
+  r.center = -1;
+  for (int p = 0; p < r.nbPlayers; p++)
+    r.players[p].card = -1;
+  for (int p = 0; p < r.nbPlayers; p++) {
+    RacePlayer *player = &r.players[p];
+    player->card = drawFreeCard(-1);
+    player->score = player->nbFalse = 0;
+    player->pile = pile;
+    player->lockedUntil = 0;
+    player->won = false;
+    dealCard(PlayerCard + p, player->card);
+  }
+  if (r.variant != RACE_HOT_POTATO) {
+    r.center = drawFreeCard(-1);
+    dealCard(CenterCard, r.center);
+  }
+  r.shownAt = 0;
+}
+
+/**
+ * Retourne le joueur dont la carte contient un point donné, -1 si aucun.
+ */
+static int playerAt(int x, int y) {
+  for (int p = 0; p < r.nbPlayers; p++) {
+    int cx, cy;
+    getCardCenter(PlayerCard + p, &cx, &cy);
+    if (dist(x, y, cx, cy) <= getCardRadius(PlayerCard + p))
+      return p;
+  }
+  return -1;
+}
+
+/**
+ * Retourne l'icône d'une carte qui contient un point donné, NULL si aucune.
+ */
+static Icon *iconAt(CardPosition pos, Card card, int x, int y) {
+  for (int i = 0; i < gameGlobal.nbIcons; i++) {
+    Icon *icon = &card.icons[i];
+    if (dist(x, y, icon->centerX, icon->centerY) <=
+        getIconDrawSize(pos, *icon) / 2.)
+      return icon;
+  }
+  return NULL;
+}
+
+/**
+ * Retourne l'icône d'une carte qui porte un symbole donné, NULL si aucune.
+ */
+static Icon *iconOf(Card card, int symbol) {
+  int i = cardKernels()->findSymbol(card.icons, symbol);
+  return i >= 0 ? &card.icons[i] : NULL;
+}
+
+/**
+ * Retourne le joueur qui porte sur sa carte un symbole donné, -1 si aucun.
+ * Les cartes des joueurs sont cherchées en une intersection d'ensembles.
+ *
+ * @param symbol   Le symbole
+ * @param excluded Le joueur dont la carte n'est pas prise en compte (-1 :
+ *                 aucun)
+ */
+static int playerHolding(int symbol, int excluded) {
+  CardSet cards = {{0}};
+  for (int p = 0; p < r.nbPlayers; p++) {
+    if (p != excluded)
+      cardSetAdd(&cards, r.players[p].card);
+  }
+  int card = deckIndexFindHolder(symbol, &cards);
+  for (int p = 0; p < r.nbPlayers; p++) {
+    if (p != excluded && r.players[p].card == card)
+      return p;
+  }
+  return -1;
+}
+
+/**
+ * Donne une carte du deck à un joueur, à la place de sa carte courante.
+ */
+static void giveCard(int p, int card) {
+  r.players[p].card = card;
+  layoutCard(PlayerCard + p, gameGlobal.cards[card]);
+}
+
+/**
+ * Remplace la carte centrale par une nouvelle carte du deck.
+ *
+ * @param excluded Une carte qui ne doit pas être tirée (-1 : aucune)
+ */
+static void replaceCenter(int excluded) {
+  r.center = drawFreeCard(excluded);
+  dealCard(CenterCard, r.center);
+}
+
+/**
+ * Bonne réponse d'un joueur : la carte touchée change de place selon la
+ * variante.
+ *
+ * @param p        Le joueur
+ * @param receiver Le joueur qui reçoit la carte (patate chaude)
+ */
+static void onCorrectAnswer(int p, int receiver) {
+  RacePlayer *player = &r.players[p];
+  int previous = player->card, discarded;
+  player->score++;
+  player->won = true;
+
+  switch (r.variant) {
+  case RACE_TOWER:
+    // Le joueur prend la carte centrale, remplacée par une carte du deck
+    giveCard(p, r.center);
+    replaceCenter(previous);
+    break;
+  case RACE_WELL:
+    // Le joueur pose sa carte au centre et prend la suivante de sa pile
+    discarded = r.center;
+    r.center = previous;
+    layoutCard(CenterCard, gameGlobal.cards[r.center]);
+    if (--player->pile == 0) {
+      printf("dobble: Joueur %d : pile vidée.\n", p + 1);
+      finishRound();
+      return;
+    }
+    player->card = drawFreeCard(discarded);
+    dealCard(PlayerCard + p, player->card);
+    break;
+  case RACE_HOT_POTATO:
+    // Le joueur donne sa carte et les cartes reçues, puis reçoit une nouvelle
+    // carte du deck
+    discarded = r.players[receiver].card;
+    r.players[receiver].pile += player->pile + 1;
+    player->pile = 0;
+    giveCard(receiver, previous);
+    player->card = drawFreeCard(discarded);
+    dealCard(PlayerCard + p, player->card);
+    break;
+  case RACE_POISONED_GIFT:
+    // Appuis sur la carte centrale (giveCenterCard)
+    break;
+  }
+}
+
+/**
+ * Traite un appui sur la carte centrale au cadeau empoisonné : la carte
+ * centrale est donnée au joueur dont la carte porte le symbole touché.
+ */
+static void giveCenterCard(int x, int y) {
+  int cx, cy;
+  getCardCenter(CenterCard, &cx, &cy);
+  if (dist(x, y, cx, cy) > getCardRadius(CenterCard))
+    return;
+  Icon *touched = iconAt(CenterCard, gameGlobal.cards[r.center], x, y);
+  int receiver = touched != NULL ? playerHolding(touched->iconId, -1) : -1;
+  if (receiver < 0)
+    return;
+
+  // L'auteur de l'appui n'est pas connu : pas de temps de réaction par joueur
+  printf("dobble: Carte centrale donnée au joueur %d.\n", receiver + 1);
+  RacePlayer *player = &r.players[receiver];
+  int previous = player->card;
+  player->pile++;
+  giveCard(receiver, r.center);
+  replaceCenter(previous);
+  r.shownAt = 0;
+  renderScene();
+}
+
+void raceOnPointerDown(int x, int y, int64_t at) {
+  // Appui antérieur au dernier changement des cartes en jeu (il visait les
+  // cartes précédentes)
+  if (r.shownAt == 0 || at < r.shownAt)
+    return;
+  if (r.variant == RACE_POISONED_GIFT) {
+    giveCenterCard(x, y);
+    return;
+  }
+  int p = playerAt(x, y);
+  if (p < 0)
+    return;
+  RacePlayer *player = &r.players[p];
+  if (at < player->lockedUntil)
+    return;
+
+  Card card = gameGlobal.cards[player->card];
+  int reaction = (int)usToMs(at - r.shownAt);
+  int receiver = -1;
+  bool correct;
+  if (r.variant == RACE_HOT_POTATO) {
+    // Le symbole touché doit être sur la carte d'un autre joueur
+    Icon *touched = iconAt(PlayerCard + p, card, x, y);
+    if (touched != NULL)
+      receiver = playerHolding(touched->iconId, p);
+    correct = receiver >= 0;
+    if (touched != NULL)
+      statsRecordAnswer(p, gameGlobal.nbIcons, touched->imageId, reaction,
+                        correct);
+  } else {
+    // Symbole commun avec la carte centrale
+    Icon *target =
+        iconOf(card, deckIndexCommonSymbol(player->card, r.center));
+    if (target == NULL)
+      return;
+    correct = dist(x, y, target->centerX, target->centerY) <=
+              getIconDrawSize(PlayerCard + p, *target) / 2.;
+    statsRecordAnswer(p, gameGlobal.nbIcons, target->imageId, reaction,
+                      correct);
+  }
+
+  if (correct) {
+    printf("dobble: Joueur %d : bonne réponse en %d ms.\n", p + 1, reaction);
+    onCorrectAnswer(p, receiver);
+    r.shownAt = 0;
+  } else {
+    player->nbFalse++;
+    player->lockedUntil = at + msToUs(RACE_LOCKOUT_MS);
+  }
+  renderScene();
+}
+
+/**
+ * Retourne le nombre affiché pour un joueur : son score à la tour infernale,
+ * le nombre de cartes de sa pile sinon.
+ */
+static int playerCount(const RacePlayer *player) {
+  return r.variant == RACE_TOWER ? player->score : player->pile;
+}
+
+/**
+ * Indique si un joueur est mieux classé qu'un autre : meilleur score à la tour
+ * infernale, moins de cartes dans sa pile sinon, puis moins d'erreurs.
+ */
+static bool ranksBefore(const RacePlayer *a, const RacePlayer *b) {
+  int countA = playerCount(a), countB = playerCount(b);
+  if (countA != countB)
+    return r.variant == RACE_TOWER ? countA > countB : countA < countB;
+  return a->nbFalse < b->nbFalse;
+}
+
+void raceRender() {
+  char title[100];
+  int64_t now = clockNow();
+
+  clearWindow();
+
+  sprintf(title, "Dobble : %s à %d", variantNames[r.variant], r.nbPlayers);
+  drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+  sprintf(title, "Temps restant : %d.%ds", gameGlobal.time / 1000,
+          (gameGlobal.time % 1000) / 100);
+  drawText(title, WIN_WIDTH / 2, 1.6 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  // Chaque carte est rendue une fois par tirage puis recopiée : le coût d'une
+  // image ne dépend presque pas du nombre de joueurs
+  if (r.center >= 0)
+    drawCardCached(CenterCard, gameGlobal.cards[r.center], 5, CARDCOLOR,
+                   CARDCOLOR, CARDCOLOR, CARDBORDER, CARDBORDER, CARDBORDER);
+  for (int p = 0; p < r.nbPlayers; p++) {
+    RacePlayer *player = &r.players[p];
+    const Uint8 *color = playerColors[p];
+    Uint8 border[3] = {color[0], color[1], color[2]};
+    if (player->won) {
+      border[0] = 0, border[1] = 200, border[2] = 0;
+      player->won = false;
+    } else if (now < player->lockedUntil) {
+      border[0] = 220, border[1] = 0, border[2] = 0;
+    }
+    drawCardCached(PlayerCard + p, gameGlobal.cards[player->card], 4,
+                   CARDCOLOR, CARDCOLOR, CARDCOLOR, border[0], border[1],
+                   border[2]);
+
+    int cx, cy;
+    getCardCenter(PlayerCard + p, &cx, &cy);
+    sprintf(title, "J%d : %d", p + 1, playerCount(player));
+    drawText(title, cx, r.labelY[p] * WIN_SCALE, Center,
+             p < (r.nbPlayers + 1) / 2 ? Bottom : Top, color[0], color[1],
+             color[2]);
+  }
+
+  showWindow();
+
+  // Première image des cartes en jeu : début des temps de réaction
+  if (r.shownAt == 0)
+    r.shownAt = clockNow();
+}
+
+void raceShowResults() {
+  char title[100];
+
+  int best = 0;
+  for (int p = 1; p < r.nbPlayers; p++) {
+    if (ranksBefore(&r.players[p], &r.players[best]))
+      best = p;
+  }
+  sprintf(title, "Vainqueur : joueur %d (%d %s)", best + 1,
+          playerCount(&r.players[best]),
+          r.variant == RACE_TOWER ? "points" : "cartes");
+  drawText(title, WIN_WIDTH / 2, 0.4 * FONT_SIZE, Center, Top,
+           playerColors[best][0], playerColors[best][1], playerColors[best][2]);
+
+  // Scores de tous les joueurs, quatre par ligne
+  for (int line = 0; line * 4 < r.nbPlayers; line++) {
+    int length = 0;
+    title[0] = '\0';
+    for (int p = line * 4; p < r.nbPlayers && p < line * 4 + 4; p++) {
+      length += snprintf(title + length, sizeof(title) - length, "%sJ%d : %d",
+                         length ? "   " : "", p + 1,
+                         playerCount(&r.players[p]));
+    }
+    drawText(title, WIN_WIDTH / 2, (1.6 + 1.2 * line) * FONT_SIZE, Center, Top,
+             TEXTCOLOR, TEXTCOLOR, TEXTCOLOR);
+  }
+
+  sprintf(title, "Bravo ! Et merci d'avoir joué !");
+  drawText(title, WIN_WIDTH / 2, 4 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+
+  sprintf(title, "Voulez-vous rejouer ?");
+  drawText(title, WIN_WIDTH / 2, 5.2 * FONT_SIZE, Center, Top, TEXTCOLOR,
+           TEXTCOLOR, TEXTCOLOR);
+}
@@ -0,0 +1,557 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "clock.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "iconmap.h"
+#include "replay.h"
+
+typedef enum { REPLAY_OFF, REPLAY_RECORD, REPLAY_PLAYBACK } ReplayMode;
+
+/**
+ * Tampon d'octets d'un enregistrement (en écriture ou en lecture).
+ */
+typedef struct {
+  uint8_t *data;
+  size_t size;     // nombre d'octets utilisés (écriture) ou disponibles (lecture)
+  size_t capacity; // capacité du tampon (écriture)
+  size_t pos;      // position de lecture
+} ReplayBuffer;
+
+/**
+ * Écriture en arrière-plan d'un tampon d'enregistrement.
+ */
+typedef struct {
+  ReplayBuffer buffer;
+  const char *fileName;
+} FlushJob;
+
+/**
+ * Évènement d'un enregistrement décodé.
+ */
+typedef struct {
+  ReplayEventType type;
+  int64_t at;       // instant depuis le début de la partie (µs)
+  int a, b;         // indices (tirage), position (clic), score/erreurs (fin)
+} ReplayEvent;
+
+/**
+ * État de l'enregistrement ou de la relecture.
+ */
+static struct ReplayState {
+  ReplayMode mode;
+  const char *fileName;
+
+  // Enregistrement
+  ReplayBuffer buffer;
+  bool overflow;
+  SDL_Thread *flushThread;
+
+  // Instant du début de la partie et du dernier évènement horodaté (µs)
+  int64_t roundStart;
+  int64_t lastEventAt;
+  int lastX, lastY;
+
+  // Relecture
+  ReplayBuffer input;
+  ReplayEvent next; // prochain évènement à rejouer
+  int dealUpper, dealLower; // dernier tirage effectué pendant la relecture
+  bool injecting;   // vrai pendant l'envoi d'un clic rejoué
+  int divergences;  // nombre de différences constatées
+} r;
+
+/****************** ENCODAGE ******************/
+
+/**
+ * Ajoute un octet au tampon d'enregistrement. Aucune allocation n'est
+ * effectuée : si le tampon est plein, l'enregistrement est interrompu.
+ */
+static void putByte(uint8_t byte) {
+  if (r.buffer.size >= r.buffer.capacity) {
+    r.overflow = true;
+    return;
+  }
+  r.buffer.data[r.buffer.size++] = byte;
+}
+
+/**
+ * Ajoute un entier non signé encodé en varint (7 bits par octet).
+ */
+static void putVarint(uint64_t value) {
+  while (value >= 0x80) {
+    putByte((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  putByte((uint8_t)value);
+}
+
+/**
+ * Ajoute un entier signé encodé en zigzag puis en varint.
+ */
+static void putSigned(int64_t value) {
+  putVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/**
+ * Ajoute la différence de temps depuis le dernier évènement horodaté.
+ *
+ * @param at L'instant de l'évènement (en µs, horloge monotone)
+ */
+static void putTime(int64_t at) {
+  putVarint((uint64_t)(at - r.lastEventAt));
+  r.lastEventAt = at;
+}
+
+/**
+ * Lit un entier encodé en varint, 0 si la fin du tampon est atteinte.
+ */
+static bool getVarint(ReplayBuffer *buffer, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (buffer->pos >= buffer->size)
+      return false;
+    uint8_t byte = buffer->data[buffer->pos++];
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static bool getSigned(ReplayBuffer *buffer, int64_t *value) {
+  uint64_t zigzag;
+  if (!getVarint(buffer, &zigzag))
+    return false;
+  *value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  return true;
+}
+
+/****************** ENREGISTREMENT ******************/
+
+/**
+ * Écrit un tampon d'enregistrement à la fin du fichier (thread d'écriture).
+ */
+static int flushThreadMain(void *param) {
+  FlushJob *job = param;
+  FILE *file = fopen(job->fileName, "ab");
+  if (file == NULL ||
+      fwrite(job->buffer.data, 1, job->buffer.size, file) != job->buffer.size)
+    printf("dobble: Echec de l'écriture de l'enregistrement '%s'.\n",
+           job->fileName);
+  if (file != NULL)
+    fclose(file);
+  free(job->buffer.data);
+  free(job);
+  return 0;
+}
+
+/**
+ * Attend la fin de l'écriture en arrière-plan précédente.
+ */
+static void waitFlush() {
+  if (r.flushThread != NULL) {
+    SDL_WaitThread(r.flushThread, NULL);
+    r.flushThread = NULL;
+  }
+}
+
+int replayStartRecording(const char *fileName) {
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL) {
+    printf("dobble: Impossible de créer l'enregistrement '%s'.\n", fileName);
+    return 0;
+  }
+  fclose(file);
+  r.mode = REPLAY_RECORD;
+  r.fileName = fileName;
+  return 1;
+}
+
+void replayBeginRound() {
+  r.roundStart = r.lastEventAt = clockNow();
+  r.lastX = r.lastY = 0;
+  if (r.mode != REPLAY_RECORD)
+    return;
+
+  // Le tampon est alloué en début de partie, jamais pendant la partie
+  r.buffer.data = malloc(REPLAY_BUFFER_SIZE);
+  r.buffer.capacity = r.buffer.data != NULL ? REPLAY_BUFFER_SIZE : 0;
+  r.buffer.size = 0;
+  r.overflow = false;
+
+  // En-tête du segment
+  putByte('D');
+  putByte('O');
+  putByte('B');
+  putByte('R');
+  putByte(REPLAY_VERSION);
+  putVarint(gameGlobal.rngState);
+  putVarint(gameGlobal.packMask);
+  putVarint(gameGlobal.nbIcons);
+  putVarint(gameGlobal.score);
+  putVarint(gameGlobal.nbFalse);
+
+  // Icônes choisies pour les symboles du deck
+  int size;
+  const int *table = iconMapTable(&size);
+  putVarint(size);
+  for (int s = 0; s < size; s++)
+    putVarint(table[s]);
+}
+
+void replayDeal(int upper, int lower) {
+  if (r.mode == REPLAY_RECORD) {
+    putByte(REPLAY_DEAL);
+    putVarint(upper);
+    putVarint(lower);
+  } else if (r.mode == REPLAY_PLAYBACK) {
+    // Relecture : le tirage sera comparé à l'évènement enregistré qui suit
+    r.dealUpper = upper;
+    r.dealLower = lower;
+  }
+}
+
+void replayRecordShown(int64_t shownAt) {
+  if (r.mode != REPLAY_RECORD)
+    return;
+  putByte(REPLAY_SHOWN);
+  putTime(shownAt);
+}
+
+void replayRecordClick(int x, int y, int64_t at) {
+  if (r.mode != REPLAY_RECORD)
+    return;
+  // Coordonnées logiques, indépendantes de l'échelle de la fenêtre
+  x = lround(x * REPLAY_CLICK_UNIT / WIN_SCALE);
+  y = lround(y * REPLAY_CLICK_UNIT / WIN_SCALE);
+  putByte(REPLAY_CLICK);
+  putTime(at);
+  putSigned(x - r.lastX);
+  putSigned(y - r.lastY);
+  r.lastX = x;
+  r.lastY = y;
+}
+
+/****************** RELECTURE ******************/
+
+/**
+ * Rejoue le clic courant, converti à l'échelle de la fenêtre.
+ */
+static void injectClick() {
+  r.injecting = true;
+  onMouseClick(lround(r.next.a * WIN_SCALE / REPLAY_CLICK_UNIT),
+               lround(r.next.b * WIN_SCALE / REPLAY_CLICK_UNIT));
+  r.injecting = false;
+}
+
+/**
+ * Lit l'en-tête d'un segment et prépare la partie correspondante.
+ *
+ * @return 1 si un segment a été lu, 0 à la fin du fichier ou en cas d'erreur
+ */
+static int readSegmentHeader(bool loadPack) {
+  ReplayBuffer *in = &r.input;
+  if (in->pos + 5 > in->size || memcmp(in->data + in->pos, "DOBR", 4) != 0 ||
+      in->data[in->pos + 4] != REPLAY_VERSION)
+    return 0;
+  in->pos += 5;
+
+  uint64_t seed, packMask, nbIcons, score, nbFalse, size;
+  if (!getVarint(in, &seed) || !getVarint(in, &packMask) ||
+      !getVarint(in, &nbIcons) || !getVarint(in, &score) ||
+      !getVarint(in, &nbFalse) || !getVarint(in, &size) ||
+      size > ICON_MAP_MAX_SYMBOLS)
+    return 0;
+  int table[ICON_MAP_MAX_SYMBOLS];
+  for (uint64_t s = 0; s < size; s++) {
+    uint64_t iconId;
+    if (!getVarint(in, &iconId))
+      return 0;
+    table[s] = (int)iconId;
+  }
+
+  // Chargement du pack et du deck s'ils diffèrent de la partie précédente.
+  // Sans fenêtre, seul l'index de similarité des packs est chargé : il
+  // influence les tirages
+  if (!gameGlobal.iconPackChosen || gameGlobal.packMask != (int)packMask) {
+    if (loadPack ? !loadIconPacks(packMask) : !loadIconIndex(packMask))
+      return 0;
+  }
+  gameGlobal.packMask = packMask;
+  gameGlobal.iconPackChosen = true;
+  if (!gameGlobal.nbIconChosen || gameGlobal.nbIcons != (int)nbIcons) {
+    if (gameGlobal.nbIconChosen)
+      freeDeck();
+    if (!loadDeck(nbIcons))
+      return 0;
+  }
+  gameGlobal.nbIconChosen = true;
+  iconMapSet(table, size);
+
+  seedRandom(seed);
+  gameGlobal.score = score;
+  gameGlobal.nbFalse = nbFalse;
+  gameGlobal.resultatClic = INDEFINI;
+  return 1;
+}
+
+/**
+ * Décode le prochain évènement du segment courant.
+ *
+ * @return 1 si un évènement a été lu, 0 en cas d'erreur
+ */
+static int readEvent() {
+  ReplayBuffer *in = &r.input;
+  uint64_t a = 0, b = 0, dt = 0;
+  int64_t dx, dy;
+
+  if (in->pos >= in->size)
+    return 0;
+  r.next.type = in->data[in->pos++];
+  switch (r.next.type) {
+  case REPLAY_DEAL:
+    if (!getVarint(in, &a) || !getVarint(in, &b))
+      return 0;
+    r.next.a = a;
+    r.next.b = b;
+    break;
+  case REPLAY_SHOWN:
+    if (!getVarint(in, &dt))
+      return 0;
+    r.next.at += dt;
+    break;
+  case REPLAY_CLICK:
+    if (!getVarint(in, &dt) || !getSigned(in, &dx) || !getSigned(in, &dy))
+      return 0;
+    r.next.at += dt;
+    r.lastX += dx;
+    r.lastY += dy;
+    r.next.a = r.lastX;
+    r.next.b = r.lastY;
+    break;
+  case REPLAY_END:
+    if (!getVarint(in, &dt) || !getVarint(in, &a) || !getVarint(in, &b))
+      return 0;
+    r.next.at += dt;
+    r.next.a = a;
+    r.next.b = b;
+    break;
+  default:
+    printf("dobble: Evènement d'enregistrement inconnu (%d).\n", r.next.type);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Charge un fichier d'enregistrement en mémoire.
+ */
+static int loadReplayFile(const char *fileName) {
+  FILE *file = fopen(fileName, "rb");
+  if (file == NULL) {
+    printf("dobble: Impossible d'ouvrir l'enregistrement '%s'.\n", fileName);
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  r.input.data = malloc(size > 0 ? size : 1);
+  r.input.size = r.input.data != NULL && size > 0
+                     ? fread(r.input.data, 1, size, file)
+                     : 0;
+  r.input.pos = 0;
+  fclose(file);
+
+  r.mode = REPLAY_PLAYBACK;
+  r.fileName = fileName;
+  r.divergences = 0;
+  return 1;
+}
+
+/**
+ * Démarre la partie du segment courant (après lecture de son en-tête).
+ */
+static void startSegment() {
+  r.next.type = 0;
+  r.next.at = 0;
+  r.lastX = r.lastY = 0;
+  gameGlobal.timerRunning = false;
+  startRound();
+}
+
+/**
+ * Vérifie que le dernier tirage effectué est celui de l'enregistrement.
+ */
+static void checkDeal() {
+  if (r.next.a != r.dealUpper || r.next.b != r.dealLower) {
+    printf("dobble: Relecture divergente : tirage (%d, %d) au lieu de "
+           "(%d, %d).\n",
+           r.dealUpper, r.dealLower, r.next.a, r.next.b);
+    r.divergences++;
+  }
+}
+
+/**
+ * Vérifie le résultat d'une partie relue.
+ */
+static void checkResult() {
+  if (gameGlobal.score != r.next.a || gameGlobal.nbFalse != r.next.b) {
+    printf("dobble: Relecture divergente : score %d (%d erreurs) au lieu de "
+           "%d (%d erreurs).\n",
+           gameGlobal.score, gameGlobal.nbFalse, r.next.a, r.next.b);
+    r.divergences++;
+  }
+}
+
+/**
+ * Rejoue les évènements de tirage (instantanés) jusqu'au prochain évènement
+ * horodaté, puis planifie celui-ci.
+ */
+static void scheduleNextEvent();
+
+static void playbackEvent(void *param) {
+  (void)param;
+  switch (r.next.type) {
+  case REPLAY_CLICK:
+    injectClick();
+    break;
+  case REPLAY_END:
+    // Fin de la partie enregistrée : segment suivant s'il y en a un
+    updateRemainingTime();
+    checkResult();
+    if (readSegmentHeader(true)) {
+      startSegment();
+      renderScene();
+    } else {
+      printf("dobble: Fin de la relecture (%d divergence(s)).\n",
+             r.divergences);
+      return;
+    }
+    break;
+  default:
+    break;
+  }
+  scheduleNextEvent();
+}
+
+static void scheduleNextEvent() {
+  // Les tirages sont vérifiés immédiatement, les affichages réels remplacent
+  // les affichages enregistrés
+  do {
+    if (!readEvent()) {
+      printf("dobble: Fin de la relecture (%d divergence(s)).\n",
+             r.divergences);
+      return;
+    }
+    if (r.next.type == REPLAY_DEAL)
+      checkDeal();
+  } while (r.next.type == REPLAY_DEAL || r.next.type == REPLAY_SHOWN);
+
+  int64_t delay = r.next.at - (clockNow() - r.roundStart);
+  callLater(playbackEvent, NULL, delay > 0 ? (Uint32)usToMs(delay) : 0);
+}
+
+int replayStartPlayback(const char *fileName) {
+  if (!loadReplayFile(fileName))
+    return 0;
+  if (!readSegmentHeader(true)) {
+    printf("dobble: Enregistrement '%s' invalide.\n", fileName);
+    return 0;
+  }
+  startSegment();
+  renderScene();
+  scheduleNextEvent();
+  return 1;
+}
+
+int replayRunHeadless(const char *fileName) {
+  if (!loadReplayFile(fileName))
+    return 1;
+
+  int rounds = 0;
+  gameGlobal.headless = true;
+  while (readSegmentHeader(false)) {
+    // Horloge virtuelle : la partie commence à un instant arbitraire
+    int64_t origin = msToUs(ROUND_DURATION_MS);
+    clockSetVirtual(origin);
+    startSegment();
+    rounds++;
+
+    bool ended = false;
+    while (!ended && readEvent()) {
+      clockSetVirtual(origin + r.next.at);
+      switch (r.next.type) {
+      case REPLAY_DEAL:
+        checkDeal();
+        break;
+      case REPLAY_SHOWN:
+        gameGlobal.pairShownAt = clockNow();
+        break;
+      case REPLAY_CLICK:
+        injectClick();
+        break;
+      case REPLAY_END:
+        updateRemainingTime();
+        stopTimer();
+        checkResult();
+        ended = true;
+        break;
+      }
+    }
+    if (!ended) {
+      printf("dobble: Enregistrement tronqué (partie %d).\n", rounds);
+      r.divergences++;
+      break;
+    }
+  }
+  clockSetVirtual(-1);
+
+  printf("dobble: %d partie(s) relue(s), %d divergence(s).\n", rounds,
+         r.divergences);
+  free(r.input.data);
+  return rounds > 0 && r.divergences == 0 ? 0 : 1;
+}
+
+bool replayAcceptsClick() { return r.mode != REPLAY_PLAYBACK || r.injecting; }
+
+bool replayPlaying() { return r.mode == REPLAY_PLAYBACK; }
+
+/****************** FIN DE PARTIE ******************/
+
+void replayEndRound(int score, int nbFalse) {
+  if (r.mode != REPLAY_RECORD || r.buffer.data == NULL)
+    return;
+
+  putByte(REPLAY_END);
+  putTime(clockNow());
+  putVarint(score);
+  putVarint(nbFalse);
+  if (r.overflow)
+    printf("dobble: Enregistrement tronqué (tampon plein).\n");
+
+  // Écriture en arrière-plan : le tampon appartient désormais au thread
+  waitFlush();
+  FlushJob *job = malloc(sizeof(FlushJob));
+  if (job == NULL)
+    return;
+  job->buffer = r.buffer;
+  job->fileName = r.fileName;
+  r.flushThread = SDL_CreateThread(flushThreadMain, "replay-flush", job);
+  if (r.flushThread == NULL)
+    flushThreadMain(job);
+  SDL_zero(r.buffer);
+}
+
+void replayShutdown() {
+  waitFlush();
+  free(r.buffer.data);
+  SDL_zero(r.buffer);
+}
@@ -0,0 +1,328 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scores.h"
+
+/* Taille de l'en-tête du fichier */
+#define HEADER_SIZE 32
+
+/* Nombre d'octets couverts par la somme de contrôle d'une partie */
+#define CHECKED_SIZE offsetof(ScoreRecord, check)
+
+_Static_assert(sizeof(ScoreRecord) == 32, "partie de 32 octets");
+
+/**
+ * En-tête du fichier des scores.
+ */
+typedef struct {
+  char magic[4]; // "DOBS"
+  uint32_t version;
+  uint32_t recordSize;
+  uint8_t reserved[HEADER_SIZE - 12];
+} FileHeader;
+
+/**
+ * Classement des parties d'un deck, de packs et d'un mode de jeu.
+ */
+typedef struct {
+  uint64_t key; // voir boardKey
+  int count;    // nombre de parties
+  int nbTop;
+  ScoreRecord top[SCORES_TOP]; // meilleures parties (ex aequo : la première)
+  int32_t tree[SCORES_MAX_VALUE + 2]; // arbre de Fenwick (indices 1 à
+                                      // SCORES_MAX_VALUE + 1)
+} Board;
+
+static struct {
+  int fd;
+  unsigned char *map; // projection du fichier (NULL si fermé)
+  size_t capacity;    // nombre de parties que le fichier peut contenir
+  long count;         // nombre de parties de l'historique
+  Board *boards[SCORES_MAX_BOARDS]; // table de hachage, adressage ouvert
+} store = {.fd = -1};
+
+/**
+ * Somme de contrôle d'une partie (FNV-1a, jamais nulle : une case remplie de
+ * zéros n'est pas une partie).
+ */
+static uint32_t checksum(const ScoreRecord *record) {
+  const unsigned char *bytes = (const unsigned char *)record;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < CHECKED_SIZE; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash != 0 ? hash : 1;
+}
+
+/**
+ * Retourne une partie de la projection.
+ */
+static ScoreRecord *recordAt(size_t i) {
+  return (ScoreRecord *)(store.map + HEADER_SIZE) + i;
+}
+
+/**
+ * Projette le fichier agrandi pour contenir un nombre de parties donné.
+ */
+static int mapFile(size_t capacity) {
+  size_t size = HEADER_SIZE + capacity * sizeof(ScoreRecord);
+  if (store.map != NULL)
+    munmap(store.map, HEADER_SIZE + store.capacity * sizeof(ScoreRecord));
+  store.map = NULL;
+  if (ftruncate(store.fd, (off_t)size) != 0)
+    return 0;
+  void *map =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, store.fd, 0);
+  if (map == MAP_FAILED)
+    return 0;
+  store.map = map;
+  store.capacity = capacity;
+  return 1;
+}
+
+/**
+ * Clé du classement d'une partie.
+ */
+static uint64_t boardKey(int nbIcons, uint32_t packs, int flags) {
+  return (uint64_t)packs << 32 | (uint32_t)(nbIcons & 0xFF) |
+         (uint32_t)(flags & 0xFF) << 8 | 1u << 31;
+}
+
+/**
+ * Cherche le classement d'une clé.
+ *
+ * @param  key    La clé
+ * @param  create Crée le classement s'il n'existe pas
+ * @return        Le classement, NULL s'il n'existe pas (ou si la table est
+ *                pleine)
+ */
+static Board *findBoard(uint64_t key, bool create) {
+  unsigned slot =
+      ((uint32_t)(key ^ key >> 32) * 2654435761u) % SCORES_MAX_BOARDS;
+  for (int i = 0; i < SCORES_MAX_BOARDS; i++) {
+    Board *board = store.boards[slot];
+    if (board == NULL) {
+      if (!create)
+        return NULL;
+      board = calloc(1, sizeof(Board));
+      if (board != NULL)
+        board->key = key;
+      store.boards[slot] = board;
+      return board;
+    }
+    if (board->key == key)
+      return board;
+    slot = (slot + 1) % SCORES_MAX_BOARDS;
+  }
+  return NULL;
+}
+
+/**
+ * Indice d'un score dans l'arbre de Fenwick.
+ */
+static int treeIndex(int score) {
+  if (score < 0)
+    score = 0;
+  if (score > SCORES_MAX_VALUE)
+    score = SCORES_MAX_VALUE;
+  return score + 1;
+}
+
+/**
+ * Nombre de parties du classement dont le score est supérieur à un score
+ * donné.
+ */
+static int countAbove(const Board *board, int score) {
+  int atMost = 0;
+  for (int i = treeIndex(score); i > 0; i -= i & -i)
+    atMost += board->tree[i];
+  return board->count - atMost;
+}
+
+/**
+ * Ajoute une partie à un classement.
+ */
+static void boardAdd(Board *board, const ScoreRecord *record) {
+  for (int i = treeIndex(record->score); i <= SCORES_MAX_VALUE + 1;
+       i += i & -i)
+    board->tree[i]++;
+  board->count++;
+
+  int pos = board->nbTop;
+  while (pos > 0 && board->top[pos - 1].score < record->score)
+    pos--;
+  if (pos == SCORES_TOP)
+    return;
+  if (board->nbTop < SCORES_TOP)
+    board->nbTop++;
+  memmove(&board->top[pos + 1], &board->top[pos],
+          (board->nbTop - 1 - pos) * sizeof(ScoreRecord));
+  board->top[pos] = *record;
+}
+
+/**
+ * Ajoute une partie de l'historique aux classements.
+ */
+static Board *indexRecord(const ScoreRecord *record) {
+  Board *board = findBoard(
+      boardKey(record->nbIcons, record->packs, record->flags), true);
+  if (board != NULL)
+    boardAdd(board, record);
+  return board;
+}
+
+/**
+ * Libère les classements.
+ */
+static void freeBoards() {
+  for (int i = 0; i < SCORES_MAX_BOARDS; i++) {
+    free(store.boards[i]);
+    store.boards[i] = NULL;
+  }
+}
+
+/**
+ * Lit ou écrit l'en-tête du fichier.
+ */
+static int checkHeader(const char *fileName, off_t size) {
+  FileHeader header;
+  if (size == 0) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "DOBS", 4);
+    header.version = SCORES_VERSION;
+    header.recordSize = sizeof(ScoreRecord);
+    if (pwrite(store.fd, &header, sizeof(header), 0) == sizeof(header))
+      return 1;
+  } else if (size >= HEADER_SIZE &&
+             pread(store.fd, &header, sizeof(header), 0) == sizeof(header) &&
+             memcmp(header.magic, "DOBS", 4) == 0 &&
+             header.version == SCORES_VERSION &&
+             header.recordSize == sizeof(ScoreRecord)) {
+    return 1;
+  }
+  printf("dobble: %s n'est pas un fichier des scores (version %d).\n",
+         fileName, SCORES_VERSION);
+  return 0;
+}
+
+int scoresOpen(const char *fileName) {
+  store.fd = open(fileName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (store.fd < 0) {
+    printf("dobble: Fichier des scores %s inaccessible, les parties ne "
+           "seront pas gardées.\n",
+           fileName);
+    return 0;
+  }
+  if (flock(store.fd, LOCK_EX | LOCK_NB) != 0) {
+    printf("dobble: Fichier des scores %s utilisé par une autre instance du "
+           "jeu, les parties ne seront pas gardées.\n",
+           fileName);
+    scoresClose();
+    return 0;
+  }
+  struct stat st;
+  if (fstat(store.fd, &st) != 0 || !checkHeader(fileName, st.st_size)) {
+    scoresClose();
+    return 0;
+  }
+
+  size_t capacity = st.st_size > HEADER_SIZE
+                        ? (size_t)(st.st_size - HEADER_SIZE) /
+                              sizeof(ScoreRecord)
+                        : 0;
+  if (!mapFile(capacity > 0 ? capacity : SCORES_GROWTH)) {
+    printf("dobble: Projection du fichier des scores %s impossible.\n",
+           fileName);
+    scoresClose();
+    return 0;
+  }
+  madvise(store.map, HEADER_SIZE + store.capacity * sizeof(ScoreRecord),
+          MADV_SEQUENTIAL);
+
+  // L'historique se termine à la première case sans partie valide (zéros, ou
+  // partie interrompue qui sera remplacée par la suivante)
+  store.count = 0;
+  while ((size_t)store.count < store.capacity) {
+    const ScoreRecord *record = recordAt(store.count);
+    if (record->check == 0 || record->check != checksum(record))
+      break;
+    indexRecord(record);
+    store.count++;
+  }
+  madvise(store.map, HEADER_SIZE + store.capacity * sizeof(ScoreRecord),
+          MADV_NORMAL);
+  return 1;
+}
+
+void scoresClose() {
+  if (store.map != NULL)
+    munmap(store.map, HEADER_SIZE + store.capacity * sizeof(ScoreRecord));
+  store.map = NULL;
+  store.capacity = 0;
+  store.count = 0;
+  if (store.fd >= 0)
+    close(store.fd);
+  store.fd = -1;
+  freeBoards();
+}
+
+bool scoresActive() {
+  return store.map != NULL;
+}
+
+int scoresAdd(ScoreRecord *record, ScoreRank *rank) {
+  memset(rank, 0, sizeof(*rank));
+  if (store.map == NULL)
+    return 0;
+  if ((size_t)store.count == store.capacity &&
+      !mapFile(store.capacity + SCORES_GROWTH)) {
+    printf("dobble: Agrandissement du fichier des scores impossible.\n");
+    scoresClose();
+    return 0;
+  }
+
+  // La somme de contrôle est écrite après le reste de la partie : une partie
+  // incomplète n'est jamais relue
+  record->date = (int64_t)time(NULL);
+  record->reserved = 0;
+  record->check = checksum(record);
+  ScoreRecord *slot = recordAt(store.count);
+  memcpy(slot, record, CHECKED_SIZE);
+  __atomic_store_n(&slot->check, record->check, __ATOMIC_RELEASE);
+  store.count++;
+
+  // Écriture sur disque demandée sans l'attendre
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)slot & ~(page - 1);
+  msync((void *)start, (uintptr_t)(slot + 1) - start, MS_ASYNC);
+
+  Board *board = indexRecord(record);
+  if (board != NULL) {
+    rank->rank = countAbove(board, record->score) + 1;
+    rank->count = board->count;
+    rank->best = board->top[0].score;
+    rank->personalBest = rank->rank == 1;
+  }
+  return 1;
+}
+
+int scoresTop(int nbIcons, uint32_t packs, int flags, ScoreRecord *top,
+              int max) {
+  if (store.map == NULL)
+    return 0;
+  const Board *board = findBoard(boardKey(nbIcons, packs, flags), false);
+  if (board == NULL)
+    return 0;
+  int n = board->nbTop < max ? board->nbTop : max;
+  memcpy(top, board->top, n * sizeof(ScoreRecord));
+  return n;
+}
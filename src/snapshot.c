@@ -0,0 +1,376 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "atlas.h"
+#include "clock.h"
+#include "difficulty.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "iconmap.h"
+#include "packs.h"
+#include "snapshot.h"
+
+/**
+ * En-tête et état de la partie d'une sauvegarde, suivis des icônes des deux
+ * cartes affichées (SnapshotIcon) puis de la correspondance entre symboles et
+ * icônes (entiers de 32 bits).
+ */
+typedef struct {
+  char magic[4]; // "DOBR"
+  uint32_t version;
+  uint32_t size;  // taille du fichier
+  uint32_t check; // somme de contrôle des octets qui suivent
+  uint64_t rngState;
+  double level, reaction, errors; // difficulté adaptative
+  int32_t adaptive, sinceSwitch, lastStep;
+  int32_t nbIcons, packMask;
+  int32_t upper, lower; // indices des cartes affichées dans le deck
+  int32_t score, nbFalse;
+  int32_t time; // temps restant (en ms, écoulé en mode sans fin)
+  int32_t endless, lives, resultatClic;
+  int32_t iconMapSize;
+} SnapshotHeader;
+
+/**
+ * Icône d'une carte affichée.
+ */
+typedef struct {
+  double radius, angle, rotation, scale;
+  int32_t iconId, imageId, centerX, centerY;
+} SnapshotIcon;
+
+/* Taille maximale d'une sauvegarde */
+#define SNAPSHOT_MAX_SIZE                                                      \
+  (sizeof(SnapshotHeader) + 2 * DECKS_MAX_ICONS * sizeof(SnapshotIcon) +      \
+   ICON_MAP_MAX_SYMBOLS * sizeof(int32_t))
+
+static struct Snapshot {
+  const char *fileName; // NULL si la sauvegarde n'est pas activée
+  bool saved;           // un fichier de sauvegarde existe peut-être
+  bool resuming;        // packs de la partie reprise en cours de chargement
+} s;
+
+/**
+ * Somme de contrôle (FNV-1a) d'une suite d'octets.
+ */
+static uint32_t checksum(const unsigned char *bytes, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void snapshotEnable(const char *fileName) {
+  s.fileName = fileName;
+  s.saved = true; // sauvegarde d'une session précédente
+}
+
+/**
+ * Copie les icônes d'une carte dans une sauvegarde.
+ */
+static void saveIcons(SnapshotIcon *out, const Icon *icons, int nbIcons) {
+  for (int i = 0; i < nbIcons; i++) {
+    out[i] = (SnapshotIcon){icons[i].radius,  icons[i].angle,
+                            icons[i].rotation, icons[i].scale,
+                            icons[i].iconId,  icons[i].imageId,
+                            icons[i].centerX, icons[i].centerY};
+  }
+}
+
+/**
+ * Copie les icônes d'une carte depuis une sauvegarde.
+ */
+static void loadIcons(Icon *icons, const SnapshotIcon *in, int nbIcons) {
+  for (int i = 0; i < nbIcons; i++) {
+    icons[i] = (Icon){in[i].iconId,   in[i].imageId, in[i].radius,
+                      in[i].angle,    in[i].rotation, in[i].scale,
+                      in[i].centerX, in[i].centerY};
+  }
+}
+
+int snapshotSave() {
+  if (s.fileName == NULL)
+    return 0;
+  if (gameGlobal.state != STATE_PLAYING) {
+    snapshotDiscard();
+    return 0;
+  }
+
+  int64_t start = clockNow();
+  updateRemainingTime();
+  unsigned char buffer[SNAPSHOT_MAX_SIZE];
+  SnapshotHeader *header = (SnapshotHeader *)buffer;
+  DifficultyState difficulty;
+  difficultyGetState(&difficulty);
+  int upper, lower, mapSize;
+  currentPair(&upper, &lower);
+  const int *map = iconMapTable(&mapSize);
+  if (mapSize > ICON_MAP_MAX_SYMBOLS)
+    mapSize = ICON_MAP_MAX_SYMBOLS;
+
+  int k = gameGlobal.nbIcons;
+  *header = (SnapshotHeader){
+      .magic = "DOBR",
+      .version = SNAPSHOT_VERSION,
+      .size = sizeof(SnapshotHeader) + 2 * k * sizeof(SnapshotIcon) +
+              mapSize * sizeof(int32_t),
+      .rngState = gameGlobal.rngState,
+      .level = difficulty.level,
+      .reaction = difficulty.reaction,
+      .errors = difficulty.errors,
+      .adaptive = difficulty.active,
+      .sinceSwitch = difficulty.sinceSwitch,
+      .lastStep = difficulty.lastStep,
+      .nbIcons = k,
+      .packMask = gameGlobal.packMask,
+      .upper = upper,
+      .lower = lower,
+      .score = gameGlobal.score,
+      .nbFalse = gameGlobal.nbFalse,
+      .time = gameGlobal.time,
+      .endless = gameGlobal.endless,
+      .lives = gameGlobal.lives,
+      .resultatClic = gameGlobal.resultatClic,
+      .iconMapSize = mapSize};
+  SnapshotIcon *icons = (SnapshotIcon *)(header + 1);
+  saveIcons(icons, gameGlobal.cardUpper.icons, k);
+  saveIcons(icons + k, gameGlobal.cardLower.icons, k);
+  int32_t *table = (int32_t *)(icons + 2 * k);
+  for (int i = 0; i < mapSize; i++)
+    table[i] = map[i];
+  size_t skipped = offsetof(SnapshotHeader, check) + sizeof(uint32_t);
+  header->check = checksum(buffer + skipped, header->size - skipped);
+
+  // Écriture dans un fichier temporaire renommé ensuite : la sauvegarde
+  // précédente reste intacte si l'écriture est interrompue
+  char temporary[512];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", s.fileName);
+  FILE *file = fopen(temporary, "wb");
+  if (file == NULL) {
+    printf("dobble: Sauvegarde de la partie impossible (%s).\n", temporary);
+    return 0;
+  }
+  // Contenu sur disque avant le renommage : après une coupure de courant, le
+  // fichier renommé n'est jamais vide
+  bool written = fwrite(buffer, header->size, 1, file) == 1 &&
+                 fflush(file) == 0 && fsync(fileno(file)) == 0;
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temporary, s.fileName) != 0) {
+    printf("dobble: Sauvegarde de la partie impossible (%s).\n", s.fileName);
+    remove(temporary);
+    return 0;
+  }
+  s.saved = true;
+  printf("dobble: Partie sauvegardée en %d µs.\n",
+         (int)(clockNow() - start));
+  return 1;
+}
+
+void snapshotDiscard() {
+  if (s.fileName != NULL && s.saved)
+    remove(s.fileName);
+  s.saved = false;
+}
+
+/**
+ * Lit et vérifie une sauvegarde.
+ *
+ * @return La taille de la sauvegarde, 0 si elle est absente ou invalide
+ */
+static size_t readSnapshot(unsigned char *buffer) {
+  FILE *file = fopen(s.fileName, "rb");
+  if (file == NULL)
+    return 0;
+  size_t size = fread(buffer, 1, SNAPSHOT_MAX_SIZE, file);
+  fclose(file);
+
+  const SnapshotHeader *header = (const SnapshotHeader *)buffer;
+  size_t skipped = offsetof(SnapshotHeader, check) + sizeof(uint32_t);
+  bool valid = size >= sizeof(SnapshotHeader) &&
+               memcmp(header->magic, "DOBR", 4) == 0 &&
+               header->version == SNAPSHOT_VERSION && header->size == size &&
+               header->check == checksum(buffer + skipped, size - skipped) &&
+               header->nbIcons >= 2 && header->nbIcons <= DECKS_MAX_ICONS &&
+               header->iconMapSize >= 0 &&
+               header->iconMapSize <= ICON_MAP_MAX_SYMBOLS &&
+               size == sizeof(SnapshotHeader) +
+                           2 * header->nbIcons * sizeof(SnapshotIcon) +
+                           header->iconMapSize * sizeof(int32_t);
+  if (!valid) {
+    printf("dobble: Sauvegarde %s invalide (version %d attendue), "
+           "ignorée.\n",
+           s.fileName, SNAPSHOT_VERSION);
+    return 0;
+  }
+  return size;
+}
+
+/**
+ * Vérifie les icônes d'une carte de la sauvegarde : ce sont les symboles de
+ * la carte du deck, chacun une fois, dessinés avec l'icône que leur donne la
+ * correspondance sauvegardée.
+ *
+ * @param  icons    Les icônes de la sauvegarde
+ * @param  card     La carte du deck
+ * @param  table    La correspondance entre symboles et icônes
+ * @param  size     La taille de la correspondance
+ * @param  nbImages Le nombre d'icônes des packs de la partie
+ * @return          true si les icônes sont celles de la carte
+ */
+static bool validCard(const SnapshotIcon *icons, const Card *card,
+                      const int32_t *table, int size, int nbImages) {
+  int k = gameGlobal.nbIcons;
+  bool used[DECKS_MAX_ICONS] = {false};
+  for (int i = 0; i < k; i++) {
+    int j = 0;
+    while (j < k && card->icons[j].iconId != icons[i].iconId)
+      j++;
+    if (j == k || used[j])
+      return false;
+    used[j] = true;
+    int iconId = icons[i].iconId;
+    int imageId = iconId < size ? table[iconId] : iconId;
+    if (icons[i].imageId != imageId || imageId < 0 || imageId >= nbImages)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Fin du chargement des packs de la partie reprise (thread principal) : les
+ * textures sont créées et le compte à rebours repart.
+ */
+static void finishResume(void *param) {
+  (void)param;
+  if (!loadIconPacks(gameGlobal.packMask))
+    printError(ECHEC_ICONES);
+  s.resuming = false;
+
+  // Le temps restant (ou écoulé) est celui de la sauvegarde
+  int64_t now = clockNow();
+  gameGlobal.roundStart = now - msToUs(gameGlobal.endless
+                                           ? gameGlobal.time
+                                           : ROUND_DURATION_MS -
+                                                 gameGlobal.time);
+  gameGlobal.deadline = now + msToUs(gameGlobal.time);
+  gameGlobal.pairShownAt = 0;
+  startTimer();
+  gameGlobal.timerRunning = true;
+  printf("dobble: Partie reprise.\n");
+  renderScene();
+}
+
+/**
+ * Décodage des packs terminé (thread de décodage).
+ */
+static void onPacksDecoded(void *param) {
+  callOnMainThread(finishResume, param);
+}
+
+int snapshotResume() {
+  if (s.fileName == NULL)
+    return 0;
+  int64_t start = clockNow();
+  unsigned char buffer[SNAPSHOT_MAX_SIZE];
+  size_t size = readSnapshot(buffer);
+  // La sauvegarde ne sert qu'une fois
+  snapshotDiscard();
+  if (size == 0)
+    return 0;
+
+  const SnapshotHeader *header = (const SnapshotHeader *)buffer;
+  const SnapshotIcon *icons = (const SnapshotIcon *)(header + 1);
+  const int32_t *table = (const int32_t *)(icons + 2 * header->nbIcons);
+  if (!loadDeck(header->nbIcons))
+    return 0;
+
+  // Packs décodés en arrière-plan ; le jeu d'icônes (et son index de
+  // similarité) est celui de la partie dès maintenant
+  const char *files[PACKS_MAX];
+  int count = 0, nbImages = 0;
+  for (int i = 0; i < PACKS_MAX; i++) {
+    if (!(header->packMask & (1 << i)))
+      continue;
+    if (packsIconCount(i) == 0) {
+      count = 0;
+      break;
+    }
+    files[count++] = packsFile(i);
+    nbImages += packsIconCount(i);
+  }
+  if (count == 0 || header->packMask >> PACKS_MAX) {
+    printf("dobble: Packs de la sauvegarde %s absents, ignorée.\n",
+           s.fileName);
+    return 0;
+  }
+
+  // Paire, icônes et correspondance cohérentes avec le deck et les packs
+  // (deck ou packs modifiés depuis la sauvegarde)
+  bool valid = header->upper >= 0 && header->upper < gameGlobal.nbCards &&
+               header->lower >= 0 && header->lower < gameGlobal.nbCards &&
+               header->upper != header->lower;
+  for (int i = 0; valid && i < header->iconMapSize; i++)
+    valid = table[i] >= 0 && table[i] < nbImages;
+  valid = valid &&
+          validCard(icons, &gameGlobal.cards[header->upper], table,
+                    header->iconMapSize, nbImages) &&
+          validCard(icons + header->nbIcons, &gameGlobal.cards[header->lower],
+                    table, header->iconMapSize, nbImages);
+  if (!valid) {
+    printf("dobble: Sauvegarde %s incohérente avec le deck ou les packs, "
+           "ignorée.\n",
+           s.fileName);
+    return 0;
+  }
+  if (!loadIconIndex(header->packMask)) {
+    printf("dobble: Packs de la sauvegarde %s absents, ignorée.\n",
+           s.fileName);
+    return 0;
+  }
+
+  int map[ICON_MAP_MAX_SYMBOLS];
+  for (int i = 0; i < header->iconMapSize; i++)
+    map[i] = table[i];
+  iconMapSet(map, header->iconMapSize);
+  DifficultyState difficulty = {header->adaptive != 0, header->level,
+                                header->reaction,      header->errors,
+                                header->sinceSwitch,   header->lastStep};
+  difficultySetState(&difficulty);
+
+  Icon upper[DECKS_MAX_ICONS], lower[DECKS_MAX_ICONS];
+  loadIcons(upper, icons, header->nbIcons);
+  loadIcons(lower, icons + header->nbIcons, header->nbIcons);
+  gameGlobal.rngState = header->rngState;
+  restorePair(header->upper, header->lower, upper, lower);
+
+  gameGlobal.score = header->score;
+  gameGlobal.nbFalse = header->nbFalse;
+  gameGlobal.time = header->time;
+  gameGlobal.endless = header->endless != 0;
+  gameGlobal.lives = header->lives;
+  gameGlobal.resultatClic = header->resultatClic;
+  gameGlobal.iconPackChosen = true;
+  gameGlobal.nbIconChosen = true;
+  gameGlobal.timerRunning = false;
+  gameGlobal.state = STATE_PLAYING;
+
+  s.resuming = true;
+  requestRedraw();
+  if (!atlasPrefetch(files, count, onPacksDecoded, NULL))
+    finishResume(NULL);
+  printf("dobble: Partie sauvegardée rétablie en %d µs (%d packs en cours "
+         "de chargement).\n",
+         (int)(clockNow() - start), count);
+  return 1;
+}
+
+bool snapshotResuming() { return s.resuming; }
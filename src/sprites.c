@@ -0,0 +1,294 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "atlas.h"
+#include "dobble-config.h"
+#include "sprites.h"
+
+/* Nombre de listes de la table de hachage des icônes en cache */
+#define SPRITE_HASH_SIZE 1024
+
+/**
+ * Icône pré-tournée en cache, chaînée dans la liste de sa clé.
+ */
+typedef struct {
+  SDL_Texture *texture; // NULL : entrée libre
+  int atlas;
+  Uint32 serial;    // numéro de chargement du pack (atlasSerial)
+  int posX, posY;   // case de l'icône dans la matrice du pack
+  int bucket, size; // angle et taille de dessin arrondis
+  int side;         // côté de la texture
+  Uint32 lastUse;
+  int next; // entrée suivante de la même liste (-1 : aucune)
+} Sprite;
+
+/**
+ * État du cache d'icônes pré-tournées.
+ */
+static struct SpriteCache {
+  bool enabled;
+  SDL_Renderer *renderer;
+  Sprite sprites[SPRITE_CACHE_SIZE];
+  int heads[SPRITE_HASH_SIZE]; // première entrée de chaque liste
+  size_t budget;
+  size_t used;
+  Uint32 clock; // compteur d'utilisation (LRU)
+} s;
+
+void spritesInit(SDL_Renderer *renderer, size_t budget, bool enabled) {
+  memset(&s, 0, sizeof(s));
+  s.renderer = renderer;
+  s.budget = budget;
+  s.enabled = enabled;
+  for (int i = 0; i < SPRITE_HASH_SIZE; i++)
+    s.heads[i] = -1;
+  // Les icônes sont tournées à partir des niveaux de mipmap en mémoire
+  atlasKeepPixels(enabled);
+  if (enabled)
+    printf("SDL: Rendu logiciel : icônes pré-tournées (%d angles).\n",
+           SPRITE_ANGLE_BUCKETS);
+}
+
+bool spritesEnabled() { return s.enabled; }
+
+double spriteSnapRotation(double rotation) {
+  if (!s.enabled)
+    return rotation;
+  double step = 360. / SPRITE_ANGLE_BUCKETS;
+  return round(rotation / step) * step;
+}
+
+/**
+ * Retourne la liste d'une clé dans la table de hachage.
+ */
+static int hashKey(int atlas, Uint32 serial, int posX, int posY, int bucket,
+                   int size) {
+  uint32_t h = 2166136261u;
+  int key[6] = {atlas, (int)serial, posX, posY, bucket, size};
+  for (int i = 0; i < 6; i++)
+    h = (h ^ (uint32_t)key[i]) * 16777619u;
+  return h % SPRITE_HASH_SIZE;
+}
+
+/**
+ * Libère une icône pré-tournée et la retire de sa liste.
+ */
+static void freeSprite(int index) {
+  Sprite *sprite = &s.sprites[index];
+  int *link = &s.heads[hashKey(sprite->atlas, sprite->serial, sprite->posX,
+                               sprite->posY, sprite->bucket, sprite->size)];
+  while (*link != index)
+    link = &s.sprites[*link].next;
+  *link = sprite->next;
+  SDL_DestroyTexture(sprite->texture);
+  s.used -= (size_t)sprite->side * sprite->side * 4;
+  memset(sprite, 0, sizeof(Sprite));
+}
+
+/**
+ * Libère l'icône pré-tournée la moins récemment utilisée.
+ *
+ * @return 1 si une icône a été libérée, 0 si le cache est vide
+ */
+static int evictOne() {
+  int victim = -1;
+  for (int i = 0; i < SPRITE_CACHE_SIZE; i++) {
+    if (s.sprites[i].texture != NULL &&
+        (victim < 0 || s.sprites[i].lastUse < s.sprites[victim].lastUse))
+      victim = i;
+  }
+  if (victim < 0)
+    return 0;
+  freeSprite(victim);
+  return 1;
+}
+
+/**
+ * Interpolation bilinéaire de quatre pixels (alpha prémultiplié) : pixels
+ * voisins p et p + 1 de deux lignes consécutives, poids fx et fy entre 0 et
+ * 255 (sur 256). Les produits et leurs sommes tiennent sur 16 bits (au plus
+ * 255 × 256).
+ */
+static void bilinear(const uint8_t *top, const uint8_t *bottom, int fx, int fy,
+                     uint8_t *out) {
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  // Deux pixels voisins de chaque ligne, un canal par entier de 16 bits
+  __m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)top), zero);
+  __m128i b =
+      _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)bottom), zero);
+  __m128i v = _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(t, _mm_set1_epi16(256 - fy)),
+                    _mm_mullo_epi16(b, _mm_set1_epi16(fy))),
+      8);
+  // Pixel de gauche (entiers 0 à 3) et de droite (4 à 7)
+  __m128i h = _mm_mullo_epi16(
+      v, _mm_setr_epi16(256 - fx, 256 - fx, 256 - fx, 256 - fx, fx, fx, fx, fx));
+  h = _mm_srli_epi16(_mm_add_epi16(h, _mm_srli_si128(h, 8)), 8);
+  uint32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(h, zero));
+  memcpy(out, &pixel, 4);
+#else
+  for (int c = 0; c < 4; c++) {
+    int left = (top[c] * (256 - fy) + bottom[c] * fy) >> 8;
+    int right = (top[4 + c] * (256 - fy) + bottom[4 + c] * fy) >> 8;
+    out[c] = (left * (256 - fx) + right * fx) >> 8;
+  }
+#endif
+}
+
+/**
+ * Calcule une icône pré-tournée : chaque pixel de la texture est interpolé
+ * dans l'icône du niveau de mipmap adapté, tournée et mise à l'échelle autour
+ * de son centre (rotation dans le sens horaire, comme SDL_RenderCopyEx).
+ *
+ * @return La texture, NULL en cas d'échec
+ */
+static SDL_Texture *renderSprite(int atlas, int posX, int posY, int bucket,
+                                 int size, int *side) {
+  int levelSize;
+  SDL_Surface *level = atlasPixels(atlas, size, &levelSize);
+  if (level == NULL)
+    return NULL;
+
+  // Icône en alpha prémultiplié (pas de franges sombres autour des parties
+  // opaques), entourée d'une bordure transparente d'un pixel
+  int padded = levelSize + 2;
+  uint8_t *icon = calloc((size_t)padded * padded, 4);
+  if (icon == NULL)
+    return NULL;
+  for (int y = 0; y < levelSize; y++) {
+    const uint8_t *in = (const uint8_t *)level->pixels +
+                        (posY / ICON_SIZE * levelSize + y) * level->pitch +
+                        posX / ICON_SIZE * levelSize * 4;
+    uint8_t *out = icon + ((y + 1) * padded + 1) * 4;
+    for (int x = 0; x < levelSize; x++, in += 4, out += 4) {
+      for (int c = 0; c < 3; c++)
+        out[c] = (in[c] * in[3] + 127) / 255;
+      out[3] = in[3];
+    }
+  }
+
+  double angle = bucket * 2 * M_PI / SPRITE_ANGLE_BUCKETS;
+  double cosA = cos(angle), sinA = sin(angle);
+  int n = (int)ceil(size * (fabs(cosA) + fabs(sinA)) - 1e-6);
+  SDL_Surface *sprite =
+      SDL_CreateRGBSurfaceWithFormat(0, n, n, 32, SDL_PIXELFORMAT_RGBA32);
+  if (sprite == NULL) {
+    free(icon);
+    return NULL;
+  }
+
+  // Position dans l'icône (bordure comprise, centres des pixels) du centre
+  // de chaque pixel de la texture, avancée d'un pixel à l'autre
+  double ratio = (double)levelSize / size;
+  double stepU = cosA * ratio, stepV = -sinA * ratio;
+  for (int y = 0; y < n; y++) {
+    double py = y + 0.5 - n / 2., px = 0.5 - n / 2.;
+    double u = (px * cosA + py * sinA) * ratio + levelSize / 2. + 0.5;
+    double v = (-px * sinA + py * cosA) * ratio + levelSize / 2. + 0.5;
+    uint8_t *out = (uint8_t *)sprite->pixels + y * sprite->pitch;
+    for (int x = 0; x < n; x++, u += stepU, v += stepV, out += 4) {
+      int iu = (int)floor(u), iv = (int)floor(v);
+      if (iu < 0 || iv < 0 || iu >= padded - 1 || iv >= padded - 1) {
+        memset(out, 0, 4);
+        continue;
+      }
+      const uint8_t *top = icon + (iv * padded + iu) * 4;
+      bilinear(top, top + padded * 4, (int)((u - iu) * 256),
+               (int)((v - iv) * 256), out);
+      // Retour à l'alpha non prémultiplié des textures de la SDL
+      if (out[3] == 0)
+        continue;
+      for (int c = 0; c < 3; c++) {
+        int value = (out[c] * 255 + out[3] / 2) / out[3];
+        out[c] = value > 255 ? 255 : value;
+      }
+    }
+  }
+  free(icon);
+
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(s.renderer, sprite);
+  SDL_FreeSurface(sprite);
+  if (texture != NULL)
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  *side = n;
+  return texture;
+}
+
+SDL_Texture *spriteGet(int atlas, int posX, int posY, double rotation,
+                       int drawSize, int *side) {
+  if (!s.enabled)
+    return NULL;
+  Uint32 serial = atlasSerial(atlas);
+  if (serial == 0)
+    return NULL;
+
+  // Angle et taille arrondis aux variantes en cache
+  int bucket =
+      (int)lround(rotation * SPRITE_ANGLE_BUCKETS / 360.) % SPRITE_ANGLE_BUCKETS;
+  if (bucket < 0)
+    bucket += SPRITE_ANGLE_BUCKETS;
+  int size = (drawSize + SPRITE_SIZE_STEP / 2) / SPRITE_SIZE_STEP *
+             SPRITE_SIZE_STEP;
+  if (size < SPRITE_SIZE_STEP)
+    size = SPRITE_SIZE_STEP;
+
+  s.clock++;
+  int hash = hashKey(atlas, serial, posX, posY, bucket, size);
+  for (int i = s.heads[hash]; i >= 0; i = s.sprites[i].next) {
+    Sprite *sprite = &s.sprites[i];
+    if (sprite->atlas == atlas && sprite->serial == serial &&
+        sprite->posX == posX && sprite->posY == posY &&
+        sprite->bucket == bucket && sprite->size == size) {
+      sprite->lastUse = s.clock;
+      *side = sprite->side;
+      return sprite->texture;
+    }
+  }
+
+  // Icône absente : calculée dans une entrée libre, en libérant si besoin les
+  // icônes les moins récemment utilisées
+  int n;
+  SDL_Texture *texture = renderSprite(atlas, posX, posY, bucket, size, &n);
+  if (texture == NULL)
+    return NULL;
+  size_t bytes = (size_t)n * n * 4;
+  while (s.used + bytes > s.budget && evictOne())
+    ;
+  int index = -1;
+  for (int i = 0; i < SPRITE_CACHE_SIZE && index < 0; i++) {
+    if (s.sprites[i].texture == NULL)
+      index = i;
+  }
+  if (index < 0) {
+    evictOne();
+    for (int i = 0; i < SPRITE_CACHE_SIZE && index < 0; i++) {
+      if (s.sprites[i].texture == NULL)
+        index = i;
+    }
+  }
+
+  Sprite *sprite = &s.sprites[index];
+  *sprite = (Sprite){texture, atlas, serial, posX, posY, bucket, size, n,
+                     s.clock, s.heads[hash]};
+  s.heads[hash] = index;
+  s.used += bytes;
+  *side = n;
+  return texture;
+}
+
+void spritesFreeAll() {
+  for (int i = 0; i < SPRITE_CACHE_SIZE; i++) {
+    if (s.sprites[i].texture != NULL)
+      freeSprite(i);
+  }
+}
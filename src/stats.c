@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+#include "stats.h"
+
+/**
+ * Statistiques de temps de réaction de la session. Tous les agrégats sont
+ * alloués statiquement : la mémoire utilisée ne dépend pas de la durée de la
+ * session.
+ */
+static struct Stats {
+  ReactionHistogram session;
+  ReactionHistogram players[STATS_MAX_PLAYERS];
+  ReactionHistogram orders[STATS_MAX_ICONS_PER_CARD + 1];
+  ReactionHistogram icons[STATS_MAX_ICON_ID];
+} s;
+
+/**
+ * Retourne l'intervalle de l'histogramme contenant une valeur donnée.
+ */
+static int bucketIndex(uint32_t value) {
+  // Valeurs exactes en dessous de 2^HISTO_SUB_BITS
+  if (value < (1u << HISTO_SUB_BITS))
+    return value;
+  // Puissance de 2 (bit de poids fort) puis sous-intervalle linéaire
+  int exponent = 31 - __builtin_clz(value);
+  int shift = exponent - HISTO_SUB_BITS;
+  int sub = (value >> shift) & ((1 << HISTO_SUB_BITS) - 1);
+  return ((shift + 1) << HISTO_SUB_BITS) + sub;
+}
+
+/**
+ * Retourne la borne inférieure et la largeur d'un intervalle de l'histogramme.
+ */
+static void bucketRange(int index, uint32_t *lower, uint32_t *width) {
+  if (index < (1 << HISTO_SUB_BITS)) {
+    *lower = index;
+    *width = 1;
+    return;
+  }
+  int shift = (index >> HISTO_SUB_BITS) - 1;
+  int sub = index & ((1 << HISTO_SUB_BITS) - 1);
+  *lower = (uint32_t)((1 << HISTO_SUB_BITS) + sub) << shift;
+  *width = 1u << shift;
+}
+
+void histogramRecord(ReactionHistogram *histo, int value) {
+  if (value < 0)
+    value = 0;
+  if (value > HISTO_MAX_VALUE)
+    value = HISTO_MAX_VALUE;
+
+  if (histo->count == 0 || (uint32_t)value < histo->min)
+    histo->min = value;
+  if ((uint32_t)value > histo->max)
+    histo->max = value;
+  histo->count++;
+  histo->sum += value;
+  histo->buckets[bucketIndex(value)]++;
+}
+
+int histogramPercentile(const ReactionHistogram *histo, double percentile) {
+  if (histo->count == 0)
+    return 0;
+
+  // Rang de la valeur recherchée parmi les valeurs enregistrées
+  uint64_t rank = (uint64_t)(percentile / 100. * histo->count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  if (rank > histo->count)
+    rank = histo->count;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < HISTO_BUCKETS; i++) {
+    seen += histo->buckets[i];
+    if (seen >= rank) {
+      // Milieu de l'intervalle, borné par les extrêmes observés
+      uint32_t lower, width;
+      bucketRange(i, &lower, &width);
+      uint32_t value = lower + width / 2;
+      if (value < histo->min)
+        value = histo->min;
+      if (value > histo->max)
+        value = histo->max;
+      return value;
+    }
+  }
+  return histo->max;
+}
+
+int histogramMean(const ReactionHistogram *histo) {
+  if (histo->count == 0)
+    return 0;
+  return (int)(histo->sum / histo->count);
+}
+
+/**
+ * Enregistre une réponse dans un agrégat.
+ */
+static void recordInto(ReactionHistogram *histo, int reactionMs, bool correct,
+                       int64_t now) {
+  histo->lastAnswerAt = now;
+  if (correct)
+    histogramRecord(histo, reactionMs);
+  else
+    histo->errors++;
+}
+
+void statsRecordAnswer(int player, int nbIcons, int iconId, int reactionMs,
+                       bool correct) {
+  int64_t now = clockNow();
+
+  recordInto(&s.session, reactionMs, correct, now);
+  if (player >= 0 && player < STATS_MAX_PLAYERS)
+    recordInto(&s.players[player], reactionMs, correct, now);
+  if (nbIcons >= 0 && nbIcons <= STATS_MAX_ICONS_PER_CARD)
+    recordInto(&s.orders[nbIcons], reactionMs, correct, now);
+  if (iconId >= 0 && iconId < STATS_MAX_ICON_ID)
+    recordInto(&s.icons[iconId], reactionMs, correct, now);
+}
+
+const ReactionHistogram *statsSession() { return &s.session; }
+
+const ReactionHistogram *statsPlayer(int player) {
+  if (player < 0 || player >= STATS_MAX_PLAYERS)
+    return NULL;
+  return &s.players[player];
+}
+
+/**
+ * Écrit une ligne CSV pour un agrégat non vide.
+ */
+static void exportHistogram(FILE *file, const char *scope, int key,
+                            const ReactionHistogram *histo) {
+  if (histo->count == 0 && histo->errors == 0)
+    return;
+  fprintf(file, "%s,%d,%u,%u,%d,%d,%d,%d,%u,%u\n", scope, key, histo->count,
+          histo->errors, histogramMean(histo), histogramPercentile(histo, 50),
+          histogramPercentile(histo, 90), histogramPercentile(histo, 99),
+          histo->min, histo->max);
+}
+
+int exportStats(const char *fileName) {
+  FILE *file = fopen(fileName, "w");
+  if (file == NULL) {
+    printf("dobble: Echec de l'export des statistiques vers '%s'.\n",
+           fileName);
+    return 0;
+  }
+
+  fprintf(file, "scope,key,count,errors,mean_ms,p50_ms,p90_ms,p99_ms,min_ms,"
+                "max_ms\n");
+  exportHistogram(file, "session", 0, &s.session);
+  for (int i = 0; i < STATS_MAX_PLAYERS; i++)
+    exportHistogram(file, "player", i, &s.players[i]);
+  // L'ordre d'un deck est le nombre d'icônes par carte moins un
+  for (int i = 1; i <= STATS_MAX_ICONS_PER_CARD; i++)
+    exportHistogram(file, "order", i - 1, &s.orders[i]);
+  for (int i = 0; i < STATS_MAX_ICON_ID; i++)
+    exportHistogram(file, "icon", i, &s.icons[i]);
+
+  fclose(file);
+  return 1;
+}
@@ -0,0 +1,284 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "clock.h"
+#include "timerwheel.h"
+
+/* Nombre de bits d'un numéro de case (TIMER_WHEEL_SLOTS = 1 << SLOT_BITS,
+ * une case par bit d'un mot de 64 bits) */
+#define SLOT_BITS 6
+
+/* Liste des appels échus, à effectuer (après les cases des niveaux) */
+#define RUN_LIST (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+
+/* Nombre de bits de l'indice dans la réserve d'un identifiant d'appel
+ * (TIMER_WHEEL_POOL_SIZE = 1 << INDEX_BITS) */
+#define INDEX_BITS 12
+
+/**
+ * Appel planifié, chaîné dans la liste de sa case.
+ */
+typedef struct {
+  int64_t expires; // échéance (en tics)
+  void (*method)(void *);
+  void *param;
+  int prev, next; // voisins dans la liste (-1 : aucun)
+  int list;       // case ou liste de l'appel (-1 : entrée libre)
+  int generation; // numéro d'utilisation de l'entrée (identifiants périmés)
+} TimerEntry;
+
+/**
+ * Roue de minuteries : cases de chaque niveau et réserve d'entrées.
+ */
+static struct TimerWheel {
+  bool started;
+  int64_t current; // dernier tic traité
+  int nbPending;   // appels en attente (dans la roue ou échus)
+
+  TimerEntry entries[TIMER_WHEEL_POOL_SIZE];
+  int freeList; // première entrée libre (-1 : réserve épuisée)
+
+  int heads[RUN_LIST + 1], tails[RUN_LIST + 1];
+  uint64_t occupied[TIMER_WHEEL_LEVELS]; // bit i : case i non vide
+} w;
+
+/**
+ * Initialise la roue au tic courant, au premier appel planifié.
+ */
+static void start() {
+  w.started = true;
+  w.current = clockNow() / TIMER_WHEEL_TICK_US;
+  for (int i = 0; i <= RUN_LIST; i++)
+    w.heads[i] = w.tails[i] = -1;
+  for (int i = 0; i < TIMER_WHEEL_POOL_SIZE; i++) {
+    w.entries[i].list = -1;
+    w.entries[i].next = i + 1 < TIMER_WHEEL_POOL_SIZE ? i + 1 : -1;
+  }
+  w.freeList = 0;
+}
+
+/**
+ * Ajoute une entrée à la fin d'une liste.
+ */
+static void link(int index, int list) {
+  TimerEntry *entry = &w.entries[index];
+  entry->list = list;
+  entry->next = -1;
+  entry->prev = w.tails[list];
+  if (entry->prev >= 0)
+    w.entries[entry->prev].next = index;
+  else
+    w.heads[list] = index;
+  w.tails[list] = index;
+  if (list < RUN_LIST)
+    w.occupied[list / TIMER_WHEEL_SLOTS] |= 1ull << (list % TIMER_WHEEL_SLOTS);
+}
+
+/**
+ * Retire une entrée de sa liste.
+ */
+static void unlink(int index) {
+  TimerEntry *entry = &w.entries[index];
+  int list = entry->list;
+  if (entry->prev >= 0)
+    w.entries[entry->prev].next = entry->next;
+  else
+    w.heads[list] = entry->next;
+  if (entry->next >= 0)
+    w.entries[entry->next].prev = entry->prev;
+  else
+    w.tails[list] = entry->prev;
+  if (list < RUN_LIST && w.heads[list] < 0)
+    w.occupied[list / TIMER_WHEEL_SLOTS] &=
+        ~(1ull << (list % TIMER_WHEEL_SLOTS));
+  entry->list = -1;
+}
+
+/**
+ * Range une entrée dans la case de son échéance, au niveau dont la
+ * granularité correspond au temps restant.
+ */
+static void place(int index) {
+  TimerEntry *entry = &w.entries[index];
+  int64_t delta = entry->expires - w.current;
+  int level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 &&
+         delta >= (int64_t)1 << (SLOT_BITS * (level + 1)))
+    level++;
+
+  // Échéance au-delà du dernier niveau : rangée à la dernière case, et
+  // replacée quand cette case redescend
+  int64_t at = entry->expires;
+  int64_t span = (int64_t)1 << (SLOT_BITS * TIMER_WHEEL_LEVELS);
+  if (delta >= span)
+    at = w.current + span - 1;
+  int slot = (int)((at >> (SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+  link(index, level * TIMER_WHEEL_SLOTS + slot);
+}
+
+/**
+ * Détache le contenu d'une liste et retourne sa première entrée.
+ */
+static int detach(int list) {
+  int first = w.heads[list];
+  w.heads[list] = w.tails[list] = -1;
+  if (list < RUN_LIST)
+    w.occupied[list / TIMER_WHEEL_SLOTS] &=
+        ~(1ull << (list % TIMER_WHEEL_SLOTS));
+  return first;
+}
+
+/**
+ * Fait redescendre les appels de la case courante d'un niveau.
+ */
+static void cascade(int level) {
+  int slot = (int)((w.current >> (SLOT_BITS * level)) &
+                   (TIMER_WHEEL_SLOTS - 1));
+  for (int index = detach(level * TIMER_WHEEL_SLOTS + slot); index >= 0;) {
+    int next = w.entries[index].next;
+    w.entries[index].list = -1;
+    place(index);
+    index = next;
+  }
+}
+
+/**
+ * Rotation à droite d'un mot de 64 bits.
+ */
+static uint64_t rotateRight(uint64_t bits, int count) {
+  return count == 0 ? bits : bits >> count | bits << (64 - count);
+}
+
+/**
+ * Retourne le prochain tic où la roue doit agir : échéance d'une case du
+ * premier niveau, ou tour qui fait redescendre une case non vide d'un niveau
+ * supérieur.
+ *
+ * @return Le tic, -1 si la roue est vide
+ */
+static int64_t nextTick() {
+  int64_t next = -1;
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (w.occupied[level] == 0)
+      continue;
+    // Cases dans l'ordre de leur passage, à partir du prochain
+    int64_t start = (w.current >> (SLOT_BITS * level)) + 1;
+    uint64_t ahead = rotateRight(w.occupied[level],
+                                 (int)(start & (TIMER_WHEEL_SLOTS - 1)));
+    int64_t tick = (start + __builtin_ctzll(ahead)) << (SLOT_BITS * level);
+    if (next < 0 || tick < next)
+      next = tick;
+  }
+  return next;
+}
+
+/**
+ * Avance la roue d'un tic : redescente des cases des niveaux qui font un tour,
+ * puis appels échus de la case courante du premier niveau.
+ */
+static void step() {
+  w.current++;
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    if ((w.current & (((int64_t)1 << (SLOT_BITS * level)) - 1)) != 0)
+      break;
+    cascade(level);
+  }
+  int slot = (int)(w.current & (TIMER_WHEEL_SLOTS - 1));
+  for (int index = detach(slot); index >= 0;) {
+    int next = w.entries[index].next;
+    w.entries[index].list = -1;
+    link(index, RUN_LIST);
+    index = next;
+  }
+}
+
+/**
+ * Rend une entrée à la réserve.
+ */
+static void release(int index) {
+  TimerEntry *entry = &w.entries[index];
+  entry->generation++;
+  entry->next = w.freeList;
+  w.freeList = index;
+  w.nbPending--;
+}
+
+TimerId timerWheelSchedule(int64_t delay, void (*method)(void *),
+                           void *param) {
+  if (!w.started)
+    start();
+  if (w.freeList < 0) {
+    printf("dobble: Trop d'appels planifiés (%d).\n", TIMER_WHEEL_POOL_SIZE);
+    return -1;
+  }
+  int64_t now = clockNow();
+  // Roue vide : elle peut sauter directement au tic courant
+  if (w.nbPending == 0 && now / TIMER_WHEEL_TICK_US > w.current)
+    w.current = now / TIMER_WHEEL_TICK_US;
+
+  int index = w.freeList;
+  TimerEntry *entry = &w.entries[index];
+  w.freeList = entry->next;
+  w.nbPending++;
+  entry->method = method;
+  entry->param = param;
+  // Échéance arrondie au tic supérieur, jamais avant le prochain tic
+  entry->expires =
+      (now + (delay > 0 ? delay : 0) + TIMER_WHEEL_TICK_US - 1) /
+      TIMER_WHEEL_TICK_US;
+  if (entry->expires <= w.current)
+    entry->expires = w.current + 1;
+  place(index);
+  return (entry->generation & ((1 << (31 - INDEX_BITS)) - 1)) << INDEX_BITS |
+         index;
+}
+
+int timerWheelCancel(TimerId id) {
+  if (id < 0)
+    return 0;
+  int index = id & (TIMER_WHEEL_POOL_SIZE - 1);
+  TimerEntry *entry = &w.entries[index];
+  if (entry->list < 0 ||
+      (entry->generation & ((1 << (31 - INDEX_BITS)) - 1)) !=
+          id >> INDEX_BITS)
+    return 0;
+  unlink(index);
+  release(index);
+  return 1;
+}
+
+void timerWheelRun() {
+  if (!w.started)
+    return;
+  int64_t now = clockNow() / TIMER_WHEEL_TICK_US;
+  while (w.current < now) {
+    // Aucune case à traiter d'ici là : saut direct au tic courant
+    int64_t next = nextTick();
+    if (next < 0 || next > now) {
+      w.current = now;
+      break;
+    }
+    w.current = next - 1;
+    step();
+
+    // Les appels peuvent en planifier ou en annuler d'autres, y compris parmi
+    // les appels échus restants
+    int index;
+    while ((index = w.heads[RUN_LIST]) >= 0) {
+      TimerEntry *entry = &w.entries[index];
+      void (*method)(void *) = entry->method;
+      void *param = entry->param;
+      unlink(index);
+      release(index);
+      method(param);
+    }
+  }
+}
+
+int64_t timerWheelNextDeadline() {
+  if (!w.started || w.nbPending == 0)
+    return -1;
+  int64_t next = nextTick();
+  return next < 0 ? -1 : next * TIMER_WHEEL_TICK_US;
+}
@@ -0,0 +1,131 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "clock.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "timerwheel.h"
+#include "tween.h"
+
+/**
+ * Interpolation d'une valeur.
+ */
+typedef struct {
+  double *value; // valeur animée (NULL : entrée libre)
+  double from, to;
+  int64_t start, duration; // début et durée (en µs)
+  TweenEasing easing;
+} Tween;
+
+/**
+ * Interpolations en cours et image suivante planifiée.
+ */
+static struct Tweens {
+  Tween tweens[TWEEN_MAX];
+  int nbRunning;
+  bool frameScheduled;
+} t;
+
+/**
+ * Applique une courbe d'accélération.
+ *
+ * @param  easing   La courbe
+ * @param  progress L'avancement de l'animation (entre 0 et 1)
+ * @return          L'avancement de la valeur (0 au départ, 1 à l'arrivée)
+ */
+static double ease(TweenEasing easing, double progress) {
+  double u = 1 - progress;
+  switch (easing) {
+  case EASE_OUT_CUBIC:
+    return 1 - u * u * u;
+  case EASE_OUT_BACK: {
+    // Dépassement d'environ 10 % de la valeur finale
+    const double overshoot = 1.70158;
+    return 1 + (overshoot + 1) * -u * u * u + overshoot * u * u;
+  }
+  case EASE_LINEAR:
+  default:
+    return progress;
+  }
+}
+
+/**
+ * Met à jour une valeur animée.
+ *
+ * @return true si l'animation est terminée
+ */
+static bool update(Tween *tween, int64_t now) {
+  double progress =
+      tween->duration > 0 ? (double)(now - tween->start) / tween->duration : 1;
+  if (progress >= 1) {
+    *tween->value = tween->to;
+    return true;
+  }
+  if (progress < 0)
+    progress = 0;
+  *tween->value =
+      tween->from + (tween->to - tween->from) * ease(tween->easing, progress);
+  return false;
+}
+
+/**
+ * Image d'animation : mise à jour des valeurs animées, puis demande de dessin
+ * et planification de l'image suivante si une animation est en cours.
+ */
+static void onFrame(void *param) {
+  (void)param;
+  int64_t now = clockNow();
+  t.frameScheduled = false;
+  for (int i = 0; i < TWEEN_MAX; i++) {
+    Tween *tween = &t.tweens[i];
+    if (tween->value != NULL && update(tween, now)) {
+      tween->value = NULL;
+      t.nbRunning--;
+    }
+  }
+  requestRedraw();
+  if (t.nbRunning > 0 && timerWheelSchedule(msToUs(TWEEN_FRAME_MS), onFrame,
+                                            NULL) >= 0)
+    t.frameScheduled = true;
+}
+
+void tweenStart(double *value, double from, double to, int duration,
+                TweenEasing easing) {
+  // Animation de la même valeur remplacée, sinon première entrée libre
+  Tween *tween = NULL;
+  for (int i = 0; i < TWEEN_MAX; i++) {
+    if (t.tweens[i].value == value) {
+      tween = &t.tweens[i];
+      break;
+    }
+    if (t.tweens[i].value == NULL && tween == NULL)
+      tween = &t.tweens[i];
+  }
+  *value = from;
+  if (tween == NULL) {
+    // Plus d'entrée libre : la valeur est directement à l'arrivée
+    *value = to;
+    return;
+  }
+  if (tween->value == NULL)
+    t.nbRunning++;
+  *tween = (Tween){value, from, to, clockNow(), msToUs(duration), easing};
+
+  if (!t.frameScheduled &&
+      timerWheelSchedule(msToUs(TWEEN_FRAME_MS), onFrame, NULL) >= 0)
+    t.frameScheduled = true;
+}
+
+void tweenFinishAll() {
+  for (int i = 0; i < TWEEN_MAX; i++) {
+    Tween *tween = &t.tweens[i];
+    if (tween->value != NULL) {
+      *tween->value = tween->to;
+      tween->value = NULL;
+    }
+  }
+  t.nbRunning = 0;
+}
+
+bool tweenRunning() { return t.nbRunning > 0; }
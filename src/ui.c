@@ -0,0 +1,317 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "assets.h"
+#include "dobble-config.h"
+#include "dobble.h"
+#include "graphics.h"
+#include "packs.h"
+#include "ui.h"
+
+typedef enum { UI_TEXT, UI_BUTTON } UiWidgetType;
+
+/**
+ * Élément d'un menu : sa description (lue dans le fichier) et sa position à
+ * l'échelle courante.
+ */
+typedef struct {
+  UiWidgetType type;
+  double x, line, size;
+  int r, g, b;
+  UiAction action;
+  char text[UI_TEXT_SIZE];
+
+  int px, py;     // position (en pixels)
+  int radius;     // rayon d'un bouton (milieu de l'anneau, en pixels)
+  int hitRadius2; // carré du rayon de la zone de clic d'un bouton
+} UiWidget;
+
+/**
+ * Rangée de boutons générés (ligne choix du fichier).
+ */
+typedef struct {
+  UiMenu menu;
+  UiActionType type; // UI_ACTION_PACK ou UI_ACTION_DECK
+  double x, line, dx, dline, size;
+  int columns;
+  int r, g, b;
+} UiChoices;
+
+/**
+ * Éléments des menus : ceux du fichier, suivis des boutons générés.
+ */
+static struct Ui {
+  UiWidget widgets[UI_NB_MENUS][UI_MAX_WIDGETS];
+  int nbWidgets[UI_NB_MENUS];
+  int nbFixed[UI_NB_MENUS]; // éléments décrits un par un dans le fichier
+  UiChoices choices[UI_MAX_CHOICES];
+  int nbChoices;
+
+  double scale; // échelle des positions calculées (0 : à calculer)
+  int border;   // épaisseur de l'anneau des boutons (en pixels)
+} ui;
+
+/**
+ * Lit l'action d'un bouton.
+ *
+ * @return 1 si l'action est valide, 0 sinon
+ */
+static int parseAction(const char *word, UiAction *action) {
+  if (sscanf(word, "pack:%d", &action->value) == 1) {
+    action->type = UI_ACTION_PACK;
+    return action->value >= 0 && action->value < packsCount();
+  } else if (sscanf(word, "deck:%d", &action->value) == 1) {
+    action->type = UI_ACTION_DECK;
+  } else if (strcmp(word, "rejouer") == 0) {
+    action->type = UI_ACTION_REPLAY;
+  } else if (strcmp(word, "quitter") == 0) {
+    action->type = UI_ACTION_QUIT;
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Lit une rangée de boutons générés.
+ *
+ * @return 1 si la ligne est valide, 0 sinon
+ */
+static int parseChoices(struct Ui *target, UiMenu menu, const char *line) {
+  if (target->nbChoices == UI_MAX_CHOICES)
+    return 0;
+  UiChoices *choices = &target->choices[target->nbChoices];
+  char actionName[16];
+  if (sscanf(line, "%lf %lf %d %lf %lf %lf %d %d %d %15s", &choices->x,
+             &choices->line, &choices->columns, &choices->dx, &choices->dline,
+             &choices->size, &choices->r, &choices->g, &choices->b,
+             actionName) != 10 ||
+      choices->columns < 1)
+    return 0;
+  if (strcmp(actionName, "pack") == 0)
+    choices->type = UI_ACTION_PACK;
+  else if (strcmp(actionName, "deck") == 0)
+    choices->type = UI_ACTION_DECK;
+  else
+    return 0;
+  choices->menu = menu;
+  target->nbChoices++;
+  return 1;
+}
+
+/**
+ * Lit un élément de menu.
+ *
+ * @param  target Les menus en cours de lecture
+ * @param  line   La ligne
+ * @return        1 si la ligne est valide, 0 sinon
+ */
+static int parseWidget(struct Ui *target, const char *line) {
+  char type[16], menuName[16], actionName[32];
+  int offset = 0;
+  if (sscanf(line, "%15s %15s %n", type, menuName, &offset) != 2)
+    return 0;
+  UiMenu menu;
+  if (strcmp(menuName, "debut") == 0)
+    menu = UI_MENU_START;
+  else if (strcmp(menuName, "fin") == 0)
+    menu = UI_MENU_END;
+  else
+    return 0;
+  if (strcmp(type, "choix") == 0)
+    return parseChoices(target, menu, line + offset);
+  if (target->nbWidgets[menu] == UI_MAX_WIDGETS)
+    return 0;
+
+  UiWidget *widget = &target->widgets[menu][target->nbWidgets[menu]];
+  memset(widget, 0, sizeof(UiWidget));
+  line += offset;
+  offset = 0;
+  if (strcmp(type, "texte") == 0) {
+    widget->type = UI_TEXT;
+    if (sscanf(line, "%lf %lf %d %d %d %n", &widget->x, &widget->line,
+               &widget->r, &widget->g, &widget->b, &offset) != 5)
+      return 0;
+  } else if (strcmp(type, "bouton") == 0) {
+    widget->type = UI_BUTTON;
+    if (sscanf(line, "%lf %lf %lf %d %d %d %31s %n", &widget->x,
+               &widget->line, &widget->size, &widget->r, &widget->g,
+               &widget->b, actionName, &offset) != 7 ||
+        !parseAction(actionName, &widget->action))
+      return 0;
+  } else {
+    return 0;
+  }
+
+  // Texte jusqu'à la fin de la ligne
+  line += offset;
+  size_t length = strcspn(line, "\r\n");
+  if (length == 0 || length >= UI_TEXT_SIZE)
+    return 0;
+  memcpy(widget->text, line, length);
+  widget->text[length] = '\0';
+
+  target->nbWidgets[menu]++;
+  target->nbFixed[menu]++;
+  return 1;
+}
+
+/**
+ * Indique si un menu a un bouton décrit dans le fichier pour une action.
+ */
+static bool hasFixedButton(const struct Ui *target, UiMenu menu,
+                           UiActionType type, int value) {
+  for (int i = 0; i < target->nbFixed[menu]; i++) {
+    const UiWidget *widget = &target->widgets[menu][i];
+    if (widget->type == UI_BUTTON && widget->action.type == type &&
+        widget->action.value == value)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Remplace les boutons générés des menus : un bouton par pack dont l'image
+ * est présente et par deck du dossier de données, sauf ceux qui ont déjà un
+ * bouton dans le fichier.
+ */
+static void generateChoices(struct Ui *target) {
+  for (int m = 0; m < UI_NB_MENUS; m++)
+    target->nbWidgets[m] = target->nbFixed[m];
+
+  for (int c = 0; c < target->nbChoices; c++) {
+    const UiChoices *choices = &target->choices[c];
+    int limit = choices->type == UI_ACTION_PACK ? packsCount() - 1
+                                                : DECKS_MAX_ICONS;
+    for (int value = 0, n = 0; value <= limit; value++) {
+      bool available = choices->type == UI_ACTION_PACK
+                           ? packsIconCount(value) > 0
+                           : packsDeckFile(value) != NULL;
+      if (!available ||
+          hasFixedButton(target, choices->menu, choices->type, value) ||
+          target->nbWidgets[choices->menu] == UI_MAX_WIDGETS)
+        continue;
+
+      UiWidget *widget =
+          &target->widgets[choices->menu][target->nbWidgets[choices->menu]++];
+      memset(widget, 0, sizeof(UiWidget));
+      widget->type = UI_BUTTON;
+      widget->x = choices->x + (n % choices->columns) * choices->dx;
+      widget->line = choices->line + (n / choices->columns) * choices->dline;
+      widget->size = choices->size;
+      widget->r = choices->r;
+      widget->g = choices->g;
+      widget->b = choices->b;
+      widget->action = (UiAction){choices->type, value};
+      if (choices->type == UI_ACTION_PACK)
+        snprintf(widget->text, UI_TEXT_SIZE, "%s", packsName(value));
+      else
+        snprintf(widget->text, UI_TEXT_SIZE, "%d", value);
+      n++;
+    }
+  }
+  // Positions à recalculer
+  target->scale = 0;
+}
+
+int uiUpdateChoices() {
+  static struct Ui previous;
+  previous = ui;
+  generateChoices(&ui);
+  for (int m = 0; m < UI_NB_MENUS; m++) {
+    if (ui.nbWidgets[m] != previous.nbWidgets[m])
+      return 1;
+    for (int i = ui.nbFixed[m]; i < ui.nbWidgets[m]; i++) {
+      const UiWidget *a = &ui.widgets[m][i], *b = &previous.widgets[m][i];
+      if (a->action.type != b->action.type ||
+          a->action.value != b->action.value || strcmp(a->text, b->text) != 0)
+        return 1;
+    }
+  }
+  return 0;
+}
+
+int uiLoad(const char *fileName) {
+  FILE *file = assetOpen(fileName, "r");
+  if (file == NULL) {
+    printf("dobble: Impossible d'ouvrir la description des menus '%s'.\n",
+           fileName);
+    return 0;
+  }
+  // Les menus courants restent utilisés si le fichier est incorrect
+  static struct Ui loaded;
+  memset(&loaded, 0, sizeof(loaded));
+
+  char line[256];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    const char *start = line + strspn(line, " \t");
+    if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0')
+      continue;
+    if (!parseWidget(&loaded, start)) {
+      printf("dobble: %s, ligne %d : élément de menu incorrect.\n", fileName,
+             lineNumber);
+      fclose(file);
+      return 0;
+    }
+  }
+  fclose(file);
+  generateChoices(&loaded);
+  ui = loaded;
+  return 1;
+}
+
+/**
+ * Calcule les positions et les zones de clic des éléments si l'échelle a
+ * changé depuis le dernier calcul.
+ */
+static void layout() {
+  if (ui.scale == WIN_SCALE)
+    return;
+  ui.scale = WIN_SCALE;
+  ui.border = (int)(WIN_SCALE * 5);
+  if (ui.border <= 0)
+    ui.border = 1;
+
+  for (int m = 0; m < UI_NB_MENUS; m++) {
+    for (int i = 0; i < ui.nbWidgets[m]; i++) {
+      UiWidget *widget = &ui.widgets[m][i];
+      widget->px = (int)(widget->x * WIN_WIDTH);
+      widget->py = (int)(widget->line * FONT_SIZE);
+      if (widget->type == UI_BUTTON) {
+        widget->py += CARD_RADIUS;
+        widget->radius = (int)((CARD_RADIUS + 5) * widget->size);
+        // La zone de clic est le disque dessiné, anneau compris
+        int hitRadius = widget->radius + ui.border / 2;
+        widget->hitRadius2 = hitRadius * hitRadius;
+      }
+    }
+  }
+}
+
+void uiDraw(UiMenu menu) {
+  layout();
+  for (int i = 0; i < ui.nbWidgets[menu]; i++) {
+    UiWidget *widget = &ui.widgets[menu][i];
+    if (widget->type == UI_TEXT)
+      drawText(widget->text, widget->px, widget->py, Center, Top, widget->r,
+               widget->g, widget->b);
+    else
+      drawButton(widget->px, widget->py, widget->radius, ui.border,
+                 widget->text, widget->r, widget->g, widget->b,
+                 1.1 * GENERALCOLOR);
+  }
+}
+
+UiAction uiHitTest(UiMenu menu, int x, int y) {
+  layout();
+  for (int i = 0; i < ui.nbWidgets[menu]; i++) {
+    UiWidget *widget = &ui.widgets[menu][i];
+    int dx = x - widget->px, dy = y - widget->py;
+    if (widget->type == UI_BUTTON && dx * dx + dy * dy <= widget->hitRadius2)
+      return widget->action;
+  }
+  return (UiAction){UI_ACTION_NONE, 0};
+}